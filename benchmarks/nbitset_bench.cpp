@@ -0,0 +1,60 @@
+// Copyright 2024 Pierre Talbot
+
+#include <benchmark/benchmark.h>
+#include "lala/universes/nbitset.hpp"
+
+using namespace lala;
+using namespace battery;
+
+template <size_t N>
+using NBit = NBitset<N, local_memory, unsigned long long>;
+
+/** The bitset containing one value out of three in `[0..N-3]`, hence the median is in the middle of the bitset. */
+template <size_t N>
+NBit<N> make_bitset() {
+  NBit<N> b(NBit<N>::bot());
+  for(int i = 0; i <= static_cast<int>(N) - 3; i += 3) {
+    b.join(NBit<N>(i));
+  }
+  return b;
+}
+
+/** The median computed by testing the bits one by one, as a baseline for `NBitset::median`. */
+template <size_t N>
+int median_bit_by_bit(const NBit<N>& b) {
+  const auto& bits = b.value();
+  int k = bits.count();
+  k = k == 1 ? 1 : k / 2;
+  for(int i = 0; i < static_cast<int>(N); ++i) {
+    if(bits.test(i) && --k == 0) {
+      return i - 1;
+    }
+  }
+  return static_cast<int>(N) - 2;
+}
+
+template <size_t N, bool word_scan>
+static void BM_Median(benchmark::State& state) {
+  NBit<N> b = make_bitset<N>();
+  for(auto _ : state) {
+    if constexpr(word_scan) {
+      benchmark::DoNotOptimize(b.median());
+    }
+    else {
+      benchmark::DoNotOptimize(median_bit_by_bit(b));
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * N);
+}
+
+#define LALA_MEDIAN_BENCHMARK(N) \
+  BENCHMARK_TEMPLATE(BM_Median, N, false); \
+  BENCHMARK_TEMPLATE(BM_Median, N, true);
+
+LALA_MEDIAN_BENCHMARK(64)
+LALA_MEDIAN_BENCHMARK(256)
+LALA_MEDIAN_BENCHMARK(1024)
+LALA_MEDIAN_BENCHMARK(4096)
+
+BENCHMARK_MAIN();
@@ -0,0 +1,147 @@
+// Copyright 2024 Pierre Talbot
+
+#include <benchmark/benchmark.h>
+#include <vector>
+#include "lala/vstore.hpp"
+#include "lala/interval.hpp"
+
+using namespace lala;
+using namespace battery;
+
+using zlb = local::ZLB;
+using Itv = Interval<zlb>;
+using FItv = Interval<local::FLB>;
+
+/** Compare the store-wide operations of `VStore` (using the kernels of `simd.hpp` when they apply) with the scalar loops over the variables.
+ * In the stores `a` and `b`, `a[i]` is a singleton and `b[i]` is larger than `a[i]`, hence the operations go over all the variables. */
+template <class U>
+struct StoreFixture {
+  using Store = VStore<U, standard_allocator>;
+  Store a;
+  Store b;
+  std::vector<U> va;
+  std::vector<U> vb;
+
+  StoreFixture(size_t n): a(UNTYPED, n), b(UNTYPED, n) {
+    for(size_t i = 0; i < n; ++i) {
+      U x(static_cast<int>(i % 1000));
+      a.embed(i, x);
+      b.embed(i, fjoin(x, U(static_cast<int>(i % 1000 + 1))));
+      va.push_back(a[i]);
+      vb.push_back(b[i]);
+    }
+  }
+};
+
+template <class U, bool vectorized>
+static void BM_Meet(benchmark::State& state) {
+  StoreFixture<U> f(state.range(0));
+  for(auto _ : state) {
+    bool has_changed = false;
+    if constexpr(vectorized) {
+      has_changed = f.a.meet(f.b);
+    }
+    else {
+      for(size_t i = 0; i < f.va.size(); ++i) {
+        has_changed |= f.va[i].meet(f.vb[i]);
+      }
+    }
+    benchmark::DoNotOptimize(has_changed);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <class U, bool vectorized>
+static void BM_Join(benchmark::State& state) {
+  StoreFixture<U> f(state.range(0));
+  for(auto _ : state) {
+    bool has_changed = false;
+    if constexpr(vectorized) {
+      has_changed = f.b.join(f.a);
+    }
+    else {
+      for(size_t i = 0; i < f.vb.size(); ++i) {
+        has_changed |= f.vb[i].join(f.va[i]);
+      }
+    }
+    benchmark::DoNotOptimize(has_changed);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <class U, bool vectorized>
+static void BM_Leq(benchmark::State& state) {
+  StoreFixture<U> f(state.range(0));
+  for(auto _ : state) {
+    bool leq = true;
+    if constexpr(vectorized) {
+      leq = f.a <= f.b;
+    }
+    else {
+      for(size_t i = 0; i < f.va.size(); ++i) {
+        leq &= f.va[i] <= f.vb[i];
+      }
+    }
+    benchmark::DoNotOptimize(leq);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <class U, bool vectorized>
+static void BM_Eq(benchmark::State& state) {
+  StoreFixture<U> f(state.range(0));
+  typename StoreFixture<U>::Store c(f.a);
+  std::vector<U> vc(f.va);
+  for(auto _ : state) {
+    bool eq = true;
+    if constexpr(vectorized) {
+      eq = f.a == c;
+    }
+    else {
+      for(size_t i = 0; i < f.va.size(); ++i) {
+        eq &= f.va[i] == vc[i];
+      }
+    }
+    benchmark::DoNotOptimize(eq);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <class U, bool vectorized>
+static void BM_IsExtractable(benchmark::State& state) {
+  StoreFixture<U> f(state.range(0));
+  for(auto _ : state) {
+    bool extractable = true;
+    if constexpr(vectorized) {
+      extractable = f.a.is_extractable(AtomicExtraction{});
+    }
+    else {
+      for(size_t i = 0; i < f.va.size(); ++i) {
+        extractable &= dual<typename U::UB>(f.va[i].lb()) == f.va[i].ub();
+      }
+    }
+    benchmark::DoNotOptimize(extractable);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+#define LALA_STORE_BENCHMARK(op, U) \
+  BENCHMARK_TEMPLATE(op, U, false)->RangeMultiplier(8)->Range(1 << 10, 1 << 20); \
+  BENCHMARK_TEMPLATE(op, U, true)->RangeMultiplier(8)->Range(1 << 10, 1 << 20);
+
+LALA_STORE_BENCHMARK(BM_Meet, zlb)
+LALA_STORE_BENCHMARK(BM_Meet, Itv)
+LALA_STORE_BENCHMARK(BM_Meet, FItv)
+LALA_STORE_BENCHMARK(BM_Join, zlb)
+LALA_STORE_BENCHMARK(BM_Join, Itv)
+LALA_STORE_BENCHMARK(BM_Join, FItv)
+LALA_STORE_BENCHMARK(BM_Leq, zlb)
+LALA_STORE_BENCHMARK(BM_Leq, Itv)
+LALA_STORE_BENCHMARK(BM_Leq, FItv)
+LALA_STORE_BENCHMARK(BM_Eq, zlb)
+LALA_STORE_BENCHMARK(BM_Eq, Itv)
+LALA_STORE_BENCHMARK(BM_Eq, FItv)
+LALA_STORE_BENCHMARK(BM_IsExtractable, Itv)
+LALA_STORE_BENCHMARK(BM_IsExtractable, FItv)
+
+BENCHMARK_MAIN();
@@ -0,0 +1,220 @@
+// Copyright 2024 Pierre Talbot
+
+#ifndef LALA_CORE_ARENA_ALLOCATOR_HPP
+#define LALA_CORE_ARENA_ALLOCATOR_HPP
+
+#include "battery/utility.hpp"
+#include "battery/allocator.hpp"
+#include <cstddef>
+
+namespace lala {
+
+/** A region (or "bump") allocator to construct many small objects that are all destroyed at the same time, e.g., the formulas, environment and tell elements built while interpreting a large model.
+ * The memory is requested to `Upstream` by chunks, and an allocation only moves a pointer in the current chunk.
+ * `deallocate` does nothing on an arena: the memory is given back to `Upstream` in one shot by `release()` or when the last copy of the allocator is destroyed.
+ *
+ * Copies of an allocator share the same arena, hence an arena can be passed by value as the `Allocator` parameter of `TFormula`, `VarEnv` or `tell_type`.
+ * Moving an allocator also shares its arena, hence the memory allocated by a moved-from allocator can still be deallocated through it.
+ * A default-constructed allocator has no arena and forwards to `Upstream()`, so containers created with `Allocator()` (e.g., temporaries) neither create an arena nor keep their memory until the end of the arena.
+ * The chunks of an arena start small and grow geometrically.
+ * The arena is not thread-safe and must not be shared among several threads. */
+template <class Upstream = battery::standard_allocator>
+class arena_allocator {
+public:
+  using upstream_type = Upstream;
+  constexpr static const size_t alignment = alignof(std::max_align_t);
+  constexpr static const size_t initial_chunk_size = 1024;
+
+private:
+  struct chunk {
+    chunk* next;
+    size_t capacity;
+  };
+
+  struct control_block {
+    Upstream upstream;
+    chunk* chunks;
+    unsigned char* current;
+    unsigned char* end;
+    size_t next_chunk_size;
+    size_t max_chunk_size;
+    size_t allocated_bytes;
+    size_t reserved_bytes;
+    size_t num_allocations;
+    size_t num_deallocations;
+    size_t counter;
+
+    CUDA control_block(size_t max_chunk_size, const Upstream& upstream)
+     : upstream(upstream), chunks(nullptr), current(nullptr), end(nullptr)
+     , next_chunk_size(battery::min(initial_chunk_size, max_chunk_size)), max_chunk_size(max_chunk_size)
+     , allocated_bytes(0), reserved_bytes(0), num_allocations(0), num_deallocations(0), counter(1)
+    {}
+  };
+
+  control_block* block;
+
+  CUDA static size_t align_up(size_t bytes) {
+    return (bytes + alignment - 1) & ~(alignment - 1);
+  }
+
+  CUDA constexpr static size_t header_size() {
+    return (sizeof(chunk) + alignment - 1) & ~(alignment - 1);
+  }
+
+  CUDA static control_block* make_block(size_t max_chunk_size, const Upstream& upstream) {
+    Upstream up(upstream);
+    control_block* b = static_cast<control_block*>(up.allocate(sizeof(control_block)));
+    new(b) control_block(max_chunk_size, upstream);
+    return b;
+  }
+
+  /** Request a new chunk with at least `bytes` available. */
+  CUDA NI void* allocate_chunk(size_t bytes) {
+    size_t capacity = battery::max(bytes, block->next_chunk_size);
+    chunk* c = static_cast<chunk*>(block->upstream.allocate(header_size() + capacity));
+    if(c == nullptr) {
+      return nullptr;
+    }
+    c->capacity = capacity;
+    block->reserved_bytes += capacity;
+    unsigned char* mem = reinterpret_cast<unsigned char*>(c) + header_size();
+    // Large allocations are served by a dedicated chunk, and we keep allocating in the current chunk.
+    if(block->chunks != nullptr && capacity > block->next_chunk_size) {
+      c->next = block->chunks->next;
+      block->chunks->next = c;
+    }
+    else {
+      c->next = block->chunks;
+      block->chunks = c;
+      block->current = mem + bytes;
+      block->end = mem + capacity;
+      block->next_chunk_size = battery::min(block->next_chunk_size * 2, block->max_chunk_size);
+    }
+    return mem;
+  }
+
+  CUDA void release_chunks() {
+    chunk* c = block->chunks;
+    while(c != nullptr) {
+      chunk* next = c->next;
+      block->upstream.deallocate(c);
+      c = next;
+    }
+    block->chunks = nullptr;
+    block->current = nullptr;
+    block->end = nullptr;
+    block->reserved_bytes = 0;
+  }
+
+  CUDA void drop() {
+    if(block != nullptr && --block->counter == 0) {
+      release_chunks();
+      Upstream upstream(block->upstream);
+      block->~control_block();
+      upstream.deallocate(block);
+    }
+    block = nullptr;
+  }
+
+public:
+  /** Create a new arena with chunks of `chunk_size` bytes (except for larger allocations). */
+  CUDA explicit arena_allocator(size_t chunk_size, const Upstream& upstream = Upstream())
+   : block(make_block(chunk_size, upstream))
+  {}
+
+  /** An allocator without arena, which forwards the allocations to `Upstream()`. */
+  CUDA arena_allocator(): block(nullptr) {}
+
+  CUDA arena_allocator(const arena_allocator& other): block(other.block) {
+    if(block != nullptr) {
+      block->counter++;
+    }
+  }
+
+  CUDA arena_allocator& operator=(const arena_allocator& other) {
+    if(block != other.block) {
+      drop();
+      block = other.block;
+      if(block != nullptr) {
+        block->counter++;
+      }
+    }
+    return *this;
+  }
+
+  CUDA ~arena_allocator() {
+    drop();
+  }
+
+  CUDA NI void* allocate(size_t bytes) {
+    if(bytes == 0) {
+      return nullptr;
+    }
+    if(block == nullptr) {
+      return Upstream().allocate(bytes);
+    }
+    bytes = align_up(bytes);
+    block->num_allocations++;
+    block->allocated_bytes += bytes;
+    if(block->end - block->current >= static_cast<ptrdiff_t>(bytes)) {
+      void* mem = block->current;
+      block->current += bytes;
+      return mem;
+    }
+    return allocate_chunk(bytes);
+  }
+
+  /** The memory of an arena is only reclaimed by `release()`. */
+  CUDA void deallocate(void* data) {
+    if(block == nullptr) {
+      Upstream().deallocate(data);
+    }
+    else if(data != nullptr) {
+      block->num_deallocations++;
+    }
+  }
+
+  /** Give back all the memory of the arena to the upstream allocator.
+   * \pre No object allocated in this arena must be alive (or used again). */
+  CUDA void release() {
+    if(block != nullptr) {
+      release_chunks();
+      block->next_chunk_size = battery::min(initial_chunk_size, block->max_chunk_size);
+    }
+  }
+
+  /** The number of bytes allocated (after alignment) since the creation of the arena (`0` without arena). */
+  CUDA size_t allocated_bytes() const {
+    return block == nullptr ? 0 : block->allocated_bytes;
+  }
+
+  /** The number of bytes currently obtained from the upstream allocator (without the chunk headers). */
+  CUDA size_t reserved_bytes() const {
+    return block == nullptr ? 0 : block->reserved_bytes;
+  }
+
+  CUDA size_t num_allocations() const {
+    return block == nullptr ? 0 : block->num_allocations;
+  }
+
+  CUDA size_t num_deallocations() const {
+    return block == nullptr ? 0 : block->num_deallocations;
+  }
+
+  CUDA bool operator==(const arena_allocator& other) const {
+    return block == other.block;
+  }
+
+  CUDA bool operator!=(const arena_allocator& other) const {
+    return block != other.block;
+  }
+};
+
+} // namespace lala
+
+template <class Upstream>
+CUDA inline void* operator new(size_t bytes, lala::arena_allocator<Upstream>& p) {
+  return p.allocate(bytes);
+}
+
+#endif
@@ -0,0 +1,271 @@
+// Copyright 2024 Pierre Talbot
+
+#ifndef LALA_CORE_ATOMIC_INTERVAL_HPP
+#define LALA_CORE_ATOMIC_INTERVAL_HPP
+
+#include "interval.hpp"
+
+#ifndef __CUDA_ARCH__
+  #include <atomic>
+#endif
+
+namespace lala {
+
+/** An interval of 32-bit integers `Interval<ZLB<int>>` packing both bounds in a single 64-bit word.
+ * With `atomic_memory`, the bounds of an `Interval` are two separate atomics, hence a thread reading an interval while another thread narrows it can observe the lower bound of the new interval and the upper bound of the old one.
+ * Here, the word is read with a single load and `meet` is a compare-and-swap loop recomputing the meet from the last value read, so:
+ *   - Every read (`lb`, `ub`, `is_bot`, `project`, ...) observes an interval that was stored at some point.
+ *   - The interval only ever narrows when several threads call `meet` concurrently, and no update is lost.
+ *
+ * It is meant to be used as the universe of a `VStore` shared by several threads (CPU or GPU), in place of `Interval<ZLB<int, atomic_memory<...>>>`.
+ * Its local type is `Interval<local::ZLB>`, to which it is implicitly converted for all the operations not provided here (interpretation, arithmetic, ...).
+ * `join` and the assignment are not extensive and must be used in a sequential context, as for `Interval`. */
+template <class Mem>
+class AtomicInterval32 {
+public:
+  using local_type = Interval<local::ZLB>;
+  using LB = local::ZLB;
+  using UB = local::ZUB;
+  using memory_type = Mem;
+  using this_type = AtomicInterval32<Mem>;
+  using word_type = unsigned long long;
+
+  template <class M>
+  friend class AtomicInterval32;
+
+  constexpr static const bool is_abstract_universe = true;
+  constexpr static const bool sequential = Mem::sequential;
+  constexpr static const bool is_totally_ordered = false;
+  constexpr static const bool preserve_top = local_type::preserve_top;
+  constexpr static const bool preserve_bot = local_type::preserve_bot;
+  constexpr static const bool preserve_meet = local_type::preserve_meet;
+  constexpr static const bool preserve_join = local_type::preserve_join;
+  constexpr static const bool injective_concretization = local_type::injective_concretization;
+  constexpr static const bool preserve_concrete_covers = local_type::preserve_concrete_covers;
+  constexpr static const bool complemented = false;
+  constexpr static const bool is_arithmetic = local_type::is_arithmetic;
+  constexpr static const char* name = "AtomicInterval32";
+
+private:
+  static_assert(sizeof(typename LB::value_type) == 4 && sizeof(typename UB::value_type) == 4, "AtomicInterval32 expects 32-bit bounds.");
+
+  /** The lower bound is stored in the 32 most significant bits, and the upper bound in the 32 least significant bits. */
+  alignas(8) word_type word;
+
+  CUDA INLINE static word_type pack(const local_type& itv) {
+    return (static_cast<word_type>(static_cast<unsigned int>(itv.lb().value())) << 32)
+      | static_cast<word_type>(static_cast<unsigned int>(itv.ub().value()));
+  }
+
+  CUDA INLINE static local_type unpack(word_type w) {
+    return local_type(
+      LB(static_cast<int>(static_cast<unsigned int>(w >> 32))),
+      UB(static_cast<int>(static_cast<unsigned int>(w))));
+  }
+
+  CUDA INLINE word_type load() const {
+    if constexpr(sequential) {
+      return word;
+    }
+    else {
+    #ifdef __CUDA_ARCH__
+      return *((volatile word_type*)&word);
+    #else
+      return std::atomic_ref<word_type>(const_cast<word_type&>(word)).load(std::memory_order_relaxed);
+    #endif
+    }
+  }
+
+  CUDA INLINE void store(word_type w) {
+    if constexpr(sequential) {
+      word = w;
+    }
+    else {
+    #ifdef __CUDA_ARCH__
+      *((volatile word_type*)&word) = w;
+    #else
+      std::atomic_ref<word_type>(word).store(w, std::memory_order_relaxed);
+    #endif
+    }
+  }
+
+  /** Replace `expected` by `desired` if the word is still equal to `expected`, otherwise `expected` is updated with the current word. */
+  CUDA INLINE bool cas(word_type& expected, word_type desired) {
+    if constexpr(sequential) {
+      word = desired;
+      return true;
+    }
+    else {
+    #ifdef __CUDA_ARCH__
+      word_type old = atomicCAS(&word, expected, desired);
+      bool success = old == expected;
+      expected = old;
+      return success;
+    #else
+      return std::atomic_ref<word_type>(word).compare_exchange_weak(expected, desired, std::memory_order_relaxed);
+    #endif
+    }
+  }
+
+  /** Apply `op` on the current interval until the result is stored, or `op` returns `false` (no change). */
+  template <class Op>
+  CUDA INLINE bool update(Op&& op) {
+    word_type expected = load();
+    while(true) {
+      local_type itv = unpack(expected);
+      if(!op(itv)) {
+        return false;
+      }
+      if(cas(expected, pack(itv))) {
+        return true;
+      }
+    }
+  }
+
+public:
+  /** Initialize the interval to top. */
+  CUDA AtomicInterval32(): word(pack(local_type::top())) {}
+  CUDA AtomicInterval32(typename LB::value_type x): word(pack(local_type(x))) {}
+  CUDA AtomicInterval32(const LB& lb, const UB& ub): word(pack(local_type(lb, ub))) {}
+  CUDA AtomicInterval32(const this_type& other): word(other.load()) {}
+
+  template <class M>
+  CUDA AtomicInterval32(const AtomicInterval32<M>& other): word(other.load()) {}
+
+  template <class A>
+  CUDA AtomicInterval32(const Interval<A>& other): word(pack(local_type(other))) {}
+
+  /** The assignment operator can only be used in a sequential context.
+   * It is monotone but not extensive. */
+  template <class A>
+  CUDA this_type& operator=(const Interval<A>& other) {
+    store(pack(local_type(other)));
+    return *this;
+  }
+
+  template <class M>
+  CUDA this_type& operator=(const AtomicInterval32<M>& other) {
+    store(other.load());
+    return *this;
+  }
+
+  CUDA this_type& operator=(const this_type& other) {
+    store(other.load());
+    return *this;
+  }
+
+  /** A consistent copy of the interval. */
+  CUDA local_type value() const {
+    return unpack(load());
+  }
+
+  CUDA operator local_type() const {
+    return value();
+  }
+
+  CUDA static local_type bot() { return local_type::bot(); }
+  CUDA static local_type top() { return local_type::top(); }
+  CUDA local::B is_bot() const { return value().is_bot(); }
+  CUDA local::B is_top() const { return value().is_top(); }
+
+  /** The bounds are returned by copy: reading both bounds with `lb()` and `ub()` is not atomic, use `value()` instead. */
+  CUDA LB lb() const { return value().lb(); }
+  CUDA UB ub() const { return value().ub(); }
+
+  CUDA void join_top() {
+    store(pack(local_type::top()));
+  }
+
+  CUDA void meet_bot() {
+    store(pack(local_type::bot()));
+  }
+
+  template <class A>
+  CUDA bool join(const Interval<A>& other) {
+    return update([&](local_type& itv) { return itv.join(other); });
+  }
+
+  template <class M>
+  CUDA bool join(const AtomicInterval32<M>& other) {
+    return join(other.value());
+  }
+
+  /** Narrow the interval with a compare-and-swap loop, it is safe to call it concurrently with other `meet`. */
+  template <class A>
+  CUDA bool meet(const Interval<A>& other) {
+    return update([&](local_type& itv) { return itv.meet(other); });
+  }
+
+  template <class M>
+  CUDA bool meet(const AtomicInterval32<M>& other) {
+    return meet(other.value());
+  }
+
+  template <class A>
+  CUDA bool meet_lb(const A& lb) {
+    return update([&](local_type& itv) { return itv.meet_lb(lb); });
+  }
+
+  template <class A>
+  CUDA bool meet_ub(const A& ub) {
+    return update([&](local_type& itv) { return itv.meet_ub(ub); });
+  }
+
+  template <class A>
+  CUDA bool extract(Interval<A>& ua) const {
+    return value().extract(ua);
+  }
+
+  template<class Env, class Allocator = typename Env::allocator_type>
+  CUDA TFormula<Allocator> deinterpret(AVar x, const Env& env, const Allocator& allocator = Allocator()) const {
+    return value().deinterpret(x, env, allocator);
+  }
+
+  template<class F>
+  CUDA F deinterpret() const {
+    return value().template deinterpret<F>();
+  }
+
+  CUDA void print() const {
+    value().print();
+  }
+};
+
+// Lattice operations, computed on consistent copies of the intervals.
+
+template<class M, class N>
+CUDA bool operator<=(const AtomicInterval32<M>& a, const AtomicInterval32<N>& b) { return a.value() <= b.value(); }
+template<class M, class K>
+CUDA bool operator<=(const AtomicInterval32<M>& a, const Interval<K>& b) { return a.value() <= b; }
+template<class L, class N>
+CUDA bool operator<=(const Interval<L>& a, const AtomicInterval32<N>& b) { return a <= b.value(); }
+
+template<class M, class N>
+CUDA bool operator<(const AtomicInterval32<M>& a, const AtomicInterval32<N>& b) { return a.value() < b.value(); }
+template<class M, class K>
+CUDA bool operator<(const AtomicInterval32<M>& a, const Interval<K>& b) { return a.value() < b; }
+template<class L, class N>
+CUDA bool operator<(const Interval<L>& a, const AtomicInterval32<N>& b) { return a < b.value(); }
+
+template<class M, class N>
+CUDA bool operator==(const AtomicInterval32<M>& a, const AtomicInterval32<N>& b) { return a.value() == b.value(); }
+template<class M, class K>
+CUDA bool operator==(const AtomicInterval32<M>& a, const Interval<K>& b) { return a.value() == b; }
+template<class L, class N>
+CUDA bool operator==(const Interval<L>& a, const AtomicInterval32<N>& b) { return a == b.value(); }
+
+template<class M, class N>
+CUDA bool operator!=(const AtomicInterval32<M>& a, const AtomicInterval32<N>& b) { return a.value() != b.value(); }
+template<class M, class K>
+CUDA bool operator!=(const AtomicInterval32<M>& a, const Interval<K>& b) { return a.value() != b; }
+template<class L, class N>
+CUDA bool operator!=(const Interval<L>& a, const AtomicInterval32<N>& b) { return a != b.value(); }
+
+template<class M>
+std::ostream& operator<<(std::ostream &s, const AtomicInterval32<M> &itv) {
+  return s << itv.value();
+}
+
+} // namespace lala
+
+#endif
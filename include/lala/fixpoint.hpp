@@ -7,6 +7,15 @@
 #include "b.hpp"
 #include "battery/memory.hpp"
 #include "battery/vector.hpp"
+#include "battery/dynamic_bitset.hpp"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <barrier>
+#include <atomic>
+#include <functional>
+#include <vector>
 
 #ifdef __CUDACC__
   #include <cooperative_groups.h>
@@ -51,6 +60,343 @@ public:
   }
 };
 
+/** An event-driven fixpoint computation: instead of executing all the deduction operations at each iteration, only the deductions that might be affected by a previous change are scheduled.
+ * The abstract domain can provide a hook `a.deduction_dependencies(i)` returning the sequence of variables (either integers or `AVar`) read or written by the deduction `i`, with `size()` and `operator[]`.
+ * When the deduction `i` changes `a`, every deduction sharing a variable with `i` is scheduled again, including `i` itself in case it is not idempotent.
+ * Without this hook, this strategy falls back to `GaussSeidelIteration`.
+ *
+ * The subscription index (from variables to deductions) is built on the first call to `iterate` or `fixpoint`, and rebuilt when the number of deductions changes (or by calling `subscribe` explicitly).
+ * When `fixpoint` is called while no deduction is scheduled, all deductions are scheduled; in a search tree, it is sufficient to schedule the deductions watching the variables modified by a branching decision with `schedule_var` before computing the fixpoint.
+ * An iteration executes the deductions scheduled at the beginning of the iteration, in FIFO order. */
+template <class Allocator = battery::standard_allocator>
+class EventDrivenIteration {
+public:
+  using allocator_type = Allocator;
+  using this_type = EventDrivenIteration<Allocator>;
+
+private:
+  template <class T> using vector_type = battery::vector<T, allocator_type>;
+
+  /** `watchers[x]` is the list of deductions depending on the variable `x`. */
+  vector_type<vector_type<int>> watchers;
+  /** `deps[i]` is the list of variables the deduction `i` depends on. */
+  vector_type<vector_type<int>> deps;
+  /** The worklist is a circular buffer of size `num_deductions`, since each deduction is scheduled at most once thanks to `scheduled`. */
+  vector_type<int> worklist;
+  battery::dynamic_bitset<battery::local_memory, allocator_type> scheduled;
+  size_t head;
+  size_t queued;
+
+  template <class A>
+  static constexpr bool has_dependencies = requires(A& a, size_t i) { a.deduction_dependencies(i); };
+
+  template <class X>
+  CUDA static int var_index(const X& x) {
+    if constexpr(std::is_same_v<X, AVar>) {
+      return x.vid();
+    }
+    else {
+      return static_cast<int>(x);
+    }
+  }
+
+  CUDA void push(int i) {
+    if(!scheduled.test(i)) {
+      scheduled.set(i, true);
+      worklist[(head + queued) % worklist.size()] = i;
+      ++queued;
+    }
+  }
+
+  CUDA int pop() {
+    int i = worklist[head];
+    head = (head + 1) % worklist.size();
+    --queued;
+    scheduled.set(i, false);
+    return i;
+  }
+
+  template <class A>
+  CUDA void subscribe_if_needed(A& a) {
+    if(deps.size() != a.num_deductions()) {
+      subscribe(a);
+    }
+  }
+
+public:
+  CUDA EventDrivenIteration(const allocator_type& alloc = allocator_type())
+   : watchers(alloc), deps(alloc), worklist(alloc), scheduled(alloc), head(0), queued(0)
+  {}
+
+  CUDA void barrier() {}
+
+  /** Build the subscription index of `a` and schedule all the deductions. */
+  template <class A>
+  CUDA void subscribe(A& a) {
+    if constexpr(has_dependencies<A>) {
+      size_t n = a.num_deductions();
+      deps = vector_type<vector_type<int>>(n, vector_type<int>(deps.get_allocator()), deps.get_allocator());
+      size_t num_vars = 0;
+      for(size_t i = 0; i < n; ++i) {
+        const auto& ds = a.deduction_dependencies(i);
+        for(size_t j = 0; j < ds.size(); ++j) {
+          int x = var_index(ds[j]);
+          deps[i].push_back(x);
+          num_vars = battery::max(num_vars, static_cast<size_t>(x) + 1);
+        }
+      }
+      watchers = vector_type<vector_type<int>>(num_vars, vector_type<int>(watchers.get_allocator()), watchers.get_allocator());
+      for(size_t i = 0; i < n; ++i) {
+        for(size_t j = 0; j < deps[i].size(); ++j) {
+          watchers[deps[i][j]].push_back(i);
+        }
+      }
+      worklist.resize(n);
+      scheduled.resize(n);
+      scheduled.reset();
+      head = 0;
+      queued = 0;
+      schedule_all();
+    }
+  }
+
+  /** Schedule all the deductions. */
+  CUDA void schedule_all() {
+    for(size_t i = 0; i < worklist.size(); ++i) {
+      push(i);
+    }
+  }
+
+  /** Schedule all the deductions depending on the variable `x`. */
+  CUDA void schedule_var(int x) {
+    if(x >= 0 && static_cast<size_t>(x) < watchers.size()) {
+      for(size_t j = 0; j < watchers[x].size(); ++j) {
+        push(watchers[x][j]);
+      }
+    }
+  }
+
+  CUDA void schedule_var(AVar x) {
+    schedule_var(x.vid());
+  }
+
+  /** Number of deductions currently scheduled. */
+  CUDA size_t num_scheduled() const {
+    return queued;
+  }
+
+  /** Execute the deductions currently scheduled, and schedule the deductions depending on the ones that changed `a`. */
+  template <class A>
+  CUDA local::B iterate(A& a) {
+    if constexpr(has_dependencies<A>) {
+      subscribe_if_needed(a);
+      bool has_changed = false;
+      for(size_t k = queued; k > 0 && !a.is_bot(); --k) {
+        int i = pop();
+        if(a.deduce(i)) {
+          has_changed = true;
+          for(size_t j = 0; j < deps[i].size(); ++j) {
+            schedule_var(deps[i][j]);
+          }
+        }
+      }
+      return has_changed;
+    }
+    else {
+      return GaussSeidelIteration{}.iterate(a);
+    }
+  }
+
+  template <class A>
+  CUDA size_t fixpoint(A& a, local::B& has_changed) {
+    if constexpr(has_dependencies<A>) {
+      subscribe_if_needed(a);
+      if(queued == 0) {
+        schedule_all();
+      }
+      size_t iterations = 0;
+      while(queued > 0 && !a.is_bot()) {
+        has_changed.join(iterate(a));
+        iterations++;
+      }
+      return iterations;
+    }
+    else {
+      return GaussSeidelIteration{}.fixpoint(a, has_changed);
+    }
+  }
+
+  template <class A>
+  CUDA local::B fixpoint(A& a) {
+    local::B has_changed(false);
+    fixpoint(a, has_changed);
+    return has_changed;
+  }
+};
+
+/** The CPU counterpart of `AsynchronousIterationGPU`: the deduction operations are composed by parallel composition \f$ f = f_1 \| \ldots \| f_n \f$ and executed by a pool of `std::thread`.
+ * The workers are created once in the constructor and reused by each call to `iterate` and `fixpoint`, which is important when the fixpoint is computed at each node of a search tree.
+ * The calling thread takes part in the computation as the worker `0`.
+ * The abstract element must be safe to be accessed concurrently by several threads, e.g., a `VStore` over universes built on `battery::atomic_memory`.
+ * As in `AsynchronousIterationGPU`, the underlying lattice must provide `a.deduce(int)`, `a.num_deductions()` and `a.is_bot()`. */
+class AsynchronousIterationCPU {
+  size_t num_workers;
+  std::vector<std::thread> pool;
+  std::mutex mutex;
+  std::condition_variable wakeup;
+  std::condition_variable done;
+  std::function<void(size_t)> task;
+  size_t generation;
+  size_t running;
+  bool shutdown;
+
+  void worker_loop(size_t tid) {
+    size_t seen = 0;
+    while(true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wakeup.wait(lock, [&]{ return shutdown || generation != seen; });
+        if(shutdown) {
+          return;
+        }
+        seen = generation;
+      }
+      task(tid);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(--running == 0) {
+          done.notify_one();
+        }
+      }
+    }
+  }
+
+  /** Execute `fun(tid)` on each worker `tid` and wait until all of them terminated. */
+  template <class Fun>
+  void run(Fun& fun) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      task = std::ref(fun);
+      running = pool.size();
+      ++generation;
+    }
+    wakeup.notify_all();
+    fun(0);
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&]{ return running == 0; });
+  }
+
+  /** The deductions `[from, to)` executed by the worker `tid` out of `workers`. */
+  static void range_of(size_t tid, size_t workers, size_t n, size_t& from, size_t& to) {
+    size_t chunk = n / workers;
+    size_t rem = n % workers;
+    from = tid * chunk + battery::min(tid, rem);
+    to = from + chunk + (tid < rem ? 1 : 0);
+  }
+
+  template <class A>
+  static bool deduce_range(A& a, size_t from, size_t to) {
+    bool has_changed = false;
+    for(size_t i = from; i < to; ++i) {
+      has_changed |= a.deduce(i);
+    }
+    return has_changed;
+  }
+
+public:
+  /** \param num_workers The number of threads deducing in parallel (including the calling thread), defaults to the number of hardware threads. */
+  AsynchronousIterationCPU(size_t num_workers = std::thread::hardware_concurrency())
+   : num_workers(battery::max(num_workers, size_t{1})), generation(0), running(0), shutdown(false)
+  {
+    for(size_t i = 1; i < this->num_workers; ++i) {
+      pool.emplace_back([this, i](){ worker_loop(i); });
+    }
+  }
+
+  AsynchronousIterationCPU(const AsynchronousIterationCPU&) = delete;
+  AsynchronousIterationCPU& operator=(const AsynchronousIterationCPU&) = delete;
+
+  ~AsynchronousIterationCPU() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      shutdown = true;
+    }
+    wakeup.notify_all();
+    for(auto& t : pool) {
+      t.join();
+    }
+  }
+
+  size_t workers() const {
+    return num_workers;
+  }
+
+  /** The workers are synchronized internally at the end of each iteration, hence this is a no-op provided for compatibility with the other strategies. */
+  void barrier() {}
+
+  /** Execute once all the deduction operations in parallel. */
+  template <class A>
+  local::B iterate(A& a) {
+    size_t n = a.num_deductions();
+    std::atomic<bool> has_changed(false);
+    auto iteration = [&](size_t tid) {
+      size_t from, to;
+      range_of(tid, num_workers, n, from, to);
+      if(deduce_range(a, from, to)) {
+        has_changed.store(true, std::memory_order_relaxed);
+      }
+    };
+    run(iteration);
+    return has_changed.load();
+  }
+
+  /** Compute the fixpoint of `a`, or stop earlier if `*stop` becomes `true`.
+   * The workers iterate without being woken up between two iterations, they only meet on a barrier to check if the fixpoint is reached.
+   * \return The number of iterations. */
+  template <class A, class M>
+  size_t fixpoint(A& a, B<M>& has_changed, volatile bool* stop) {
+    size_t n = a.num_deductions();
+    std::atomic<bool> changed(false);
+    bool any_change = false;
+    bool keep_going = !a.is_bot() && !*stop;
+    size_t iterations = 0;
+    // Executed by a single thread once all workers reached the barrier.
+    auto end_of_iteration = [&]() noexcept {
+      ++iterations;
+      bool c = changed.exchange(false);
+      any_change |= c;
+      keep_going = c && !a.is_bot() && !*stop;
+    };
+    std::barrier sync(num_workers, end_of_iteration);
+    auto iterations_loop = [&](size_t tid) {
+      size_t from, to;
+      range_of(tid, num_workers, n, from, to);
+      while(keep_going) {
+        if(deduce_range(a, from, to)) {
+          changed.store(true, std::memory_order_relaxed);
+        }
+        sync.arrive_and_wait();
+      }
+    };
+    run(iterations_loop);
+    has_changed.join(any_change);
+    return iterations;
+  }
+
+  template <class A, class M>
+  size_t fixpoint(A& a, B<M>& has_changed) {
+    bool stop = false;
+    return fixpoint(a, has_changed, &stop);
+  }
+
+  template <class A>
+  local::B fixpoint(A& a) {
+    local::B has_changed(false);
+    fixpoint(a, has_changed);
+    return has_changed;
+  }
+};
+
 #ifdef __CUDACC__
 
 /** A simple form of fixpoint computation based on Kleene fixpoint.
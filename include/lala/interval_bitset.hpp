@@ -0,0 +1,369 @@
+// Copyright 2024 Pierre Talbot
+
+#ifndef LALA_CORE_INTERVAL_BITSET_HPP
+#define LALA_CORE_INTERVAL_BITSET_HPP
+
+#include "interval.hpp"
+#include "universes/nbitset.hpp"
+
+namespace lala {
+
+/** The reduced product of an interval and a bitset of `N` bits.
+ * Concretization function: \f$ \gamma((i, b)) = \gamma_{Interval}(i) \cap \gamma_{NBitset}(b) \f$, as in `CartesianProduct<Interval, NBitset>`.
+ * In addition, the method `reduce` tightens each component with the other after each operation (e.g., `meet` or `project`):
+ *   * The bitset is restricted to the bounds of the interval, which only takes a bitwise conjunction with a range of bits.
+ *   * The bounds of the interval are tightened to the first and last values of the bitset, which are found by counting the leading and trailing zeros of the words of the bitset.
+ * Hence, a hole at a bound of the bitset is immediately seen by the interval (and the other way around), instead of requiring another propagation round.
+ * One reduction is enough to reach the fixpoint: the restricted bitset is included in the tightened interval.
+ *
+ * The interpretation dispatches the bound constraints (`x <= k`, `x < k`, `x >= k`, `x > k`) to the interval, and `x != k` and `x in S` to the bitset, before the reduction.
+ * The other formulas (e.g., `x == k` or existentials) are interpreted in both components. */
+template <size_t N, class Mem, class T = unsigned long long>
+class IntervalBitset {
+public:
+  using itv_type = Interval<ZLB<int, Mem>>;
+  using bitset_type = NBitset<N, Mem, T>;
+  using CP = CartesianProduct<itv_type, bitset_type>;
+  using this_type = IntervalBitset<N, Mem, T>;
+  template <class M> using this_type2 = IntervalBitset<N, M, T>;
+  using local_type = this_type2<battery::local_memory>;
+  using LB = local::ZLB;
+  using UB = local::ZUB;
+  using value_type = typename CP::value_type;
+  using memory_type = Mem;
+
+  template <size_t N2, class Mem2, class T2>
+  friend class IntervalBitset;
+
+  constexpr static const bool is_abstract_universe = true;
+  constexpr static const bool sequential = CP::sequential;
+  constexpr static const bool is_totally_ordered = false;
+  constexpr static const bool preserve_top = true;
+  constexpr static const bool preserve_bot = true;
+  constexpr static const bool preserve_meet = true;
+  constexpr static const bool preserve_join = false;
+  constexpr static const bool injective_concretization = false;
+  constexpr static const bool preserve_concrete_covers = false;
+  constexpr static const bool complemented = false;
+  constexpr static const bool is_arithmetic = true;
+  constexpr static const char* name = "IntervalBitset";
+
+private:
+  using bitset_local = typename bitset_type::local_type;
+  CP cp;
+  CUDA constexpr IntervalBitset(const CP& cp): cp(cp) {}
+
+  CUDA constexpr itv_type& itv() { return cp.template project<0>(); }
+  CUDA constexpr bitset_type& bits() { return cp.template project<1>(); }
+
+public:
+  /** Initialize to top. */
+  CUDA constexpr IntervalBitset() {}
+  /** Initialize to the singleton \f$ \{x\} \f$. */
+  CUDA constexpr IntervalBitset(int x): cp(itv_type(x), bitset_type(x)) {}
+  /** Initialize to the set \f$ \{lb..ub\} \f$. */
+  CUDA constexpr IntervalBitset(int lb, int ub):
+    cp(itv_type(typename itv_type::LB(lb), typename itv_type::UB(ub)), bitset_type(lb, ub)) {}
+  /** The product of `itv` and `bits`, which is reduced. */
+  template <class A, class M>
+  CUDA constexpr IntervalBitset(const Interval<A>& itv, const NBitset<N, M, T>& bits): cp(itv, bits) {
+    reduce();
+  }
+
+  template <class M>
+  CUDA constexpr IntervalBitset(const this_type2<M>& other): cp(other.cp) {}
+
+  template <class M>
+  CUDA constexpr IntervalBitset(this_type2<M>&& other): cp(std::move(other.cp)) {}
+
+  /** The assignment operator can only be used in a sequential context.
+   * It is monotone but not extensive. */
+  template <class M>
+  CUDA constexpr this_type& operator=(const this_type2<M>& other) {
+    cp = other.cp;
+    return *this;
+  }
+
+  CUDA constexpr this_type& operator=(const this_type& other) {
+    cp = other.cp;
+    return *this;
+  }
+
+  /** Pre-interpreted formula `x == 0`. */
+  CUDA constexpr static local_type eq_zero() { return local_type(0); }
+  /** Pre-interpreted formula `x == 1`. */
+  CUDA constexpr static local_type eq_one() { return local_type(1); }
+
+  CUDA constexpr static local_type bot() { return local_type(local_type::CP::bot()); }
+  CUDA constexpr static local_type top() { return local_type(local_type::CP::top()); }
+  CUDA constexpr local::B is_bot() const { return cp.is_bot(); }
+  CUDA constexpr local::B is_top() const { return cp.is_top(); }
+  CUDA constexpr const CP& as_product() const { return cp; }
+  CUDA constexpr value_type value() const { return cp.value(); }
+
+  CUDA constexpr const itv_type& interval() const { return cp.template project<0>(); }
+  CUDA constexpr const bitset_type& bitset() const { return cp.template project<1>(); }
+
+  /** Tighten the bitset with the bounds of the interval, and then the interval with the first and last values of the bitset.
+   * \return `true` if one of the components has changed. */
+  CUDA constexpr bool reduce() {
+    if(itv().is_bot() || bits().is_bot()) {
+      bool has_changed = !itv().is_bot() || !bits().is_bot();
+      meet_bot();
+      return has_changed;
+    }
+    bool has_changed = false;
+    if(!itv().lb().is_top()) {
+      has_changed |= bits().meet_lb(itv().lb());
+    }
+    if(!itv().ub().is_top()) {
+      has_changed |= bits().meet_ub(itv().ub());
+    }
+    has_changed |= itv().meet_lb(bits().lb());
+    has_changed |= itv().meet_ub(bits().ub());
+    return has_changed;
+  }
+
+private:
+  enum class component { interval, bitset, both };
+
+  template <class F>
+  CUDA static component component_of(const F& f) {
+    if(f.is_binary() && f.seq(0).is_variable() && f.seq(1).is_constant()) {
+      switch(f.sig()) {
+        case LEQ:
+        case LT:
+        case GEQ:
+        case GT: return component::interval;
+        case NEQ:
+        case IN: return component::bitset;
+        default: break;
+      }
+    }
+    return component::both;
+  }
+
+public:
+  template<IKind kind, bool diagnose = false, class F, class Env, class M>
+  CUDA NI static bool interpret(const F& f, const Env& env, this_type2<M>& k, IDiagnostics& diagnostics) {
+    bool res = false;
+    switch(component_of(f)) {
+      case component::interval:
+        res = itv_type::template interpret<kind, diagnose>(f, env, k.itv(), diagnostics);
+        break;
+      case component::bitset:
+        res = bitset_type::template interpret<kind, diagnose>(f, env, k.bits(), diagnostics);
+        break;
+      default:
+        res = CP::template interpret<kind, diagnose>(f, env, k.cp, diagnostics);
+    }
+    if(res) {
+      k.reduce();
+    }
+    return res;
+  }
+
+  template<bool diagnose = false, class F, class Env, class M>
+  CUDA NI static bool interpret_tell(const F& f, const Env& env, this_type2<M>& k, IDiagnostics& diagnostics) {
+    return interpret<IKind::TELL, diagnose>(f, env, k, diagnostics);
+  }
+
+  template<bool diagnose = false, class F, class Env, class M>
+  CUDA NI static bool interpret_ask(const F& f, const Env& env, this_type2<M>& k, IDiagnostics& diagnostics) {
+    return interpret<IKind::ASK, diagnose>(f, env, k, diagnostics);
+  }
+
+  /** The bounds of the interval, which are the tightest bounds of the set since the product is reduced. */
+  CUDA constexpr LB lb() const { return LB(interval().lb()); }
+  CUDA constexpr UB ub() const { return UB(interval().ub()); }
+
+  CUDA constexpr void join_top() {
+    cp.join_top();
+  }
+
+  template<class A>
+  CUDA constexpr bool join_lb(const A& lb) {
+    bool has_changed = itv().join_lb(lb);
+    has_changed |= bits().join_lb(lb);
+    return has_changed;
+  }
+
+  template<class A>
+  CUDA constexpr bool join_ub(const A& ub) {
+    bool has_changed = itv().join_ub(ub);
+    has_changed |= bits().join_ub(ub);
+    return has_changed;
+  }
+
+  template<class M>
+  CUDA constexpr bool join(const this_type2<M>& other) {
+    if(other.is_bot()) {
+      return false;
+    }
+    if(is_bot()) {
+      cp = other.cp;
+      return true;
+    }
+    return cp.join(other.cp);
+  }
+
+  CUDA constexpr void meet_bot() {
+    cp.meet_bot();
+  }
+
+  template<class A>
+  CUDA constexpr bool meet_lb(const A& lb) {
+    bool has_changed = itv().meet_lb(lb);
+    return reduce() || has_changed;
+  }
+
+  template<class A>
+  CUDA constexpr bool meet_ub(const A& ub) {
+    bool has_changed = itv().meet_ub(ub);
+    return reduce() || has_changed;
+  }
+
+  template<class M>
+  CUDA constexpr bool meet(const this_type2<M>& other) {
+    bool has_changed = cp.meet(other.cp);
+    return reduce() || has_changed;
+  }
+
+  template <class M>
+  CUDA constexpr bool extract(this_type2<M>& ua) const {
+    return cp.extract(ua.cp);
+  }
+
+  template<class Env, class Allocator = typename Env::allocator_type>
+  CUDA TFormula<Allocator> deinterpret(AVar x, const Env& env, const Allocator& allocator = Allocator()) const {
+    return cp.deinterpret(x, env, allocator);
+  }
+
+  /** Deinterpret the current value to a logical constant.
+   * The lower bound is deinterpreted, and it is up to the user to check that the set is a singleton. */
+  template<class F>
+  CUDA NI F deinterpret() const {
+    return interval().template deinterpret<F>();
+  }
+
+  CUDA NI void print() const {
+    interval().print();
+    printf(" /\\ ");
+    bitset().print();
+  }
+
+  CUDA static constexpr bool is_trivial_fun(Sig fun) {
+    return itv_type::is_trivial_fun(fun) && bitset_type::is_trivial_fun(fun);
+  }
+
+  CUDA constexpr void neg(const local_type& x) {
+    itv().neg(x.interval());
+    bits().neg(x.bitset());
+    reduce();
+  }
+
+  CUDA constexpr void abs(const local_type& x) {
+    itv().abs(x.interval());
+    bits().abs(x.bitset());
+    reduce();
+  }
+
+  CUDA constexpr void project(Sig fun, const local_type& x) {
+    switch(fun) {
+      case NEG: neg(x); break;
+      case ABS: abs(x); break;
+    }
+  }
+
+  /** The bitset does not support the additive inverse, it is computed on the interval and transferred to the bitset by the reduction. */
+  CUDA constexpr void additive_inverse(const local_type& x) {
+    itv().additive_inverse(x.interval());
+    reduce();
+  }
+
+  /** The bitset does not support binary functions, they are computed on the interval and transferred to the bitset by the reduction. */
+  CUDA constexpr void project(Sig fun, const local_type& x, const local_type& y) {
+    itv().project(fun, x.interval(), y.interval());
+    reduce();
+  }
+
+  /** The number of values of the bitset when it is finite, and the width of the interval otherwise. */
+  CUDA constexpr local_type width() const {
+    if(!bitset().lb().is_top() && !bitset().ub().is_top()) {
+      return local_type(bitset().width().lb().value());
+    }
+    return local_type(interval().width(), bitset_local::top());
+  }
+
+  /** The median value of the bitset when it is finite, and of the interval otherwise. */
+  CUDA constexpr local_type median() const {
+    if(is_bot()) { return local_type::bot(); }
+    if(!bitset().lb().is_top() && !bitset().ub().is_top()) {
+      return local_type(bitset().median().lb().value());
+    }
+    return local_type(interval().median(), bitset_local::top());
+  }
+};
+
+// Lattice operations
+
+template<size_t N, class M1, class M2, class T>
+CUDA constexpr IntervalBitset<N, battery::local_memory, T> fjoin(const IntervalBitset<N, M1, T>& a, const IntervalBitset<N, M2, T>& b)
+{
+  IntervalBitset<N, battery::local_memory, T> r(a);
+  r.join(b);
+  return r;
+}
+
+template<size_t N, class M1, class M2, class T>
+CUDA constexpr IntervalBitset<N, battery::local_memory, T> fmeet(const IntervalBitset<N, M1, T>& a, const IntervalBitset<N, M2, T>& b)
+{
+  IntervalBitset<N, battery::local_memory, T> r(a);
+  r.meet(b);
+  return r;
+}
+
+template<size_t N, class M1, class M2, class T>
+CUDA constexpr bool operator<=(const IntervalBitset<N, M1, T>& a, const IntervalBitset<N, M2, T>& b)
+{
+  return a.is_bot() || a.as_product() <= b.as_product();
+}
+
+template<size_t N, class M1, class M2, class T>
+CUDA constexpr bool operator<(const IntervalBitset<N, M1, T>& a, const IntervalBitset<N, M2, T>& b)
+{
+  return (a.is_bot() && !b.is_bot()) || a.as_product() < b.as_product();
+}
+
+template<size_t N, class M1, class M2, class T>
+CUDA constexpr bool operator>=(const IntervalBitset<N, M1, T>& a, const IntervalBitset<N, M2, T>& b)
+{
+  return b <= a;
+}
+
+template<size_t N, class M1, class M2, class T>
+CUDA constexpr bool operator>(const IntervalBitset<N, M1, T>& a, const IntervalBitset<N, M2, T>& b)
+{
+  return b < a;
+}
+
+template<size_t N, class M1, class M2, class T>
+CUDA constexpr bool operator==(const IntervalBitset<N, M1, T>& a, const IntervalBitset<N, M2, T>& b)
+{
+  return a.as_product() == b.as_product() || (a.is_bot() && b.is_bot());
+}
+
+template<size_t N, class M1, class M2, class T>
+CUDA constexpr bool operator!=(const IntervalBitset<N, M1, T>& a, const IntervalBitset<N, M2, T>& b)
+{
+  return !(a == b);
+}
+
+template<size_t N, class M, class T>
+std::ostream& operator<<(std::ostream &s, const IntervalBitset<N, M, T> &a) {
+  return s << "(" << a.interval() << ", " << a.bitset() << ")";
+}
+
+} // namespace lala
+
+#endif
@@ -205,6 +205,10 @@ CUDA NI inline const char* string_of_sig(Sig sig) {
     return sig == ADD || sig == MUL || sig == AND || sig == OR || sig == EQUIV || sig == XOR
       || sig == UNION || sig == INTERSECTION || sig == MAX || sig == MIN;
   }
+
+  CUDA NI inline constexpr bool is_commutative(Sig sig) {
+    return is_associative(sig) || sig == EQ || sig == NEQ || sig == SYMMETRIC_DIFFERENCE;
+  }
 }
 
 namespace battery {
@@ -10,9 +10,9 @@
 #include "battery/variant.hpp"
 #include "ast.hpp"
 #include "diagnostics.hpp"
+#include "symbol_table.hpp"
+#include "serialization.hpp"
 
-#include <string>
-#include <unordered_map>
 #include <functional>
 
 namespace lala {
@@ -103,10 +103,13 @@ struct ListVarIndex {
   }
 };
 
+/** An index from the names of the variables to their positions in `lvars`, with an open-addressing hash table (linear probing) working on both the host and the device.
+ * A lookup hashes the name once and compares it to the names in `lvars` sharing the same slots, it does not allocate memory.
+ * The table stores only the positions in `lvars`, so the names are not duplicated. */
 template <class Allocator>
-struct HashMapVarIndex {
+struct HashVarIndex {
   using allocator_type = Allocator;
-  using this_type = ListVarIndex<Allocator>;
+  using this_type = HashVarIndex<Allocator>;
   using variable_type = Variable<Allocator>;
 
   template<class T>
@@ -114,148 +117,103 @@ struct HashMapVarIndex {
   using bstring = battery::string<Allocator>;
 
   bvector<variable_type>* lvars;
-  std::unordered_map<std::string, size_t> lvar_index;
-
-  HashMapVarIndex(bvector<variable_type>* lvars): lvars(lvars) {
-    for(size_t i = 0; i < lvars->size(); ++i) {
-      lvar_index[std::string((*lvars)[i].name.data())] = i;
-    }
-  }
-
-  HashMapVarIndex(this_type&& other, bvector<variable_type>* lvars)
-   : lvars(lvars), lvar_index(std::move(other.lvar_index)) {}
-
-  HashMapVarIndex(const this_type& other, bvector<variable_type>* lvars)
-   : lvars(lvars), lvar_index(other.lvar_index) {}
+  /** Positions in `lvars` (`-1` is an empty slot), its size is a power of two. */
+  bvector<int> slots;
 
-  template <class Alloc2>
-  HashMapVarIndex(const HashMapVarIndex<Alloc2>& other, bvector<variable_type>* lvars)
-    : lvars(lvars), lvar_index(other.lvar_index)
-  {}
-
-  // For this operator=, we suppose `lvars` is updated before.
-  this_type& operator=(this_type&& other) {
-    lvar_index = std::move(other.lvar_index);
-    return *this;
-  }
-  this_type& operator=(const this_type& other) {
-    lvar_index = other.lvar_index;
-    return *this;
+  CUDA static size_t length(const char* lv) {
+    size_t n = 0;
+    while(lv[n] != '\0') { ++n; }
+    return n;
   }
 
-  std::optional<size_t> lvar_index_of(const char* lv) const {
-    auto it = lvar_index.find(std::string(lv));
-    if(it != lvar_index.end()) {
-      return {it->second};
+  CUDA size_t slot_of(const char* lv, size_t n) const {
+    size_t mask = slots.size() - 1;
+    size_t i = hash_chars(lv, n) & mask;
+    while(slots[i] != -1 && !((*lvars)[slots[i]].name == lv)) {
+      i = (i + 1) & mask;
     }
-    return {};
+    return i;
   }
 
-  void push_back(variable_type&& var) {
-    lvar_index[std::string(var.name.data())] = lvars->size();
-    lvars->push_back(std::move(var));
+  CUDA NI void rebuild(size_t capacity) {
+    slots = bvector<int>(capacity, -1, slots.get_allocator());
+    for(size_t i = 0; i < lvars->size(); ++i) {
+      const bstring& name = (*lvars)[i].name;
+      slots[slot_of(name.data(), name.size())] = i;
+    }
   }
 
-  void erase(const char* lv) {
-    lvar_index.erase(std::string(lv));
+  CUDA NI HashVarIndex(bvector<variable_type>* lvars): lvars(lvars), slots(lvars->get_allocator()) {
+    size_t capacity = 16;
+    while(capacity < 2 * lvars->size()) { capacity *= 2; }
+    rebuild(capacity);
   }
 
-  void set_lvars(bvector<variable_type>* lvars) {
-    this->lvars = lvars;
-  }
-};
+  CUDA HashVarIndex(this_type&& other, bvector<variable_type>* lvars)
+   : lvars(lvars), slots(std::move(other.slots)) {}
 
-template <class Allocator>
-struct DispatchIndex {
-  using allocator_type = Allocator;
-  using this_type = ListVarIndex<Allocator>;
-  using variable_type = Variable<Allocator>;
-
-  template<class T>
-  using bvector = battery::vector<T, Allocator>;
-  using bstring = battery::string<Allocator>;
-
-  battery::unique_ptr<HashMapVarIndex<allocator_type>, allocator_type> cpu_index;
-  battery::unique_ptr<ListVarIndex<allocator_type>, allocator_type> gpu_index;
-
-  CUDA DispatchIndex(bvector<variable_type>* lvars): cpu_index(nullptr), gpu_index(nullptr) {
-    gpu_index = std::move(battery::allocate_unique<ListVarIndex<allocator_type>>(lvars->get_allocator(), lvars));
-    #ifndef __CUDA_ARCH__
-      cpu_index = std::move(battery::allocate_unique<HashMapVarIndex<allocator_type>>(lvars->get_allocator(), lvars));
-    #endif
-  }
-
-  CUDA DispatchIndex(this_type&& other, bvector<variable_type>* lvars)
-   : gpu_index(std::move(other.gpu_index))
-  {
-    #ifndef __CUDA_ARCH__
-      cpu_index = std::move(other.cpu_index);
-    #endif
-  }
-
-  CUDA DispatchIndex(const this_type& other, bvector<variable_type>* lvars)
-  {
-    gpu_index = std::move(battery::allocate_unique<ListVarIndex<allocator_type>>(lvars->get_allocator(), *other.gpu_index, lvars));
-    #ifndef __CUDA_ARCH__
-      cpu_index = std::move(battery::allocate_unique<HashMapVarIndex<allocator_type>>(lvars->get_allocator(), *other.cpu_index, lvars));
-    #endif
-  }
+  CUDA HashVarIndex(const this_type& other, bvector<variable_type>* lvars)
+   : lvars(lvars), slots(other.slots, lvars->get_allocator()) {}
 
   template <class Alloc2>
-  CUDA DispatchIndex(const DispatchIndex<Alloc2>& other, bvector<variable_type>* lvars)
-  {
-    gpu_index = std::move(battery::allocate_unique<ListVarIndex<allocator_type>>(lvars->get_allocator(), *other.gpu_index, lvars));
-    #ifndef __CUDA_ARCH__
-      cpu_index = std::move(battery::allocate_unique<HashMapVarIndex<allocator_type>>(lvars->get_allocator(), *other.cpu_index, lvars));
-    #endif
-  }
+  CUDA HashVarIndex(const HashVarIndex<Alloc2>& other, bvector<variable_type>* lvars)
+    : lvars(lvars), slots(other.slots, lvars->get_allocator())
+  {}
 
   // For this operator=, we suppose `lvars` is updated before.
   CUDA this_type& operator=(this_type&& other) {
-    gpu_index = std::move(other.gpu_index);
-    #ifndef __CUDA_ARCH__
-      cpu_index = std::move(other.cpu_index);
-    #endif
+    slots = std::move(other.slots);
     return *this;
   }
 
   CUDA this_type& operator=(const this_type& other) {
-    *gpu_index = *other.gpu_index;
-    #ifndef __CUDA_ARCH__
-      *cpu_index = *other.cpu_index;
-    #endif
+    slots = other.slots;
     return *this;
   }
 
   CUDA std::optional<size_t> lvar_index_of(const char* lv) const {
-    #ifdef __CUDA_ARCH__
-      return gpu_index->lvar_index_of(lv);
-    #else
-      return cpu_index->lvar_index_of(lv);
-    #endif
+    int i = slots[slot_of(lv, length(lv))];
+    if(i == -1) {
+      return {};
+    }
+    return {static_cast<size_t>(i)};
   }
 
   CUDA void push_back(variable_type&& var) {
-    #ifdef __CUDA_ARCH__
-      gpu_index->push_back(std::move(var));
-    #else
-      cpu_index->push_back(std::move(var));
-    #endif
+    // We keep the load factor below 1/2.
+    if(2 * (lvars->size() + 1) > slots.size()) {
+      lvars->push_back(std::move(var));
+      rebuild(slots.size() * 2);
+    }
+    else {
+      size_t i = slot_of(var.name.data(), var.name.size());
+      slots[i] = lvars->size();
+      lvars->push_back(std::move(var));
+    }
   }
 
-  CUDA void erase(const char* lv) {
-    #ifdef __CUDA_ARCH__
-      gpu_index->erase(lv);
-    #else
-      cpu_index->erase(lv);
-    #endif
+  /** Remove `lv` from the index (but not from `lvars`), the following entries of the probing sequence are shifted backward to fill the hole. */
+  CUDA NI void erase(const char* lv) {
+    size_t mask = slots.size() - 1;
+    size_t hole = slot_of(lv, length(lv));
+    if(slots[hole] == -1) {
+      return;
+    }
+    slots[hole] = -1;
+    for(size_t i = (hole + 1) & mask; slots[i] != -1; i = (i + 1) & mask) {
+      const bstring& name = (*lvars)[slots[i]].name;
+      size_t home = hash_chars(name.data(), name.size()) & mask;
+      // The entry `i` can be moved into the hole if its home slot is not in the cyclic range (hole, i].
+      if(((i - home) & mask) >= ((i - hole) & mask)) {
+        slots[hole] = slots[i];
+        slots[i] = -1;
+        hole = i;
+      }
+    }
   }
 
   CUDA void set_lvars(bvector<variable_type>* lvars) {
-    gpu_index->set_lvars(lvars);
-    #ifndef __CUDA_ARCH__
-      cpu_index->set_lvars(lvars);
-    #endif
+    this->lvars = lvars;
   }
 };
 
@@ -279,13 +237,25 @@ public:
   friend class VarEnv;
 
 private:
+  /** An entry of the trail recording a change to the environment, in order to undo it in `restore`.
+   *   - `lvar == -1`: a new abstract domain was added to `avar2lvar`.
+   *   - `lvar >= 0` and `created`: the logical variable `lvar` was created with an abstract variable of type `aty`.
+   *   - `lvar >= 0` and `!created`: an abstract variable of type `aty` was added to the existing logical variable `lvar`. */
+  struct trail_entry {
+    int lvar;
+    AType aty;
+    bool created;
+  };
+
   bvector<variable_type> lvars;
   bvector<bvector<size_t>> avar2lvar;
-  DispatchIndex<allocator_type> var_index; // Note that this must always be declared *after* `lvars` because it stores a reference to it.
+  HashVarIndex<allocator_type> var_index; // Note that this must always be declared *after* `lvars` because it stores a reference to it.
+  bvector<trail_entry> trail;
 
 public:
   CUDA NI AType extends_abstract_dom() {
     avar2lvar.push_back(bvector<int>(get_allocator()));
+    trail.push_back(trail_entry{-1, UNTYPED, false});
     return static_cast<AType>(avar2lvar.size()) - 1;
   }
 
@@ -310,11 +280,13 @@ private:
       }
       else {
         lvars[*lvar_idx].avars.push_back(avar);
+        trail.push_back(trail_entry{static_cast<int>(*lvar_idx), aty, false});
       }
     }
     else {
       lvar_idx ={lvars.size()};
       var_index.push_back(Variable<allocator_type>{name, sort, avar, get_allocator()});
+      trail.push_back(trail_entry{static_cast<int>(*lvar_idx), aty, true});
     }
     avar2lvar[aty].push_back(*lvar_idx);
     return avar;
@@ -370,31 +342,36 @@ private:
   }
 
 public:
-  CUDA VarEnv(const Allocator& allocator): lvars(allocator), avar2lvar(allocator), var_index(&lvars) {}
-  CUDA VarEnv(this_type&& other): lvars(std::move(other.lvars)), avar2lvar(std::move(other.avar2lvar)), var_index(std::move(other.var_index), &lvars) {}
+  CUDA VarEnv(const Allocator& allocator): lvars(allocator), avar2lvar(allocator), var_index(&lvars), trail(allocator) {}
+  CUDA VarEnv(this_type&& other): lvars(std::move(other.lvars)), avar2lvar(std::move(other.avar2lvar)), var_index(std::move(other.var_index), &lvars), trail(std::move(other.trail)) {}
   CUDA VarEnv(): VarEnv(Allocator{}) {}
-  CUDA VarEnv(const this_type& other): lvars(other.lvars), avar2lvar(other.avar2lvar), var_index(other.var_index, &lvars) {}
+  CUDA VarEnv(const this_type& other): lvars(other.lvars), avar2lvar(other.avar2lvar), var_index(other.var_index, &lvars), trail(other.trail) {}
 
   template <class Alloc2>
   CUDA VarEnv(const VarEnv<Alloc2>& other, const Allocator& allocator = Allocator{})
     : lvars(other.lvars, allocator)
     , avar2lvar(other.avar2lvar, allocator)
     , var_index(other.var_index, &lvars)
-  {}
+    , trail(allocator)
+  {
+    copy_trail(other);
+  }
 
   CUDA this_type& operator=(this_type&& other) {
     lvars = std::move(other.lvars);
     avar2lvar = std::move(other.avar2lvar);
     var_index = std::move(other.var_index);
     var_index.set_lvars(&lvars);
+    trail = std::move(other.trail);
     return *this;
   }
 
   CUDA this_type& operator=(const this_type& other) {
     lvars = other.lvars;
     avar2lvar = other.avar2lvar;
-    var_index = DispatchIndex<allocator_type>(other.var_index, &lvars);
+    var_index = HashVarIndex<allocator_type>(other.var_index, &lvars);
     var_index.set_lvars(&lvars);
+    trail = other.trail;
     return *this;
   }
 
@@ -402,11 +379,23 @@ public:
   CUDA this_type& operator=(const VarEnv<Alloc2>& other) {
     lvars = other.lvars;
     avar2lvar = other.avar2lvar;
-    var_index = DispatchIndex<allocator_type>(other.var_index, &lvars);
+    var_index = HashVarIndex<allocator_type>(other.var_index, &lvars);
     var_index.set_lvars(&lvars);
+    copy_trail(other);
     return *this;
   }
 
+private:
+  template <class Alloc2>
+  CUDA void copy_trail(const VarEnv<Alloc2>& other) {
+    trail.resize(other.trail.size());
+    for(int i = 0; i < trail.size(); ++i) {
+      trail[i] = trail_entry{other.trail[i].lvar, other.trail[i].aty, other.trail[i].created};
+    }
+  }
+
+public:
+
   CUDA allocator_type get_allocator() const {
     return lvars.get_allocator();
   }
@@ -454,6 +443,17 @@ public:
     }
   }
 
+  /** \return The position of the logical variable `lv` in this environment, which is a dense identifier in `0..num_vars()-1` such that `(*this)[i].name == lv`.
+   * The lookup is performed in expected constant time. */
+  CUDA std::optional<size_t> lvar_index_of(const char* lv) const {
+    return var_index.lvar_index_of(lv);
+  }
+
+  template <class Alloc2>
+  CUDA std::optional<size_t> lvar_index_of(const battery::string<Alloc2>& lv) const {
+    return lvar_index_of(lv.data());
+  }
+
   CUDA NI std::optional<std::reference_wrapper<const variable_type>> variable_of(const char* lv) const {
     auto r = var_index.lvar_index_of(lv);
     if(r.has_value()) {
@@ -501,39 +501,136 @@ public:
     return (*this)[av].sort;
   }
 
-  struct snapshot_type {
-    bvector<size_t> lvars_snap;
-    bvector<size_t> avar2lvar_snap;
-  };
-
-  /** Save the state of the environment. */
-  CUDA NI snapshot_type snapshot() const {
-    snapshot_type snap;
+  /** Encode the environment (variables, abstract variables and trail) in `w`. */
+  template <class Alloc2>
+  CUDA NI void serialize(BinaryWriter<Alloc2>& w) const {
+    w.write(static_cast<unsigned long long>(lvars.size()));
     for(int i = 0; i < lvars.size(); ++i) {
-      snap.lvars_snap.push_back(lvars[i].avars.size());
+      w.write_string(lvars[i].name);
+      lala::serialize(w, lvars[i].sort);
+      w.write(static_cast<unsigned long long>(lvars[i].avars.size()));
+      for(int j = 0; j < lvars[i].avars.size(); ++j) {
+        lala::serialize(w, lvars[i].avars[j]);
+      }
     }
+    w.write(static_cast<unsigned long long>(avar2lvar.size()));
     for(int i = 0; i < avar2lvar.size(); ++i) {
-      snap.avar2lvar_snap.push_back(avar2lvar[i].size());
+      w.write(static_cast<unsigned long long>(avar2lvar[i].size()));
+      for(int j = 0; j < avar2lvar[i].size(); ++j) {
+        w.write(static_cast<unsigned long long>(avar2lvar[i][j]));
+      }
+    }
+    w.write(static_cast<unsigned long long>(trail.size()));
+    for(int i = 0; i < trail.size(); ++i) {
+      w.write(trail[i].lvar);
+      w.write(trail[i].aty);
+      w.write(static_cast<unsigned char>(trail[i].created));
     }
-    return std::move(snap);
   }
 
-  /** Restore the environment to its previous state `snap`. */
-  CUDA NI void restore(const snapshot_type& snap) {
-    assert(lvars.size() >= snap.lvars_snap.size());
-    assert(avar2lvar.size() >= snap.avar2lvar_snap.size());
-    while(lvars.size() > snap.lvars_snap.size()) {
-      var_index.erase(lvars.back().name.data());
-      lvars.pop_back();
+  /** Decode an environment encoded by `serialize`.
+   * The variables are directly rebuilt from the buffer (instead of being interpreted again), only the index of the names is recomputed.
+   * \return An empty optional if the buffer is truncated or invalid. */
+  CUDA NI static std::optional<this_type> deserialize(BinaryReader& r, const allocator_type& alloc = allocator_type()) {
+    this_type env(alloc);
+    unsigned long long n, m;
+    if(!r.read(n)) { return {}; }
+    for(unsigned long long i = 0; i < n; ++i) {
+      bstring name(alloc);
+      if(!r.read_string(name, alloc)) { return {}; }
+      auto sort = deserialize_sort<allocator_type>(r, alloc);
+      AVar avar;
+      if(!sort.has_value() || !r.read(m) || m == 0 || !deserialize_avar(r, avar)) { return {}; }
+      env.lvars.push_back(variable_type(name, *sort, avar, alloc));
+      for(unsigned long long j = 1; j < m; ++j) {
+        if(!deserialize_avar(r, avar)) { return {}; }
+        env.lvars.back().avars.push_back(avar);
+      }
     }
-    for(int i = 0; i < lvars.size(); ++i) {
-      lvars[i].avars.resize(snap.lvars_snap[i]);
+    if(!r.read(n)) { return {}; }
+    for(unsigned long long i = 0; i < n; ++i) {
+      if(!r.read(m)) { return {}; }
+      env.avar2lvar.push_back(bvector<size_t>(alloc));
+      for(unsigned long long j = 0; j < m; ++j) {
+        unsigned long long lvar;
+        if(!r.read(lvar) || lvar >= env.lvars.size()) { return {}; }
+        env.avar2lvar.back().push_back(lvar);
+      }
     }
-    while(avar2lvar.size() > snap.avar2lvar_snap.size()) {
-      avar2lvar.pop_back();
+    if(!r.read(n)) { return {}; }
+    // The trail is checked so that `restore` undoes exactly the abstract domains and variables of the environment.
+    // The abstract domains (`lvar == -1`) and the variables (`created`) must be recorded in the order they were created, and replaying the trail must rebuild `avar2lvar` and the abstract variables of each variable: the entry `k` of `aty` adds `avar2lvar[aty][k] == lvar`, which is the abstract variable `AVar(aty, k)` of `lvar`.
+    size_t num_doms = 0;
+    size_t num_created = 0;
+    bvector<size_t> entries_of_aty(env.avar2lvar.size(), size_t{0}, alloc);
+    bvector<size_t> entries_of_lvar(env.lvars.size(), size_t{0}, alloc);
+    for(unsigned long long i = 0; i < n; ++i) {
+      trail_entry e;
+      unsigned char created;
+      if(!r.read(e.lvar) || !r.read(e.aty) || !r.read(created) || created > 1) { return {}; }
+      e.created = created;
+      if(e.lvar == -1) {
+        if(e.aty != UNTYPED || e.created || num_doms++ >= env.avar2lvar.size()) { return {}; }
+      }
+      else {
+        if(e.lvar < 0 || e.lvar >= env.lvars.size() || e.aty < 0 || e.aty >= num_doms
+          || (e.created ? e.lvar != num_created++ : e.lvar >= num_created))
+        {
+          return {};
+        }
+        size_t k = entries_of_aty[e.aty]++;
+        size_t j = entries_of_lvar[e.lvar]++;
+        const auto& avars = env.lvars[e.lvar].avars;
+        if(k >= env.avar2lvar[e.aty].size() || env.avar2lvar[e.aty][k] != e.lvar
+          || j >= avars.size() || avars[j] != AVar(e.aty, static_cast<int>(k)))
+        {
+          return {};
+        }
+      }
+      env.trail.push_back(e);
     }
-    for(int i = 0; i < avar2lvar.size(); ++i) {
-      avar2lvar[i].resize(snap.avar2lvar_snap[i]);
+    if(num_doms != env.avar2lvar.size() || num_created != env.lvars.size()) { return {}; }
+    for(int i = 0; i < env.avar2lvar.size(); ++i) {
+      if(entries_of_aty[i] != env.avar2lvar[i].size()) { return {}; }
+    }
+    for(int i = 0; i < env.lvars.size(); ++i) {
+      if(entries_of_lvar[i] != env.lvars[i].avars.size()) { return {}; }
+    }
+    env.var_index = HashVarIndex<allocator_type>(&env.lvars);
+    return std::move(env);
+  }
+
+  /** A snapshot is the size of the trail, i.e., the number of changes made to the environment since its creation. */
+  struct snapshot_type {
+    size_t trail_size;
+  };
+
+  /** Save the state of the environment in constant time. */
+  CUDA snapshot_type snapshot() const {
+    return snapshot_type{trail.size()};
+  }
+
+  /** Restore the environment to its previous state `snap` by undoing the changes recorded in the trail since `snap`, in reverse order.
+   * The complexity is linear in the number of changes since `snap`. */
+  CUDA NI void restore(const snapshot_type& snap) {
+    assert(trail.size() >= snap.trail_size);
+    while(trail.size() > snap.trail_size) {
+      const trail_entry& e = trail.back();
+      if(e.lvar == -1) {
+        avar2lvar.pop_back();
+      }
+      else {
+        avar2lvar[e.aty].pop_back();
+        if(e.created) {
+          assert(e.lvar == lvars.size() - 1);
+          var_index.erase(lvars.back().name.data());
+          lvars.pop_back();
+        }
+        else {
+          lvars[e.lvar].avars.pop_back();
+        }
+      }
+      trail.pop_back();
     }
   }
 };
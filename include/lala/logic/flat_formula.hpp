@@ -0,0 +1,309 @@
+// Copyright 2024 Pierre Talbot
+
+#ifndef LALA_CORE_FLAT_FORMULA_HPP
+#define LALA_CORE_FLAT_FORMULA_HPP
+
+#include "battery/utility.hpp"
+#include "battery/vector.hpp"
+#include "ast.hpp"
+#include "algorithm.hpp"
+#include "symbol_table.hpp"
+
+namespace lala {
+
+/** An immutable and flat representation of a formula `TFormula<Allocator, ExtendedSig>`, suited to algorithms traversing large formulas.
+ * The nodes are stored in post-order in a single array, hence the root is the last node and the subformula rooted at a node `i` occupies the contiguous range `[begin(i)..i]`.
+ * Each node takes a few words:
+ *   - Booleans and integers are stored inline,
+ *   - logical variables (including the ones in existential quantifiers) are interned in a symbol table and represented by a dense identifier,
+ *   - abstract variables are stored inline,
+ *   - the remaining constants (real numbers, sets), the sorts and the extended signatures are stored in side tables.
+ * The children of a n-ary node are given by a range in an array of node indices (since the children are not contiguous in post-order).
+ *
+ * Algorithms such as `num_vars`, `var_in`, `is_var_equality` and `eval` have a version working on `FlatFormula` (see below), which consist in a linear scan of the range of a node. */
+template<class Allocator, class ExtendedSig = battery::string<Allocator>>
+class FlatFormula {
+public:
+  using allocator_type = Allocator;
+  using this_type = FlatFormula<Allocator, ExtendedSig>;
+  using formula_type = TFormula<Allocator, ExtendedSig>;
+  using F = formula_type;
+
+  struct node {
+    /** The value of the node, depending on its kind:
+     *  - `F::B`, `F::Z`: the constant itself.
+     *  - `F::R`, `F::S`: index in `reals` or `sets`.
+     *  - `F::V`: the abstract variable encoded as in `AVar`, see `FlatFormula::v`.
+     *  - `F::LV`, `F::E`: identifier of the name in `names`.
+     *  - `F::Seq`: the signature.
+     *  - `F::ESeq`: index in `esigs`. */
+    logic_int value;
+    AType type;
+    /** Index of the first node of the subformula rooted at this node. */
+    int begin;
+    /** Index of the first child in `children` (or of the sort in `sorts` for `F::E`). */
+    int first;
+    int arity;
+    unsigned char kind;
+  };
+
+private:
+  template <class T>
+  using bvector = battery::vector<T, Allocator>;
+
+  bvector<node> nodes;
+  bvector<int> children;
+  SymbolTable<Allocator> names;
+  bvector<logic_real> reals;
+  bvector<typename F::LogicSet> sets;
+  bvector<Sort<Allocator>> sorts;
+  bvector<ExtendedSig> esigs;
+
+  CUDA NI int push_node(unsigned char kind, AType type, logic_int value, int begin, int first = 0, int arity = 0) {
+    nodes.push_back(node{value, type, begin, first, arity, kind});
+    return nodes.size() - 1;
+  }
+
+  template <class F2>
+  CUDA NI int push_seq(const F2& f, unsigned char kind, logic_int value, const typename F2::Sequence& seq) {
+    int begin = nodes.size();
+    bvector<int> sub(seq.size(), 0, children.get_allocator());
+    for(int i = 0; i < seq.size(); ++i) {
+      sub[i] = flatten(seq[i]);
+    }
+    int first = children.size();
+    for(int i = 0; i < sub.size(); ++i) {
+      children.push_back(sub[i]);
+    }
+    return push_node(kind, f.type(), value, begin, first, seq.size());
+  }
+
+  template <class F2>
+  CUDA NI int flatten(const F2& f) {
+    int begin = nodes.size();
+    switch(f.index()) {
+      case F2::B: return push_node(F::B, f.type(), f.b(), begin);
+      case F2::Z: return push_node(F::Z, f.type(), f.z(), begin);
+      case F2::R:
+        reals.push_back(f.r());
+        return push_node(F::R, f.type(), reals.size() - 1, begin);
+      case F2::S:
+        sets.push_back(F(f, get_allocator()).s());
+        return push_node(F::S, f.type(), sets.size() - 1, begin);
+      case F2::V: {
+        AVar v = f.v();
+        return push_node(F::V, f.type(), v.is_untyped() ? -1 : ((v.vid() << 8) | v.aty()), begin);
+      }
+      case F2::LV: return push_node(F::LV, f.type(), names.intern(f.lv()), begin);
+      case F2::E: {
+        sorts.push_back(Sort<Allocator>(battery::get<1>(f.exists()), get_allocator()));
+        return push_node(F::E, f.type(), names.intern(battery::get<0>(f.exists())), begin, sorts.size() - 1);
+      }
+      case F2::Seq: return push_seq(f, F::Seq, f.sig(), f.seq());
+      case F2::ESeq:
+        esigs.push_back(ExtendedSig(f.esig(), get_allocator()));
+        return push_seq(f, F::ESeq, esigs.size() - 1, f.eseq());
+      default: assert(false); return -1;
+    }
+  }
+
+public:
+  /** Flatten the formula `f`. */
+  template <class Alloc2, class ExtendedSig2>
+  CUDA NI FlatFormula(const TFormula<Alloc2, ExtendedSig2>& f, const allocator_type& alloc = allocator_type())
+   : nodes(alloc), children(alloc), names(alloc), reals(alloc), sets(alloc), sorts(alloc), esigs(alloc)
+  {
+    flatten(f);
+  }
+
+  FlatFormula(const this_type&) = default;
+  FlatFormula(this_type&&) = default;
+
+  CUDA allocator_type get_allocator() const {
+    return nodes.get_allocator();
+  }
+
+  /** The number of nodes. */
+  CUDA size_t size() const {
+    return nodes.size();
+  }
+
+  CUDA int root() const {
+    return nodes.size() - 1;
+  }
+
+  CUDA const node& operator[](int i) const {
+    return nodes[i];
+  }
+
+  CUDA size_t index(int i) const { return nodes[i].kind; }
+  CUDA bool is(int i, size_t kind) const { return nodes[i].kind == kind; }
+  CUDA AType type(int i) const { return nodes[i].type; }
+  CUDA int begin(int i) const { return nodes[i].begin; }
+  CUDA int arity(int i) const { return nodes[i].arity; }
+
+  /** The index of the `k`-th child of the node `i`. */
+  CUDA int child(int i, int k) const {
+    assert(k < nodes[i].arity);
+    return children[nodes[i].first + k];
+  }
+
+  CUDA bool is_variable(int i) const {
+    return nodes[i].kind == F::LV || nodes[i].kind == F::V || nodes[i].kind == F::E;
+  }
+
+  CUDA bool is_constant(int i) const {
+    return nodes[i].kind == F::B || nodes[i].kind == F::Z || nodes[i].kind == F::R || nodes[i].kind == F::S;
+  }
+
+  CUDA logic_bool b(int i) const { assert(is(i, F::B)); return nodes[i].value; }
+  CUDA logic_int z(int i) const { assert(is(i, F::Z)); return nodes[i].value; }
+  CUDA const logic_real& r(int i) const { assert(is(i, F::R)); return reals[nodes[i].value]; }
+  CUDA const typename F::LogicSet& s(int i) const { assert(is(i, F::S)); return sets[nodes[i].value]; }
+  CUDA Sig sig(int i) const { assert(is(i, F::Seq)); return static_cast<Sig>(nodes[i].value); }
+  CUDA const ExtendedSig& esig(int i) const { assert(is(i, F::ESeq)); return esigs[nodes[i].value]; }
+  CUDA const Sort<Allocator>& sort(int i) const { assert(is(i, F::E)); return sorts[nodes[i].first]; }
+
+  CUDA AVar v(int i) const {
+    assert(is(i, F::V));
+    return nodes[i].value == -1 ? AVar{} : AVar(static_cast<AType>(nodes[i].value & 255), static_cast<int>(nodes[i].value >> 8));
+  }
+
+  /** The dense identifier of the logical variable of the node `i` (`F::LV` or `F::E`), two occurrences of the same name have the same identifier. */
+  CUDA int var_id(int i) const {
+    assert(is(i, F::LV) || is(i, F::E));
+    return nodes[i].value;
+  }
+
+  /** The name of the logical variable of the node `i` (`F::LV` or `F::E`). */
+  CUDA const LVar<Allocator>& lv(int i) const {
+    return names[var_id(i)];
+  }
+
+  /** The table of the names occurring in the formula. */
+  CUDA const SymbolTable<Allocator>& symbols() const {
+    return names;
+  }
+
+  /** Rebuild the subformula rooted at node `i` (by default the whole formula). */
+  template <class Alloc2 = Allocator>
+  CUDA NI TFormula<Alloc2, ExtendedSig> to_formula(int i, const Alloc2& alloc = Alloc2()) const {
+    using F2 = TFormula<Alloc2, ExtendedSig>;
+    const node& n = nodes[i];
+    switch(n.kind) {
+      case F::B: return F2::make_bool(n.value, n.type);
+      case F::Z: return F2::make_z(n.value, n.type);
+      case F::R: return F2::make_real(reals[n.value], n.type);
+      case F::S: return F2(F::make_set(sets[n.value], n.type), alloc);
+      case F::V: return F2(n.type, F2::Formula::template create<F2::V>(v(i)));
+      case F::LV: return F2::make_lvar(n.type, LVar<Alloc2>(lv(i), alloc));
+      case F::E: return F2::make_exists(n.type, LVar<Alloc2>(lv(i), alloc), Sort<Alloc2>(sort(i), alloc));
+      case F::Seq:
+      case F::ESeq: {
+        typename F2::Sequence seq(alloc);
+        for(int k = 0; k < n.arity; ++k) {
+          seq.push_back(to_formula(child(i, k), alloc));
+        }
+        if(n.kind == F::Seq) {
+          return F2::make_nary(sig(i), std::move(seq), n.type, false);
+        }
+        else {
+          return F2::make_nary(esig(i), std::move(seq), n.type);
+        }
+      }
+      default: assert(false); return F2::make_true();
+    }
+  }
+
+  template <class Alloc2 = Allocator>
+  CUDA TFormula<Alloc2, ExtendedSig> to_formula(const Alloc2& alloc = Alloc2()) const {
+    return to_formula(root(), alloc);
+  }
+};
+
+/** \return The number of variables occurring in the subformula rooted at `i` (see `num_vars(f)`). */
+template <class Allocator, class ExtendedSig>
+CUDA NI int num_vars(const FlatFormula<Allocator, ExtendedSig>& f, int i) {
+  int total = 0;
+  for(int j = f.begin(i); j <= i; ++j) {
+    total += f.is_variable(j);
+  }
+  return total;
+}
+
+template <class Allocator, class ExtendedSig>
+CUDA int num_vars(const FlatFormula<Allocator, ExtendedSig>& f) {
+  return num_vars(f, f.root());
+}
+
+/** \return The index of the first variable occurring in the subformula rooted at `i`, or `i` itself if it does not contain a variable (see `var_in(f)`).
+ * Since variables are leaves, the first variable in post-order is also the first one in the depth-first order of `var_in(f)`. */
+template <class Allocator, class ExtendedSig>
+CUDA NI int var_in(const FlatFormula<Allocator, ExtendedSig>& f, int i) {
+  for(int j = f.begin(i); j <= i; ++j) {
+    if(f.is_variable(j)) {
+      return j;
+    }
+  }
+  return i;
+}
+
+template <class Allocator, class ExtendedSig>
+CUDA int var_in(const FlatFormula<Allocator, ExtendedSig>& f) {
+  return var_in(f, f.root());
+}
+
+/** \return `true` if the node `i` has the shape `variable = variable` or `variable <=> variable`. */
+template <class Allocator, class ExtendedSig>
+CUDA NI bool is_var_equality(const FlatFormula<Allocator, ExtendedSig>& f, int i) {
+  using F = typename FlatFormula<Allocator, ExtendedSig>::formula_type;
+  auto is_var = [&](int k) { return f.is(k, F::LV) || f.is(k, F::V); };
+  return f.is(i, F::Seq)
+    && (f.sig(i) == EQ || f.sig(i) == EQUIV)
+    && f.arity(i) >= 2
+    && is_var(f.child(i, 0))
+    && is_var(f.child(i, 1));
+}
+
+template <class Allocator, class ExtendedSig>
+CUDA bool is_var_equality(const FlatFormula<Allocator, ExtendedSig>& f) {
+  return is_var_equality(f, f.root());
+}
+
+/** Evaluate the subformula rooted at `i` as `eval(f)` does.
+ * The nodes are evaluated bottom-up in a single pass over the range of `i` with an explicit stack, instead of a recursive traversal of the tree. */
+template <class Allocator, class ExtendedSig>
+CUDA NI TFormula<Allocator, ExtendedSig> eval(const FlatFormula<Allocator, ExtendedSig>& f, int i) {
+  using F = typename FlatFormula<Allocator, ExtendedSig>::formula_type;
+  battery::vector<F, Allocator> stack(f.get_allocator());
+  for(int j = f.begin(i); j <= i; ++j) {
+    if(f.is(j, F::Seq) || f.is(j, F::ESeq)) {
+      int arity = f.arity(j);
+      typename F::Sequence seq(f.get_allocator());
+      for(int k = stack.size() - arity; k < stack.size(); ++k) {
+        seq.push_back(std::move(stack[k]));
+      }
+      stack.resize(stack.size() - arity);
+      if(f.is(j, F::Seq)) {
+        stack.push_back(impl::eval_seq<F>(f.sig(j), seq, f.type(j)));
+      }
+      else {
+        stack.push_back(F::make_nary(f.esig(j), std::move(seq), f.type(j)));
+      }
+    }
+    else {
+      stack.push_back(f.to_formula(j, f.get_allocator()));
+    }
+  }
+  assert(stack.size() == 1);
+  return std::move(stack[0]);
+}
+
+template <class Allocator, class ExtendedSig>
+CUDA TFormula<Allocator, ExtendedSig> eval(const FlatFormula<Allocator, ExtendedSig>& f) {
+  return eval(f, f.root());
+}
+
+} // namespace lala
+
+#endif
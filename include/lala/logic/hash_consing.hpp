@@ -0,0 +1,365 @@
+// Copyright 2024 Pierre Talbot
+
+#ifndef LALA_CORE_HASH_CONSING_HPP
+#define LALA_CORE_HASH_CONSING_HPP
+
+#include "battery/utility.hpp"
+#include "battery/vector.hpp"
+#include "ast.hpp"
+#include "symbol_table.hpp"
+#include <cstring>
+
+namespace lala {
+
+CUDA inline size_t hash_combine(size_t seed, size_t h) {
+  return seed ^ (h + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+namespace impl {
+  CUDA inline size_t hash_node_header(size_t kind, AType type, size_t value) {
+    return hash_combine(hash_combine(kind, static_cast<size_t>(type)), value);
+  }
+
+  CUDA inline size_t hash_real(const logic_real& r) {
+    double lb = battery::get<0>(r);
+    double ub = battery::get<1>(r);
+    unsigned long long bits[2];
+    memcpy(&bits[0], &lb, sizeof(double));
+    memcpy(&bits[1], &ub, sizeof(double));
+    return hash_combine(bits[0], bits[1]);
+  }
+
+  template <class Alloc>
+  CUDA NI size_t hash_sort(const Sort<Alloc>& sort) {
+    size_t h = sort.tag;
+    return sort.sub ? hash_combine(h, hash_sort(*sort.sub)) : h;
+  }
+}
+
+/** A structural hash of the formula `f`: two formulas equal according to `operator==` have the same hash.
+ * The hash does not depend on the memory layout nor on the allocator, so it is stable across runs and equal to the hash of the formula once interned in `HashConsing`. */
+template <class Allocator, class ExtendedSig>
+CUDA NI size_t structural_hash(const TFormula<Allocator, ExtendedSig>& f) {
+  using F = TFormula<Allocator, ExtendedSig>;
+  switch(f.index()) {
+    case F::B: return impl::hash_node_header(F::B, f.type(), f.b());
+    case F::Z: return impl::hash_node_header(F::Z, f.type(), f.z());
+    case F::R: return impl::hash_node_header(F::R, f.type(), impl::hash_real(f.r()));
+    case F::S: {
+      size_t h = impl::hash_node_header(F::S, f.type(), f.s().size());
+      for(int i = 0; i < f.s().size(); ++i) {
+        h = hash_combine(h, structural_hash(battery::get<0>(f.s()[i])));
+        h = hash_combine(h, structural_hash(battery::get<1>(f.s()[i])));
+      }
+      return h;
+    }
+    case F::V: return impl::hash_node_header(F::V, f.type(), f.v().vid() * 256 + f.v().aty());
+    case F::LV: return impl::hash_node_header(F::LV, f.type(), hash_chars(f.lv().data(), f.lv().size()));
+    case F::E: {
+      const auto& name = battery::get<0>(f.exists());
+      return hash_combine(impl::hash_node_header(F::E, f.type(), hash_chars(name.data(), name.size())), impl::hash_sort(battery::get<1>(f.exists())));
+    }
+    case F::Seq:
+    case F::ESeq: {
+      size_t h = f.is(F::Seq)
+        ? impl::hash_node_header(F::Seq, f.type(), f.sig())
+        : impl::hash_node_header(F::ESeq, f.type(), hash_chars(f.esig().data(), f.esig().size()));
+      const auto& children = f.is(F::Seq) ? f.seq() : f.eseq();
+      h = hash_combine(h, children.size());
+      for(int i = 0; i < children.size(); ++i) {
+        h = hash_combine(h, structural_hash(children[i]));
+      }
+      return h;
+    }
+    default: assert(false); return 0;
+  }
+}
+
+/** A hash-consing table of formulas: structurally equal subformulas are stored only once and identified by a unique integer (called a formula identifier below).
+ * Hence, two interned formulas are equal if and only if their identifiers are equal, which is a constant-time test.
+ * A formula can be interned with `intern(f)`, or directly built in the table with the factory methods `make_*`, similar to those of `TFormula`, taking the identifiers of the children.
+ * The n-ary formulas are not flattened: the structure of the formula is preserved.
+ *
+ * Each node stores its structural hash (see `structural_hash`), its kind, type, a value (depending on the kind) and a range of children identifiers:
+ *   - A set is represented by the node `F::S` whose children are the bounds of each interval of the set.
+ *   - The names of logical variables and the extended signatures are interned in symbol tables.
+ * The formulas are never removed from the table. */
+template <class Allocator>
+class HashConsing {
+public:
+  using allocator_type = Allocator;
+  using this_type = HashConsing<Allocator>;
+  using F = TFormula<Allocator>;
+
+private:
+  template <class T>
+  using bvector = battery::vector<T, Allocator>;
+
+  struct node {
+    size_t hash;
+    logic_int value;
+    AType type;
+    int first;
+    int arity;
+    unsigned char kind;
+  };
+
+  bvector<node> nodes;
+  bvector<int> children;
+  SymbolTable<Allocator> names;
+  SymbolTable<Allocator> esigs;
+  bvector<logic_real> reals;
+  bvector<Sort<Allocator>> sorts;
+  /** Open-addressing table of formula identifiers (`-1` is an empty slot), its size is a power of two. */
+  bvector<int> slots;
+
+  CUDA size_t mask() const {
+    return slots.size() - 1;
+  }
+
+  CUDA bool same_node(int id, const node& n, const int* cs) const {
+    const node& m = nodes[id];
+    if(m.hash != n.hash || m.kind != n.kind || m.type != n.type || m.value != n.value || m.arity != n.arity) {
+      return false;
+    }
+    if(n.kind == F::R && !(battery::get<0>(reals[m.first]) == battery::get<0>(reals[n.first]) && battery::get<1>(reals[m.first]) == battery::get<1>(reals[n.first]))) {
+      return false;
+    }
+    if(n.kind == F::E && !(sorts[m.first] == sorts[n.first])) {
+      return false;
+    }
+    for(int i = 0; i < n.arity; ++i) {
+      if(children[m.first + i] != cs[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  CUDA NI void grow() {
+    slots = bvector<int>(battery::max(size_t{64}, slots.size() * 2), -1, nodes.get_allocator());
+    for(int id = 0; id < nodes.size(); ++id) {
+      size_t i = nodes[id].hash & mask();
+      while(slots[i] != -1) {
+        i = (i + 1) & mask();
+      }
+      slots[i] = id;
+    }
+  }
+
+  /** Return the identifier of the node `n` with the children `cs`, the node is added if it does not exist yet.
+   * For `F::R` and `F::E`, `n.first` is the index of a value pushed at the end of `reals` or `sorts`, which is popped if the node already exists. */
+  CUDA NI int find_or_insert(node n, const int* cs) {
+    if(2 * (nodes.size() + 1) > slots.size()) {
+      grow();
+    }
+    size_t i = n.hash & mask();
+    while(slots[i] != -1) {
+      if(same_node(slots[i], n, cs)) {
+        if(n.kind == F::R) { reals.pop_back(); }
+        if(n.kind == F::E) { sorts.pop_back(); }
+        return slots[i];
+      }
+      i = (i + 1) & mask();
+    }
+    if(n.kind != F::R && n.kind != F::E) {
+      n.first = children.size();
+      for(int k = 0; k < n.arity; ++k) {
+        children.push_back(cs[k]);
+      }
+    }
+    nodes.push_back(n);
+    slots[i] = nodes.size() - 1;
+    return slots[i];
+  }
+
+  CUDA int make_leaf(unsigned char kind, AType type, logic_int value, size_t value_hash, int first = 0) {
+    return find_or_insert(node{impl::hash_node_header(kind, type, value_hash), value, type, first, 0, kind}, nullptr);
+  }
+
+  CUDA NI int make_seq(unsigned char kind, AType type, logic_int value, size_t value_hash, const int* cs, int arity) {
+    size_t h = kind == F::S
+      ? impl::hash_node_header(kind, type, arity / 2)
+      : hash_combine(impl::hash_node_header(kind, type, value_hash), arity);
+    for(int k = 0; k < arity; ++k) {
+      h = hash_combine(h, nodes[cs[k]].hash);
+    }
+    return find_or_insert(node{h, value, type, 0, arity, kind}, cs);
+  }
+
+public:
+  CUDA HashConsing(const allocator_type& alloc = allocator_type())
+   : nodes(alloc), children(alloc), names(alloc), esigs(alloc), reals(alloc), sorts(alloc), slots(alloc)
+  {}
+
+  CUDA allocator_type get_allocator() const {
+    return nodes.get_allocator();
+  }
+
+  /** The number of distinct formulas in the table. */
+  CUDA size_t size() const {
+    return nodes.size();
+  }
+
+  CUDA int make_bool(logic_bool b, AType type = UNTYPED) {
+    return make_leaf(F::B, type, b, b);
+  }
+
+  CUDA int make_z(logic_int z, AType type = UNTYPED) {
+    return make_leaf(F::Z, type, z, z);
+  }
+
+  CUDA int make_real(const logic_real& r, AType type = UNTYPED) {
+    reals.push_back(r);
+    return make_leaf(F::R, type, 0, impl::hash_real(r), reals.size() - 1);
+  }
+
+  /** The type of the formula is embedded in `v` (as in `TFormula::make_avar`). */
+  CUDA int make_avar(AVar v) {
+    return make_leaf(F::V, v.aty(), v.is_untyped() ? -1 : v.vid() * 256 + v.aty(), v.vid() * 256 + v.aty());
+  }
+
+  template <class Alloc2>
+  CUDA int make_lvar(AType type, const LVar<Alloc2>& name) {
+    return make_leaf(F::LV, type, names.intern(name), hash_chars(name.data(), name.size()));
+  }
+
+  template <class Alloc2>
+  CUDA int make_exists(AType type, const LVar<Alloc2>& name, const Sort<Alloc2>& sort) {
+    sorts.push_back(Sort<Allocator>(sort, get_allocator()));
+    return find_or_insert(node{
+      hash_combine(impl::hash_node_header(F::E, type, hash_chars(name.data(), name.size())), impl::hash_sort(sort)),
+      names.intern(name), type, static_cast<int>(sorts.size() - 1), 0, F::E}, nullptr);
+  }
+
+  /** `bounds` contains the identifiers of the lower and upper bounds of each interval in the set, i.e., `[l1, u1, l2, u2, ...]`. */
+  CUDA int make_set(const int* bounds, int n, AType type = UNTYPED) {
+    assert(n % 2 == 0);
+    return make_seq(F::S, type, 0, 0, bounds, n);
+  }
+
+  CUDA int make_nary(Sig sig, const int* cs, int arity, AType type = UNTYPED) {
+    return make_seq(F::Seq, type, sig, sig, cs, arity);
+  }
+
+  template <class Alloc2>
+  CUDA int make_nary(Sig sig, const battery::vector<int, Alloc2>& cs, AType type = UNTYPED) {
+    return make_nary(sig, cs.data(), cs.size(), type);
+  }
+
+  CUDA int make_binary(int lhs, Sig sig, int rhs, AType type = UNTYPED) {
+    int cs[2] = {lhs, rhs};
+    return make_nary(sig, cs, 2, type);
+  }
+
+  template <class Alloc2>
+  CUDA int make_nary(const battery::string<Alloc2>& esig, const int* cs, int arity, AType type = UNTYPED) {
+    return make_seq(F::ESeq, type, esigs.intern(esig), hash_chars(esig.data(), esig.size()), cs, arity);
+  }
+
+  /** Intern the formula `f` and all its subformulas.
+   * \return The identifier of `f`. */
+  template <class Alloc2>
+  CUDA NI int intern(const TFormula<Alloc2>& f) {
+    using F2 = TFormula<Alloc2>;
+    switch(f.index()) {
+      case F2::B: return make_bool(f.b(), f.type());
+      case F2::Z: return make_z(f.z(), f.type());
+      case F2::R: return make_real(f.r(), f.type());
+      case F2::V: {
+        int id = make_avar(f.v());
+        // The type of an abstract variable is usually the one of the variable, but it can be changed with `type_as`.
+        if(nodes[id].type != f.type()) {
+          AVar v = f.v();
+          return make_leaf(F::V, f.type(), nodes[id].value, v.vid() * 256 + v.aty());
+        }
+        return id;
+      }
+      case F2::LV: return make_lvar(f.type(), f.lv());
+      case F2::E: return make_exists(f.type(), battery::get<0>(f.exists()), battery::get<1>(f.exists()));
+      case F2::S: {
+        bvector<int> bounds(get_allocator());
+        for(int i = 0; i < f.s().size(); ++i) {
+          bounds.push_back(intern(battery::get<0>(f.s()[i])));
+          bounds.push_back(intern(battery::get<1>(f.s()[i])));
+        }
+        return make_set(bounds.data(), bounds.size(), f.type());
+      }
+      case F2::Seq:
+      case F2::ESeq: {
+        const auto& seq = f.is(F2::Seq) ? f.seq() : f.eseq();
+        bvector<int> cs(get_allocator());
+        for(int i = 0; i < seq.size(); ++i) {
+          cs.push_back(intern(seq[i]));
+        }
+        if(f.is(F2::Seq)) {
+          return make_nary(f.sig(), cs.data(), cs.size(), f.type());
+        }
+        else {
+          return make_nary(f.esig(), cs.data(), cs.size(), f.type());
+        }
+      }
+      default: assert(false); return -1;
+    }
+  }
+
+  /** The structural hash of the formula `id`, equal to `structural_hash(to_formula(id))`. */
+  CUDA size_t hash(int id) const { return nodes[id].hash; }
+  CUDA size_t index(int id) const { return nodes[id].kind; }
+  CUDA bool is(int id, size_t kind) const { return nodes[id].kind == kind; }
+  CUDA AType type(int id) const { return nodes[id].type; }
+  CUDA int arity(int id) const { return nodes[id].arity; }
+  CUDA int child(int id, int k) const { assert(k < arity(id)); return children[nodes[id].first + k]; }
+  CUDA logic_bool b(int id) const { assert(is(id, F::B)); return nodes[id].value; }
+  CUDA logic_int z(int id) const { assert(is(id, F::Z)); return nodes[id].value; }
+  CUDA const logic_real& r(int id) const { assert(is(id, F::R)); return reals[nodes[id].first]; }
+  CUDA Sig sig(int id) const { assert(is(id, F::Seq)); return static_cast<Sig>(nodes[id].value); }
+  CUDA const LVar<Allocator>& lv(int id) const { assert(is(id, F::LV) || is(id, F::E)); return names[nodes[id].value]; }
+  CUDA const Sort<Allocator>& sort(int id) const { assert(is(id, F::E)); return sorts[nodes[id].first]; }
+  CUDA const battery::string<Allocator>& esig(int id) const { assert(is(id, F::ESeq)); return esigs[nodes[id].value]; }
+
+  CUDA AVar v(int id) const {
+    assert(is(id, F::V));
+    return nodes[id].value == -1 ? AVar{} : AVar(static_cast<AType>(nodes[id].value & 255), static_cast<int>(nodes[id].value >> 8));
+  }
+
+  /** Rebuild the formula `id` as a tree. */
+  template <class Alloc2 = Allocator>
+  CUDA NI TFormula<Alloc2> to_formula(int id, const Alloc2& alloc = Alloc2()) const {
+    using F2 = TFormula<Alloc2>;
+    const node& n = nodes[id];
+    switch(n.kind) {
+      case F::B: return F2::make_bool(n.value, n.type);
+      case F::Z: return F2::make_z(n.value, n.type);
+      case F::R: return F2::make_real(r(id), n.type);
+      case F::V: return F2(n.type, F2::Formula::template create<F2::V>(v(id)));
+      case F::LV: return F2::make_lvar(n.type, LVar<Alloc2>(lv(id), alloc));
+      case F::E: return F2::make_exists(n.type, LVar<Alloc2>(lv(id), alloc), Sort<Alloc2>(sort(id), alloc));
+      case F::S: {
+        typename F2::LogicSet set(alloc);
+        for(int k = 0; k < n.arity; k += 2) {
+          set.push_back(battery::make_tuple(to_formula(child(id, k), alloc), to_formula(child(id, k + 1), alloc)));
+        }
+        return F2::make_set(std::move(set), n.type);
+      }
+      case F::Seq:
+      case F::ESeq: {
+        typename F2::Sequence seq(alloc);
+        for(int k = 0; k < n.arity; ++k) {
+          seq.push_back(to_formula(child(id, k), alloc));
+        }
+        if(n.kind == F::Seq) {
+          return F2::make_nary(sig(id), std::move(seq), n.type, false);
+        }
+        else {
+          return F2::make_nary(battery::string<Alloc2>(esig(id), alloc), std::move(seq), n.type);
+        }
+      }
+      default: assert(false); return F2::make_true();
+    }
+  }
+};
+
+} // namespace lala
+
+#endif
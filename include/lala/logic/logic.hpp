@@ -8,5 +8,9 @@
 #include "env.hpp"
 #include "diagnostics.hpp"
 #include "algorithm.hpp"
+#include "symbol_table.hpp"
+#include "flat_formula.hpp"
+#include "hash_consing.hpp"
+#include "serialization.hpp"
 
 #endif
@@ -0,0 +1,389 @@
+// Copyright 2024 Pierre Talbot
+
+#ifndef LALA_CORE_SERIALIZATION_HPP
+#define LALA_CORE_SERIALIZATION_HPP
+
+#include "battery/utility.hpp"
+#include "battery/vector.hpp"
+#include "battery/string.hpp"
+#include "ast.hpp"
+#include <cstring>
+#include <cstdio>
+#include <type_traits>
+#include <optional>
+#include <utility>
+
+#if !defined(__CUDA_ARCH__) && (defined(__unix__) || defined(__APPLE__))
+  #define LALA_CORE_HAS_MMAP
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
+namespace lala {
+
+/** A binary buffer starts with the magic number "LALA" followed by the version of the format.
+ * The version is incremented each time the encoding changes, and a `BinaryReader` refuses a buffer with a different version.
+ * Numbers are stored in the native byte order: the format is meant to share preprocessed models between processes of the same machine, not across architectures. */
+constexpr unsigned int binary_format_version = 1;
+
+/** A buffer of bytes in which values, formulas (see `serialize`), environments (see `VarEnv::serialize`) and stores (see `VStore::serialize`) are encoded.
+ * The header is written on construction. */
+template <class Allocator = battery::standard_allocator>
+class BinaryWriter {
+public:
+  using allocator_type = Allocator;
+
+private:
+  battery::vector<char, Allocator> bytes;
+
+public:
+  CUDA BinaryWriter(const allocator_type& alloc = allocator_type())
+   : bytes(alloc)
+  {
+    write_bytes("LALA", 4);
+    write(binary_format_version);
+  }
+
+  CUDA void write_bytes(const void* src, size_t n) {
+    size_t pos = bytes.size();
+    bytes.resize(pos + n);
+    memcpy(bytes.data() + pos, src, n);
+  }
+
+  template <class T>
+  CUDA void write(const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>, "BinaryWriter::write only supports trivially copyable types.");
+    write_bytes(&value, sizeof(T));
+  }
+
+  CUDA void write_string(const char* s, size_t n) {
+    write(static_cast<unsigned long long>(n));
+    write_bytes(s, n);
+  }
+
+  template <class Alloc2>
+  CUDA void write_string(const battery::string<Alloc2>& s) {
+    write_string(s.data(), s.size());
+  }
+
+  CUDA const char* data() const {
+    return bytes.data();
+  }
+
+  CUDA size_t size() const {
+    return bytes.size();
+  }
+};
+
+/** Decode a buffer produced by a `BinaryWriter`, for instance the content of a file mapped in memory (see `MappedFile`).
+ * The reader does not own the buffer, nor copy it.
+ * Once a read fails (truncated buffer or invalid header), `ok()` is `false` and all subsequent reads fail. */
+class BinaryReader {
+  const char* bytes;
+  size_t length;
+  size_t pos;
+  bool valid;
+
+public:
+  CUDA BinaryReader(const char* bytes, size_t length)
+   : bytes(bytes), length(length), pos(0), valid(true)
+  {
+    char magic[4];
+    unsigned int version;
+    valid = read_bytes(magic, 4) && memcmp(magic, "LALA", 4) == 0
+      && read(version) && version == binary_format_version;
+  }
+
+  CUDA bool ok() const {
+    return valid;
+  }
+
+  CUDA size_t remaining() const {
+    return length - pos;
+  }
+
+  /** A pointer to the next `n` bytes of the buffer, which are skipped, or `nullptr` if there are less than `n` bytes left. */
+  CUDA const char* skip(size_t n) {
+    if(!valid || remaining() < n) {
+      valid = false;
+      return nullptr;
+    }
+    const char* p = bytes + pos;
+    pos += n;
+    return p;
+  }
+
+  CUDA bool read_bytes(void* dst, size_t n) {
+    const char* p = skip(n);
+    if(p != nullptr) {
+      memcpy(dst, p, n);
+    }
+    return p != nullptr;
+  }
+
+  template <class T>
+  CUDA bool read(T& value) {
+    static_assert(std::is_trivially_copyable_v<T>, "BinaryReader::read only supports trivially copyable types.");
+    return read_bytes(&value, sizeof(T));
+  }
+
+  template <class Alloc>
+  CUDA bool read_string(battery::string<Alloc>& s, const Alloc& alloc = Alloc()) {
+    unsigned long long n;
+    if(!read(n) || remaining() < n) {
+      valid = false;
+      return false;
+    }
+    s = battery::string<Alloc>(static_cast<size_t>(n), alloc);
+    return read_bytes(s.data(), n);
+  }
+};
+
+template <class Alloc>
+CUDA void serialize(BinaryWriter<Alloc>& w, AVar v) {
+  w.write(static_cast<unsigned char>(v.is_untyped()));
+  w.write(v.aty());
+  w.write(v.vid());
+}
+
+CUDA inline bool deserialize_avar(BinaryReader& r, AVar& v) {
+  unsigned char untyped;
+  int aty, vid;
+  if(!r.read(untyped) || !r.read(aty) || !r.read(vid)) {
+    return false;
+  }
+  v = untyped ? AVar{} : AVar(aty, vid);
+  return true;
+}
+
+template <class Alloc, class Alloc2>
+CUDA NI void serialize(BinaryWriter<Alloc>& w, const Sort<Alloc2>& sort) {
+  w.write(static_cast<unsigned char>(sort.tag));
+  if(sort.is_set()) {
+    serialize(w, *sort.sub);
+  }
+}
+
+template <class Alloc>
+CUDA NI std::optional<Sort<Alloc>> deserialize_sort(BinaryReader& r, const Alloc& alloc = Alloc()) {
+  unsigned char tag;
+  if(!r.read(tag) || tag > Sort<Alloc>::Set) {
+    return {};
+  }
+  if(tag == Sort<Alloc>::Set) {
+    auto sub = deserialize_sort<Alloc>(r, alloc);
+    if(!sub.has_value()) {
+      return {};
+    }
+    return Sort<Alloc>(Sort<Alloc>::Set, std::move(*sub), alloc);
+  }
+  return Sort<Alloc>(static_cast<typename Sort<Alloc>::Tag>(tag));
+}
+
+/** Encode the formula `f` in pre-order: the kind and type of each node followed by its value or its children.
+ * The extended signature `ExtendedSig` must be a string (as the default one). */
+template <class Alloc, class Alloc2, class ExtendedSig>
+CUDA NI void serialize(BinaryWriter<Alloc>& w, const TFormula<Alloc2, ExtendedSig>& f) {
+  using F = TFormula<Alloc2, ExtendedSig>;
+  w.write(static_cast<unsigned char>(f.index()));
+  w.write(f.type());
+  switch(f.index()) {
+    case F::B: w.write(static_cast<unsigned char>(f.b())); break;
+    case F::Z: w.write(f.z()); break;
+    case F::R: {
+      w.write(battery::get<0>(f.r()));
+      w.write(battery::get<1>(f.r()));
+      break;
+    }
+    case F::S: {
+      w.write(static_cast<unsigned long long>(f.s().size()));
+      for(int i = 0; i < f.s().size(); ++i) {
+        serialize(w, battery::get<0>(f.s()[i]));
+        serialize(w, battery::get<1>(f.s()[i]));
+      }
+      break;
+    }
+    case F::V: serialize(w, f.v()); break;
+    case F::LV: w.write_string(f.lv()); break;
+    case F::E: {
+      w.write_string(battery::get<0>(f.exists()));
+      serialize(w, battery::get<1>(f.exists()));
+      break;
+    }
+    case F::Seq:
+    case F::ESeq: {
+      if(f.is(F::Seq)) {
+        w.write(static_cast<int>(f.sig()));
+      }
+      else {
+        w.write_string(f.esig().data(), f.esig().size());
+      }
+      const auto& children = f.is(F::Seq) ? f.seq() : f.eseq();
+      w.write(static_cast<unsigned long long>(children.size()));
+      for(int i = 0; i < children.size(); ++i) {
+        serialize(w, children[i]);
+      }
+      break;
+    }
+    default: assert(false);
+  }
+}
+
+/** Decode a formula encoded by `serialize`.
+ * \return An empty optional if the buffer is truncated or invalid. */
+template <class F>
+CUDA NI std::optional<F> deserialize_formula(BinaryReader& r, const typename F::allocator_type& alloc = typename F::allocator_type()) {
+  using Alloc = typename F::allocator_type;
+  unsigned char kind;
+  AType type;
+  if(!r.read(kind) || !r.read(type)) {
+    return {};
+  }
+  switch(kind) {
+    case F::B: {
+      unsigned char b;
+      if(!r.read(b)) { return {}; }
+      return F::make_bool(b != 0, type);
+    }
+    case F::Z: {
+      logic_int z;
+      if(!r.read(z)) { return {}; }
+      return F::make_z(z, type);
+    }
+    case F::R: {
+      double lb, ub;
+      if(!r.read(lb) || !r.read(ub)) { return {}; }
+      return F::make_real(lb, ub, type);
+    }
+    case F::S: {
+      unsigned long long n;
+      if(!r.read(n)) { return {}; }
+      typename F::LogicSet set(alloc);
+      for(unsigned long long i = 0; i < n; ++i) {
+        auto l = deserialize_formula<F>(r, alloc);
+        if(!l.has_value()) { return {}; }
+        auto u = deserialize_formula<F>(r, alloc);
+        if(!u.has_value()) { return {}; }
+        set.push_back(battery::make_tuple(std::move(*l), std::move(*u)));
+      }
+      return F::make_set(std::move(set), type);
+    }
+    case F::V: {
+      AVar v;
+      if(!deserialize_avar(r, v)) { return {}; }
+      return F(type, F::Formula::template create<F::V>(v));
+    }
+    case F::LV: {
+      LVar<Alloc> lv(alloc);
+      if(!r.read_string(lv, alloc)) { return {}; }
+      return F::make_lvar(type, std::move(lv));
+    }
+    case F::E: {
+      LVar<Alloc> lv(alloc);
+      if(!r.read_string(lv, alloc)) { return {}; }
+      auto sort = deserialize_sort<Alloc>(r, alloc);
+      if(!sort.has_value()) { return {}; }
+      return F::make_exists(type, std::move(lv), std::move(*sort));
+    }
+    case F::Seq:
+    case F::ESeq: {
+      int sig = 0;
+      battery::string<Alloc> esig(alloc);
+      if(kind == F::Seq ? !r.read(sig) : !r.read_string(esig, alloc)) {
+        return {};
+      }
+      unsigned long long n;
+      if(!r.read(n)) { return {}; }
+      typename F::Sequence children(alloc);
+      for(unsigned long long i = 0; i < n; ++i) {
+        auto child = deserialize_formula<F>(r, alloc);
+        if(!child.has_value()) { return {}; }
+        children.push_back(std::move(*child));
+      }
+      if(kind == F::Seq) {
+        return F::make_nary(static_cast<Sig>(sig), std::move(children), type, false);
+      }
+      else {
+        using ExtendedSig = std::decay_t<decltype(std::declval<const F&>().esig())>;
+        return F::make_nary(ExtendedSig(esig.data(), alloc), std::move(children), type);
+      }
+    }
+    default: return {};
+  }
+}
+
+/** Write the content of `w` in the file `path`.
+ * \return `false` if the file could not be written. */
+template <class Alloc>
+bool write_file(const char* path, const BinaryWriter<Alloc>& w) {
+  FILE* file = fopen(path, "wb");
+  if(file == nullptr) {
+    return false;
+  }
+  bool success = fwrite(w.data(), 1, w.size(), file) == w.size();
+  return fclose(file) == 0 && success;
+}
+
+#ifdef LALA_CORE_HAS_MMAP
+
+/** A read-only memory mapping of a file (only on the host of POSIX systems).
+ * Together with `BinaryReader`, it loads a serialized model without reading the whole file upfront, and the pages of the file are shared between the processes mapping it. */
+class MappedFile {
+  const char* bytes;
+  size_t length;
+
+public:
+  MappedFile(const char* path): bytes(nullptr), length(0) {
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+      return;
+    }
+    struct stat st;
+    if(fstat(fd, &st) == 0 && st.st_size > 0) {
+      void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if(p != MAP_FAILED) {
+        bytes = static_cast<const char*>(p);
+        length = st.st_size;
+      }
+    }
+    close(fd);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  MappedFile(MappedFile&& other): bytes(other.bytes), length(other.length) {
+    other.bytes = nullptr;
+    other.length = 0;
+  }
+
+  ~MappedFile() {
+    if(bytes != nullptr) {
+      munmap(const_cast<char*>(bytes), length);
+    }
+  }
+
+  bool is_open() const {
+    return bytes != nullptr;
+  }
+
+  const char* data() const {
+    return bytes;
+  }
+
+  size_t size() const {
+    return length;
+  }
+
+  BinaryReader reader() const {
+    return BinaryReader(bytes, length);
+  }
+};
+
+#endif
+
+} // namespace lala
+
+#endif
@@ -0,0 +1,147 @@
+// Copyright 2024 Pierre Talbot
+
+#ifndef LALA_CORE_SYMBOL_TABLE_HPP
+#define LALA_CORE_SYMBOL_TABLE_HPP
+
+#include "battery/utility.hpp"
+#include "battery/vector.hpp"
+#include "battery/string.hpp"
+#include "ast.hpp"
+#include <optional>
+
+namespace lala {
+
+/** FNV-1a hash of the first `n` characters of `s`. */
+CUDA inline size_t hash_chars(const char* s, size_t n) {
+  size_t h = 14695981039346656037ull;
+  for(size_t i = 0; i < n; ++i) {
+    h ^= static_cast<unsigned char>(s[i]);
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+/** A symbol table interning logical variables (names) into dense identifiers `0..size()-1`, in the order of their first insertion.
+ * Lookups are performed in expected constant time with an open-addressing hash table. */
+template <class Allocator>
+class SymbolTable {
+public:
+  using allocator_type = Allocator;
+  using this_type = SymbolTable<Allocator>;
+
+private:
+  battery::vector<LVar<Allocator>, Allocator> names;
+  /** Open-addressing table of identifiers (`-1` is an empty slot), its size is a power of two. */
+  battery::vector<int, Allocator> slots;
+
+  CUDA size_t mask() const {
+    return slots.size() - 1;
+  }
+
+  CUDA static bool equals(const LVar<Allocator>& name, const char* s, size_t n) {
+    if(name.size() != n) {
+      return false;
+    }
+    for(size_t i = 0; i < n; ++i) {
+      if(name[i] != s[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /** \return The slot of `s` if it is in the table, or the empty slot where it must be inserted otherwise. */
+  CUDA size_t slot_of(const char* s, size_t n) const {
+    size_t i = hash_chars(s, n) & mask();
+    while(slots[i] != -1 && !equals(names[slots[i]], s, n)) {
+      i = (i + 1) & mask();
+    }
+    return i;
+  }
+
+  CUDA NI void grow() {
+    battery::vector<int, Allocator> old(std::move(slots));
+    slots = battery::vector<int, Allocator>(battery::max(size_t{16}, old.size() * 2), -1, names.get_allocator());
+    for(int id = 0; id < names.size(); ++id) {
+      slots[slot_of(names[id].data(), names[id].size())] = id;
+    }
+  }
+
+public:
+  CUDA SymbolTable(const allocator_type& alloc = allocator_type())
+   : names(alloc), slots(alloc)
+  {}
+
+  template <class Alloc2>
+  CUDA SymbolTable(const SymbolTable<Alloc2>& other, const allocator_type& alloc = allocator_type())
+   : names(other.names, alloc), slots(other.slots, alloc)
+  {}
+
+  SymbolTable(const this_type&) = default;
+  SymbolTable(this_type&&) = default;
+  this_type& operator=(const this_type&) = default;
+  this_type& operator=(this_type&&) = default;
+
+  template <class Alloc2>
+  friend class SymbolTable;
+
+  CUDA allocator_type get_allocator() const {
+    return names.get_allocator();
+  }
+
+  /** The number of interned names. */
+  CUDA size_t size() const {
+    return names.size();
+  }
+
+  /** \return The identifier of `name`, which is added to the table if it does not exist yet. */
+  template <class Alloc2>
+  CUDA NI int intern(const LVar<Alloc2>& name) {
+    // We keep the load factor below 1/2.
+    if(2 * (names.size() + 1) > slots.size()) {
+      grow();
+    }
+    size_t i = slot_of(name.data(), name.size());
+    if(slots[i] == -1) {
+      slots[i] = names.size();
+      names.push_back(LVar<Allocator>(name, names.get_allocator()));
+    }
+    return slots[i];
+  }
+
+  /** \return The identifier of `name` if it was interned. */
+  template <class Alloc2>
+  CUDA std::optional<int> find(const LVar<Alloc2>& name) const {
+    return find(name.data(), name.size());
+  }
+
+  CUDA std::optional<int> find(const char* s, size_t n) const {
+    if(slots.size() == 0) {
+      return {};
+    }
+    size_t i = slot_of(s, n);
+    if(slots[i] == -1) {
+      return {};
+    }
+    return slots[i];
+  }
+
+  CUDA const LVar<Allocator>& operator[](int id) const {
+    return names[id];
+  }
+
+  /** Remove the names with an identifier greater or equal to `n`. */
+  CUDA NI void resize(size_t n) {
+    if(n < names.size()) {
+      names.resize(n);
+      slots = battery::vector<int, Allocator>(slots.size(), -1, names.get_allocator());
+      for(int id = 0; id < names.size(); ++id) {
+        slots[slot_of(names[id].data(), names[id].size())] = id;
+      }
+    }
+  }
+};
+
+} // namespace lala
+
+#endif
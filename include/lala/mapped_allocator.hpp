@@ -0,0 +1,298 @@
+// Copyright 2024 Pierre Talbot
+
+#ifndef LALA_CORE_MAPPED_ALLOCATOR_HPP
+#define LALA_CORE_MAPPED_ALLOCATOR_HPP
+
+#include "battery/utility.hpp"
+#include "battery/allocator.hpp"
+#include "battery/vector.hpp"
+#include "logic/serialization.hpp"
+#include "vstore.hpp"
+#include <type_traits>
+
+#ifdef LALA_CORE_HAS_MMAP
+
+namespace lala {
+
+/** An allocator backing arrays with a region of a file (or of a shared memory segment, e.g., obtained with `shm_open`), called the _image_ (only on the host of POSIX systems).
+ * Each allocation of exactly the size of the image is a private mapping (`MAP_PRIVATE`) of this region: the array initially shares the pages of the image with all the processes mapping the same file, and the kernel copies a page the first time it is modified ("copy-on-write").
+ * Any other allocation is delegated to `battery::standard_allocator`.
+ *
+ * It is meant to back a `VStore` (and its snapshots) shared by many solver processes searching from the same root node (see `write_store_image` and `load_store_image`), so only the pages of the store modified by a worker are resident in its memory.
+ * Since constructing or copying an array writes all its elements, the pages are not shared anymore after a copy: `share` gives back the pages identical to the image, and `reset` gives back all the pages.
+ *
+ * Copies of an allocator share the same image, hence it can be passed by value as the `Allocator` parameter of `VStore`.
+ * The allocator is not thread-safe and must not be shared among several threads. */
+class mapped_allocator {
+public:
+  using upstream_type = battery::standard_allocator;
+
+private:
+  struct control_block {
+    int fd;
+    size_t offset;
+    size_t bytes;
+    /** A read-only view of the image, to compare the pages of the arrays with the image. */
+    const char* image;
+    /** The private mappings currently allocated. */
+    battery::vector<void*, upstream_type> mappings;
+    size_t counter;
+  };
+
+  control_block* block;
+  upstream_type upstream;
+
+  static size_t page_size() {
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  }
+
+  void drop() {
+    if(block != nullptr && --block->counter == 0) {
+      for(int i = 0; i < block->mappings.size(); ++i) {
+        munmap(block->mappings[i], block->bytes);
+      }
+      if(block->image != nullptr) {
+        munmap(const_cast<char*>(block->image), block->bytes);
+      }
+      if(block->fd >= 0) {
+        close(block->fd);
+      }
+      delete block;
+    }
+    block = nullptr;
+  }
+
+  int mapping_of(const void* data) const {
+    if(block != nullptr) {
+      for(int i = 0; i < block->mappings.size(); ++i) {
+        if(block->mappings[i] == data) {
+          return i;
+        }
+      }
+    }
+    return -1;
+  }
+
+  /** Replace the pages `[from, to)` of the mapping `data` by the pages of the image.
+   * \return `false` if the pages could not be mapped. */
+  bool remap(char* data, size_t from, size_t to) {
+    void* p = mmap(data + from, to - from, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, block->fd, block->offset + from);
+    return p != MAP_FAILED;
+  }
+
+public:
+  /** An allocator without image, all the allocations are delegated to `battery::standard_allocator`. */
+  mapped_allocator(): block(nullptr) {}
+
+  /** Map the `bytes` bytes starting at `offset` of the file descriptor `fd`, which is duplicated and can be closed afterwards.
+   * \pre `offset` is a multiple of the page size. */
+  mapped_allocator(int fd, size_t offset, size_t bytes)
+   : block(new control_block{-1, offset, bytes, nullptr, battery::vector<void*, upstream_type>(), 1})
+  {
+    if(fd >= 0 && bytes > 0) {
+      block->fd = dup(fd);
+      void* p = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, block->fd, offset);
+      if(p != MAP_FAILED) {
+        block->image = static_cast<const char*>(p);
+      }
+    }
+  }
+
+  /** Map the `bytes` bytes starting at `offset` of the file `path`, see the constructor above. */
+  mapped_allocator(const char* path, size_t offset, size_t bytes)
+   : mapped_allocator(-1, offset, bytes)
+  {
+    int fd = open(path, O_RDONLY);
+    if(fd >= 0) {
+      *this = mapped_allocator(fd, offset, bytes);
+      close(fd);
+    }
+  }
+
+  mapped_allocator(const mapped_allocator& other): block(other.block) {
+    if(block != nullptr) {
+      block->counter++;
+    }
+  }
+
+  mapped_allocator(mapped_allocator&& other): block(other.block) {
+    other.block = nullptr;
+  }
+
+  mapped_allocator& operator=(const mapped_allocator& other) {
+    if(this != &other) {
+      drop();
+      block = other.block;
+      if(block != nullptr) {
+        block->counter++;
+      }
+    }
+    return *this;
+  }
+
+  mapped_allocator& operator=(mapped_allocator&& other) {
+    if(this != &other) {
+      drop();
+      block = other.block;
+      other.block = nullptr;
+    }
+    return *this;
+  }
+
+  ~mapped_allocator() {
+    drop();
+  }
+
+  /** \return `true` if the image could be mapped. */
+  bool is_mapped() const {
+    return block != nullptr && block->image != nullptr;
+  }
+
+  /** The size of the image in bytes, which is also the size of the allocations served by private mappings. */
+  size_t image_size() const {
+    return block == nullptr ? 0 : block->bytes;
+  }
+
+  /** The read-only view of the image. */
+  const void* image() const {
+    return block == nullptr ? nullptr : block->image;
+  }
+
+  void* allocate(size_t bytes) {
+    if(bytes == 0) {
+      return nullptr;
+    }
+    if(is_mapped() && bytes == block->bytes) {
+      void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, block->fd, block->offset);
+      if(p != MAP_FAILED) {
+        block->mappings.push_back(p);
+        return p;
+      }
+    }
+    return upstream.allocate(bytes);
+  }
+
+  void deallocate(void* data) {
+    int i = mapping_of(data);
+    if(i == -1) {
+      upstream.deallocate(data);
+      return;
+    }
+    munmap(data, block->bytes);
+    block->mappings[i] = block->mappings.back();
+    block->mappings.pop_back();
+  }
+
+  /** \return `true` if `data` was allocated as a private mapping of the image. */
+  bool is_mapping(const void* data) const {
+    return mapping_of(data) != -1;
+  }
+
+  /** Give back the pages of the mapping `data` that are identical to the image, so they are shared again with the other processes.
+   * It is useful after copying an array allocated with this allocator (e.g., a `VStore` or a snapshot), in which case only the modified pages remain private.
+   * The content of the array is unchanged.
+   * \return The number of pages of `data` identical to the image and shared again (the pages that could not be mapped remain private), or `0` if `data` is not a mapping of this allocator. */
+  size_t share(const void* data) {
+    if(!is_mapping(data)) {
+      return 0;
+    }
+    char* bytes = static_cast<char*>(const_cast<void*>(data));
+    size_t page = page_size();
+    size_t shared = 0;
+    size_t run = 0;
+    size_t i = 0;
+    for(; i < block->bytes; i += page) {
+      size_t n = battery::min(page, block->bytes - i);
+      if(memcmp(bytes + i, block->image + i, n) != 0) {
+        if(run < i && remap(bytes, run, i)) {
+          shared += (i - run) / page;
+        }
+        run = i + page;
+      }
+    }
+    if(run < i && remap(bytes, run, i)) {
+      shared += (i - run) / page;
+    }
+    return shared;
+  }
+
+  /** Give back all the pages of the mapping `data`, hence its content is equal to the image.
+   * It is useful to initialize an array without writing its elements, since constructing the array (e.g., with `VStore(aty, n, alloc)`) overwrites the image.
+   * \pre `data` is a mapping of this allocator and the array does not have non-trivial destructors.
+   * \return `false` if `data` is not a mapping of this allocator or if the pages could not be mapped. */
+  bool reset(const void* data) {
+    return is_mapping(data) && remap(static_cast<char*>(const_cast<void*>(data)), 0, block->bytes);
+  }
+
+  bool operator==(const mapped_allocator& other) const {
+    return block == other.block;
+  }
+
+  bool operator!=(const mapped_allocator& other) const {
+    return block != other.block;
+  }
+};
+
+/** The universes of a store image start at this offset, which is a multiple of the page size of the usual systems. */
+constexpr size_t store_image_alignment = 1 << 16;
+
+/** Write the store `store` in the file `path` as an image that can be mapped by `load_store_image`.
+ * The image starts with the header of a `BinaryWriter`, the abstract type, whether the store is bot, the number of variables and the size of a universe.
+ * The universes are then stored as they are in memory, starting at `store_image_alignment`, hence the universe must not hold pointers or resources (e.g., intervals or bitsets).
+ * \return `false` if the file could not be written. */
+template <class U, class Alloc>
+bool write_store_image(const char* path, const VStore<U, Alloc>& store) {
+  using local_universe = typename VStore<U, Alloc>::local_universe;
+  static_assert(std::is_trivially_destructible_v<local_universe>, "write_store_image requires a universe without pointers or resources.");
+  BinaryWriter<> w;
+  w.write(store.aty());
+  w.write(static_cast<unsigned char>(store.is_bot().value()));
+  w.write(static_cast<unsigned long long>(store.vars()));
+  w.write(static_cast<unsigned long long>(sizeof(local_universe)));
+  battery::vector<char> padding(store_image_alignment - w.size(), 0);
+  w.write_bytes(padding.data(), padding.size());
+  for(int i = 0; i < store.vars(); ++i) {
+    local_universe u(store[i]);
+    w.write_bytes(&u, sizeof(u));
+  }
+  return write_file(path, w);
+}
+
+/** Load a store written by `write_store_image` by mapping the file `path` in memory, without reading or copying the universes.
+ * The store is at the root level: the modified pages are copied when the store is modified, and the workers copying this store can call `get_allocator().share` to share the unmodified pages again.
+ * \return An empty optional if the file cannot be mapped or was written with a different universe. */
+template <class U>
+std::optional<VStore<U, mapped_allocator>> load_store_image(const char* path) {
+  using store_type = VStore<U, mapped_allocator>;
+  static_assert(std::is_trivially_destructible_v<U> && sizeof(U) == sizeof(typename store_type::local_universe),
+    "load_store_image requires a universe without pointers or resources, and with the same representation as its local universe.");
+  AType aty;
+  unsigned char bot;
+  unsigned long long n, universe_size;
+  {
+    MappedFile file(path);
+    BinaryReader r = file.reader();
+    if(!r.read(aty) || !r.read(bot) || !r.read(n) || !r.read(universe_size)
+     || universe_size != sizeof(U) || file.size() < store_image_alignment + n * sizeof(U))
+    {
+      return {};
+    }
+  }
+  mapped_allocator alloc(path, store_image_alignment, n * sizeof(U));
+  if(n > 0 && !alloc.is_mapped()) {
+    return {};
+  }
+  store_type store(aty, n, alloc);
+  if(n > 0 && !alloc.reset(&store[0])) {
+    return {};
+  }
+  if(bot) {
+    store.meet_bot();
+  }
+  return std::move(store);
+}
+
+} // namespace lala
+
+#endif
+#endif
@@ -0,0 +1,199 @@
+// Copyright 2024 Pierre Talbot
+
+#ifndef LALA_CORE_PROFILED_FIXPOINT_HPP
+#define LALA_CORE_PROFILED_FIXPOINT_HPP
+
+#include "fixpoint.hpp"
+#include "battery/allocator.hpp"
+#include "battery/vector.hpp"
+
+#ifndef __CUDA_ARCH__
+  #include <chrono>
+  #include <ostream>
+#endif
+
+namespace lala {
+
+/** Profiling policy disabling the profiling: `ProfiledIteration<Engine, NoProfiler>` is exactly `Engine`. */
+struct NoProfiler {
+  static constexpr bool enabled = false;
+};
+
+/** Statistics on each deduction operation collected during one or several fixpoint computations, stored as flat arrays indexed by the deduction number.
+ * For each deduction `i`, we record:
+ *   - `calls[i]`: the number of times `a.deduce(i)` was called.
+ *   - `changes[i]`: the number of times `a.deduce(i)` returned `true`.
+ *   - `nanoseconds[i]`: the cumulative time spent in `a.deduce(i)`.
+ *   - `last_iteration[i]`: the value of `calls[i]` the last time `a.deduce(i)` returned `true` (`0` if it never did). For strategies executing every deduction once per iteration (e.g., `GaussSeidelIteration` or the asynchronous iterations), this is the iteration in which the deduction fired for the last time.
+ *
+ * The counters are not atomic: it relies on the fact that, in all fixpoint strategies, a deduction is never executed by two threads at the same time. */
+template <class Allocator = battery::standard_allocator>
+class DeductionProfiler {
+public:
+  static constexpr bool enabled = true;
+  using allocator_type = Allocator;
+  using counters_type = battery::vector<unsigned long long, allocator_type>;
+
+  counters_type calls;
+  counters_type changes;
+  counters_type nanoseconds;
+  counters_type last_iteration;
+
+  CUDA DeductionProfiler(const allocator_type& alloc = allocator_type())
+   : calls(alloc), changes(alloc), nanoseconds(alloc), last_iteration(alloc)
+  {}
+
+  /** Reset the counters and prepare them for `n` deductions. */
+  CUDA NI void reset(size_t n) {
+    calls = counters_type(n, 0, calls.get_allocator());
+    changes = counters_type(n, 0, changes.get_allocator());
+    nanoseconds = counters_type(n, 0, nanoseconds.get_allocator());
+    last_iteration = counters_type(n, 0, last_iteration.get_allocator());
+  }
+
+  CUDA size_t num_deductions() const {
+    return calls.size();
+  }
+
+  /** A timestamp in nanoseconds, only meaningful to compute durations. */
+  CUDA INLINE static unsigned long long now() {
+  #ifdef __CUDA_ARCH__
+    unsigned long long t;
+    asm volatile("mov.u64 %0, %%globaltimer;" : "=l"(t));
+    return t;
+  #else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  #endif
+  }
+
+  CUDA INLINE void record(size_t i, bool has_changed, unsigned long long ns) {
+    ++calls[i];
+    nanoseconds[i] += ns;
+    if(has_changed) {
+      ++changes[i];
+      last_iteration[i] = calls[i];
+    }
+  }
+
+  /** Deductions which never changed the abstract element. */
+  CUDA NI size_t num_dead() const {
+    size_t dead = 0;
+    for(size_t i = 0; i < calls.size(); ++i) {
+      dead += (calls[i] > 0 && changes[i] == 0);
+    }
+    return dead;
+  }
+
+#ifndef __CUDA_ARCH__
+  /** One line per deduction with the columns `deduction,calls,changes,nanoseconds,last_iteration`. */
+  void print_csv(std::ostream& s) const {
+    s << "deduction,calls,changes,nanoseconds,last_iteration\n";
+    for(size_t i = 0; i < calls.size(); ++i) {
+      s << i << "," << calls[i] << "," << changes[i] << "," << nanoseconds[i] << "," << last_iteration[i] << "\n";
+    }
+  }
+
+  /** An array of objects `{"deduction": i, "calls": ..., "changes": ..., "nanoseconds": ..., "last_iteration": ...}`. */
+  void print_json(std::ostream& s) const {
+    s << "[";
+    for(size_t i = 0; i < calls.size(); ++i) {
+      s << (i == 0 ? "\n" : ",\n")
+        << "  {\"deduction\": " << i
+        << ", \"calls\": " << calls[i]
+        << ", \"changes\": " << changes[i]
+        << ", \"nanoseconds\": " << nanoseconds[i]
+        << ", \"last_iteration\": " << last_iteration[i] << "}";
+    }
+    s << "\n]\n";
+  }
+#endif
+};
+
+/** A view of the abstract element `A` forwarding the deduction interface to `a` and recording each call to `deduce` in the profiler.
+ * The hook `deduction_dependencies` is forwarded if available, so the view can be used with `EventDrivenIteration` too. */
+template <class A, class Profiler>
+class ProfiledDeductions {
+  A& a;
+  Profiler& profiler;
+
+public:
+  CUDA ProfiledDeductions(A& a, Profiler& profiler): a(a), profiler(profiler) {}
+
+  CUDA size_t num_deductions() const {
+    return a.num_deductions();
+  }
+
+  CUDA bool deduce(size_t i) {
+    unsigned long long start = Profiler::now();
+    bool has_changed = a.deduce(i);
+    profiler.record(i, has_changed, Profiler::now() - start);
+    return has_changed;
+  }
+
+  CUDA local::B is_bot() const {
+    return a.is_bot();
+  }
+
+  CUDA decltype(auto) deduction_dependencies(size_t i) const requires requires(A& b, size_t j) { b.deduction_dependencies(j); } {
+    return a.deduction_dependencies(i);
+  }
+};
+
+/** Instrument the fixpoint engine `Engine` (e.g., `GaussSeidelIteration`, `AsynchronousIterationCPU`, `BlockAsynchronousIterationGPU`) to collect statistics on each deduction operation in `Profiler`.
+ * The profiling is enabled at compile-time by the policy: with `NoProfiler`, the calls are directly forwarded to `Engine`.
+ * The profiler is not reset between fixpoint computations (unless the number of deductions changes), so the statistics accumulate over a whole search.
+ * On GPU, the profiler must be shared among the threads and its counters allocated before calling `fixpoint`, e.g., with `profiler.reset(a.num_deductions())`. */
+template <class Engine, class Profiler = DeductionProfiler<>>
+class ProfiledIteration {
+  Engine& engine;
+  Profiler* profiler;
+
+  template <class A>
+  CUDA void prepare(A& a) {
+  #ifndef __CUDA_ARCH__
+    if(profiler->num_deductions() != a.num_deductions()) {
+      profiler->reset(a.num_deductions());
+    }
+  #endif
+  }
+
+public:
+  CUDA ProfiledIteration(Engine& engine, Profiler& profiler): engine(engine), profiler(&profiler) {}
+  CUDA ProfiledIteration(Engine& engine): engine(engine), profiler(nullptr) {
+    static_assert(!Profiler::enabled, "A profiler must be provided when the profiling is enabled.");
+  }
+
+  CUDA void barrier() {
+    engine.barrier();
+  }
+
+  template <class A>
+  CUDA local::B iterate(A& a) {
+    if constexpr(Profiler::enabled) {
+      prepare(a);
+      ProfiledDeductions<A, Profiler> view(a, *profiler);
+      return engine.iterate(view);
+    }
+    else {
+      return engine.iterate(a);
+    }
+  }
+
+  /** Forward to `engine.fixpoint(a, args...)`, hence the same overloads as in `Engine` are available. */
+  template <class A, class... Args>
+  CUDA decltype(auto) fixpoint(A& a, Args&&... args) {
+    if constexpr(Profiler::enabled) {
+      prepare(a);
+      ProfiledDeductions<A, Profiler> view(a, *profiler);
+      return engine.fixpoint(view, std::forward<Args>(args)...);
+    }
+    else {
+      return engine.fixpoint(a, std::forward<Args>(args)...);
+    }
+  }
+};
+
+} // namespace lala
+
+#endif
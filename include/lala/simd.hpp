@@ -0,0 +1,703 @@
+// Copyright 2024 Pierre Talbot
+
+#ifndef LALA_CORE_SIMD_HPP
+#define LALA_CORE_SIMD_HPP
+
+#include "battery/utility.hpp"
+#include "battery/memory.hpp"
+#include <type_traits>
+
+#if !defined(__CUDA_ARCH__) && defined(__AVX512F__)
+  #define LALA_SIMD_AVX512
+  #include <immintrin.h>
+#elif !defined(__CUDA_ARCH__) && defined(__AVX2__)
+  #define LALA_SIMD_AVX2
+  #include <immintrin.h>
+#endif
+
+/** Kernels over contiguous arrays of values, used to implement the store-wide lattice operations (e.g., `VStoreSoA::meet` or `operator<=`).
+ * The stores of intervals `VStore<Interval<...>>` are processed as arrays in which the lower and upper bounds are interleaved (see `flat_interval`).
+ * When compiling for the CPU with AVX-512 or AVX2 instructions enabled (e.g., with `-march=native`), the kernels over `int` and `double` are vectorized.
+ * Otherwise, or on the GPU, the scalar version is used (which can still be auto-vectorized by the compiler).
+ * All kernels work on any arithmetic type. */
+namespace lala::simd {
+
+/** The number of bits of the vector registers used by the kernels (`0` for the scalar fallback). */
+#if defined(LALA_SIMD_AVX512)
+  inline constexpr int width = 512;
+#elif defined(LALA_SIMD_AVX2)
+  inline constexpr int width = 256;
+#else
+  inline constexpr int width = 0;
+#endif
+
+/** `true` if an array of abstract universes `U` can be seen as an array of its `value_type` and processed by the kernels.
+ * This is the case of the arithmetic bounds `ArithBound` (e.g., `ZLB`, `FUB`) over local memory. */
+template <class U>
+concept flat_universe = requires {
+    typename U::memory_type;
+    typename U::value_type;
+    U::is_lower_bound;
+    U::is_upper_bound;
+  }
+  && std::is_same_v<typename U::memory_type, battery::local_memory>
+  && std::is_arithmetic_v<typename U::value_type>
+  && sizeof(U) == sizeof(typename U::value_type)
+  && std::is_standard_layout_v<U>
+  && (U::is_lower_bound != U::is_upper_bound);
+
+/** Arrays of `U` and `V` can be processed together by the kernels. */
+template <class U, class V>
+concept same_flat_universe = flat_universe<U> && flat_universe<V> && std::is_same_v<U, V>;
+
+/** `true` if an array of `n` intervals `U` can be seen as an array of `2n` values, in which the lower and upper bounds are interleaved.
+ * This is the case of `Interval` over arithmetic bounds in local memory (e.g., `Interval<local::ZLB>`).
+ * The bound stored first depends on the implementation of `battery::tuple` (see `lb_first`). */
+template <class U>
+concept flat_interval = requires {
+    typename U::LB;
+    typename U::UB;
+  }
+  && flat_universe<typename U::LB>
+  && flat_universe<typename U::UB>
+  && U::LB::is_lower_bound
+  && std::is_same_v<typename U::LB::value_type, typename U::UB::value_type>
+  && sizeof(U) == 2 * sizeof(typename U::LB::value_type);
+
+template <class U, class V>
+concept same_flat_interval = flat_interval<U> && flat_interval<V> && std::is_same_v<U, V>;
+
+template <flat_universe U>
+CUDA INLINE typename U::value_type* values(U* data) {
+  return reinterpret_cast<typename U::value_type*>(data);
+}
+
+template <flat_universe U>
+CUDA INLINE const typename U::value_type* values(const U* data) {
+  return reinterpret_cast<const typename U::value_type*>(data);
+}
+
+template <flat_interval U>
+CUDA INLINE typename U::LB::value_type* values(U* data) {
+  return reinterpret_cast<typename U::LB::value_type*>(data);
+}
+
+template <flat_interval U>
+CUDA INLINE const typename U::LB::value_type* values(const U* data) {
+  return reinterpret_cast<const typename U::LB::value_type*>(data);
+}
+
+/** \return `true` if the lower bound of an interval `U` is stored before its upper bound (the compiler folds this function to a constant). */
+template <flat_interval U>
+CUDA INLINE bool lb_first() {
+  U itv(typename U::LB(0), typename U::UB(1));
+  return values(&itv)[0] == 0;
+}
+
+namespace scalar {
+  template <class T>
+  CUDA INLINE bool max_into(T* a, const T* b, size_t from, size_t n) {
+    bool has_changed = false;
+    for(size_t i = from; i < n; ++i) {
+      has_changed |= b[i] > a[i];
+      a[i] = battery::max(a[i], b[i]);
+    }
+    return has_changed;
+  }
+
+  template <class T>
+  CUDA INLINE bool min_into(T* a, const T* b, size_t from, size_t n) {
+    bool has_changed = false;
+    for(size_t i = from; i < n; ++i) {
+      has_changed |= b[i] < a[i];
+      a[i] = battery::min(a[i], b[i]);
+    }
+    return has_changed;
+  }
+
+  template <class T>
+  CUDA INLINE bool any_gt(const T* a, const T* b, size_t from, size_t n) {
+    bool res = false;
+    for(size_t i = from; i < n; ++i) {
+      res |= a[i] > b[i];
+    }
+    return res;
+  }
+
+  template <class T>
+  CUDA INLINE bool any_neq(const T* a, const T* b, size_t from, size_t n) {
+    bool res = false;
+    for(size_t i = from; i < n; ++i) {
+      res |= a[i] != b[i];
+    }
+    return res;
+  }
+
+  template <class T>
+  CUDA INLINE bool any_eq(const T* a, T k, size_t from, size_t n) {
+    bool res = false;
+    for(size_t i = from; i < n; ++i) {
+      res |= a[i] == k;
+    }
+    return res;
+  }
+
+  CUDA INLINE bool even_lane(size_t i, bool even) {
+    return (i % 2 == 0) == even;
+  }
+
+  template <class T>
+  CUDA INLINE bool max_min_into(T* a, const T* b, size_t from, size_t n, bool max_even) {
+    bool has_changed = false;
+    for(size_t i = from; i < n; ++i) {
+      if(even_lane(i, max_even)) {
+        has_changed |= b[i] > a[i];
+        a[i] = battery::max(a[i], b[i]);
+      }
+      else {
+        has_changed |= b[i] < a[i];
+        a[i] = battery::min(a[i], b[i]);
+      }
+    }
+    return has_changed;
+  }
+
+  template <class T>
+  CUDA INLINE bool any_gt_lt(const T* a, const T* b, size_t from, size_t n, bool gt_even) {
+    bool res = false;
+    for(size_t i = from; i < n; ++i) {
+      res |= even_lane(i, gt_even) ? a[i] > b[i] : a[i] < b[i];
+    }
+    return res;
+  }
+
+  template <class T>
+  CUDA INLINE bool any_neq_pairs(const T* a, T k1, T k2, size_t from, size_t n) {
+    bool res = false;
+    for(size_t i = from; i + 1 < n; i += 2) {
+      res |= a[i] != a[i + 1] || a[i] == k1 || a[i] == k2;
+    }
+    return res;
+  }
+
+  /** \return The word `x` with its bits in reverse order. */
+  CUDA INLINE unsigned long long reverse_bits(unsigned long long x) {
+    x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+    x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+    x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    x = ((x >> 8) & 0x00FF00FF00FF00FFULL) | ((x & 0x00FF00FF00FF00FFULL) << 8);
+    x = ((x >> 16) & 0x0000FFFF0000FFFFULL) | ((x & 0x0000FFFF0000FFFFULL) << 16);
+    return (x >> 32) | (x << 32);
+  }
+
+  CUDA INLINE void reverse_bits(unsigned long long* out, const unsigned long long* in, size_t from, size_t n) {
+    for(size_t i = from; i < n; ++i) {
+      out[i] = reverse_bits(in[n - 1 - i]);
+    }
+  }
+}
+
+/** Reverse the bits of the array `in` of `n` words, seen as a single bitset of `64 * n` bits: `out[i]` is the word `in[n-1-i]` with its bits in reverse order.
+ * `out` and `in` must not overlap.
+ * With AVX2, four words are reversed at once: the bytes are reversed with a shuffle, and the bits inside each byte with a lookup table of 16 entries per nibble. */
+CUDA INLINE void reverse_bits(unsigned long long* out, const unsigned long long* in, size_t n) {
+  size_t i = 0;
+#if defined(LALA_SIMD_AVX512) || defined(LALA_SIMD_AVX2)
+  const __m256i bytes = _mm256_setr_epi8(
+    7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+    7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+  const __m256i rev_hi = _mm256_setr_epi8(
+    0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE, 0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF,
+    0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE, 0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF);
+  const __m256i rev_lo = _mm256_slli_epi16(rev_hi, 4);
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  for(; i + 4 <= n; i += 4) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + n - 4 - i));
+    x = _mm256_permute4x64_epi64(x, 0x1B);
+    x = _mm256_shuffle_epi8(x, bytes);
+    __m256i lo = _mm256_shuffle_epi8(rev_lo, _mm256_and_si256(x, nibble));
+    __m256i hi = _mm256_shuffle_epi8(rev_hi, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_or_si256(lo, hi));
+  }
+#endif
+  scalar::reverse_bits(out, in, i, n);
+}
+
+/** `a[i] = max(a[i], b[i])` for all `i < n`.
+ * \return `true` if `a` has changed. */
+template <class T>
+CUDA INLINE bool max_into(T* a, const T* b, size_t n) {
+  size_t i = 0;
+  bool has_changed = false;
+#if defined(LALA_SIMD_AVX512)
+  if constexpr(std::is_same_v<T, int>) {
+    __mmask16 changed = 0;
+    for(; i + 16 <= n; i += 16) {
+      __m512i x = _mm512_loadu_si512(a + i);
+      __m512i y = _mm512_loadu_si512(b + i);
+      changed |= _mm512_cmpgt_epi32_mask(y, x);
+      _mm512_storeu_si512(a + i, _mm512_max_epi32(x, y));
+    }
+    has_changed = changed != 0;
+  }
+  else if constexpr(std::is_same_v<T, double>) {
+    __mmask8 changed = 0;
+    for(; i + 8 <= n; i += 8) {
+      __m512d x = _mm512_loadu_pd(a + i);
+      __m512d y = _mm512_loadu_pd(b + i);
+      changed |= _mm512_cmp_pd_mask(y, x, _CMP_GT_OQ);
+      _mm512_storeu_pd(a + i, _mm512_max_pd(x, y));
+    }
+    has_changed = changed != 0;
+  }
+#elif defined(LALA_SIMD_AVX2)
+  if constexpr(std::is_same_v<T, int>) {
+    __m256i changed = _mm256_setzero_si256();
+    for(; i + 8 <= n; i += 8) {
+      __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+      __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+      changed = _mm256_or_si256(changed, _mm256_cmpgt_epi32(y, x));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(a + i), _mm256_max_epi32(x, y));
+    }
+    has_changed = !_mm256_testz_si256(changed, changed);
+  }
+  else if constexpr(std::is_same_v<T, double>) {
+    __m256d changed = _mm256_setzero_pd();
+    for(; i + 4 <= n; i += 4) {
+      __m256d x = _mm256_loadu_pd(a + i);
+      __m256d y = _mm256_loadu_pd(b + i);
+      changed = _mm256_or_pd(changed, _mm256_cmp_pd(y, x, _CMP_GT_OQ));
+      _mm256_storeu_pd(a + i, _mm256_max_pd(x, y));
+    }
+    has_changed = _mm256_movemask_pd(changed) != 0;
+  }
+#endif
+  return scalar::max_into(a, b, i, n) || has_changed;
+}
+
+/** `a[i] = min(a[i], b[i])` for all `i < n`.
+ * \return `true` if `a` has changed. */
+template <class T>
+CUDA INLINE bool min_into(T* a, const T* b, size_t n) {
+  size_t i = 0;
+  bool has_changed = false;
+#if defined(LALA_SIMD_AVX512)
+  if constexpr(std::is_same_v<T, int>) {
+    __mmask16 changed = 0;
+    for(; i + 16 <= n; i += 16) {
+      __m512i x = _mm512_loadu_si512(a + i);
+      __m512i y = _mm512_loadu_si512(b + i);
+      changed |= _mm512_cmpgt_epi32_mask(x, y);
+      _mm512_storeu_si512(a + i, _mm512_min_epi32(x, y));
+    }
+    has_changed = changed != 0;
+  }
+  else if constexpr(std::is_same_v<T, double>) {
+    __mmask8 changed = 0;
+    for(; i + 8 <= n; i += 8) {
+      __m512d x = _mm512_loadu_pd(a + i);
+      __m512d y = _mm512_loadu_pd(b + i);
+      changed |= _mm512_cmp_pd_mask(y, x, _CMP_LT_OQ);
+      _mm512_storeu_pd(a + i, _mm512_min_pd(x, y));
+    }
+    has_changed = changed != 0;
+  }
+#elif defined(LALA_SIMD_AVX2)
+  if constexpr(std::is_same_v<T, int>) {
+    __m256i changed = _mm256_setzero_si256();
+    for(; i + 8 <= n; i += 8) {
+      __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+      __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+      changed = _mm256_or_si256(changed, _mm256_cmpgt_epi32(x, y));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(a + i), _mm256_min_epi32(x, y));
+    }
+    has_changed = !_mm256_testz_si256(changed, changed);
+  }
+  else if constexpr(std::is_same_v<T, double>) {
+    __m256d changed = _mm256_setzero_pd();
+    for(; i + 4 <= n; i += 4) {
+      __m256d x = _mm256_loadu_pd(a + i);
+      __m256d y = _mm256_loadu_pd(b + i);
+      changed = _mm256_or_pd(changed, _mm256_cmp_pd(y, x, _CMP_LT_OQ));
+      _mm256_storeu_pd(a + i, _mm256_min_pd(x, y));
+    }
+    has_changed = _mm256_movemask_pd(changed) != 0;
+  }
+#endif
+  return scalar::min_into(a, b, i, n) || has_changed;
+}
+
+/** \return `true` if `a[i] > b[i]` for some `i < n`. */
+template <class T>
+CUDA INLINE bool any_gt(const T* a, const T* b, size_t n) {
+  size_t i = 0;
+  bool res = false;
+#if defined(LALA_SIMD_AVX512)
+  if constexpr(std::is_same_v<T, int>) {
+    __mmask16 gt = 0;
+    for(; i + 16 <= n; i += 16) {
+      gt |= _mm512_cmpgt_epi32_mask(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+    }
+    res = gt != 0;
+  }
+  else if constexpr(std::is_same_v<T, double>) {
+    __mmask8 gt = 0;
+    for(; i + 8 <= n; i += 8) {
+      gt |= _mm512_cmp_pd_mask(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), _CMP_GT_OQ);
+    }
+    res = gt != 0;
+  }
+#elif defined(LALA_SIMD_AVX2)
+  if constexpr(std::is_same_v<T, int>) {
+    __m256i gt = _mm256_setzero_si256();
+    for(; i + 8 <= n; i += 8) {
+      gt = _mm256_or_si256(gt, _mm256_cmpgt_epi32(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i))));
+    }
+    res = !_mm256_testz_si256(gt, gt);
+  }
+  else if constexpr(std::is_same_v<T, double>) {
+    __m256d gt = _mm256_setzero_pd();
+    for(; i + 4 <= n; i += 4) {
+      gt = _mm256_or_pd(gt, _mm256_cmp_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), _CMP_GT_OQ));
+    }
+    res = _mm256_movemask_pd(gt) != 0;
+  }
+#endif
+  return res || scalar::any_gt(a, b, i, n);
+}
+
+/** \return `true` if `a[i] != b[i]` for some `i < n`. */
+template <class T>
+CUDA INLINE bool any_neq(const T* a, const T* b, size_t n) {
+  size_t i = 0;
+  bool res = false;
+#if defined(LALA_SIMD_AVX512)
+  if constexpr(std::is_same_v<T, int>) {
+    __mmask16 neq = 0;
+    for(; i + 16 <= n; i += 16) {
+      neq |= _mm512_cmpneq_epi32_mask(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+    }
+    res = neq != 0;
+  }
+  else if constexpr(std::is_same_v<T, double>) {
+    __mmask8 neq = 0;
+    for(; i + 8 <= n; i += 8) {
+      neq |= _mm512_cmp_pd_mask(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), _CMP_NEQ_UQ);
+    }
+    res = neq != 0;
+  }
+#elif defined(LALA_SIMD_AVX2)
+  if constexpr(std::is_same_v<T, int>) {
+    __m256i diff = _mm256_setzero_si256();
+    for(; i + 8 <= n; i += 8) {
+      diff = _mm256_or_si256(diff, _mm256_xor_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i))));
+    }
+    res = !_mm256_testz_si256(diff, diff);
+  }
+  else if constexpr(std::is_same_v<T, double>) {
+    __m256d neq = _mm256_setzero_pd();
+    for(; i + 4 <= n; i += 4) {
+      neq = _mm256_or_pd(neq, _mm256_cmp_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), _CMP_NEQ_UQ));
+    }
+    res = _mm256_movemask_pd(neq) != 0;
+  }
+#endif
+  return res || scalar::any_neq(a, b, i, n);
+}
+
+/** \return `true` if `a[i] == k` for some `i < n`. */
+template <class T>
+CUDA INLINE bool any_eq(const T* a, T k, size_t n) {
+  size_t i = 0;
+  bool res = false;
+#if defined(LALA_SIMD_AVX512)
+  if constexpr(std::is_same_v<T, int>) {
+    __m512i vk = _mm512_set1_epi32(k);
+    __mmask16 eq = 0;
+    for(; i + 16 <= n; i += 16) {
+      eq |= _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(a + i), vk);
+    }
+    res = eq != 0;
+  }
+  else if constexpr(std::is_same_v<T, double>) {
+    __m512d vk = _mm512_set1_pd(k);
+    __mmask8 eq = 0;
+    for(; i + 8 <= n; i += 8) {
+      eq |= _mm512_cmp_pd_mask(_mm512_loadu_pd(a + i), vk, _CMP_EQ_OQ);
+    }
+    res = eq != 0;
+  }
+#elif defined(LALA_SIMD_AVX2)
+  if constexpr(std::is_same_v<T, int>) {
+    __m256i vk = _mm256_set1_epi32(k);
+    __m256i eq = _mm256_setzero_si256();
+    for(; i + 8 <= n; i += 8) {
+      eq = _mm256_or_si256(eq, _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)), vk));
+    }
+    res = !_mm256_testz_si256(eq, eq);
+  }
+  else if constexpr(std::is_same_v<T, double>) {
+    __m256d vk = _mm256_set1_pd(k);
+    __m256d eq = _mm256_setzero_pd();
+    for(; i + 4 <= n; i += 4) {
+      eq = _mm256_or_pd(eq, _mm256_cmp_pd(_mm256_loadu_pd(a + i), vk, _CMP_EQ_OQ));
+    }
+    res = _mm256_movemask_pd(eq) != 0;
+  }
+#endif
+  return res || scalar::any_eq(a, k, i, n);
+}
+
+/** `a[i] = max(a[i], b[i])` for the even `i < n` and `a[i] = min(a[i], b[i])` for the odd ones if `max_even`, and conversely otherwise.
+ * The vectorized loops start at `0` and process an even number of values, hence the parity of the lanes is the parity of the indices.
+ * \return `true` if `a` has changed. */
+template <class T>
+CUDA INLINE bool max_min_into(T* a, const T* b, size_t n, bool max_even) {
+  size_t i = 0;
+  bool has_changed = false;
+#if defined(LALA_SIMD_AVX512)
+  if constexpr(std::is_same_v<T, int>) {
+    const __mmask16 m = max_even ? 0x5555 : 0xAAAA;
+    __mmask16 changed = 0;
+    for(; i + 16 <= n; i += 16) {
+      __m512i x = _mm512_loadu_si512(a + i);
+      __m512i y = _mm512_loadu_si512(b + i);
+      changed |= _mm512_mask_cmpgt_epi32_mask(m, y, x) | _mm512_mask_cmpgt_epi32_mask(~m, x, y);
+      _mm512_storeu_si512(a + i, _mm512_mask_blend_epi32(m, _mm512_min_epi32(x, y), _mm512_max_epi32(x, y)));
+    }
+    has_changed = changed != 0;
+  }
+  else if constexpr(std::is_same_v<T, double>) {
+    const __mmask8 m = max_even ? 0x55 : 0xAA;
+    __mmask8 changed = 0;
+    for(; i + 8 <= n; i += 8) {
+      __m512d x = _mm512_loadu_pd(a + i);
+      __m512d y = _mm512_loadu_pd(b + i);
+      changed |= _mm512_mask_cmp_pd_mask(m, y, x, _CMP_GT_OQ) | _mm512_mask_cmp_pd_mask(~m, y, x, _CMP_LT_OQ);
+      _mm512_storeu_pd(a + i, _mm512_mask_blend_pd(m, _mm512_min_pd(x, y), _mm512_max_pd(x, y)));
+    }
+    has_changed = changed != 0;
+  }
+#elif defined(LALA_SIMD_AVX2)
+  if constexpr(std::is_same_v<T, int>) {
+    const __m256i m = max_even ? _mm256_setr_epi32(-1, 0, -1, 0, -1, 0, -1, 0) : _mm256_setr_epi32(0, -1, 0, -1, 0, -1, 0, -1);
+    __m256i changed = _mm256_setzero_si256();
+    for(; i + 8 <= n; i += 8) {
+      __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+      __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+      changed = _mm256_or_si256(changed, _mm256_blendv_epi8(_mm256_cmpgt_epi32(x, y), _mm256_cmpgt_epi32(y, x), m));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(a + i), _mm256_blendv_epi8(_mm256_min_epi32(x, y), _mm256_max_epi32(x, y), m));
+    }
+    has_changed = !_mm256_testz_si256(changed, changed);
+  }
+  else if constexpr(std::is_same_v<T, double>) {
+    const __m256d m = _mm256_castsi256_pd(max_even ? _mm256_setr_epi64x(-1, 0, -1, 0) : _mm256_setr_epi64x(0, -1, 0, -1));
+    __m256d changed = _mm256_setzero_pd();
+    for(; i + 4 <= n; i += 4) {
+      __m256d x = _mm256_loadu_pd(a + i);
+      __m256d y = _mm256_loadu_pd(b + i);
+      changed = _mm256_or_pd(changed, _mm256_blendv_pd(_mm256_cmp_pd(y, x, _CMP_LT_OQ), _mm256_cmp_pd(y, x, _CMP_GT_OQ), m));
+      _mm256_storeu_pd(a + i, _mm256_blendv_pd(_mm256_min_pd(x, y), _mm256_max_pd(x, y), m));
+    }
+    has_changed = _mm256_movemask_pd(changed) != 0;
+  }
+#endif
+  return scalar::max_min_into(a, b, i, n, max_even) || has_changed;
+}
+
+/** \return `true` if `a[i] > b[i]` for some even `i < n` or `a[i] < b[i]` for some odd `i < n` if `gt_even`, and conversely otherwise. */
+template <class T>
+CUDA INLINE bool any_gt_lt(const T* a, const T* b, size_t n, bool gt_even) {
+  size_t i = 0;
+  bool res = false;
+#if defined(LALA_SIMD_AVX512)
+  if constexpr(std::is_same_v<T, int>) {
+    const __mmask16 m = gt_even ? 0x5555 : 0xAAAA;
+    __mmask16 found = 0;
+    for(; i + 16 <= n; i += 16) {
+      __m512i x = _mm512_loadu_si512(a + i);
+      __m512i y = _mm512_loadu_si512(b + i);
+      found |= _mm512_mask_cmpgt_epi32_mask(m, x, y) | _mm512_mask_cmpgt_epi32_mask(~m, y, x);
+    }
+    res = found != 0;
+  }
+  else if constexpr(std::is_same_v<T, double>) {
+    const __mmask8 m = gt_even ? 0x55 : 0xAA;
+    __mmask8 found = 0;
+    for(; i + 8 <= n; i += 8) {
+      __m512d x = _mm512_loadu_pd(a + i);
+      __m512d y = _mm512_loadu_pd(b + i);
+      found |= _mm512_mask_cmp_pd_mask(m, x, y, _CMP_GT_OQ) | _mm512_mask_cmp_pd_mask(~m, x, y, _CMP_LT_OQ);
+    }
+    res = found != 0;
+  }
+#elif defined(LALA_SIMD_AVX2)
+  if constexpr(std::is_same_v<T, int>) {
+    const __m256i m = gt_even ? _mm256_setr_epi32(-1, 0, -1, 0, -1, 0, -1, 0) : _mm256_setr_epi32(0, -1, 0, -1, 0, -1, 0, -1);
+    __m256i found = _mm256_setzero_si256();
+    for(; i + 8 <= n; i += 8) {
+      __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+      __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+      found = _mm256_or_si256(found, _mm256_blendv_epi8(_mm256_cmpgt_epi32(y, x), _mm256_cmpgt_epi32(x, y), m));
+    }
+    res = !_mm256_testz_si256(found, found);
+  }
+  else if constexpr(std::is_same_v<T, double>) {
+    const __m256d m = _mm256_castsi256_pd(gt_even ? _mm256_setr_epi64x(-1, 0, -1, 0) : _mm256_setr_epi64x(0, -1, 0, -1));
+    __m256d found = _mm256_setzero_pd();
+    for(; i + 4 <= n; i += 4) {
+      __m256d x = _mm256_loadu_pd(a + i);
+      __m256d y = _mm256_loadu_pd(b + i);
+      found = _mm256_or_pd(found, _mm256_blendv_pd(_mm256_cmp_pd(x, y, _CMP_LT_OQ), _mm256_cmp_pd(x, y, _CMP_GT_OQ), m));
+    }
+    res = _mm256_movemask_pd(found) != 0;
+  }
+#endif
+  return res || scalar::any_gt_lt(a, b, i, n, gt_even);
+}
+
+/** \return `true` if `a[i] != a[i+1]`, `a[i] == k1` or `a[i] == k2` for some even `i < n`. */
+template <class T>
+CUDA INLINE bool any_neq_pairs(const T* a, T k1, T k2, size_t n) {
+  size_t i = 0;
+  bool res = false;
+#if defined(LALA_SIMD_AVX512)
+  if constexpr(std::is_same_v<T, int>) {
+    __m512i vk1 = _mm512_set1_epi32(k1);
+    __m512i vk2 = _mm512_set1_epi32(k2);
+    __mmask16 found = 0;
+    for(; i + 16 <= n; i += 16) {
+      __m512i x = _mm512_loadu_si512(a + i);
+      found |= _mm512_cmpneq_epi32_mask(x, _mm512_shuffle_epi32(x, _MM_PERM_CDAB))
+        | _mm512_cmpeq_epi32_mask(x, vk1) | _mm512_cmpeq_epi32_mask(x, vk2);
+    }
+    res = found != 0;
+  }
+  else if constexpr(std::is_same_v<T, double>) {
+    __m512d vk1 = _mm512_set1_pd(k1);
+    __m512d vk2 = _mm512_set1_pd(k2);
+    __mmask8 found = 0;
+    for(; i + 8 <= n; i += 8) {
+      __m512d x = _mm512_loadu_pd(a + i);
+      found |= _mm512_cmp_pd_mask(x, _mm512_permute_pd(x, 0x55), _CMP_NEQ_UQ)
+        | _mm512_cmp_pd_mask(x, vk1, _CMP_EQ_OQ) | _mm512_cmp_pd_mask(x, vk2, _CMP_EQ_OQ);
+    }
+    res = found != 0;
+  }
+#elif defined(LALA_SIMD_AVX2)
+  if constexpr(std::is_same_v<T, int>) {
+    __m256i vk1 = _mm256_set1_epi32(k1);
+    __m256i vk2 = _mm256_set1_epi32(k2);
+    __m256i found = _mm256_setzero_si256();
+    for(; i + 8 <= n; i += 8) {
+      __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+      found = _mm256_or_si256(found, _mm256_xor_si256(x, _mm256_shuffle_epi32(x, 0xB1)));
+      found = _mm256_or_si256(found, _mm256_or_si256(_mm256_cmpeq_epi32(x, vk1), _mm256_cmpeq_epi32(x, vk2)));
+    }
+    res = !_mm256_testz_si256(found, found);
+  }
+  else if constexpr(std::is_same_v<T, double>) {
+    __m256d vk1 = _mm256_set1_pd(k1);
+    __m256d vk2 = _mm256_set1_pd(k2);
+    __m256d found = _mm256_setzero_pd();
+    for(; i + 4 <= n; i += 4) {
+      __m256d x = _mm256_loadu_pd(a + i);
+      found = _mm256_or_pd(found, _mm256_cmp_pd(x, _mm256_permute_pd(x, 0x5), _CMP_NEQ_UQ));
+      found = _mm256_or_pd(found, _mm256_or_pd(_mm256_cmp_pd(x, vk1, _CMP_EQ_OQ), _mm256_cmp_pd(x, vk2, _CMP_EQ_OQ)));
+    }
+    res = _mm256_movemask_pd(found) != 0;
+  }
+#endif
+  return res || scalar::any_neq_pairs(a, k1, k2, i, n);
+}
+
+/** `a[i].meet(b[i])` for all `i < n`.
+ * \return `true` if `a` has changed. */
+template <flat_universe U>
+CUDA INLINE bool meet_into(U* a, const U* b, size_t n) {
+  if constexpr(U::is_lower_bound) {
+    return max_into(values(a), values(b), n);
+  }
+  else {
+    return min_into(values(a), values(b), n);
+  }
+}
+
+/** `a[i].join(b[i])` for all `i < n`.
+ * \return `true` if `a` has changed. */
+template <flat_universe U>
+CUDA INLINE bool join_into(U* a, const U* b, size_t n) {
+  if constexpr(U::is_lower_bound) {
+    return min_into(values(a), values(b), n);
+  }
+  else {
+    return max_into(values(a), values(b), n);
+  }
+}
+
+/** \return `true` if `a[i] <= b[i]` in the lattice order for all `i < n`. */
+template <flat_universe U>
+CUDA INLINE bool all_leq(const U* a, const U* b, size_t n) {
+  if constexpr(U::is_lower_bound) {
+    return !any_gt(values(b), values(a), n);
+  }
+  else {
+    return !any_gt(values(a), values(b), n);
+  }
+}
+
+/** \return `true` if `a[i] == b[i]` for all `i < n`. */
+template <flat_universe U>
+CUDA INLINE bool all_eq(const U* a, const U* b, size_t n) {
+  return !any_neq(values(a), values(b), n);
+}
+
+/** \return `true` if `a[i]` is bot for some `i < n`. */
+template <flat_universe U>
+CUDA INLINE bool any_bot(const U* a, size_t n) {
+  return any_eq(values(a), U::bot().value(), n);
+}
+
+/** `a[i].meet(b[i])` for all `i < n`, the lower bounds are met with `max` and the upper bounds with `min`.
+ * \return `true` if `a` has changed. */
+template <flat_interval U>
+CUDA INLINE bool meet_into(U* a, const U* b, size_t n) {
+  return max_min_into(values(a), values(b), 2 * n, lb_first<U>());
+}
+
+/** `a[i].join(b[i])` for all `i < n`.
+ * \return `true` if `a` has changed. */
+template <flat_interval U>
+CUDA INLINE bool join_into(U* a, const U* b, size_t n) {
+  return max_min_into(values(a), values(b), 2 * n, !lb_first<U>());
+}
+
+/** \return `true` if the bounds of `a[i]` are smaller or equal than the bounds of `b[i]` for all `i < n`.
+ * It implies `a[i] <= b[i]`, but the converse does not hold when `a[i]` is bot. */
+template <flat_interval U>
+CUDA INLINE bool all_leq(const U* a, const U* b, size_t n) {
+  return !any_gt_lt(values(a), values(b), 2 * n, !lb_first<U>());
+}
+
+/** \return `true` if the bounds of `a[i]` and `b[i]` are equal for all `i < n`.
+ * It implies `a[i] == b[i]`, but the converse does not hold when both are bot. */
+template <flat_interval U>
+CUDA INLINE bool all_eq(const U* a, const U* b, size_t n) {
+  return !any_neq(values(a), values(b), 2 * n);
+}
+
+/** \return `true` if `a[i]` is a singleton for all `i < n`.
+ * Two equal bounds are not a singleton when they are the bot or top value of the lower bound (e.g., `[inf..inf]`). */
+template <flat_interval U>
+CUDA INLINE bool all_singletons(const U* a, size_t n) {
+  using LB = typename U::LB;
+  return !any_neq_pairs(values(a), LB::bot().value(), LB::top().value(), 2 * n);
+}
+
+} // namespace lala::simd
+
+#endif
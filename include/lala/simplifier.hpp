@@ -6,6 +6,7 @@
 #include "logic/logic.hpp"
 #include "universes/arith_bound.hpp"
 #include "abstract_deps.hpp"
+#include "union_find.hpp"
 #include "battery/dynamic_bitset.hpp"
 
 namespace lala {
@@ -16,6 +17,13 @@ namespace lala {
  *  2. Removing unused variables.
  *  3. Removing entailed formulas.
  *  4. Removing variable equality by tracking equivalence classes.
+ *     The classes are computed once with a union-find when the formulas are told (see `deduce(tell_type&&)`), instead of being propagated through the fixpoint loop.
+ *     Linear equalities such as `x = 2 * y + 1` are also used to substitute a variable by an affine expression of another (see `compute_affine_substitutions`).
+ *  5. Removing duplicated and subsumed formulas, and merging unary bounds (e.g., `x <= 5`) into the sub-domain.
+ *     This is also done once when the formulas are told, by comparing the canonical forms of the formulas (see `canonize`).
+ *
+ * The simplification is incremental: an index from the equivalence classes to the formulas they occur in is built once, and a formula is only simplified again when the constant of one of its equivalence classes changed.
+ * The dependencies between the deduction operators are exposed by `deduction_dependencies` for `EventDrivenIteration`.
  *
  * The simplified formula can be obtained by calling `deinterpret()`.
  * Given a solution to the simplified formula, the extended model (with the variables deleted) can be obtained by calling `representative()` to obtain the representative variable of each equivalence class.
@@ -65,6 +73,20 @@ private:
   battery::vector<ZUB<int, memory_type>, allocator_type> equivalence_classes;
   // `constants[i]` contains the universe value of the representative variables `i`, aggregated by join on the values of all variables in the equivalence class.
   battery::vector<universe_type, allocator_type> constants;
+  // The variable `i` is equal to `scales[i] * r + offsets[i]` where `r` is its representative, this is `1 * r + 0` unless `i` was substituted by a linear equality.
+  battery::vector<logic_int, allocator_type> scales;
+  battery::vector<logic_int, allocator_type> offsets;
+  // `occurrences[occurrences_begin[j]..occurrences_begin[j+1]-1]` are the formulas in which occurs a variable of the equivalence class represented by `j`.
+  battery::vector<int, allocator_type> occurrences_begin;
+  battery::vector<int, allocator_type> occurrences;
+  // `formula_classes[formula_classes_begin[i]..formula_classes_begin[i+1]-1]` are the representatives of the variables occurring in the formula `i` (without duplicates).
+  battery::vector<int, allocator_type> formula_classes_begin;
+  battery::vector<int, allocator_type> formula_classes;
+  // dirty_formulas[i] is `true` when the formula `i` must be simplified again because the constant of one of its variables changed.
+  battery::dynamic_bitset<memory_type, allocator_type> dirty_formulas;
+  // Reused in each call to `cons_deduce` to avoid allocating memory when checking entailment.
+  typename sub_type::template ask_type<allocator_type> ask_buffer;
+  IDiagnostics ask_diagnostics;
 
 public:
   CUDA Simplifier(AType atype
@@ -74,6 +96,10 @@ public:
    , formulas(alloc), simplified_formulas(alloc)
    , eliminated_variables(alloc), eliminated_formulas(alloc)
    , equivalence_classes(alloc), constants(alloc)
+   , scales(alloc), offsets(alloc)
+   , occurrences_begin(alloc), occurrences(alloc)
+   , formula_classes_begin(alloc), formula_classes(alloc)
+   , dirty_formulas(alloc), ask_buffer(alloc)
   {}
 
   CUDA Simplifier(this_type&& other)
@@ -81,6 +107,10 @@ public:
     , formulas(std::move(other.formulas)), simplified_formulas(std::move(other.simplified_formulas))
     , eliminated_variables(std::move(other.eliminated_variables)), eliminated_formulas(std::move(other.eliminated_formulas))
     , equivalence_classes(std::move(other.equivalence_classes)), constants(std::move(other.constants))
+    , scales(std::move(other.scales)), offsets(std::move(other.offsets))
+    , occurrences_begin(std::move(other.occurrences_begin)), occurrences(std::move(other.occurrences))
+    , formula_classes_begin(std::move(other.formula_classes_begin)), formula_classes(std::move(other.formula_classes))
+    , dirty_formulas(std::move(other.dirty_formulas)), ask_buffer(std::move(other.ask_buffer))
   {}
 
   struct light_copy_tag {};
@@ -93,6 +123,10 @@ public:
    , env(other.env, alloc)
    , equivalence_classes(other.equivalence_classes, alloc)
    , constants(other.constants, alloc)
+   , scales(other.scales, alloc), offsets(other.offsets, alloc)
+   , occurrences_begin(alloc), occurrences(alloc)
+   , formula_classes_begin(alloc), formula_classes(alloc)
+   , dirty_formulas(alloc), ask_buffer(alloc)
   {}
 
   CUDA allocator_type get_allocator() const {
@@ -159,14 +193,418 @@ public:
       for(int i = 0; i < equivalence_classes.size(); ++i) {
         equivalence_classes[i].meet(local::ZUB(i));
       }
+      scales = battery::vector<logic_int, allocator_type>(t.num_vars, 1, get_allocator());
+      offsets = battery::vector<logic_int, allocator_type>(t.num_vars, 0, get_allocator());
       formulas = std::move(t.formulas);
       simplified_formulas.resize(formulas.size());
+      compute_equivalence_classes();
+      compute_affine_substitutions();
+      eliminate_redundant_formulas();
+      compute_occurrences();
       return true;
     }
     return false;
   }
 
 private:
+  /** Merge the variables occurring in formulas of the form `x = y` into equivalence classes, and eliminate these formulas.
+   * The representative of each class is its smallest variable. */
+  CUDA NI void compute_equivalence_classes() {
+    UnionFind<allocator_type> classes(equivalence_classes.size(), get_allocator());
+    for(int i = 0; i < formulas.size(); ++i) {
+      if(is_var_equality(formulas[i])) {
+        classes.unite(var_of(formulas[i].seq(0)).vid(), var_of(formulas[i].seq(1)).vid());
+        eliminate(eliminated_formulas, i);
+      }
+    }
+    for(int i = 0; i < equivalence_classes.size(); ++i) {
+      equivalence_classes[i].meet(local::ZUB(classes.representative(i)));
+    }
+  }
+
+  /** Add `c * t` to the linear expression `terms + constant`, where `terms` is a sequence of pairs of variable and coefficient.
+   * \return `false` if `t` is not a linear term over integer variables. */
+  CUDA NI bool linearize(const TFormula<allocator_type>& t, logic_int c,
+    battery::vector<battery::tuple<int, logic_int>, allocator_type>& terms, logic_int& constant) const
+  {
+    using F = TFormula<allocator_type>;
+    if(t.is(F::Z)) {
+      constant += c * t.z();
+      return true;
+    }
+    else if(t.is_variable()) {
+      AVar x = var_of(t);
+      if(!env[x].sort.is_int()) {
+        return false;
+      }
+      terms.push_back(battery::make_tuple(x.vid(), c));
+      return true;
+    }
+    else if(t.is(F::Seq)) {
+      switch(t.sig()) {
+        case ADD: {
+          for(int k = 0; k < t.seq().size(); ++k) {
+            if(!linearize(t.seq(k), c, terms, constant)) {
+              return false;
+            }
+          }
+          return true;
+        }
+        case SUB:
+          return t.seq().size() == 2 && linearize(t.seq(0), c, terms, constant) && linearize(t.seq(1), -c, terms, constant);
+        case NEG:
+          return linearize(t.seq(0), -c, terms, constant);
+        case MUL: {
+          if(t.seq().size() != 2) {
+            return false;
+          }
+          if(t.seq(0).is(F::Z)) {
+            return linearize(t.seq(1), c * t.seq(0).z(), terms, constant);
+          }
+          if(t.seq(1).is(F::Z)) {
+            return linearize(t.seq(0), c * t.seq(1).z(), terms, constant);
+          }
+          return false;
+        }
+        default: return false;
+      }
+    }
+    return false;
+  }
+
+  /** Find the root of `x` in the forest `parent` where each `x` is equal to `scale[x] * parent[x] + offset[x]`, and compress the path so that `parent[x]` is the root. */
+  CUDA NI static int affine_root(int x, battery::vector<int, allocator_type>& parent,
+    battery::vector<logic_int, allocator_type>& scale, battery::vector<logic_int, allocator_type>& offset)
+  {
+    int p = parent[x];
+    if(p == x) {
+      return x;
+    }
+    int r = affine_root(p, parent, scale, offset);
+    // x = scale[x] * (scale[p] * r + offset[p]) + offset[x]
+    offset[x] += scale[x] * offset[p];
+    scale[x] *= scale[p];
+    parent[x] = r;
+    return r;
+  }
+
+  /** Eliminate variables by substitution using the linear equalities over integer variables.
+   * Each equality is rewritten over the roots of the variables already substituted; if it has two variables `a * x + b * y + c = 0` and `a` divides `b` and `c`, then `x` is substituted by `-(b/a) * y - c/a`, and the equality is eliminated.
+   * When both variables can be substituted, we substitute the largest one.
+   * Equalities becoming trivially true after substitution (`0 = 0`) are eliminated too.
+   * This is a Gaussian elimination restricted to equalities with two variables (after substitution), which keeps every substitution integral and invertible on intervals (see `affine_preimage`).
+   * Therefore, a representative is not necessarily the smallest variable of its class anymore. */
+  CUDA NI void compute_affine_substitutions() {
+    using F = TFormula<allocator_type>;
+    battery::vector<int, allocator_type> parent(vars(), get_allocator());
+    for(int i = 0; i < vars(); ++i) {
+      parent[i] = equivalence_classes[i];
+    }
+    battery::vector<battery::tuple<int, logic_int>, allocator_type> terms(get_allocator());
+    battery::vector<battery::tuple<int, logic_int>, allocator_type> roots(get_allocator());
+    bool has_changed = true;
+    while(has_changed) {
+      has_changed = false;
+      for(int i = 0; i < formulas.size(); ++i) {
+        const F& f = formulas[i];
+        if(eliminated_formulas.test(i) || !f.is(F::Seq) || f.sig() != EQ || f.seq().size() != 2) {
+          continue;
+        }
+        terms.resize(0);
+        logic_int constant = 0;
+        if(!linearize(f.seq(0), 1, terms, constant) || !linearize(f.seq(1), -1, terms, constant)) {
+          continue;
+        }
+        // Rewrite the equality over the roots.
+        roots.resize(0);
+        for(int k = 0; k < terms.size(); ++k) {
+          int x = battery::get<0>(terms[k]);
+          logic_int c = battery::get<1>(terms[k]);
+          int r = affine_root(x, parent, scales, offsets);
+          constant += c * offsets[x];
+          int l = 0;
+          for(; l < roots.size() && battery::get<0>(roots[l]) != r; ++l) {}
+          if(l == roots.size()) {
+            roots.push_back(battery::make_tuple(r, logic_int(0)));
+          }
+          battery::get<1>(roots[l]) += c * scales[x];
+        }
+        int n = 0;
+        for(int k = 0; k < roots.size(); ++k) {
+          if(battery::get<1>(roots[k]) != 0) {
+            roots[n++] = roots[k];
+          }
+        }
+        if(n == 0 && constant == 0) {
+          has_changed |= eliminate(eliminated_formulas, i);
+        }
+        else if(n == 2) {
+          int big = battery::get<0>(roots[0]) > battery::get<0>(roots[1]) ? 0 : 1;
+          auto divides = [&](int k) {
+            return battery::get<1>(roots[1 - k]) % battery::get<1>(roots[k]) == 0 && constant % battery::get<1>(roots[k]) == 0;
+          };
+          int target = divides(big) ? big : (divides(1 - big) ? 1 - big : -1);
+          if(target != -1) {
+            int x = battery::get<0>(roots[target]);
+            logic_int a = battery::get<1>(roots[target]);
+            int y = battery::get<0>(roots[1 - target]);
+            logic_int b = battery::get<1>(roots[1 - target]);
+            parent[x] = y;
+            scales[x] = -(b / a);
+            offsets[x] = -(constant / a);
+            eliminate(eliminated_formulas, i);
+            has_changed = true;
+          }
+        }
+      }
+    }
+    for(int i = 0; i < vars(); ++i) {
+      equivalence_classes[i].join_top();
+      equivalence_classes[i].meet(local::ZUB(affine_root(i, parent, scales, offsets)));
+    }
+  }
+
+  /** \return `true` if the variable `i` is equal to its representative (and not to an affine expression of it). */
+  CUDA bool is_identity(size_t i) const {
+    return scales[i] == 1 && offsets[i] == 0;
+  }
+
+  /** The term replacing the variable `i` in the simplified formulas, which is `scales[i] * r + offsets[i]` where `r` is the representative of `i`. */
+  template <class F>
+  CUDA NI F substitute(size_t i, F r) const {
+    if(scales[i] != 1) {
+      r = F::make_binary(F::make_z(scales[i]), MUL, std::move(r), UNTYPED, get_allocator());
+    }
+    if(offsets[i] != 0) {
+      r = F::make_binary(std::move(r), ADD, F::make_z(offsets[i]), UNTYPED, get_allocator());
+    }
+    return r;
+  }
+
+  /** The values `y` of the representative of the variable `i` such that `scales[i] * y + offsets[i]` belongs to `u`.
+   * On integer intervals, this is exact: we round the lower bound up and the upper bound down. */
+  CUDA NI universe_type affine_preimage(size_t i, const universe_type& u) const {
+    using LB = typename universe_type::LB;
+    using UB = typename universe_type::UB;
+    logic_int a = scales[i];
+    logic_int b = offsets[i];
+    universe_type v{};
+    if(u.is_bot()) {
+      v.meet_bot();
+      return v;
+    }
+    if(!u.lb().is_top()) {
+      logic_int k = u.lb().value() - b;
+      if(a > 0) { v.meet_lb(LB::geq_k(battery::cdiv(k, a))); }
+      else { v.meet_ub(UB::leq_k(battery::fdiv(k, a))); }
+    }
+    if(!u.ub().is_top()) {
+      logic_int k = u.ub().value() - b;
+      if(a > 0) { v.meet_ub(UB::leq_k(battery::fdiv(k, a))); }
+      else { v.meet_lb(LB::geq_k(battery::cdiv(k, a))); }
+    }
+    return v;
+  }
+
+  /** A canonical form of `f` such that two formulas equivalent up to the following rewritings have the same canonical form:
+   *   - each variable is replaced by the representative of its equivalence class,
+   *   - the arguments of commutative operators are sorted by structural hash,
+   *   - in a comparison, a constant is moved to the right side, and otherwise `>` and `>=` are rewritten into `<` and `<=` (see `converse_comparison`). */
+  CUDA NI TFormula<allocator_type> canonize(const TFormula<allocator_type>& f) const {
+    using F = TFormula<allocator_type>;
+    if(f.is_variable()) {
+      int x = var_of(f).vid();
+      return substitute(x, F::make_avar(AVar(aty(), equivalence_classes[x])));
+    }
+    else if(f.is(F::ESeq)) {
+      typename F::Sequence children(get_allocator());
+      for(int k = 0; k < f.eseq().size(); ++k) {
+        children.push_back(canonize(f.eseq(k)));
+      }
+      return F::make_nary(f.esig(), std::move(children), f.type());
+    }
+    else if(!f.is(F::Seq)) {
+      return f;
+    }
+    Sig sig = f.sig();
+    typename F::Sequence children(get_allocator());
+    battery::vector<size_t, allocator_type> hashes(get_allocator());
+    for(int k = 0; k < f.seq().size(); ++k) {
+      children.push_back(canonize(f.seq(k)));
+      hashes.push_back(structural_hash(children[k]));
+    }
+    if(is_commutative(sig)) {
+      // Insertion sort, the arity of most formulas is small.
+      for(int k = 1; k < children.size(); ++k) {
+        for(int l = k; l > 0 && hashes[l] < hashes[l-1]; --l) {
+          battery::swap(hashes[l], hashes[l-1]);
+          battery::swap(children[l], children[l-1]);
+        }
+      }
+    }
+    if(is_comparison(f) && children.size() == 2) {
+      bool swap = children[0].is_constant()
+        ? !children[1].is_constant()
+        : !children[1].is_constant() && (sig == GEQ || sig == GT || sig == SUPSET || sig == SUPSETEQ);
+      if(swap) {
+        sig = converse_comparison(sig);
+        battery::swap(children[0], children[1]);
+      }
+    }
+    return F::make_nary(sig, std::move(children), f.type(), false);
+  }
+
+  /** \return `true` if the canonical formula `c` has the shape `t <op> k` where `k` is an integer constant and `<op>` is one of `<=`, `<`, `>=` or `>`.
+   * Two such formulas with the same term `t` and operator `<op>` are comparable, the one with the smallest (resp. largest) constant subsumes the other for `<=` and `<` (resp. `>=` and `>`). */
+  CUDA NI static bool is_bound(const TFormula<allocator_type>& c) {
+    using F = TFormula<allocator_type>;
+    return c.is(F::Seq) && (c.sig() == LEQ || c.sig() == LT || c.sig() == GEQ || c.sig() == GT)
+      && c.seq().size() == 2 && c.seq(1).is(F::Z) && !c.seq(0).is_constant();
+  }
+
+  /** Tell the formula `i` in the sub-domain if it is a unary constraint such as `x <= 5` or `x \in {1..3}`.
+   * \return `true` if the formula is entailed by the sub-domain afterwards, in which case it can be eliminated. */
+  CUDA NI bool merge_unary_bound(int i) {
+    using F = TFormula<allocator_type>;
+    const F& g = formulas[i];
+    if(!g.is(F::Seq) || g.seq().size() != 2 || !(is_arithmetic_comparison(g) || g.sig() == IN) || g.sig() == NEQ) {
+      return false;
+    }
+    bool var_left = g.seq(0).is_variable() && g.seq(1).is_constant();
+    bool var_right = g.sig() != IN && g.seq(0).is_constant() && g.seq(1).is_variable();
+    if(!var_left && !var_right) {
+      return false;
+    }
+    // The sub-domain might only interpret the shape `x <op> k`.
+    F f = var_left ? g : F::make_binary(g.seq(1), converse_comparison(g.sig()), g.seq(0), g.type(), get_allocator());
+    typename sub_type::template tell_type<allocator_type> tell(get_allocator());
+    ask_diagnostics.cut(0);
+#ifdef _MSC_VER // Avoid MSVC compiler bug. See https://stackoverflow.com/questions/77144003/use-of-template-keyword-before-dependent-template-name
+    if(!sub->interpret_tell(f, env, tell, ask_diagnostics)) {
+#else
+    if(!sub->template interpret_tell(f, env, tell, ask_diagnostics)) {
+#endif
+      return false;
+    }
+    sub->deduce(std::move(tell));
+    // The tell interpretation might be an over-approximation of `f` (e.g., `x \in {1,3}` in an interval), so we check `f` is now entailed.
+    ask_buffer.resize(0);
+    ask_diagnostics.cut(0);
+#ifdef _MSC_VER
+    if(sub->interpret_ask(f, env, ask_buffer, ask_diagnostics)) {
+#else
+    if(sub->template interpret_ask(f, env, ask_buffer, ask_diagnostics)) {
+#endif
+      return sub->ask(ask_buffer);
+    }
+    return false;
+  }
+
+  /** Eliminate the unary bounds merged into the sub-domain, the duplicated formulas and the subsumed bounds.
+   * The canonical forms of the formulas are stored in an open addressing hash table; the key of a bound `t <op> k` is `<op>` and `t`, and the key of any other formula is the formula itself. */
+  CUDA NI void eliminate_redundant_formulas() {
+    using F = TFormula<allocator_type>;
+    battery::vector<F, allocator_type> canonical(formulas.size(), get_allocator());
+    battery::vector<size_t, allocator_type> keys(formulas.size(), 0, get_allocator());
+    size_t capacity = 1;
+    while(capacity < 2 * formulas.size()) {
+      capacity <<= 1;
+    }
+    battery::vector<int, allocator_type> slots(capacity, -1, get_allocator());
+    auto same_key = [&](int i, int k) {
+      const F& a = canonical[i];
+      const F& b = canonical[k];
+      if(is_bound(a) && is_bound(b)) {
+        return a.sig() == b.sig() && a.seq(0) == b.seq(0);
+      }
+      return !is_bound(a) && !is_bound(b) && a == b;
+    };
+    for(int i = 0; i < formulas.size(); ++i) {
+      if(eliminated_formulas.test(i)) {
+        continue;
+      }
+      if(merge_unary_bound(i)) {
+        eliminate(eliminated_formulas, i);
+        continue;
+      }
+      canonical[i] = canonize(formulas[i]);
+      bool bound = is_bound(canonical[i]);
+      keys[i] = bound
+        ? hash_combine(static_cast<size_t>(canonical[i].sig()), structural_hash(canonical[i].seq(0)))
+        : structural_hash(canonical[i]);
+      for(size_t j = keys[i] & (capacity - 1); ; j = (j + 1) & (capacity - 1)) {
+        int k = slots[j];
+        if(k == -1) {
+          slots[j] = i;
+          break;
+        }
+        if(keys[k] == keys[i] && same_key(i, k)) {
+          if(bound) {
+            logic_int ki = canonical[i].seq(1).z();
+            logic_int kk = canonical[k].seq(1).z();
+            bool tighter = (canonical[i].sig() == LEQ || canonical[i].sig() == LT) ? ki < kk : ki > kk;
+            if(tighter) {
+              eliminate(eliminated_formulas, k);
+              slots[j] = i;
+              break;
+            }
+          }
+          eliminate(eliminated_formulas, i);
+          break;
+        }
+      }
+    }
+  }
+
+  /** Collect in `formula_classes` the representatives of the variables occurring in `f` (the formula `i`), using `last_seen` to avoid duplicates. */
+  CUDA NI void collect_classes(const TFormula<allocator_type>& f, int i, battery::vector<int, allocator_type>& last_seen) {
+    using F = TFormula<allocator_type>;
+    if(f.is_variable()) {
+      int j = equivalence_classes[var_of(f).vid()];
+      if(last_seen[j] != i) {
+        last_seen[j] = i;
+        formula_classes.push_back(j);
+      }
+    }
+    else if(f.is(F::Seq) || f.is(F::ESeq)) {
+      const auto& children = f.is(F::Seq) ? f.seq() : f.eseq();
+      for(int k = 0; k < children.size(); ++k) {
+        collect_classes(children[k], i, last_seen);
+      }
+    }
+  }
+
+  /** Build the occurrence index between the equivalence classes and the formulas, and mark all the formulas as dirty. */
+  CUDA NI void compute_occurrences() {
+    battery::vector<int, allocator_type> last_seen(vars(), -1, get_allocator());
+    formula_classes_begin = battery::vector<int, allocator_type>(formulas.size() + 1, 0, get_allocator());
+    formula_classes.resize(0);
+    for(int i = 0; i < formulas.size(); ++i) {
+      formula_classes_begin[i] = formula_classes.size();
+      if(!eliminated_formulas.test(i)) {
+        collect_classes(formulas[i], i, last_seen);
+      }
+    }
+    formula_classes_begin[formulas.size()] = formula_classes.size();
+    // Counting sort of the pairs (class, formula) by class.
+    occurrences_begin = battery::vector<int, allocator_type>(vars() + 1, 0, get_allocator());
+    for(int k = 0; k < formula_classes.size(); ++k) {
+      ++occurrences_begin[formula_classes[k] + 1];
+    }
+    for(int j = 0; j < vars(); ++j) {
+      occurrences_begin[j + 1] += occurrences_begin[j];
+    }
+    occurrences.resize(formula_classes.size());
+    battery::vector<int, allocator_type> next(occurrences_begin, get_allocator());
+    for(int i = 0; i < formulas.size(); ++i) {
+      for(int k = formula_classes_begin[i]; k < formula_classes_begin[i + 1]; ++k) {
+        occurrences[next[formula_classes[k]]++] = i;
+      }
+    }
+    dirty_formulas.resize(formulas.size());
+    dirty_formulas.set();
+  }
+
   // Return the abstract variable of the subdomain from the abstract variable `x` of this domain.
   // In the environment, all variables should have been interpreted by the sub-domain, and we assume avars[0] contains the sub abstract variable.
   CUDA AVar to_sub_var(AVar x) const {
@@ -194,15 +632,28 @@ private:
   }
 
 public:
-  /** Print the abstract universe of `vname` taking into account simplifications (representative variable and constant).
+  /** Print the abstract universe of `vname` taking into account simplifications (representative variable, affine substitution and constant).
   */
   template <class Alloc, class Abs, class Env>
   CUDA void print_variable(const LVar<Alloc>& vname, const Env& benv, const Abs& b) const {
     const auto& local_var = env.variable_of(vname)->get();
-    int rep = equivalence_classes[local_var.avar_of(aty())->vid()];
+    int x = local_var.avar_of(aty())->vid();
+    int rep = equivalence_classes[x];
     const auto& rep_name = env.name_of(AVar{aty(), rep});
     auto benv_variable = benv.variable_of(rep_name);
-    if(benv_variable.has_value()) {
+    if(!is_identity(x)) {
+      // The variable was substituted by `scales[x] * rep + offsets[x]`, we rebuild its value from the value of `rep`.
+      using LB = typename universe_type::LB;
+      using UB = typename universe_type::UB;
+      logic_int v = benv_variable.has_value()
+        ? b.project(benv_variable->get().avars[0]).lb().value()
+        : constants[rep].lb().value();
+      universe_type u{};
+      u.meet_lb(LB::geq_k(scales[x] * v + offsets[x]));
+      u.meet_ub(UB::leq_k(scales[x] * v + offsets[x]));
+      local_var.sort.print_value(u);
+    }
+    else if(benv_variable.has_value()) {
       benv_variable->get().sort.print_value(b.project(benv_variable->get().avars[0]));
     }
     else {
@@ -221,37 +672,40 @@ private:
   }
 
   // We eliminate the representative of the variable `i` if it is a singleton.
+  // When the constant of the class changes, the formulas in which the class occurs must be simplified again.
   CUDA local::B vdeduce(size_t i) {
     const auto& u = sub->project(to_sub_var(i));
     size_t j = equivalence_classes[i];
-    local::B has_changed = constants[j].meet(u);
+    local::B has_changed = is_identity(i) ? constants[j].meet(u) : constants[j].meet(affine_preimage(i, u));
     if(!constants[j].is_bot() && constants[j].lb() == dual<typename universe_type::LB>(constants[j].ub())) {
       has_changed |= eliminate(eliminated_variables, j);
     }
+    if(has_changed) {
+      for(int k = occurrences_begin[j]; k < occurrences_begin[j + 1]; ++k) {
+        dirty_formulas.set(occurrences[k], true);
+      }
+    }
     return has_changed;
   }
 
   CUDA local::B cons_deduce(size_t i) {
     using F = TFormula<allocator_type>;
-    // Eliminate constraint of the form x = y, and add x,y in the same equivalence class.
-    if(is_var_equality(formulas[i])) {
-      AVar x = var_of(formulas[i].seq(0));
-      AVar y = var_of(formulas[i].seq(1));
-      local::B has_changed = equivalence_classes[x.vid()].meet(local::ZUB(equivalence_classes[y.vid()]));
-      has_changed |= equivalence_classes[y.vid()].meet(local::ZUB(equivalence_classes[x.vid()]));
-      has_changed |= eliminate(eliminated_formulas, i);
-      return has_changed;
+    // Constraints of the form x = y are already eliminated by `compute_equivalence_classes`.
+    // Other formulas are only simplified again if the constant of one of their variables changed since the last call.
+    if(eliminated_formulas.test(i) || !dirty_formulas.test(i)) {
+      return false;
     }
     else {
+      dirty_formulas.set(i, false);
       // Eliminate entailed formulas.
-      IDiagnostics diagnostics;
-      typename sub_type::template ask_type<allocator_type> ask;
+      ask_buffer.resize(0);
+      ask_diagnostics.cut(0);
 #ifdef _MSC_VER // Avoid MSVC compiler bug. See https://stackoverflow.com/questions/77144003/use-of-template-keyword-before-dependent-template-name
-      if(sub->interpret_ask(formulas[i], env, ask, diagnostics)) {
+      if(sub->interpret_ask(formulas[i], env, ask_buffer, ask_diagnostics)) {
 #else
-      if(sub->template interpret_ask(formulas[i], env, ask, diagnostics)) {
+      if(sub->template interpret_ask(formulas[i], env, ask_buffer, ask_diagnostics)) {
 #endif
-        if(sub->ask(ask)) {
+        if(sub->ask(ask_buffer)) {
           return eliminate(eliminated_formulas, i);
         }
       }
@@ -261,7 +715,14 @@ private:
       auto f = formulas[i].map([&](const F& f, const F& parent) {
         if(f.is_variable()) {
           AVar x = var_of(f);
-          if(eliminated_variables.test(x.vid())) {
+          if(!is_identity(x.vid())) {
+            int r = equivalence_classes[x.vid()];
+            if(eliminated_variables.test(r)) {
+              return F::make_z(scales[x.vid()] * constants[r].lb().value() + offsets[x.vid()]);
+            }
+            return substitute(x.vid(), F::make_lvar(UNTYPED, env.name_of(AVar{aty(), r})));
+          }
+          else if(eliminated_variables.test(x.vid())) {
             auto k = constants[x.vid()].template deinterpret<F>();
             if(env[x].sort.is_bool() && k.is(F::Z) && parent.is_logical()) {
               return k.z() == 0 ? F::make_false() : F::make_true();
@@ -293,6 +754,24 @@ public:
     return constants.size() + formulas.size();
   }
 
+  /** The deduction of the variable `i` depends on its equivalence class, and the deduction of a formula on the equivalence classes of its variables.
+   * The equivalence classes are identified by their representatives.
+   * This is used by `EventDrivenIteration` to only schedule the deductions affected by a change. */
+  CUDA NI battery::vector<int, allocator_type> deduction_dependencies(size_t i) const {
+    assert(i < num_deductions());
+    battery::vector<int, allocator_type> deps(get_allocator());
+    if(i < constants.size()) {
+      deps.push_back(static_cast<int>(equivalence_classes[i]));
+    }
+    else {
+      i -= constants.size();
+      for(int k = formula_classes_begin[i]; k < formula_classes_begin[i + 1]; ++k) {
+        deps.push_back(formula_classes[k]);
+      }
+    }
+    return deps;
+  }
+
   CUDA local::B deduce(size_t i) {
     assert(i < num_deductions());
     if(i < constants.size()) {
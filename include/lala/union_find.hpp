@@ -0,0 +1,184 @@
+// Copyright 2024 Pierre Talbot
+
+#ifndef LALA_CORE_UNION_FIND_HPP
+#define LALA_CORE_UNION_FIND_HPP
+
+#include "battery/utility.hpp"
+#include "battery/vector.hpp"
+
+#ifndef __CUDA_ARCH__
+  #include <atomic>
+#endif
+
+namespace lala {
+
+/** A union-find (disjoint-set) structure over the elements `0..n-1`, with union by rank and path compression (path halving).
+ * A sequence of `m` operations costs \f$ O(m\alpha(n)) \f$.
+ * In addition to the root of the tree (which depends on the order of the unions), we maintain the smallest element of each class, called the representative. */
+template <class Allocator = battery::standard_allocator>
+class UnionFind {
+public:
+  using allocator_type = Allocator;
+  using this_type = UnionFind<Allocator>;
+
+private:
+  battery::vector<int, Allocator> parent;
+  battery::vector<int, Allocator> rank;
+  /** `smallest[r]` is the smallest element in the class of the root `r`. */
+  battery::vector<int, Allocator> smallest;
+  size_t classes;
+
+public:
+  CUDA UnionFind(size_t n = 0, const allocator_type& alloc = allocator_type())
+   : parent(n, alloc), rank(n, 0, alloc), smallest(n, alloc), classes(n)
+  {
+    for(int i = 0; i < n; ++i) {
+      parent[i] = i;
+      smallest[i] = i;
+    }
+  }
+
+  CUDA size_t size() const {
+    return parent.size();
+  }
+
+  /** The number of equivalence classes. */
+  CUDA size_t num_classes() const {
+    return classes;
+  }
+
+  /** \return The root of the class of `x`. */
+  CUDA int find(int x) {
+    while(parent[x] != x) {
+      parent[x] = parent[parent[x]];
+      x = parent[x];
+    }
+    return x;
+  }
+
+  /** \return The smallest element of the class of `x`. */
+  CUDA int representative(int x) {
+    return smallest[find(x)];
+  }
+
+  /** Merge the classes of `x` and `y`.
+   * \return `true` if `x` and `y` were not in the same class. */
+  CUDA bool unite(int x, int y) {
+    x = find(x);
+    y = find(y);
+    if(x == y) {
+      return false;
+    }
+    if(rank[x] < rank[y]) {
+      battery::swap(x, y);
+    }
+    parent[y] = x;
+    smallest[x] = battery::min(smallest[x], smallest[y]);
+    if(rank[x] == rank[y]) {
+      ++rank[x];
+    }
+    --classes;
+    return true;
+  }
+
+  CUDA bool same(int x, int y) {
+    return find(x) == find(y);
+  }
+};
+
+/** A lock-free union-find over the elements `0..n-1` to build equivalence classes in parallel (several CPU threads or GPU threads).
+ * The roots are linked by index (the larger root points to the smaller one) with a compare-and-swap, and the paths are compressed by path halving.
+ * Linking by index ensures the root of a class is always its smallest element, and that the final classes do not depend on the interleaving of the threads.
+ * `find`, `unite` and `same` can be called concurrently; `representative` is equal to `find` and only stable once all the unions are done. */
+template <class Allocator = battery::standard_allocator>
+class ConcurrentUnionFind {
+public:
+  using allocator_type = Allocator;
+  using this_type = ConcurrentUnionFind<Allocator>;
+
+private:
+  battery::vector<int, Allocator> parent;
+
+  CUDA INLINE int load(int x) const {
+  #ifdef __CUDA_ARCH__
+    return *((volatile int*)&parent[x]);
+  #else
+    return std::atomic_ref<int>(const_cast<int&>(parent[x])).load(std::memory_order_relaxed);
+  #endif
+  }
+
+  CUDA INLINE bool cas(int x, int expected, int desired) {
+  #ifdef __CUDA_ARCH__
+    return atomicCAS(&parent[x], expected, desired) == expected;
+  #else
+    return std::atomic_ref<int>(parent[x]).compare_exchange_strong(expected, desired);
+  #endif
+  }
+
+public:
+  CUDA ConcurrentUnionFind(size_t n = 0, const allocator_type& alloc = allocator_type())
+   : parent(n, alloc)
+  {
+    for(int i = 0; i < n; ++i) {
+      parent[i] = i;
+    }
+  }
+
+  CUDA size_t size() const {
+    return parent.size();
+  }
+
+  CUDA int find(int x) {
+    int p = load(x);
+    while(p != x) {
+      int gp = load(p);
+      if(gp != p) {
+        // Path halving, it does not matter if it fails because another thread already compressed the path.
+        cas(x, p, gp);
+      }
+      x = p;
+      p = load(x);
+    }
+    return x;
+  }
+
+  /** \return The smallest element of the class of `x`. */
+  CUDA int representative(int x) {
+    return find(x);
+  }
+
+  CUDA bool unite(int x, int y) {
+    while(true) {
+      x = find(x);
+      y = find(y);
+      if(x == y) {
+        return false;
+      }
+      if(x < y) {
+        battery::swap(x, y);
+      }
+      // `x` is the larger root and is linked to `y`, unless it was linked in-between by another thread.
+      if(cas(x, x, y)) {
+        return true;
+      }
+    }
+  }
+
+  CUDA bool same(int x, int y) {
+    while(true) {
+      x = find(x);
+      y = find(y);
+      if(x == y) {
+        return true;
+      }
+      // If `x` is still a root, the classes were disjoint at this point.
+      if(load(x) == x) {
+        return false;
+      }
+    }
+  }
+};
+
+} // namespace lala
+
+#endif
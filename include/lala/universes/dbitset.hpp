@@ -0,0 +1,910 @@
+// Copyright 2024 Pierre Talbot
+
+#ifndef LALA_CORE_DBITSET_HPP
+#define LALA_CORE_DBITSET_HPP
+
+#include "arith_bound.hpp"
+#include "../simd.hpp"
+#include "battery/vector.hpp"
+#include "battery/allocator.hpp"
+
+namespace lala {
+
+template <class Allocator>
+class VStoreDBitset;
+
+/** This class represents a set of integer values with a bitset whose size and offset are given at runtime.
+ * It is the dynamic counterpart of `NBitset` for large finite domains with holes (e.g., domains of a few thousand values), where `N` would have to be fixed at compile time to the largest domain.
+ * The set is described by a window of `n` bits \f$ b_0...b_{n-1} \f$ starting at the value `base`, and two flags L and R for the values outside this window:
+ * \f$ \gamma(base, b_0...b_{n-1}, L, R) = \{ base + i \mid 0 \leq i < n \land b_i = 1 \} \cup \{ v \in \mathbb{Z} \mid v < base \land L = 1 \} \cup \{ v \in \mathbb{Z} \mid v \geq base + n \land R = 1 \} \f$
+ * Top is represented by an empty window with L and R set, and the constraint `x >= k` by an empty window starting at `k` with only R set.
+ * In contrast to `NBitset`, no value falls outside the bitset: the lattice operations are exact and extend the window when required (e.g., the meet of `x >= 0` and `x <= 4000` has a window of 4001 bits).
+ * However, a window never has more than `max_window_size` bits: the values of a larger window are kept in its first `max_window_size` bits (or its last ones if L is set), and the others are over-approximated by the flag on their side (e.g., `0..1000000` is over-approximated by `x >= 0`).
+ *
+ * The binary operations are computed 64 values at a time: when the windows of both bitsets coincide, the words are combined directly, and otherwise the words of one bitset are shifted to be aligned with the words of the other.
+ * This universe is sequential. In a store, `VStoreDBitset` stores the words of all the variables in a single pool instead of one array per variable. */
+template <class Allocator = battery::standard_allocator>
+class DBitset
+{
+public:
+  using allocator_type = Allocator;
+  using memory_type = battery::local_memory;
+  using this_type = DBitset<Allocator>;
+  using local_type = this_type;
+  using word_type = unsigned long long;
+  constexpr static const int word_bits = 64;
+
+  using LB = local::ZLB;
+  using UB = local::ZUB;
+  using value_type = typename LB::value_type;
+
+  /** The maximal number of values in a window, see `make_window`. */
+  constexpr static const int max_window_size = 1 << 16;
+
+  template <class A>
+  friend class DBitset;
+
+  template <class A>
+  friend class VStoreDBitset;
+
+  constexpr static const bool is_abstract_universe = true;
+  constexpr static const bool sequential = true;
+  constexpr static const bool is_totally_ordered = false;
+  constexpr static const bool preserve_bot = true;
+  constexpr static const bool preserve_top = true;
+  constexpr static const bool preserve_join = true;
+  constexpr static const bool preserve_meet = true;
+  constexpr static const bool injective_concretization = true;
+  constexpr static const bool preserve_concrete_covers = false;
+  constexpr static const bool complemented = true;
+  constexpr static const bool is_arithmetic = true;
+  constexpr static const char* name = "DBitset";
+
+private:
+  using words_type = battery::vector<word_type, allocator_type>;
+
+  value_type base;
+  int n;
+  bool lower;
+  bool upper;
+  words_type words;
+
+  struct window_tag {};
+
+  /** A bitset with a window of `n` bits starting at `base`, all bits of the window being unset. */
+  CUDA DBitset(window_tag, value_type base, int n, bool lower, bool upper, const allocator_type& alloc)
+   : base(base), n(n), lower(lower), upper(upper), words(num_words(n), 0, alloc) {}
+
+  /** A bitset with the window `[lo..hi)` and the flags `l` and `r`, all bits of the window being unset.
+   * If the window has more than `max_window_size` values, only its first values are kept (its last ones if `l` is set), and the values removed from the window are over-approximated by setting the flag on their side.
+   * The flags are unset when there is no integer beyond the window. */
+  CUDA static local_type make_window(long long lo, long long hi, bool l, bool r, const allocator_type& alloc) {
+    hi = battery::max(lo, hi);
+    if(hi - lo > max_window_size) {
+      if(l) {
+        lo = hi - max_window_size;
+      }
+      else {
+        hi = lo + max_window_size;
+        r = true;
+      }
+    }
+    l &= lo > battery::limits<value_type>::neg_inf();
+    r &= hi <= battery::limits<value_type>::inf();
+    return local_type(window_tag{}, static_cast<value_type>(lo), static_cast<int>(hi - lo), l, r, alloc);
+  }
+
+  CUDA static int num_words(int bits) {
+    return (bits + word_bits - 1) / word_bits;
+  }
+
+  /** The mask of the bits of the `w`-th word belonging to a window of `bits` bits. */
+  CUDA static word_type mask(int bits, int w) {
+    int r = bits - w * word_bits;
+    return r >= word_bits ? ~word_type(0) : (word_type(1) << r) - 1;
+  }
+
+  /** The membership of the 64 values `v, v+1, ..., v+63`: the bit `i` is set if `v + i` belongs to the set. */
+  CUDA word_type window(long long v) const {
+    long long o = v - base;
+    if(o >= n) {
+      return upper ? ~word_type(0) : 0;
+    }
+    if(o <= -word_bits) {
+      return lower ? ~word_type(0) : 0;
+    }
+    word_type w = 0;
+    if(o >= 0) {
+      int q = o / word_bits;
+      int r = o % word_bits;
+      w = words[q] >> r;
+      if(r != 0 && q + 1 < words.size()) {
+        w |= words[q + 1] << (word_bits - r);
+      }
+    }
+    else {
+      int s = -o;
+      if(words.size() > 0) {
+        w = words[0] << s;
+      }
+      if(lower) {
+        w |= (word_type(1) << s) - 1;
+      }
+    }
+    long long k = n - o;
+    if(k < word_bits) {
+      word_type m = (word_type(1) << k) - 1;
+      w = (w & m) | (upper ? ~m : 0);
+    }
+    return w;
+  }
+
+  template <class A>
+  CUDA bool same_window(const DBitset<A>& other) const {
+    return base == other.base && n == other.n;
+  }
+
+  /** `true` if the set is either empty or the whole set of integers, without considering the bits in the window. */
+  CUDA bool is_uniform() const {
+    return n == 0 && lower == upper;
+  }
+
+  /** Set the bits of the values in `[l..u]` (restricted to the window). */
+  CUDA void set_range(long long l, long long u) {
+    long long i = battery::max(l - base, 0LL);
+    long long to = battery::min(u - base, static_cast<long long>(n) - 1);
+    while(i <= to) {
+      int r = i % word_bits;
+      int len = static_cast<int>(battery::min(static_cast<long long>(word_bits - r), to - i + 1));
+      word_type m = len == word_bits ? ~word_type(0) : ((word_type(1) << len) - 1) << r;
+      words[i / word_bits] |= m;
+      i += len;
+    }
+  }
+
+  /** \return The index of the first bit equal to `value` in the window at or after the index `i`, or `n` if there is none. */
+  CUDA int find_next(int i, bool value) const {
+    while(i < n) {
+      int w = i / word_bits;
+      word_type bits = (value ? words[w] : ~words[w]) >> (i % word_bits);
+      if(bits != 0) {
+        return battery::min(n, i + battery::countr_zero(bits));
+      }
+      i = (w + 1) * word_bits;
+    }
+    return n;
+  }
+
+  /** The smallest window outside of which the meet of `this` and `other` is either empty or contains all the values. */
+  template <class A>
+  CUDA void meet_window(const DBitset<A>& other, long long& lo, long long& hi) const {
+    long long b1 = base, b2 = other.base;
+    long long e1 = b1 + n, e2 = b2 + other.n;
+    lo = lower ? (other.lower ? battery::min(b1, b2) : b2) : (other.lower ? b1 : battery::max(b1, b2));
+    hi = upper ? (other.upper ? battery::max(e1, e2) : e2) : (other.upper ? e1 : battery::min(e1, e2));
+  }
+
+  /** Replace the current set by `x`, taking its memory. */
+  CUDA void assign(this_type&& x) {
+    base = x.base;
+    n = x.n;
+    lower = x.lower;
+    upper = x.upper;
+    words = std::move(x.words);
+  }
+
+  /** The set \f$ \{ -v \mid v \in x \} \f$.
+   * The words of `x` are reversed in bulk (see `simd::reverse_bits`), and then shifted by the number of unused bits in the last word of `x`. */
+  CUDA static local_type negation(const local_type& x) {
+    local_type r(window_tag{}, -(x.base + x.n - 1), x.n, x.upper, x.lower, x.words.get_allocator());
+    int nw = r.words.size();
+    if(nw == 0) {
+      return r;
+    }
+    simd::reverse_bits(r.words.data(), x.words.data(), nw);
+    int pad = nw * word_bits - x.n;
+    if(pad != 0) {
+      for(int w = 0; w < nw; ++w) {
+        r.words[w] = (r.words[w] >> pad) | (w + 1 < nw ? r.words[w + 1] << (word_bits - pad) : 0);
+      }
+    }
+    r.words[nw - 1] &= mask(r.n, nw - 1);
+    return r;
+  }
+
+  CUDA static local_type geq(long long k, const allocator_type& alloc = allocator_type()) {
+    if(k <= battery::limits<value_type>::neg_inf()) { return top(alloc); }
+    if(k > battery::limits<value_type>::inf()) { return bot(alloc); }
+    return local_type(window_tag{}, static_cast<value_type>(k), 0, false, true, alloc);
+  }
+
+  CUDA static local_type leq(long long k, const allocator_type& alloc = allocator_type()) {
+    if(k >= battery::limits<value_type>::inf()) { return top(alloc); }
+    if(k < battery::limits<value_type>::neg_inf()) { return bot(alloc); }
+    return local_type(window_tag{}, static_cast<value_type>(k + 1), 0, true, false, alloc);
+  }
+
+public:
+  /** Initialize to top (all integers). */
+  CUDA explicit DBitset(const allocator_type& alloc = allocator_type())
+   : base(0), n(0), lower(true), upper(true), words(alloc) {}
+
+  /** Initialize to the singleton \f$ \{x\} \f$. */
+  CUDA DBitset(value_type x, const allocator_type& alloc = allocator_type())
+   : DBitset(x, x, alloc) {}
+
+  /** Initialize to the set \f$ \{lb..ub\} \f$ (bot if `lb > ub`). */
+  CUDA DBitset(value_type lb, value_type ub, const allocator_type& alloc = allocator_type())
+   : DBitset(make_window(lb, static_cast<long long>(ub) + 1, false, false, alloc))
+  {
+    for(int w = 0; w < words.size(); ++w) {
+      words[w] = mask(n, w);
+    }
+  }
+
+  CUDA DBitset(const this_type& other)
+   : base(other.base), n(other.n), lower(other.lower), upper(other.upper), words(other.words) {}
+
+  CUDA DBitset(this_type&& other)
+   : base(other.base), n(other.n), lower(other.lower), upper(other.upper), words(std::move(other.words)) {}
+
+  template <class A>
+  CUDA DBitset(const DBitset<A>& other, const allocator_type& alloc = allocator_type())
+   : base(other.base), n(other.n), lower(other.lower), upper(other.upper), words(other.words, alloc) {}
+
+  /** Build a set from a list of values. */
+  CUDA static local_type from_set(const battery::vector<int>& values, const allocator_type& alloc = allocator_type()) {
+    if(values.size() == 0) {
+      return bot(alloc);
+    }
+    int l = values[0];
+    int u = values[0];
+    for(int i = 1; i < values.size(); ++i) {
+      l = battery::min(l, values[i]);
+      u = battery::max(u, values[i]);
+    }
+    local_type b = make_window(l, static_cast<long long>(u) + 1, false, false, alloc);
+    for(int i = 0; i < values.size(); ++i) {
+      b.set_range(values[i], values[i]);
+    }
+    return b;
+  }
+
+  /** The assignment operator can only be used in a sequential context.
+   * It is monotone but not extensive. */
+  template <class A>
+  CUDA this_type& operator=(const DBitset<A>& other) {
+    base = other.base;
+    n = other.n;
+    lower = other.lower;
+    upper = other.upper;
+    words = words_type(other.words, words.get_allocator());
+    return *this;
+  }
+
+  CUDA this_type& operator=(const this_type& other) {
+    base = other.base;
+    n = other.n;
+    lower = other.lower;
+    upper = other.upper;
+    words = other.words;
+    return *this;
+  }
+
+  CUDA this_type& operator=(this_type&& other) {
+    assign(std::move(other));
+    return *this;
+  }
+
+  CUDA allocator_type get_allocator() const {
+    return words.get_allocator();
+  }
+
+  /** Pre-interpreted formula `x == 0`. */
+  CUDA static local_type eq_zero() { return local_type(0); }
+  /** Pre-interpreted formula `x == 1`. */
+  CUDA static local_type eq_one() { return local_type(1); }
+
+  CUDA static local_type bot(const allocator_type& alloc = allocator_type()) {
+    return local_type(window_tag{}, 0, 0, false, false, alloc);
+  }
+
+  CUDA static local_type top(const allocator_type& alloc = allocator_type()) {
+    return local_type(alloc);
+  }
+
+  CUDA local::B is_top() const {
+    if(!lower || !upper) {
+      return false;
+    }
+    for(int w = 0; w < words.size(); ++w) {
+      if(words[w] != mask(n, w)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  CUDA local::B is_bot() const {
+    if(lower || upper) {
+      return false;
+    }
+    for(int w = 0; w < words.size(); ++w) {
+      if(words[w] != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /** \return `true` if `v` belongs to the set. */
+  CUDA bool contains(long long v) const {
+    if(v < base) { return lower; }
+    long long o = v - base;
+    if(o >= n) { return upper; }
+    return (words[o / word_bits] >> (o % word_bits)) & 1;
+  }
+
+  /** The first value of the window. */
+  CUDA value_type window_base() const { return base; }
+  /** The number of values in the window. */
+  CUDA int window_size() const { return n; }
+
+  /** \return The number of values in the window belonging to the set. */
+  CUDA int count() const {
+    int c = 0;
+    for(int w = 0; w < words.size(); ++w) {
+      c += battery::popcount(words[w]);
+    }
+    return c;
+  }
+
+private:
+  template<bool diagnose, class F, class Env, class A>
+  CUDA NI static bool interpret_existential(const F& f, const Env& env, DBitset<A>& k, IDiagnostics& diagnostics) {
+    const auto& sort = battery::get<1>(f.exists());
+    if(sort.is_int()) {
+      return true;
+    }
+    else if(sort.is_bool()) {
+      k.meet(local_type(0, 1));
+      return true;
+    }
+    else {
+      const auto& vname = battery::get<0>(f.exists());
+      RETURN_INTERPRETATION_ERROR(("DBitset only supports variables of type `Int` or `Bool`, but `" + vname + "` has another sort."));
+    }
+  }
+
+  template<bool diagnose, bool negated, class F, class A>
+  CUDA NI static bool interpret_tell_set(const F& f, const F& k, DBitset<A>& tell, IDiagnostics& diagnostics) {
+    using sort_type = Sort<typename F::allocator_type>;
+    std::optional<sort_type> sort = f.seq(1).sort();
+    if(sort.has_value() &&
+       (sort.value() == sort_type(sort_type::Set, sort_type(sort_type::Int))
+     || sort.value() == sort_type(sort_type::Set, sort_type(sort_type::Bool))))
+    {
+      const auto& set = f.seq(1).s();
+      local_type s = bot();
+      if(set.size() > 0) {
+        int l = battery::get<0>(set[0]).to_z();
+        int u = battery::get<1>(set[0]).to_z();
+        for(int i = 1; i < set.size(); ++i) {
+          l = battery::min(l, static_cast<int>(battery::get<0>(set[i]).to_z()));
+          u = battery::max(u, static_cast<int>(battery::get<1>(set[i]).to_z()));
+        }
+        s = make_window(l, static_cast<long long>(u) + 1, false, false, allocator_type());
+        for(int i = 0; i < set.size(); ++i) {
+          s.set_range(battery::get<0>(set[i]).to_z(), battery::get<1>(set[i]).to_z());
+        }
+      }
+      if constexpr(negated) {
+        s = s.complement();
+      }
+      tell.meet(s);
+      return true;
+    }
+    else {
+      RETURN_INTERPRETATION_ERROR("DBitset only supports membership (`x in S`) where `S` is a set of integers.");
+    }
+  }
+
+  template<bool diagnose, class F, class A>
+  CUDA NI static bool interpret_tell_x_op_k(const F& f, logic_int k, Sig sig, DBitset<A>& tell, IDiagnostics& diagnostics) {
+    switch(sig) {
+      case EQ: tell.meet(local_type(k)); break;
+      case NEQ: tell.meet(local_type(k).complement()); break;
+      case LEQ: tell.meet(leq(k)); break;
+      case LT: tell.meet(leq(k - 1)); break;
+      case GEQ: tell.meet(geq(k)); break;
+      case GT: tell.meet(geq(k + 1)); break;
+      default: RETURN_INTERPRETATION_ERROR("This symbol is not supported.");
+    }
+    return true;
+  }
+
+  template<bool diagnose, bool negated, class F, class Env, class A>
+  CUDA NI static bool interpret_binary(const F& f, const Env& env, DBitset<A>& tell, IDiagnostics& diagnostics) {
+    if(f.sig() == IN) {
+      return interpret_tell_set<diagnose, negated>(f, f.seq(1), tell, diagnostics);
+    }
+    else if(f.seq(1).is(F::Z) || f.seq(1).is(F::B)) {
+      if constexpr(negated) {
+        local_type s;
+        if(!interpret_tell_x_op_k<diagnose>(f, f.seq(1).to_z(), f.sig(), s, diagnostics)) {
+          return false;
+        }
+        tell.meet(s.complement());
+        return true;
+      }
+      else {
+        return interpret_tell_x_op_k<diagnose>(f, f.seq(1).to_z(), f.sig(), tell, diagnostics);
+      }
+    }
+    else {
+      RETURN_INTERPRETATION_ERROR("Only integer and Boolean constants are supported in DBitset.");
+    }
+  }
+
+public:
+  /** Support the following language where all constants `k` are integer or Boolean values:
+   *   * `var x:Z`
+   *   * `var x:B`
+   *   * `x <op> k` where `k` is an integer constant and `<op>` in {==, !=, <, <=, >, >=}.
+   *   * `x in S` where `S` is a set of integers.
+   * The interpretation is always exact. */
+  template<bool diagnose = false, class F, class Env, class A>
+  CUDA NI static bool interpret_tell(const F& f, const Env& env, DBitset<A>& tell, IDiagnostics& diagnostics) {
+    if(f.is(F::E)) {
+      return interpret_existential<diagnose>(f, env, tell, diagnostics);
+    }
+    else if(f.is_unary() && f.sig() == NOT && f.seq(0).is_binary()) {
+      return interpret_binary<diagnose, true>(f.seq(0), env, tell, diagnostics);
+    }
+    else if(f.is_binary() && f.seq(0).is_variable() && f.seq(1).is_constant()) {
+      return interpret_binary<diagnose, false>(f, env, tell, diagnostics);
+    }
+    else {
+      RETURN_INTERPRETATION_ERROR("Only binary formulas of the form `x <sig> k` where if x is a variable and k is a constant are supported. We also supports existential quantifier and membership in a set of integers (x in S).");
+    }
+  }
+
+  /** Support the same language than the "tell language" without existential. */
+  template<bool diagnose = false, class F, class Env, class A>
+  CUDA NI static bool interpret_ask(const F& f, const Env& env, DBitset<A>& k, IDiagnostics& diagnostics) {
+    local_type b = local_type::top();
+    auto nf = negate(f);
+    if(!nf.has_value()) {
+      RETURN_INTERPRETATION_ERROR("Could not negate the formula in order to interpret_ask it.");
+    }
+    if(f.is(F::E)) {
+      RETURN_INTERPRETATION_ERROR("Existential quantification is not supported in ask interpretation.");
+    }
+    if(interpret_tell<diagnose>(nf.value(), env, b, diagnostics)) {
+      k.meet(b.complement());
+      return true;
+    }
+    else {
+      return false;
+    }
+  }
+
+  template<IKind kind, bool diagnose = false, class F, class Env, class A>
+  CUDA NI static bool interpret(const F& f, const Env& env, DBitset<A>& k, IDiagnostics& diagnostics) {
+    if constexpr(kind == IKind::ASK) {
+      return interpret_ask<diagnose>(f, env, k, diagnostics);
+    }
+    else {
+      return interpret_tell<diagnose>(f, env, k, diagnostics);
+    }
+  }
+
+  CUDA LB lb() const {
+    if(lower) {
+      return LB::top();
+    }
+    for(int w = 0; w < words.size(); ++w) {
+      if(words[w] != 0) {
+        return LB::geq_k(base + w * word_bits + battery::countr_zero(words[w]));
+      }
+    }
+    return upper ? LB::geq_k(base + n) : LB::bot();
+  }
+
+  CUDA UB ub() const {
+    if(upper) {
+      return UB::top();
+    }
+    for(int w = words.size() - 1; w >= 0; --w) {
+      if(words[w] != 0) {
+        return UB::leq_k(base + w * word_bits + word_bits - 1 - battery::countl_zero(words[w]));
+      }
+    }
+    return lower ? UB::leq_k(base - 1) : UB::bot();
+  }
+
+  CUDA local_type complement() const {
+    local_type c(*this);
+    c.lower = !lower;
+    c.upper = !upper;
+    for(int w = 0; w < c.words.size(); ++w) {
+      c.words[w] = ~c.words[w] & mask(n, w);
+    }
+    return c;
+  }
+
+  CUDA void join_top() {
+    lower = true;
+    upper = true;
+    for(int w = 0; w < words.size(); ++w) {
+      words[w] = mask(n, w);
+    }
+  }
+
+  template<class A>
+  CUDA bool join_lb(const A& lb) {
+    if(lb.is_top()) {
+      bool has_changed = !is_top();
+      join_top();
+      return has_changed;
+    }
+    return lb.is_bot() ? false : join(geq(lb.value()));
+  }
+
+  template<class A>
+  CUDA bool join_ub(const A& ub) {
+    if(ub.is_top()) {
+      bool has_changed = !is_top();
+      join_top();
+      return has_changed;
+    }
+    return ub.is_bot() ? false : join(leq(ub.value()));
+  }
+
+  template<class A>
+  CUDA bool join(const DBitset<A>& other) {
+    if(same_window(other)) {
+      word_type changes = (!lower && other.lower) || (!upper && other.upper);
+      lower |= other.lower;
+      upper |= other.upper;
+      for(int w = 0; w < words.size(); ++w) {
+        changes |= other.words[w] & ~words[w];
+        words[w] |= other.words[w];
+      }
+      return changes != 0;
+    }
+    if(other.is_subset_of(*this)) {
+      return false;
+    }
+    if(is_uniform()) {
+      // `this` is bot since `other` is not included in it.
+      *this = other;
+      return true;
+    }
+    if(other.is_uniform()) {
+      join_top();
+      return true;
+    }
+    long long lo = battery::min(static_cast<long long>(base), static_cast<long long>(other.base));
+    long long hi = battery::max(static_cast<long long>(base) + n, static_cast<long long>(other.base) + other.n);
+    local_type r = make_window(lo, hi, lower || other.lower, upper || other.upper, words.get_allocator());
+    for(int w = 0; w < r.words.size(); ++w) {
+      long long v = static_cast<long long>(r.base) + w * word_bits;
+      r.words[w] = (window(v) | other.window(v)) & mask(r.n, w);
+    }
+    // The window of `r` might be too small, in which case the join is over-approximated and possibly equal to `this`.
+    if(r.is_subset_of(*this)) {
+      return false;
+    }
+    assign(std::move(r));
+    return true;
+  }
+
+  CUDA void meet_bot() {
+    lower = false;
+    upper = false;
+    for(int w = 0; w < words.size(); ++w) {
+      words[w] = 0;
+    }
+  }
+
+  template<class A>
+  CUDA bool meet_lb(const A& lb) {
+    if(lb.is_bot()) {
+      bool has_changed = !is_bot();
+      meet_bot();
+      return has_changed;
+    }
+    return lb.is_top() ? false : meet(geq(lb.value()));
+  }
+
+  template<class A>
+  CUDA bool meet_ub(const A& ub) {
+    if(ub.is_bot()) {
+      bool has_changed = !is_bot();
+      meet_bot();
+      return has_changed;
+    }
+    return ub.is_top() ? false : meet(leq(ub.value()));
+  }
+
+  template<class A>
+  CUDA bool meet(const DBitset<A>& other) {
+    if(same_window(other)) {
+      word_type changes = (lower && !other.lower) || (upper && !other.upper);
+      lower &= other.lower;
+      upper &= other.upper;
+      for(int w = 0; w < words.size(); ++w) {
+        changes |= words[w] & ~other.words[w];
+        words[w] &= other.words[w];
+      }
+      return changes != 0;
+    }
+    if(is_subset_of(other)) {
+      return false;
+    }
+    long long lo, hi;
+    meet_window(other, lo, hi);
+    local_type r = make_window(lo, hi, lower && other.lower, upper && other.upper, words.get_allocator());
+    for(int w = 0; w < r.words.size(); ++w) {
+      long long v = static_cast<long long>(r.base) + w * word_bits;
+      r.words[w] = window(v) & other.window(v) & mask(r.n, w);
+    }
+    // The window of `r` might be too small, in which case the meet is over-approximated, and we keep `this` unless `r` is strictly smaller.
+    if(!r.is_subset_of(*this) || is_subset_of(r)) {
+      return false;
+    }
+    assign(std::move(r));
+    return true;
+  }
+
+  /** \return `true` if the set is included in `other`. */
+  template<class A>
+  CUDA bool is_subset_of(const DBitset<A>& other) const {
+    if((lower && !other.lower) || (upper && !other.upper)) {
+      return false;
+    }
+    if(same_window(other)) {
+      for(int w = 0; w < words.size(); ++w) {
+        if(words[w] & ~other.words[w]) {
+          return false;
+        }
+      }
+      return true;
+    }
+    // Outside of the two windows, both sets are uniform below, between and above the windows.
+    long long b1 = base, e1 = b1 + n;
+    long long b2 = other.base, e2 = b2 + other.n;
+    for(long long v = b1; v < e1; v += word_bits) {
+      if(window(v) & ~other.window(v)) {
+        return false;
+      }
+    }
+    for(long long v = b2; v < e2; v += word_bits) {
+      if(window(v) & ~other.window(v)) {
+        return false;
+      }
+    }
+    long long gap = battery::min(e1, e2);
+    return gap >= battery::max(b1, b2) || !contains(gap) || other.contains(gap);
+  }
+
+  template <class A>
+  CUDA bool extract(DBitset<A>& ua) const {
+    ua = *this;
+    return true;
+  }
+
+  template<class Env, class Allocator2 = typename Env::allocator_type>
+  CUDA TFormula<Allocator2> deinterpret(AVar x, const Env& env, const Allocator2& allocator = Allocator2()) const {
+    using F = TFormula<Allocator2>;
+    if(is_bot()) {
+      return F::make_false();
+    }
+    else if(is_top()) {
+      return F::make_true();
+    }
+    else {
+      typename F::Sequence seq{allocator};
+      if(lower) {
+        seq.push_back(F::make_binary(F::make_avar(x), LEQ, F::make_z(base - 1), UNTYPED, allocator));
+      }
+      if(upper) {
+        seq.push_back(F::make_binary(F::make_avar(x), GEQ, F::make_z(base + n), UNTYPED, allocator));
+      }
+      logic_set<F> logical_set(allocator);
+      for(int i = find_next(0, true); i < n; i = find_next(i, true)) {
+        int j = find_next(i, false);
+        logical_set.push_back(battery::make_tuple(F::make_z(base + i), F::make_z(base + j - 1)));
+        i = j;
+      }
+      if(logical_set.size() > 0) {
+        seq.push_back(F::make_binary(F::make_avar(x), IN, F::make_set(std::move(logical_set)), UNTYPED, allocator));
+      }
+      if(seq.size() == 1) {
+        return std::move(seq[0]);
+      }
+      else {
+        return F::make_nary(OR, std::move(seq));
+      }
+    }
+  }
+
+  /** Deinterpret the current value to a logical constant.
+   * The lower bound is deinterpreted, and it is up to the user to check that the set is a singleton.
+  */
+  template<class F>
+  CUDA NI F deinterpret() const {
+    return lb().template deinterpret<F>();
+  }
+
+  CUDA NI void print() const {
+    printf("{");
+    bool comma_needed = false;
+    if(lower) {
+      printf(".., %d", base - 1);
+      comma_needed = true;
+    }
+    for(int i = find_next(0, true); i < n; i = find_next(i + 1, true)) {
+      if(comma_needed) { printf(", "); }
+      printf("%d", base + i);
+      comma_needed = true;
+    }
+    if(upper) {
+      if(comma_needed) { printf(", "); }
+      printf("%d, ..", base + n);
+    }
+    printf("}");
+  }
+
+  CUDA NI constexpr static bool is_trivial_fun(Sig sig) {
+    switch(sig) {
+      case ABS:
+      case NEG: return false;
+      default: return true;
+    }
+  }
+
+public:
+  /** Meet with \f$ \{ -v \mid v \in x \} \f$, the bits of `x` are reversed four words at a time with AVX2. */
+  CUDA void neg(const local_type& x) {
+    meet(negation(x));
+  }
+
+  CUDA void abs(const local_type& x) {
+    local_type pos(x);
+    pos.meet(geq(0));
+    local_type neg_part(x);
+    neg_part.meet(leq(-1));
+    local_type r = negation(neg_part);
+    r.join(pos);
+    meet(r);
+  }
+
+  CUDA void project(Sig fun, const local_type& x)  {
+    switch(fun) {
+      case NEG: neg(x); break;
+      case ABS: abs(x); break;
+    }
+  }
+
+  /** On sets of integers, the additive inverse is the negation. */
+  CUDA void additive_inverse(const local_type& x) {
+    neg(x);
+  }
+
+  CUDA void project(Sig fun, const local_type& x, const local_type& y) {
+    printf("%% binary functions %s are unsupported\n", string_of_sig(fun));
+    int* ptr = nullptr;
+    ptr[1] = 193;
+  }
+
+  CUDA local_type width() const {
+    if(lower || upper) { return top(); }
+    else { return local_type(count()); }
+  }
+
+  /** \return The median value of the set, the values below (resp. above) the window count as the single value `base - 1` (resp. `base + n`), as in `NBitset`. */
+  CUDA local_type median() const {
+    if(is_bot()) { return local_type::bot(); }
+    int total = count() + lower + upper;
+    int k = total == 1 ? 1 : total / 2;
+    if(lower) {
+      if(k == 1) { return local_type(base - 1); }
+      --k;
+    }
+    for(int w = 0; w < words.size(); ++w) {
+      int c = battery::popcount(words[w]);
+      if(k <= c) {
+        word_type bits = words[w];
+        for(int i = 1; i < k; ++i) {
+          bits &= bits - 1;
+        }
+        return local_type(base + w * word_bits + battery::countr_zero(bits));
+      }
+      k -= c;
+    }
+    return local_type(base + n);
+  }
+};
+
+// Lattice operations
+
+template<class A1, class A2>
+CUDA DBitset<A1> fjoin(const DBitset<A1>& a, const DBitset<A2>& b)
+{
+  DBitset<A1> r(a);
+  r.join(b);
+  return r;
+}
+
+template<class A1, class A2>
+CUDA DBitset<A1> fmeet(const DBitset<A1>& a, const DBitset<A2>& b)
+{
+  DBitset<A1> r(a);
+  r.meet(b);
+  return r;
+}
+
+template<class A1, class A2>
+CUDA bool operator<=(const DBitset<A1>& a, const DBitset<A2>& b)
+{
+  return a.is_subset_of(b);
+}
+
+template<class A1, class A2>
+CUDA bool operator<(const DBitset<A1>& a, const DBitset<A2>& b)
+{
+  return a.is_subset_of(b) && !b.is_subset_of(a);
+}
+
+template<class A1, class A2>
+CUDA bool operator>=(const DBitset<A1>& a, const DBitset<A2>& b)
+{
+  return b <= a;
+}
+
+template<class A1, class A2>
+CUDA bool operator>(const DBitset<A1>& a, const DBitset<A2>& b)
+{
+  return b < a;
+}
+
+template<class A1, class A2>
+CUDA bool operator==(const DBitset<A1>& a, const DBitset<A2>& b)
+{
+  return a.is_subset_of(b) && b.is_subset_of(a);
+}
+
+template<class A1, class A2>
+CUDA bool operator!=(const DBitset<A1>& a, const DBitset<A2>& b)
+{
+  return !(a == b);
+}
+
+template<class A>
+std::ostream& operator<<(std::ostream &s, const DBitset<A> &a) {
+  s << "{";
+  bool comma_needed = false;
+  if(a.lb().is_top()) {
+    s << ".., " << a.window_base() - 1;
+    comma_needed = true;
+  }
+  for(int i = 0; i < a.window_size(); ++i) {
+    if(a.contains(static_cast<long long>(a.window_base()) + i)) {
+      if(comma_needed) { s << ", "; }
+      s << a.window_base() + i;
+      comma_needed = true;
+    }
+  }
+  if(a.ub().is_top()) {
+    if(comma_needed) { s << ", "; }
+    s << a.window_base() + a.window_size() << ", ..";
+  }
+  s << "}";
+  return s;
+}
+
+} // end namespace lala
+
+#endif
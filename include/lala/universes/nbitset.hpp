@@ -455,20 +455,34 @@ public:
     else { return local_type(bits.count()); }
   }
 
-  /** \return The median value of the bitset. */
+  /** \return The median value of the bitset.
+   * The word containing the median is found by a binary search over the words, counting the values of the words before it with `count` on a masked copy of the bitset, and the median is then selected by testing the bits of this word.
+   * It takes \f$ O(\frac{N}{64} \log \frac{N}{64}) \f$ word operations and at most 64 bit tests instead of \f$ O(N) \f$ bit tests. */
   CUDA constexpr local_type median() const {
+    using mask_type = battery::bitset<N, battery::local_memory, T>;
     if(is_bot()) { return local_type::bot(); }
     int total = bits.count();
-    int current = 0;
-    for(int i = 0; i < bits.size(); ++i) {
-      if(bits.test(i)) {
-        ++current;
-        if(current == total/2 || total == 1) {
-          return local_type(i-1);
-        }
+    int k = total == 1 ? 1 : total / 2;
+    constexpr int word_bits = sizeof(T) * 8;
+    int lo = 0;
+    int hi = (static_cast<int>(N) - 1) / word_bits;
+    int before = 0;
+    while(lo < hi) {
+      int mid = lo + (hi - lo) / 2;
+      int c = (bits & mask_type(0, (mid + 1) * word_bits - 1)).count();
+      if(k <= c) { hi = mid; }
+      else {
+        lo = mid + 1;
+        before = c;
+      }
+    }
+    k -= before;
+    for(int i = lo * word_bits; i < static_cast<int>(N); ++i) {
+      if(bits.test(i) && --k == 0) {
+        return local_type(i - 1);
       }
     }
-    return local_type::bot();
+    return local_type(static_cast<int>(N) - 2);
   }
 };
 
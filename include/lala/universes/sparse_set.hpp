@@ -0,0 +1,1011 @@
+// Copyright 2024 Pierre Talbot
+
+#ifndef LALA_CORE_SPARSE_SET_HPP
+#define LALA_CORE_SPARSE_SET_HPP
+
+#include "arith_bound.hpp"
+#include "battery/vector.hpp"
+#include "battery/allocator.hpp"
+
+namespace lala {
+
+/** This class represents a set of integer values with a sparse set, for large domains from which values are mostly removed one at a time (e.g., by `x != k` constraints).
+ * As in `DBitset`, the set is described by a window of `n` values starting at `base`, and two flags L and R for the values outside this window:
+ * \f$ \gamma(base, n, M, L, R) = \{ base + i \mid i \in M \} \cup \{ v \in \mathbb{Z} \mid v < base \land L = 1 \} \cup \{ v \in \mathbb{Z} \mid v \geq base + n \land R = 1 \} \f$
+ * The offsets `M` of the values in the window are stored in a sparse set: `dense` is a permutation of `0..n-1` where the first `card` offsets are the values in the set, and `sparse` is its inverse.
+ * Hence, testing or removing a value takes constant time, the smallest and largest values of the window are cached, and removing values never moves the values that are not in the set.
+ *
+ * The last property makes backtracking cheap: when a set is only narrowed in the same window, the state taken by `snapshot` is restored by `restore` in constant time, by resetting the number of values and the cached bounds.
+ * This is the case of every meet (with any set) once the set has no L and R flags, for instance after the interpretation of `var 0..4000: x`.
+ * The other operations (e.g., join, or a meet requiring a larger window) rebuild the set in time linear in the size of the window.
+ * As in `DBitset`, a window never has more than `max_window_size` values, the values of a larger window being over-approximated by the flags L and R.
+ * This universe is sequential and can be stored in `VStore`, which then uses `snapshot` and `restore` to backtrack. */
+template <class Allocator = battery::standard_allocator>
+class SparseSet
+{
+public:
+  using allocator_type = Allocator;
+  using memory_type = battery::local_memory;
+  using this_type = SparseSet<Allocator>;
+  using local_type = this_type;
+
+  using LB = local::ZLB;
+  using UB = local::ZUB;
+  using value_type = typename LB::value_type;
+
+  /** The maximal number of values in a window, see `make_window`. */
+  constexpr static const int max_window_size = 1 << 16;
+
+  template <class A>
+  friend class SparseSet;
+
+  constexpr static const bool is_abstract_universe = true;
+  constexpr static const bool sequential = true;
+  constexpr static const bool is_totally_ordered = false;
+  constexpr static const bool preserve_bot = true;
+  constexpr static const bool preserve_top = true;
+  constexpr static const bool preserve_join = true;
+  constexpr static const bool preserve_meet = true;
+  constexpr static const bool injective_concretization = true;
+  constexpr static const bool preserve_concrete_covers = false;
+  constexpr static const bool complemented = true;
+  constexpr static const bool is_arithmetic = true;
+  constexpr static const char* name = "SparseSet";
+
+  /** The state of a set restorable in constant time with `restore`, see `snapshot`. */
+  struct snapshot_type {
+    value_type base;
+    int n;
+    unsigned int version;
+    int card;
+    int first;
+    int last;
+    bool lower;
+    bool upper;
+
+    CUDA bool operator==(const snapshot_type& other) const {
+      return base == other.base && n == other.n && version == other.version && card == other.card
+        && first == other.first && last == other.last && lower == other.lower && upper == other.upper;
+    }
+  };
+
+private:
+  using indexes_type = battery::vector<int, allocator_type>;
+
+  value_type base;
+  int n;
+  /** Incremented when the order of the offsets in `dense` is changed by something else than a removal, which invalidates the snapshots taken before. */
+  unsigned int version;
+  /** The number of values of the window in the set, they are the offsets `dense[0..card-1]`. */
+  int card;
+  /** The smallest and largest offsets in the set (`n` and `-1` if `card == 0`). */
+  int first;
+  int last;
+  bool lower;
+  bool upper;
+  indexes_type dense;
+  indexes_type sparse;
+
+  struct window_tag {};
+
+  /** A set with a window of `n` values starting at `base`, none of them being in the set. */
+  CUDA SparseSet(window_tag, value_type base, int n, bool lower, bool upper, const allocator_type& alloc)
+   : base(base), n(n), version(0), card(0), first(n), last(-1), lower(lower), upper(upper), dense(n, 0, alloc), sparse(n, 0, alloc)
+  {
+    for(int i = 0; i < n; ++i) {
+      dense[i] = i;
+      sparse[i] = i;
+    }
+  }
+
+  /** A set with the window `[lo..hi)` and the flags `l` and `r`, none of the values of the window being in the set.
+   * If the window has more than `max_window_size` values, only its first values are kept (its last ones if `l` is set), and the values removed from the window are over-approximated by setting the flag on their side.
+   * The flags are unset when there is no integer beyond the window. */
+  CUDA static local_type make_window(long long lo, long long hi, bool l, bool r, const allocator_type& alloc) {
+    hi = battery::max(lo, hi);
+    if(hi - lo > max_window_size) {
+      if(l) {
+        lo = hi - max_window_size;
+      }
+      else {
+        hi = lo + max_window_size;
+        r = true;
+      }
+    }
+    l &= lo > battery::limits<value_type>::neg_inf();
+    r &= hi <= battery::limits<value_type>::inf();
+    return local_type(window_tag{}, static_cast<value_type>(lo), static_cast<int>(hi - lo), l, r, alloc);
+  }
+
+  CUDA bool has(int o) const {
+    return sparse[o] < card;
+  }
+
+  /** Swap the offsets at the positions `p` and `q` of `dense`. */
+  CUDA void swap_at(int p, int q) {
+    int a = dense[p];
+    int b = dense[q];
+    dense[p] = b;
+    dense[q] = a;
+    sparse[b] = p;
+    sparse[a] = q;
+  }
+
+  CUDA void insert(int o) {
+    if(!has(o)) {
+      swap_at(sparse[o], card);
+      ++card;
+      first = battery::min(first, o);
+      last = battery::max(last, o);
+    }
+  }
+
+  /** Insert the values in `[l..u]` (restricted to the window). */
+  CUDA void insert_range(long long l, long long u) {
+    long long from = battery::max(l - base, 0LL);
+    long long to = battery::min(u - base, static_cast<long long>(n) - 1);
+    for(long long o = from; o <= to; ++o) {
+      insert(static_cast<int>(o));
+    }
+  }
+
+  /** Remove the offset `o` without updating `first` and `last`, see `tighten`.
+   * \return `true` if `o` was in the set. */
+  CUDA bool remove_raw(int o) {
+    if(has(o)) {
+      --card;
+      swap_at(sparse[o], card);
+      return true;
+    }
+    return false;
+  }
+
+  /** Restore `first` and `last` after the removal of some values. */
+  CUDA void tighten() {
+    if(card == 0) {
+      first = n;
+      last = -1;
+    }
+    else {
+      while(!has(first)) { ++first; }
+      while(!has(last)) { --last; }
+    }
+  }
+
+  /** Remove the values in `[l..u]` (restricted to the values of the window in the set).
+   * \return `true` if a value was removed. */
+  CUDA bool remove_range(long long l, long long u) {
+    long long from = battery::max(l - base, static_cast<long long>(first));
+    long long to = battery::min(u - base, static_cast<long long>(last));
+    bool has_changed = false;
+    if(to - from + 1 <= card) {
+      for(long long o = from; o <= to; ++o) {
+        has_changed |= remove_raw(static_cast<int>(o));
+      }
+    }
+    else {
+      for(int i = card - 1; i >= 0; --i) {
+        if(dense[i] >= from && dense[i] <= to) {
+          has_changed |= remove_raw(dense[i]);
+        }
+      }
+    }
+    return has_changed;
+  }
+
+  template <class A>
+  CUDA bool same_window(const SparseSet<A>& other) const {
+    return base == other.base && n == other.n;
+  }
+
+  /** `true` if the values outside the window of the meet of `this` and `other` are described by the flags of the meet. */
+  template <class A>
+  CUDA bool meet_in_window(const SparseSet<A>& other) const {
+    return (!lower || other.base >= base) && (!upper || other.base + other.n <= base + n);
+  }
+
+  /** `true` if the values of `other` outside the window of `this` are described by the flags of `this` (which are set). */
+  template <class A>
+  CUDA bool join_in_window(const SparseSet<A>& other) const {
+    if(other.is_bot()) {
+      return true;
+    }
+    LB l = other.lb();
+    UB u = other.ub();
+    return (lower || (!l.is_top() && l.value() >= base))
+        && (upper || (!u.is_top() && static_cast<long long>(u.value()) < static_cast<long long>(base) + n));
+  }
+
+  /** The smallest window outside of which the meet of `this` and `other` is either empty or contains all the values. */
+  template <class A>
+  CUDA void meet_window(const SparseSet<A>& other, long long& lo, long long& hi) const {
+    long long b1 = base, b2 = other.base;
+    long long e1 = b1 + n, e2 = b2 + other.n;
+    lo = lower ? (other.lower ? battery::min(b1, b2) : b2) : (other.lower ? b1 : battery::max(b1, b2));
+    hi = upper ? (other.upper ? battery::max(e1, e2) : e2) : (other.upper ? e1 : battery::min(e1, e2));
+  }
+
+  /** The set in the window `[lo..hi)` (see `make_window`), where `v` belongs to the set if `pred(v)` holds. */
+  template <class P>
+  CUDA local_type build(long long lo, long long hi, bool l, bool r, P&& pred) const {
+    local_type s = make_window(lo, hi, l, r, dense.get_allocator());
+    for(int o = 0; o < s.n; ++o) {
+      if(pred(static_cast<long long>(s.base) + o)) {
+        s.insert(o);
+      }
+    }
+    return s;
+  }
+
+  /** Replace the current set by `x`, which invalidates the snapshots. */
+  CUDA void replace(this_type&& x) {
+    unsigned int v = battery::max(version, x.version) + 1;
+    assign(std::move(x));
+    version = v;
+  }
+
+  /** Replace the current set by `x`, taking its memory. */
+  CUDA void assign(this_type&& x) {
+    base = x.base;
+    n = x.n;
+    version = x.version;
+    card = x.card;
+    first = x.first;
+    last = x.last;
+    lower = x.lower;
+    upper = x.upper;
+    dense = std::move(x.dense);
+    sparse = std::move(x.sparse);
+  }
+
+  /** The set \f$ \{ -v \mid v \in x \} \f$. */
+  CUDA static local_type negation(const local_type& x) {
+    local_type r(window_tag{}, -(x.base + x.n - 1), x.n, x.upper, x.lower, x.dense.get_allocator());
+    for(int i = 0; i < x.card; ++i) {
+      r.insert(x.n - 1 - x.dense[i]);
+    }
+    return r;
+  }
+
+  CUDA static local_type geq(long long k, const allocator_type& alloc = allocator_type()) {
+    if(k <= battery::limits<value_type>::neg_inf()) { return top(alloc); }
+    if(k > battery::limits<value_type>::inf()) { return bot(alloc); }
+    return local_type(window_tag{}, static_cast<value_type>(k), 0, false, true, alloc);
+  }
+
+  CUDA static local_type leq(long long k, const allocator_type& alloc = allocator_type()) {
+    if(k >= battery::limits<value_type>::inf()) { return top(alloc); }
+    if(k < battery::limits<value_type>::neg_inf()) { return bot(alloc); }
+    return local_type(window_tag{}, static_cast<value_type>(k + 1), 0, true, false, alloc);
+  }
+
+public:
+  /** Initialize to top (all integers). */
+  CUDA explicit SparseSet(const allocator_type& alloc = allocator_type())
+   : SparseSet(window_tag{}, 0, 0, true, true, alloc) {}
+
+  /** Initialize to the singleton \f$ \{x\} \f$. */
+  CUDA SparseSet(value_type x, const allocator_type& alloc = allocator_type())
+   : SparseSet(x, x, alloc) {}
+
+  /** Initialize to the set \f$ \{lb..ub\} \f$ (bot if `lb > ub`). */
+  CUDA SparseSet(value_type lb, value_type ub, const allocator_type& alloc = allocator_type())
+   : SparseSet(make_window(lb, static_cast<long long>(ub) + 1, false, false, alloc))
+  {
+    card = n;
+    first = 0;
+    last = n - 1;
+  }
+
+  /** The copies of a set share its snapshots. */
+  CUDA SparseSet(const this_type& other)
+   : base(other.base), n(other.n), version(other.version), card(other.card), first(other.first), last(other.last),
+     lower(other.lower), upper(other.upper), dense(other.dense), sparse(other.sparse) {}
+
+  CUDA SparseSet(this_type&& other)
+   : base(other.base), n(other.n), version(other.version), card(other.card), first(other.first), last(other.last),
+     lower(other.lower), upper(other.upper), dense(std::move(other.dense)), sparse(std::move(other.sparse)) {}
+
+  template <class A>
+  CUDA SparseSet(const SparseSet<A>& other, const allocator_type& alloc = allocator_type())
+   : base(other.base), n(other.n), version(other.version), card(other.card), first(other.first), last(other.last),
+     lower(other.lower), upper(other.upper), dense(other.dense, alloc), sparse(other.sparse, alloc) {}
+
+  /** Build a set from a list of values. */
+  CUDA static local_type from_set(const battery::vector<int>& values, const allocator_type& alloc = allocator_type()) {
+    if(values.size() == 0) {
+      return bot(alloc);
+    }
+    int l = values[0];
+    int u = values[0];
+    for(int i = 1; i < values.size(); ++i) {
+      l = battery::min(l, values[i]);
+      u = battery::max(u, values[i]);
+    }
+    local_type s = make_window(l, static_cast<long long>(u) + 1, false, false, alloc);
+    for(int i = 0; i < values.size(); ++i) {
+      s.insert_range(values[i], values[i]);
+    }
+    return s;
+  }
+
+  /** The assignment operator can only be used in a sequential context.
+   * It is monotone but not extensive. */
+  template <class A>
+  CUDA this_type& operator=(const SparseSet<A>& other) {
+    assign(this_type(other, dense.get_allocator()));
+    return *this;
+  }
+
+  CUDA this_type& operator=(const this_type& other) {
+    base = other.base;
+    n = other.n;
+    version = other.version;
+    card = other.card;
+    first = other.first;
+    last = other.last;
+    lower = other.lower;
+    upper = other.upper;
+    dense = other.dense;
+    sparse = other.sparse;
+    return *this;
+  }
+
+  CUDA this_type& operator=(this_type&& other) {
+    assign(std::move(other));
+    return *this;
+  }
+
+  CUDA allocator_type get_allocator() const {
+    return dense.get_allocator();
+  }
+
+  /** Pre-interpreted formula `x == 0`. */
+  CUDA static local_type eq_zero() { return local_type(0); }
+  /** Pre-interpreted formula `x == 1`. */
+  CUDA static local_type eq_one() { return local_type(1); }
+
+  CUDA static local_type bot(const allocator_type& alloc = allocator_type()) {
+    return local_type(window_tag{}, 0, 0, false, false, alloc);
+  }
+
+  CUDA static local_type top(const allocator_type& alloc = allocator_type()) {
+    return local_type(alloc);
+  }
+
+  CUDA local::B is_top() const {
+    return lower && upper && card == n;
+  }
+
+  CUDA local::B is_bot() const {
+    return !lower && !upper && card == 0;
+  }
+
+  /** \return `true` if `v` belongs to the set. */
+  CUDA bool contains(long long v) const {
+    if(v < base) { return lower; }
+    long long o = v - base;
+    if(o >= n) { return upper; }
+    return has(static_cast<int>(o));
+  }
+
+  /** The first value of the window. */
+  CUDA value_type window_base() const { return base; }
+  /** The number of values in the window. */
+  CUDA int window_size() const { return n; }
+
+  /** \return The number of values in the window belonging to the set. */
+  CUDA int count() const {
+    return card;
+  }
+
+  /** \return The state of the set, to be restored with `restore`. */
+  CUDA snapshot_type snapshot() const {
+    return snapshot_type{base, n, version, card, first, last, lower, upper};
+  }
+
+  /** Restore the set to the state `snap` in constant time, by resetting the number of values, the cached bounds and the flags.
+   * Since `snap` was taken, the set (or the set it is a copy of) must have only been narrowed in place (see `meet_in_place`), and the snapshots taken after `snap` must not be restored afterwards.
+   * \return `false` if the set was rebuilt, joined or extended since `snap` was taken, in which case it is left unchanged. */
+  CUDA bool restore(const snapshot_type& snap) {
+    if(base != snap.base || n != snap.n || version != snap.version || card > snap.card) {
+      return false;
+    }
+    card = snap.card;
+    first = snap.first;
+    last = snap.last;
+    lower = snap.lower;
+    upper = snap.upper;
+    return true;
+  }
+
+  /** \return `true` if `meet(other)` only removes values from the set, hence keeping the snapshots valid. */
+  template <class A>
+  CUDA bool meet_in_place(const SparseSet<A>& other) const {
+    return meet_in_window(other);
+  }
+
+  /** \return `true` if every meet only removes values from the set, which is the case when the flags L and R are unset. */
+  CUDA bool always_meet_in_place() const {
+    return !lower && !upper;
+  }
+
+private:
+  template<bool diagnose, class F, class Env, class A>
+  CUDA NI static bool interpret_existential(const F& f, const Env& env, SparseSet<A>& k, IDiagnostics& diagnostics) {
+    const auto& sort = battery::get<1>(f.exists());
+    if(sort.is_int()) {
+      return true;
+    }
+    else if(sort.is_bool()) {
+      k.meet(local_type(0, 1));
+      return true;
+    }
+    else {
+      const auto& vname = battery::get<0>(f.exists());
+      RETURN_INTERPRETATION_ERROR(("SparseSet only supports variables of type `Int` or `Bool`, but `" + vname + "` has another sort."));
+    }
+  }
+
+  template<bool diagnose, bool negated, class F, class A>
+  CUDA NI static bool interpret_tell_set(const F& f, const F& k, SparseSet<A>& tell, IDiagnostics& diagnostics) {
+    using sort_type = Sort<typename F::allocator_type>;
+    std::optional<sort_type> sort = f.seq(1).sort();
+    if(sort.has_value() &&
+       (sort.value() == sort_type(sort_type::Set, sort_type(sort_type::Int))
+     || sort.value() == sort_type(sort_type::Set, sort_type(sort_type::Bool))))
+    {
+      const auto& set = f.seq(1).s();
+      local_type s = bot();
+      if(set.size() > 0) {
+        int l = battery::get<0>(set[0]).to_z();
+        int u = battery::get<1>(set[0]).to_z();
+        for(int i = 1; i < set.size(); ++i) {
+          l = battery::min(l, static_cast<int>(battery::get<0>(set[i]).to_z()));
+          u = battery::max(u, static_cast<int>(battery::get<1>(set[i]).to_z()));
+        }
+        s = make_window(l, static_cast<long long>(u) + 1, false, false, allocator_type());
+        for(int i = 0; i < set.size(); ++i) {
+          s.insert_range(battery::get<0>(set[i]).to_z(), battery::get<1>(set[i]).to_z());
+        }
+      }
+      if constexpr(negated) {
+        s = s.complement();
+      }
+      tell.meet(s);
+      return true;
+    }
+    else {
+      RETURN_INTERPRETATION_ERROR("SparseSet only supports membership (`x in S`) where `S` is a set of integers.");
+    }
+  }
+
+  template<bool diagnose, class F, class A>
+  CUDA NI static bool interpret_tell_x_op_k(const F& f, logic_int k, Sig sig, SparseSet<A>& tell, IDiagnostics& diagnostics) {
+    switch(sig) {
+      case EQ: tell.meet(local_type(k)); break;
+      case NEQ: tell.meet(local_type(k).complement()); break;
+      case LEQ: tell.meet(leq(k)); break;
+      case LT: tell.meet(leq(k - 1)); break;
+      case GEQ: tell.meet(geq(k)); break;
+      case GT: tell.meet(geq(k + 1)); break;
+      default: RETURN_INTERPRETATION_ERROR("This symbol is not supported.");
+    }
+    return true;
+  }
+
+  template<bool diagnose, bool negated, class F, class Env, class A>
+  CUDA NI static bool interpret_binary(const F& f, const Env& env, SparseSet<A>& tell, IDiagnostics& diagnostics) {
+    if(f.sig() == IN) {
+      return interpret_tell_set<diagnose, negated>(f, f.seq(1), tell, diagnostics);
+    }
+    else if(f.seq(1).is(F::Z) || f.seq(1).is(F::B)) {
+      if constexpr(negated) {
+        local_type s;
+        if(!interpret_tell_x_op_k<diagnose>(f, f.seq(1).to_z(), f.sig(), s, diagnostics)) {
+          return false;
+        }
+        tell.meet(s.complement());
+        return true;
+      }
+      else {
+        return interpret_tell_x_op_k<diagnose>(f, f.seq(1).to_z(), f.sig(), tell, diagnostics);
+      }
+    }
+    else {
+      RETURN_INTERPRETATION_ERROR("Only integer and Boolean constants are supported in SparseSet.");
+    }
+  }
+
+public:
+  /** Support the following language where all constants `k` are integer or Boolean values:
+   *   * `var x:Z`
+   *   * `var x:B`
+   *   * `x <op> k` where `k` is an integer constant and `<op>` in {==, !=, <, <=, >, >=}.
+   *   * `x in S` where `S` is a set of integers.
+   * The interpretation is always exact. */
+  template<bool diagnose = false, class F, class Env, class A>
+  CUDA NI static bool interpret_tell(const F& f, const Env& env, SparseSet<A>& tell, IDiagnostics& diagnostics) {
+    if(f.is(F::E)) {
+      return interpret_existential<diagnose>(f, env, tell, diagnostics);
+    }
+    else if(f.is_unary() && f.sig() == NOT && f.seq(0).is_binary()) {
+      return interpret_binary<diagnose, true>(f.seq(0), env, tell, diagnostics);
+    }
+    else if(f.is_binary() && f.seq(0).is_variable() && f.seq(1).is_constant()) {
+      return interpret_binary<diagnose, false>(f, env, tell, diagnostics);
+    }
+    else {
+      RETURN_INTERPRETATION_ERROR("Only binary formulas of the form `x <sig> k` where if x is a variable and k is a constant are supported. We also supports existential quantifier and membership in a set of integers (x in S).");
+    }
+  }
+
+  /** Support the same language than the "tell language" without existential. */
+  template<bool diagnose = false, class F, class Env, class A>
+  CUDA NI static bool interpret_ask(const F& f, const Env& env, SparseSet<A>& k, IDiagnostics& diagnostics) {
+    local_type b = local_type::top();
+    auto nf = negate(f);
+    if(!nf.has_value()) {
+      RETURN_INTERPRETATION_ERROR("Could not negate the formula in order to interpret_ask it.");
+    }
+    if(f.is(F::E)) {
+      RETURN_INTERPRETATION_ERROR("Existential quantification is not supported in ask interpretation.");
+    }
+    if(interpret_tell<diagnose>(nf.value(), env, b, diagnostics)) {
+      k.meet(b.complement());
+      return true;
+    }
+    else {
+      return false;
+    }
+  }
+
+  template<IKind kind, bool diagnose = false, class F, class Env, class A>
+  CUDA NI static bool interpret(const F& f, const Env& env, SparseSet<A>& k, IDiagnostics& diagnostics) {
+    if constexpr(kind == IKind::ASK) {
+      return interpret_ask<diagnose>(f, env, k, diagnostics);
+    }
+    else {
+      return interpret_tell<diagnose>(f, env, k, diagnostics);
+    }
+  }
+
+  /** In constant time, thanks to the cached bounds. */
+  CUDA LB lb() const {
+    if(lower) {
+      return LB::top();
+    }
+    if(card > 0) {
+      return LB::geq_k(base + first);
+    }
+    return upper ? LB::geq_k(base + n) : LB::bot();
+  }
+
+  /** In constant time, thanks to the cached bounds. */
+  CUDA UB ub() const {
+    if(upper) {
+      return UB::top();
+    }
+    if(card > 0) {
+      return UB::leq_k(base + last);
+    }
+    return lower ? UB::leq_k(base - 1) : UB::bot();
+  }
+
+  /** The values not in the set are the offsets `dense[card..n-1]`, they become the first offsets of the complement. */
+  CUDA local_type complement() const {
+    local_type c(window_tag{}, base, n, !lower, !upper, dense.get_allocator());
+    for(int i = card; i < n; ++i) {
+      c.insert(dense[i]);
+    }
+    return c;
+  }
+
+  CUDA void join_top() {
+    lower = true;
+    upper = true;
+    card = n;
+    first = 0;
+    last = n - 1;
+    ++version;
+  }
+
+  template<class A>
+  CUDA bool join_lb(const A& lb) {
+    if(lb.is_top()) {
+      bool has_changed = !is_top();
+      join_top();
+      return has_changed;
+    }
+    return lb.is_bot() ? false : join(geq(lb.value()));
+  }
+
+  template<class A>
+  CUDA bool join_ub(const A& ub) {
+    if(ub.is_top()) {
+      bool has_changed = !is_top();
+      join_top();
+      return has_changed;
+    }
+    return ub.is_bot() ? false : join(leq(ub.value()));
+  }
+
+  /** When the join fits in the window of `this`, the values of `other` are inserted in time linear in the number of values of `other`. */
+  template<class A>
+  CUDA bool join(const SparseSet<A>& other) {
+    if(other.is_subset_of(*this)) {
+      return false;
+    }
+    if(is_bot()) {
+      replace(local_type(other, dense.get_allocator()));
+      return true;
+    }
+    if(join_in_window(other)) {
+      ++version;
+      for(int i = 0; i < other.card; ++i) {
+        long long o = static_cast<long long>(other.base) + other.dense[i] - base;
+        if(o >= 0 && o < n) {
+          insert(static_cast<int>(o));
+        }
+      }
+      if(other.lower) {
+        insert_range(base, static_cast<long long>(other.base) - 1);
+      }
+      if(other.upper) {
+        insert_range(static_cast<long long>(other.base) + other.n, static_cast<long long>(base) + n - 1);
+      }
+      lower |= other.lower;
+      upper |= other.upper;
+      return true;
+    }
+    long long lo = battery::min(static_cast<long long>(base), static_cast<long long>(other.base));
+    long long hi = battery::max(static_cast<long long>(base) + n, static_cast<long long>(other.base) + other.n);
+    local_type r = build(lo, hi, lower || other.lower, upper || other.upper,
+      [&](long long v) { return contains(v) || other.contains(v); });
+    // The window of `r` might be too small, in which case the join is over-approximated and possibly equal to `this`.
+    if(r.is_subset_of(*this)) {
+      return false;
+    }
+    replace(std::move(r));
+    return true;
+  }
+
+  CUDA void meet_bot() {
+    lower = false;
+    upper = false;
+    card = 0;
+    first = n;
+    last = -1;
+  }
+
+  template<class A>
+  CUDA bool meet_lb(const A& lb) {
+    if(lb.is_bot()) {
+      bool has_changed = !is_bot();
+      meet_bot();
+      return has_changed;
+    }
+    return lb.is_top() ? false : meet(geq(lb.value()));
+  }
+
+  template<class A>
+  CUDA bool meet_ub(const A& ub) {
+    if(ub.is_bot()) {
+      bool has_changed = !is_bot();
+      meet_bot();
+      return has_changed;
+    }
+    return ub.is_top() ? false : meet(leq(ub.value()));
+  }
+
+  /** When the meet fits in the window of `this`, the values not in `other` are removed in place, and the state before the meet can be restored with `restore`.
+   * The values to remove are either found among the values of `this`, or among the values not in `other` when there are fewer (e.g., a single one for `x != k`, or a range of values for `x >= k`). */
+  template<class A>
+  CUDA bool meet(const SparseSet<A>& other) {
+    if(!meet_in_window(other)) {
+      if(is_subset_of(other)) {
+        return false;
+      }
+      long long lo, hi;
+      meet_window(other, lo, hi);
+      local_type r = build(lo, hi, lower && other.lower, upper && other.upper,
+        [&](long long v) { return contains(v) && other.contains(v); });
+      // The window of `r` might be too small, in which case the meet is over-approximated, and we keep `this` unless `r` is strictly smaller.
+      if(!r.is_subset_of(*this) || is_subset_of(r)) {
+        return false;
+      }
+      replace(std::move(r));
+      return true;
+    }
+    bool has_changed = (lower && !other.lower) || (upper && !other.upper);
+    lower &= other.lower;
+    upper &= other.upper;
+    if(card == 0) {
+      return has_changed;
+    }
+    long long l = static_cast<long long>(base) + first;
+    long long u = static_cast<long long>(base) + last;
+    long long other_l = other.base;
+    long long other_u = static_cast<long long>(other.base) + other.n - 1;
+    long long outside =
+      (other.lower ? 0 : battery::max(0LL, battery::min(other_l - 1, u) - l + 1)) +
+      (other.upper ? 0 : battery::max(0LL, u - battery::max(other_u + 1, l) + 1));
+    if(outside + (other.n - other.card) <= card) {
+      if(!other.lower) {
+        has_changed |= remove_range(l, other_l - 1);
+      }
+      if(!other.upper) {
+        has_changed |= remove_range(other_u + 1, u);
+      }
+      for(int i = other.card; i < other.n; ++i) {
+        long long o = static_cast<long long>(other.base) + other.dense[i] - base;
+        if(o >= 0 && o < n) {
+          has_changed |= remove_raw(static_cast<int>(o));
+        }
+      }
+    }
+    else {
+      for(int i = card - 1; i >= 0; --i) {
+        if(!other.contains(static_cast<long long>(base) + dense[i])) {
+          has_changed |= remove_raw(dense[i]);
+        }
+      }
+    }
+    tighten();
+    return has_changed;
+  }
+
+  /** \return `true` if the set is included in `other`. */
+  template<class A>
+  CUDA bool is_subset_of(const SparseSet<A>& other) const {
+    if((lower && !other.lower) || (upper && !other.upper)) {
+      return false;
+    }
+    for(int i = 0; i < card; ++i) {
+      if(!other.contains(static_cast<long long>(base) + dense[i])) {
+        return false;
+      }
+    }
+    // The values of `this` outside of its window must be in `other`, which is uniform outside of its own window.
+    long long b1 = base, e1 = b1 + n;
+    long long b2 = other.base, e2 = b2 + other.n;
+    if(lower) {
+      for(long long v = b2; v < battery::min(b1, e2); ++v) {
+        if(!other.contains(v)) {
+          return false;
+        }
+      }
+      if(e2 < b1 && !other.upper) {
+        return false;
+      }
+    }
+    if(upper) {
+      for(long long v = battery::max(e1, b2); v < e2; ++v) {
+        if(!other.contains(v)) {
+          return false;
+        }
+      }
+      if(b2 > e1 && !other.lower) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  template <class A>
+  CUDA bool extract(SparseSet<A>& ua) const {
+    ua = *this;
+    return true;
+  }
+
+  template<class Env, class Allocator2 = typename Env::allocator_type>
+  CUDA TFormula<Allocator2> deinterpret(AVar x, const Env& env, const Allocator2& allocator = Allocator2()) const {
+    using F = TFormula<Allocator2>;
+    if(is_bot()) {
+      return F::make_false();
+    }
+    else if(is_top()) {
+      return F::make_true();
+    }
+    else {
+      typename F::Sequence seq{allocator};
+      if(lower) {
+        seq.push_back(F::make_binary(F::make_avar(x), LEQ, F::make_z(base - 1), UNTYPED, allocator));
+      }
+      if(upper) {
+        seq.push_back(F::make_binary(F::make_avar(x), GEQ, F::make_z(base + n), UNTYPED, allocator));
+      }
+      logic_set<F> logical_set(allocator);
+      for(int i = first; i <= last; ++i) {
+        if(has(i)) {
+          int j = i;
+          while(j + 1 <= last && has(j + 1)) { ++j; }
+          logical_set.push_back(battery::make_tuple(F::make_z(base + i), F::make_z(base + j)));
+          i = j;
+        }
+      }
+      if(logical_set.size() > 0) {
+        seq.push_back(F::make_binary(F::make_avar(x), IN, F::make_set(std::move(logical_set)), UNTYPED, allocator));
+      }
+      if(seq.size() == 1) {
+        return std::move(seq[0]);
+      }
+      else {
+        return F::make_nary(OR, std::move(seq));
+      }
+    }
+  }
+
+  /** Deinterpret the current value to a logical constant.
+   * The lower bound is deinterpreted, and it is up to the user to check that the set is a singleton.
+  */
+  template<class F>
+  CUDA NI F deinterpret() const {
+    return lb().template deinterpret<F>();
+  }
+
+  CUDA NI void print() const {
+    printf("{");
+    bool comma_needed = false;
+    if(lower) {
+      printf(".., %d", base - 1);
+      comma_needed = true;
+    }
+    for(int i = first; i <= last; ++i) {
+      if(has(i)) {
+        if(comma_needed) { printf(", "); }
+        printf("%d", base + i);
+        comma_needed = true;
+      }
+    }
+    if(upper) {
+      if(comma_needed) { printf(", "); }
+      printf("%d, ..", base + n);
+    }
+    printf("}");
+  }
+
+  CUDA NI constexpr static bool is_trivial_fun(Sig sig) {
+    switch(sig) {
+      case ABS:
+      case NEG: return false;
+      default: return true;
+    }
+  }
+
+public:
+  CUDA void neg(const local_type& x) {
+    meet(negation(x));
+  }
+
+  CUDA void abs(const local_type& x) {
+    local_type pos(x);
+    pos.meet(geq(0));
+    local_type neg_part(x);
+    neg_part.meet(leq(-1));
+    local_type r = negation(neg_part);
+    r.join(pos);
+    meet(r);
+  }
+
+  CUDA void project(Sig fun, const local_type& x)  {
+    switch(fun) {
+      case NEG: neg(x); break;
+      case ABS: abs(x); break;
+    }
+  }
+
+  /** On sets of integers, the additive inverse is the negation. */
+  CUDA void additive_inverse(const local_type& x) {
+    neg(x);
+  }
+
+  CUDA void project(Sig fun, const local_type& x, const local_type& y) {
+    printf("%% binary functions %s are unsupported\n", string_of_sig(fun));
+    int* ptr = nullptr;
+    ptr[1] = 193;
+  }
+
+  CUDA local_type width() const {
+    if(lower || upper) { return top(); }
+    else { return local_type(card); }
+  }
+
+  /** \return The median value of the set, the values below (resp. above) the window count as the single value `base - 1` (resp. `base + n`), as in `NBitset`. */
+  CUDA local_type median() const {
+    if(is_bot()) { return local_type::bot(); }
+    int total = card + lower + upper;
+    int k = total == 1 ? 1 : total / 2;
+    if(lower) {
+      if(k == 1) { return local_type(base - 1); }
+      --k;
+    }
+    for(int i = first; i <= last; ++i) {
+      if(has(i) && --k == 0) {
+        return local_type(base + i);
+      }
+    }
+    return local_type(base + n);
+  }
+};
+
+// Lattice operations
+
+template<class A1, class A2>
+CUDA SparseSet<A1> fjoin(const SparseSet<A1>& a, const SparseSet<A2>& b)
+{
+  SparseSet<A1> r(a);
+  r.join(b);
+  return r;
+}
+
+template<class A1, class A2>
+CUDA SparseSet<A1> fmeet(const SparseSet<A1>& a, const SparseSet<A2>& b)
+{
+  SparseSet<A1> r(a);
+  r.meet(b);
+  return r;
+}
+
+template<class A1, class A2>
+CUDA bool operator<=(const SparseSet<A1>& a, const SparseSet<A2>& b)
+{
+  return a.is_subset_of(b);
+}
+
+template<class A1, class A2>
+CUDA bool operator<(const SparseSet<A1>& a, const SparseSet<A2>& b)
+{
+  return a.is_subset_of(b) && !b.is_subset_of(a);
+}
+
+template<class A1, class A2>
+CUDA bool operator>=(const SparseSet<A1>& a, const SparseSet<A2>& b)
+{
+  return b <= a;
+}
+
+template<class A1, class A2>
+CUDA bool operator>(const SparseSet<A1>& a, const SparseSet<A2>& b)
+{
+  return b < a;
+}
+
+template<class A1, class A2>
+CUDA bool operator==(const SparseSet<A1>& a, const SparseSet<A2>& b)
+{
+  return a.is_subset_of(b) && b.is_subset_of(a);
+}
+
+template<class A1, class A2>
+CUDA bool operator!=(const SparseSet<A1>& a, const SparseSet<A2>& b)
+{
+  return !(a == b);
+}
+
+template<class A>
+std::ostream& operator<<(std::ostream &s, const SparseSet<A> &a) {
+  s << "{";
+  bool comma_needed = false;
+  if(a.lb().is_top()) {
+    s << ".., " << a.window_base() - 1;
+    comma_needed = true;
+  }
+  for(int i = 0; i < a.window_size(); ++i) {
+    if(a.contains(static_cast<long long>(a.window_base()) + i)) {
+      if(comma_needed) { s << ", "; }
+      s << a.window_base() + i;
+      comma_needed = true;
+    }
+  }
+  if(a.ub().is_top()) {
+    if(comma_needed) { s << ", "; }
+    s << a.window_base() + a.window_size() << ", ..";
+  }
+  s << "}";
+  return s;
+}
+
+} // end namespace lala
+
+#endif
@@ -6,7 +6,9 @@
 #include "logic/logic.hpp"
 #include "universes/arith_bound.hpp"
 #include "abstract_deps.hpp"
+#include "simd.hpp"
 #include <optional>
+#include <concepts>
 
 namespace lala {
 
@@ -18,6 +20,27 @@ namespace lala {
     static constexpr bool atoms = true;
   };
 
+namespace impl {
+  /** Universes whose state can be restored in constant time after being narrowed in place (e.g., `SparseSet`), which are backtracked by `VStore` without copying their domains. */
+  template <class U>
+  concept restorable_universe = requires(U& u, const U& v, const typename U::snapshot_type& s) {
+    { v.snapshot() } -> std::same_as<typename U::snapshot_type>;
+    { u.restore(s) } -> std::same_as<bool>;
+    { v.meet_in_place(v) } -> std::same_as<bool>;
+    { v.always_meet_in_place() } -> std::same_as<bool>;
+  };
+
+  template <class U, bool = restorable_universe<U>>
+  struct universe_state {
+    struct type {};
+  };
+
+  template <class U>
+  struct universe_state<U, true> {
+    using type = typename U::snapshot_type;
+  };
+}
+
 /** The variable store abstract domain is a _domain transformer_ built on top of an abstract universe `U`.
 Concretization function: \f$ \gamma(\rho) := \bigcap_{x \in \pi(\rho)} \gamma_{U_x}(\rho(x)) \f$.
 The bot element is smashed and the equality between two stores is represented by the following equivalence relation, for two stores \f$ S \f$ and \f$ T \f$:
@@ -60,8 +83,44 @@ public:
   template <class Alloc>
   using ask_type = tell_type<Alloc>;
 
+  /** For restorable universes (see `impl::restorable_universe`), a snapshot holds the state of each variable, and a copy of the domains that might be modified by a meet other than in place.
+   * `stamp` identifies the level of the store in which the snapshot was taken (see `push_level`). */
+  template <class Alloc>
+  struct restorable_snapshot_type {
+    battery::vector<typename universe_type::snapshot_type, Alloc> states;
+    tell_type<Alloc> copies;
+    size_t stamp;
+
+    CUDA restorable_snapshot_type(const Alloc& alloc = Alloc())
+     : states(alloc), copies(alloc), stamp(0) {}
+
+    CUDA size_t size() const {
+      return states.size();
+    }
+  };
+
   template <class Alloc = allocator_type>
-  using snapshot_type = battery::vector<local_universe, Alloc>;
+  using snapshot_type = std::conditional_t<impl::restorable_universe<universe_type>,
+    restorable_snapshot_type<Alloc>,
+    battery::vector<local_universe, Alloc>>;
+
+  /** The number of variables in a page of a `paged_snapshot_type`. */
+  constexpr static const size_t snapshot_page_size = 256;
+
+  /** A snapshot split in pages of `snapshot_page_size` variables, which are shared among the paged snapshots of a store (see `paged_snapshot`). */
+  struct paged_snapshot_type {
+    using page_type = battery::vector<local_universe, allocator_type>;
+    battery::vector<battery::shared_ptr<page_type, allocator_type>, allocator_type> pages;
+    size_t vars;
+    bool is_bot;
+
+    CUDA paged_snapshot_type(const allocator_type& alloc = allocator_type())
+     : pages(alloc), vars(0), is_bot(false) {}
+
+    CUDA size_t size() const {
+      return vars;
+    }
+  };
 
   constexpr static const bool is_abstract_universe = false;
   constexpr static const bool sequential = universe_type::sequential;
@@ -81,32 +140,83 @@ private:
   using store_type = battery::vector<universe_type, allocator_type>;
   using memory_type = typename universe_type::memory_type;
 
+  constexpr static const bool restorable = impl::restorable_universe<universe_type>;
+  using state_type = typename impl::universe_state<universe_type>::type;
+
+  /** The state of the store when a level was pushed. */
+  struct trail_level {
+    size_t trail_size;
+    size_t states_size;
+    size_t vars;
+    bool was_bot;
+  };
+
+  struct var_state {
+    int x;
+    /** The size of the trail when the state was recorded. */
+    size_t trail_size;
+    state_type state;
+  };
+
   AType atype;
   store_type data;
   B<memory_type> is_at_bot;
 
+  /** The trail records the old value of a variable the first time it is modified in a level (see `push_level`).
+   * For restorable universes, `states` records the state of a variable instead, and `trail` a copy of its value before each modification not done in place. */
+  tell_type<allocator_type> trail;
+  battery::vector<var_state, allocator_type> states;
+  battery::vector<trail_level, allocator_type> levels;
+  /** `stamps[x]` is the identifier of the level in which `x` was last trailed. */
+  battery::vector<size_t, allocator_type> stamps;
+  size_t current_stamp;
+
+  /** `changes[x]` is `true` if `x` was modified since the last call to `clear_changes` (only when `tracking` is `true`). */
+  battery::vector<B<memory_type>, allocator_type> changes;
+  bool tracking;
+
+  /** The last paged snapshot taken or restored, and `dirty_pages[p]` is `true` if a variable of the page `p` was modified since (only when `paging` is `true`). */
+  paged_snapshot_type base;
+  battery::vector<B<memory_type>, allocator_type> dirty_pages;
+  bool paging;
+
 public:
   CUDA VStore(const this_type& other)
     : atype(other.atype), data(other.data), is_at_bot(other.is_at_bot)
+    , trail(other.get_allocator()), states(other.get_allocator()), levels(other.get_allocator()), stamps(other.get_allocator()), current_stamp(0)
+    , changes(other.get_allocator()), tracking(false)
+    , base(other.get_allocator()), dirty_pages(other.get_allocator()), paging(false)
   {}
 
   /** Initialize an empty store. */
   CUDA VStore(AType atype, const allocator_type& alloc = allocator_type())
    : atype(atype), data(alloc), is_at_bot(false)
+   , trail(alloc), states(alloc), levels(alloc), stamps(alloc), current_stamp(0)
+   , changes(alloc), tracking(false)
+   , base(alloc), dirty_pages(alloc), paging(false)
   {}
 
   CUDA VStore(AType atype, size_t size, const allocator_type& alloc = allocator_type())
    : atype(atype), data(size, alloc), is_at_bot(false)
+   , trail(alloc), states(alloc), levels(alloc), stamps(alloc), current_stamp(0)
+   , changes(alloc), tracking(false)
+   , base(alloc), dirty_pages(alloc), paging(false)
   {}
 
   template<class R>
   CUDA VStore(const VStore<R, allocator_type>& other)
     : atype(other.atype), data(other.data), is_at_bot(other.is_at_bot)
+    , trail(other.get_allocator()), states(other.get_allocator()), levels(other.get_allocator()), stamps(other.get_allocator()), current_stamp(0)
+    , changes(other.get_allocator()), tracking(false)
+    , base(other.get_allocator()), dirty_pages(other.get_allocator()), paging(false)
   {}
 
   template<class R, class Alloc2>
   CUDA VStore(const VStore<R, Alloc2>& other, const allocator_type& alloc = allocator_type())
     : atype(other.atype), data(other.data, alloc), is_at_bot(other.is_at_bot)
+    , trail(alloc), states(alloc), levels(alloc), stamps(alloc), current_stamp(0)
+    , changes(alloc), tracking(false)
+    , base(alloc), dirty_pages(alloc), paging(false)
   {}
 
   /** Copy the vstore `other` in the current element.
@@ -116,7 +226,10 @@ public:
    : VStore(other, deps.template get_allocator<allocator_type>()) {}
 
   CUDA VStore(this_type&& other):
-    atype(other.atype), data(std::move(other.data)), is_at_bot(other.is_at_bot) {}
+    atype(other.atype), data(std::move(other.data)), is_at_bot(other.is_at_bot),
+    trail(std::move(other.trail)), states(std::move(other.states)), levels(std::move(other.levels)), stamps(std::move(other.stamps)), current_stamp(other.current_stamp),
+    changes(std::move(other.changes)), tracking(other.tracking),
+    base(std::move(other.base)), dirty_pages(std::move(other.dirty_pages)), paging(other.paging) {}
 
   CUDA allocator_type get_allocator() const {
     return data.get_allocator();
@@ -180,26 +293,470 @@ public:
     return true;
   }
 
-  /** Take a snapshot of the current variable store. */
+  /** Take a snapshot of the current variable store.
+   * For restorable universes, only the state of the domains is copied, except for the domains that might be modified by a meet other than in place. */
   template <class Alloc = allocator_type>
   CUDA snapshot_type<Alloc> snapshot(const Alloc& alloc = Alloc()) const {
-    return snapshot_type<Alloc>(data, alloc);
+    if constexpr(restorable) {
+      snapshot_type<Alloc> snap(alloc);
+      snap.stamp = current_stamp;
+      snap.states.reserve(data.size());
+      for(int i = 0; i < data.size(); ++i) {
+        snap.states.push_back(data[i].snapshot());
+        if(!data[i].always_meet_in_place()) {
+          snap.copies.push_back(var_dom<Alloc>(AVar(atype, i), data[i]));
+        }
+      }
+      return snap;
+    }
+    else {
+      return snapshot_type<Alloc>(data, alloc);
+    }
+  }
+
+  template <class Alloc>
+  CUDA this_type& restore(const battery::vector<local_universe, Alloc>& snap) {
+    while(snap.size() < data.size()) {
+      data.pop_back();
+    }
+    is_at_bot.meet_bot();
+    for(int i = 0; i < snap.size(); ++i) {
+      save(i);
+      if(data[i].join(snap[i])) {
+        mark(i);
+      }
+      is_at_bot.join(data[i].is_bot());
+    }
+    return *this;
   }
 
+  /** Restore a snapshot taken in an ancestor state of the current state.
+   * The domains not copied in the snapshot are restored in constant time, they must have only been narrowed in place since the snapshot (e.g., they must not have been joined in between).
+   * In trailing mode, only the state of these domains is recorded if the snapshot was taken in the current level, since `pop_level` then widens them back.
+   * Otherwise, `pop_level` must narrow them back to their values before `restore`, which are copied in the trail.
+   * A domain that cannot be restored is a misuse of `restore` which is reported, and the store becomes bot instead of over-approximating the domain. */
   template <class Alloc>
-  CUDA this_type& restore(const snapshot_type<Alloc>& snap) {
+  CUDA this_type& restore(const restorable_snapshot_type<Alloc>& snap) {
     while(snap.size() < data.size()) {
       data.pop_back();
     }
     is_at_bot.meet_bot();
+    bool restored = true;
+    int c = 0;
     for(int i = 0; i < snap.size(); ++i) {
-      data[i].join(snap[i]);
+      if(c < snap.copies.size() && snap.copies[c].avar.vid() == i) {
+        save(i);
+        data[i] = snap.copies[c++].dom;
+        mark(i);
+      }
+      else if(!(data[i].snapshot() == snap.states[i])) {
+        save(i, snap.stamp == current_stamp);
+        if(data[i].restore(snap.states[i])) {
+          mark(i);
+        }
+        else {
+          printf("%% VStore::restore: the domain of the variable %d was joined since the snapshot.\n", i);
+          restored = false;
+        }
+      }
       is_at_bot.join(data[i].is_bot());
     }
+    if(!restored) {
+      meet_bot();
+    }
+    return *this;
+  }
+
+  /** Take a snapshot sharing its pages of `snapshot_page_size` variables with the last paged snapshot taken or restored, except the pages modified since then.
+   * Hence, it only costs the number of pages plus the size of the modified pages, and the snapshots of a search tree only hold the pages that differ between them.
+   * The store keeps its last paged snapshot (until `forget_paged_snapshot`), which is not copied when the store is copied.
+   * @sequential */
+  CUDA NI paged_snapshot_type paged_snapshot() {
+    using page_type = typename paged_snapshot_type::page_type;
+    paged_snapshot_type snap(get_allocator());
+    size_t n = num_pages(data.size());
+    for(size_t p = 0; p < n; ++p) {
+      if(!page_changed(p)) {
+        snap.pages.push_back(base.pages[p]);
+      }
+      else {
+        size_t from = p * snapshot_page_size;
+        size_t to = battery::min(data.size(), from + snapshot_page_size);
+        auto page = battery::allocate_shared<page_type, allocator_type>(get_allocator(), to - from, get_allocator());
+        for(size_t i = from; i < to; ++i) {
+          (*page)[i - from] = data[i];
+        }
+        snap.pages.push_back(std::move(page));
+      }
+    }
+    snap.vars = data.size();
+    snap.is_bot = is_at_bot.value();
+    base = snap;
+    clear_dirty_pages();
+    return snap;
+  }
+
+  /** Restore a paged snapshot by copying the pages modified since the last paged snapshot taken or restored, and the pages it does not share with `snap`.
+   * Contrarily to `restore(snapshot_type)`, `snap` does not need to be an ancestor of the current state in the search tree.
+   * @sequential */
+  CUDA NI this_type& restore(const paged_snapshot_type& snap) {
+    while(snap.vars < data.size()) {
+      data.pop_back();
+    }
+    if(snap.vars > data.size()) {
+      data.resize(snap.vars);
+      if(tracking) {
+        changes.resize(data.size());
+      }
+      if(paging) {
+        dirty_pages.resize(num_pages(data.size()));
+      }
+    }
+    for(size_t p = 0; p < snap.pages.size(); ++p) {
+      if(page_changed(p) || base.pages[p].get() != snap.pages[p].get()) {
+        const auto& page = *snap.pages[p];
+        size_t from = p * snapshot_page_size;
+        for(size_t i = 0; i < page.size(); ++i) {
+          save(from + i);
+          data[from + i] = page[i];
+          mark(from + i);
+        }
+      }
+    }
+    is_at_bot = local::B(snap.is_bot);
+    base = snap;
+    clear_dirty_pages();
     return *this;
   }
 
+  /** Release the pages held by the last paged snapshot, the next paged snapshot copies the whole store. */
+  CUDA void forget_paged_snapshot() {
+    paging = false;
+    base = paged_snapshot_type(get_allocator());
+    dirty_pages = battery::vector<B<memory_type>, allocator_type>(dirty_pages.get_allocator());
+  }
+
 private:
+  CUDA static size_t num_pages(size_t vars) {
+    return (vars + snapshot_page_size - 1) / snapshot_page_size;
+  }
+
+  /** \return `true` if the page `p` of the store might be different from the page `p` of the last paged snapshot. */
+  CUDA bool page_changed(size_t p) const {
+    size_t end = (p + 1) * snapshot_page_size;
+    return !paging || p >= base.pages.size() || dirty_pages[p].value()
+      || battery::min(data.size(), end) != battery::min(base.vars, end);
+  }
+
+  /** Forget the levels and flag all the variables as modified, after `data` was replaced as a whole (see `extract`).
+   * The trail refers to the previous domains, and `changes` and `dirty_pages` to the previous number of variables. */
+  CUDA void reset_bookkeeping() {
+    trail.resize(0);
+    states.resize(0);
+    levels.resize(0);
+    stamps.resize(0);
+    current_stamp++;
+    if(tracking) {
+      changes.resize(data.size());
+      for(int i = 0; i < changes.size(); ++i) {
+        changes[i].join_top();
+      }
+    }
+    if(paging) {
+      dirty_pages.resize(num_pages(data.size()));
+      for(int i = 0; i < dirty_pages.size(); ++i) {
+        dirty_pages[i].join_top();
+      }
+    }
+  }
+
+  CUDA void clear_dirty_pages() {
+    paging = true;
+    dirty_pages.resize(num_pages(data.size()));
+    for(int i = 0; i < dirty_pages.size(); ++i) {
+      dirty_pages[i].meet_bot();
+    }
+  }
+
+  /** Universes are encoded bound by bound (e.g., intervals), bit by bit for bitsets, value by value (e.g., arithmetic bounds), or byte per byte otherwise. */
+  template <class Alloc2, class V>
+  CUDA static void serialize_universe(BinaryWriter<Alloc2>& w, const V& u) {
+    if constexpr(requires(V& v) { { v.lb() } -> std::same_as<typename V::LB&>; }) {
+      serialize_universe(w, u.lb());
+      serialize_universe(w, u.ub());
+    }
+    else if constexpr(requires { typename V::value_type; u.value().test(0); u.value().size(); }) {
+      const auto& bits = u.value();
+      for(size_t i = 0; i < bits.size(); i += 8) {
+        unsigned char byte = 0;
+        for(size_t j = 0; j < 8 && i + j < bits.size(); ++j) {
+          byte |= static_cast<unsigned char>(bits.test(i + j)) << j;
+        }
+        w.write(byte);
+      }
+    }
+    else if constexpr(requires { typename V::value_type; u.value(); }) {
+      w.write(u.value());
+    }
+    else {
+      w.write(u);
+    }
+  }
+
+  /** The number of bytes of a universe encoded by `serialize_universe`. */
+  template <class V>
+  CUDA static size_t encoded_universe_size() {
+    if constexpr(requires(V& v) { { v.lb() } -> std::same_as<typename V::LB&>; }) {
+      return encoded_universe_size<typename V::LB>() + encoded_universe_size<typename V::UB>();
+    }
+    else if constexpr(requires(V& u) { typename V::value_type; u.value().test(0); u.value().size(); }) {
+      std::decay_t<decltype(std::declval<V>().value())> bits;
+      return (bits.size() + 7) / 8;
+    }
+    else if constexpr(requires(V& u) { typename V::value_type; u.value(); }) {
+      return sizeof(std::decay_t<decltype(std::declval<V>().value())>);
+    }
+    else {
+      return sizeof(V);
+    }
+  }
+
+  template <class V>
+  CUDA static bool deserialize_universe(BinaryReader& r, V& u) {
+    if constexpr(requires(V& v) { { v.lb() } -> std::same_as<typename V::LB&>; }) {
+      return deserialize_universe(r, u.lb()) && deserialize_universe(r, u.ub());
+    }
+    else if constexpr(requires { typename V::value_type; u.value().test(0); u.value().size(); }) {
+      std::decay_t<decltype(u.value())> bits;
+      for(size_t i = 0; i < bits.size(); i += 8) {
+        unsigned char byte;
+        if(!r.read(byte)) {
+          return false;
+        }
+        for(size_t j = 0; j < 8 && i + j < bits.size(); ++j) {
+          bits.set(i + j, (byte >> j) & 1);
+        }
+      }
+      u = V(bits);
+      return true;
+    }
+    else if constexpr(requires { typename V::value_type; u.value(); }) {
+      std::decay_t<decltype(u.value())> value;
+      if(!r.read(value)) {
+        return false;
+      }
+      u = V(value);
+      return true;
+    }
+    else {
+      return r.read(u);
+    }
+  }
+
+public:
+  /** Encode the abstract type and the domains of the variables in `w`.
+   * The levels and the trail are not encoded, so the store is serialized as if it was at the root level. */
+  template <class Alloc2>
+  CUDA NI void serialize(BinaryWriter<Alloc2>& w) const {
+    w.write(atype);
+    w.write(static_cast<unsigned char>(is_bot().value()));
+    w.write(static_cast<unsigned long long>(vars()));
+    for(int i = 0; i < vars(); ++i) {
+      serialize_universe(w, local_universe(data[i]));
+    }
+  }
+
+  /** Decode a store encoded by `serialize`.
+   * \return An empty optional if the buffer is truncated or invalid. */
+  CUDA NI static std::optional<this_type> deserialize(BinaryReader& r, const allocator_type& alloc = allocator_type()) {
+    AType aty;
+    unsigned char bot;
+    unsigned long long n;
+    // The number of variables is checked against the size of the buffer before allocating the store.
+    if(!r.read(aty) || !r.read(bot) || !r.read(n) || n > r.remaining() / encoded_universe_size<local_universe>()) {
+      return {};
+    }
+    this_type store(aty, n, alloc);
+    for(unsigned long long i = 0; i < n; ++i) {
+      local_universe u;
+      if(!deserialize_universe(r, u)) {
+        return {};
+      }
+      store.data[i].meet(u);
+    }
+    if(bot) {
+      store.meet_bot();
+    }
+    return std::move(store);
+  }
+
+  /** Start a new decision level in trailing mode.
+   * Until the matching `pop_level`, the old value of each variable is recorded the first time it is modified in this level.
+   * Hence, backtracking with `pop_level` only costs the number of variables modified, instead of copying the whole store as with `snapshot`/`restore`.
+   * The memory of the trail is reused across levels, so no memory is allocated once the trail reached its maximal size.
+   * The levels are not copied when the store is copied.
+   * The trailing mode is only active when at least one level is pushed, and the store must then be modified sequentially.
+   * @sequential */
+  CUDA void push_level() {
+    levels.push_back(trail_level{trail.size(), states.size(), data.size(), is_at_bot.value()});
+    current_stamp++;
+  }
+
+  /** Undo all the modifications since the last call to `push_level`.
+   * The variables added in this level are removed.
+   * @sequential */
+  CUDA void pop_level() {
+    assert(levels.size() > 0);
+    const trail_level& level = levels.back();
+    // The states and copies are undone in the reverse order they were recorded, hence a domain is restored to a state only after being restored to the copies taken after this state.
+    for(size_t i = states.size(); i > level.states_size; --i) {
+      int x = states[i-1].x;
+      undo_trail(states[i-1].trail_size);
+      if constexpr(restorable) {
+        // The domains are only narrowed in place after their state is recorded, or copied in the trail, hence they can always be widened back to this state.
+        [[maybe_unused]] bool restored = data[x].restore(states[i-1].state);
+        assert(restored);
+      }
+      mark(x);
+    }
+    states.resize(level.states_size);
+    undo_trail(level.trail_size);
+    while(data.size() > level.vars) {
+      data.pop_back();
+    }
+    is_at_bot = local::B(level.was_bot);
+    levels.pop_back();
+    current_stamp++;
+  }
+
+  /** The number of levels pushed and not yet popped. */
+  CUDA size_t num_levels() const {
+    return levels.size();
+  }
+
+  /** The number of variables recorded in the trail over all levels. */
+  CUDA size_t trail_size() const {
+    return trail.size() + states.size();
+  }
+
+  /** The number of domains copied in the trail over all levels, which is zero for restorable universes only narrowed in place. */
+  CUDA size_t trail_copies() const {
+    return trail.size();
+  }
+
+  /** Start recording which variables are modified, so incremental consumers (e.g., fixpoint loops, solution printers) do not need to rescan the whole store.
+   * A variable is marked as changed each time its domain is modified (by `embed`, `deduce`, `meet`, `join`, `restore`, `pop_level`, ...).
+   * Marking a variable only sets a flag of type `B<memory_type>` to `true`, hence it is safe to call `embed` in parallel when the store is atomic.
+   * The flags are not copied when the store is copied.
+   * @sequential */
+  CUDA void track_changes() {
+    tracking = true;
+    changes.resize(data.size());
+    clear_changes();
+  }
+
+  /** Stop recording the modified variables and release the flags. */
+  CUDA void untrack_changes() {
+    tracking = false;
+    changes = battery::vector<B<memory_type>, allocator_type>(changes.get_allocator());
+  }
+
+  CUDA bool is_tracking_changes() const {
+    return tracking;
+  }
+
+  /** \return `true` if `x` was modified since the last call to `clear_changes`.
+   * \pre `is_tracking_changes()` must be `true`. */
+  CUDA bool changed(int x) const {
+    assert(tracking);
+    return x < changes.size() && changes[x].value();
+  }
+
+  /** Call `f(x)` for each variable `x` modified since the last call to `clear_changes`, in increasing order. */
+  template <class F>
+  CUDA void changed_vars(F&& f) const {
+    assert(tracking);
+    int n = battery::min(changes.size(), data.size());
+    for(int i = 0; i < n; ++i) {
+      if(changes[i].value()) {
+        f(i);
+      }
+    }
+  }
+
+  /** \return The variables modified since the last call to `clear_changes`, in increasing order. */
+  template <class Alloc = allocator_type>
+  CUDA battery::vector<int, Alloc> changed_vars(const Alloc& alloc = Alloc()) const {
+    battery::vector<int, Alloc> vars(alloc);
+    changed_vars([&](int x) { vars.push_back(x); });
+    return vars;
+  }
+
+  /** Forget the variables modified so far.
+   * @sequential */
+  CUDA void clear_changes() {
+    for(int i = 0; i < changes.size(); ++i) {
+      changes[i].meet_bot();
+    }
+  }
+
+private:
+  /** Record the value of `x` in the trail if it is the first time it is modified in the current level.
+   * For restorable universes, the state of `x` is recorded instead if it is modified `in_place`, and its value is copied before each modification that is not in place. */
+  CUDA INLINE void save(int x, bool in_place = false) {
+    if(levels.size() > 0 && x < levels.back().vars) {
+      if(x >= stamps.size()) {
+        stamps.resize(data.size());
+      }
+      if constexpr(restorable) {
+        if(!in_place) {
+          stamps[x] = current_stamp;
+          trail.push_back(var_dom<allocator_type>(AVar(atype, x), data[x]));
+          return;
+        }
+      }
+      if(stamps[x] != current_stamp) {
+        stamps[x] = current_stamp;
+        if constexpr(restorable) {
+          states.push_back(var_state{x, trail.size(), data[x].snapshot()});
+        }
+        else {
+          trail.push_back(var_dom<allocator_type>(AVar(atype, x), data[x]));
+        }
+      }
+    }
+  }
+
+  /** Restore the copies recorded in the trail after its first `trail_size` entries. */
+  CUDA void undo_trail(size_t trail_size) {
+    for(size_t i = trail.size(); i > trail_size; --i) {
+      data[trail[i-1].avar.vid()] = trail[i-1].dom;
+      mark(trail[i-1].avar.vid());
+    }
+    trail.resize(trail_size);
+  }
+
+  /** \return `true` if meeting `x` with `dom` keeps the states of `x` recorded so far valid (only for restorable universes). */
+  template <class U2>
+  CUDA INLINE bool meet_in_place(int x, const U2& dom) const {
+    if constexpr(restorable && std::same_as<U2, universe_type>) {
+      return data[x].meet_in_place(dom);
+    }
+    else {
+      return false;
+    }
+  }
+
+  /** Mark `x` as modified if the changes are tracked, and its page as modified since the last paged snapshot. */
+  CUDA INLINE void mark(int x) {
+    if(tracking) {
+      changes[x].join_top();
+    }
+    if(paging) {
+      dirty_pages[x / snapshot_page_size].join_top();
+    }
+  }
+
   template <bool diagnose, class F, class Env, class Alloc2>
   CUDA NI bool interpret_existential(const F& f, Env& env, tell_type<Alloc2>& tell, IDiagnostics& diagnostics) const {
     assert(f.is(F::E));
@@ -313,6 +870,7 @@ public:
     assert(vars() == store.vars());
     if(group.thread_rank() == 0) {
       store.is_at_bot = is_at_bot;
+      store.paging = false;
     }
     if(is_at_bot) {
       return;
@@ -333,6 +891,7 @@ public:
   /** Change the allocator of the underlying data, and reallocate the memory without copying the old data. */
   CUDA void reset_data(allocator_type alloc) {
     data = store_type(data.size(), alloc);
+    paging = false;
   }
 
   template <class Univ>
@@ -361,7 +920,11 @@ public:
   */
   CUDA bool embed(int x, const universe_type& dom) {
     assert(x < data.size());
+    save(x, meet_in_place(x, dom));
     bool has_changed = data[x].meet(dom);
+    if(has_changed) {
+      mark(x);
+    }
     has_changed |= is_at_bot.join(data[x].is_bot());
     return has_changed;
   }
@@ -385,6 +948,12 @@ public:
     }
     if(t.back().avar.vid() >= data.size()) {
       data.resize(t.back().avar.vid()+1);
+      if(tracking) {
+        changes.resize(data.size());
+      }
+      if(paging) {
+        dirty_pages.resize(num_pages(data.size()));
+      }
     }
     bool has_changed = false;
     for(int i = 0; i < t.size(); ++i) {
@@ -398,8 +967,19 @@ public:
   CUDA bool meet(const VStore<U2, Alloc2>& other) {
     bool has_changed = is_at_bot.join(other.is_at_bot);
     int min_size = battery::min(vars(), other.vars());
-    for(int i = 0; i < min_size; ++i) {
-      has_changed |= data[i].meet(other[i]);
+    int from = 0;
+    if constexpr(simd::same_flat_universe<universe_type, U2> || simd::same_flat_interval<universe_type, U2>) {
+      if(levels.size() == 0 && !tracking && !paging) {
+        has_changed |= simd::meet_into(data.data(), other.data.data(), min_size);
+        from = min_size;
+      }
+    }
+    for(int i = from; i < min_size; ++i) {
+      save(i, meet_in_place(i, other[i]));
+      if(data[i].meet(other[i])) {
+        mark(i);
+        has_changed = true;
+      }
     }
     for(int i = min_size; i < other.vars(); ++i) {
       assert(other[i].is_top()); // the size of the current store cannot be modified.
@@ -410,7 +990,9 @@ public:
   CUDA void join_top() {
     is_at_bot.meet_bot();
     for(int i = 0; i < data.size(); ++i) {
+      save(i);
       data[i].join_top();
+      mark(i);
     }
   }
 
@@ -422,11 +1004,26 @@ public:
     }
     int min_size = battery::min(vars(), other.vars());
     bool has_changed = is_at_bot.meet(other.is_at_bot);
-    for(int i = 0; i < min_size; ++i) {
-      has_changed |= data[i].join(other[i]);
+    int from = 0;
+    if constexpr(simd::same_flat_universe<universe_type, U2> || simd::same_flat_interval<universe_type, U2>) {
+      if(levels.size() == 0 && !tracking && !paging) {
+        has_changed |= simd::join_into(data.data(), other.data.data(), min_size);
+        from = min_size;
+      }
+    }
+    for(int i = from; i < min_size; ++i) {
+      save(i);
+      if(data[i].join(other[i])) {
+        mark(i);
+        has_changed = true;
+      }
     }
     for(int i = min_size; i < vars(); ++i) {
-      has_changed |= data[i].join(U::top());
+      save(i);
+      if(data[i].join(U::top())) {
+        mark(i);
+        has_changed = true;
+      }
     }
     for(int i = min_size; i < other.vars(); ++i) {
       assert(other[i].is_top());
@@ -459,6 +1056,12 @@ public:
       return false;
     }
     if constexpr(ExtractionStrategy::atoms) {
+      if constexpr(simd::flat_interval<universe_type>) {
+        // Fast path when all domains are singletons, otherwise the scalar loop finds the first non-singleton domain.
+        if(simd::all_singletons(data.data(), data.size())) {
+          return true;
+        }
+      }
       for(int i = 0; i < data.size(); ++i) {
         if(dual<typename universe_type::UB>(data[i].lb()) != data[i].ub()) {
           return false;
@@ -496,12 +1099,14 @@ public:
 
   /** Whenever `this` is different from `bot`, we extract its data into `ua`.
    * \pre `is_extractable()` must be `true`.
+   * The levels of `ua` are forgotten, and all its variables are flagged as modified when it tracks changes or paged snapshots.
    * For now, we suppose VStore is only used to store under-approximation, I'm not sure yet how we would interact with over-approximation. */
   template<class U2, class Alloc2>
   CUDA void extract(VStore<U2, Alloc2>& ua) const {
     if((void*)&ua != (void*)this) {
       ua.data = data;
       ua.is_at_bot.meet_bot();
+      ua.reset_bookkeeping();
     }
   }
 
@@ -617,11 +1222,25 @@ CUDA bool operator<=(const VStore<L, Alloc1>& a, const VStore<K, Alloc2>& b)
   }
   else {
     int min_size = battery::min(a.vars(), b.vars());
-    for(int i = 0; i < min_size; ++i) {
-      if(!(a[i] <= b[i])) {
+    if constexpr(simd::same_flat_universe<L, K>) {
+      if(min_size > 0 && !simd::all_leq(&a[0], &b[0], min_size)) {
         return false;
       }
     }
+    else {
+      int from = 0;
+      if constexpr(simd::same_flat_interval<L, K>) {
+        // Fast path when the bounds are ordered, otherwise the scalar loop also considers the bot intervals.
+        if(min_size > 0 && simd::all_leq(&a[0], &b[0], min_size)) {
+          from = min_size;
+        }
+      }
+      for(int i = from; i < min_size; ++i) {
+        if(!(a[i] <= b[i])) {
+          return false;
+        }
+      }
+    }
     for(int i = min_size; i < b.vars(); ++i) {
       if(!b[i].is_top()) {
         return false;
@@ -686,11 +1305,25 @@ CUDA bool operator==(const VStore<L, Alloc1>& a, const VStore<K, Alloc2>& b)
   }
   else {
     int min_size = battery::min(a.vars(), b.vars());
-    for(int i = 0; i < min_size; ++i) {
-      if(a[i] != b[i]) {
+    if constexpr(simd::same_flat_universe<L, K>) {
+      if(min_size > 0 && !simd::all_eq(&a[0], &b[0], min_size)) {
         return false;
       }
     }
+    else {
+      int from = 0;
+      if constexpr(simd::same_flat_interval<L, K>) {
+        // Fast path when the bounds are equal, otherwise the scalar loop also considers the bot intervals.
+        if(min_size > 0 && simd::all_eq(&a[0], &b[0], min_size)) {
+          from = min_size;
+        }
+      }
+      for(int i = from; i < min_size; ++i) {
+        if(a[i] != b[i]) {
+          return false;
+        }
+      }
+    }
     for(int i = min_size; i < a.vars(); ++i) {
       if(!a[i].is_top()) {
         return false;
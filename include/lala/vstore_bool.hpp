@@ -0,0 +1,600 @@
+// Copyright 2024 Pierre Talbot
+
+#ifndef LALA_CORE_VSTORE_BOOL_HPP
+#define LALA_CORE_VSTORE_BOOL_HPP
+
+#include "vstore.hpp"
+#include "interval.hpp"
+
+namespace lala {
+
+/** A variable store of Boolean variables packing the domain of each variable in 2 bits.
+ * The domain of a variable is represented by two bits: `geq1` if the variable is known to be `1` (lower bound equal to `1`) and `leq0` if the variable is known to be `0` (upper bound equal to `0`).
+ * Hence, `[0..1]` is encoded by `00`, `1` by `10`, `0` by `01` and bot by `11`.
+ * The bits of 64 variables are packed in a word, so the operations over the whole store (`meet`, `join`, `<=`, `is_extractable`, ...) process 64 variables at once with bitwise operations.
+ *
+ * It has the same interpretation and interface as `VStore<Interval<LB>, Allocator>`, where each variable is implicitly in `[0..1]`:
+ *   - `embed` intersects the interval with `[0..1]`, hence telling `x >= 2` or `x <= -1` leads to bot.
+ *   - `project` and `operator[]` return a local copy of the interval instead of a reference.
+ *   - The snapshots are packed as well.
+ *
+ * Since two variables share a word, the store must be modified sequentially.
+ *
+ * Template parameters:
+ *   - `U` is an integer interval universe `Interval<LB>`, used to interpret formulas and to view the domains of the variables.
+ *   - `Allocator` is the allocator of the underlying arrays of bits. */
+template<class U, class Allocator>
+class VStoreBool {
+public:
+  using universe_type = U;
+  using local_universe = typename universe_type::local_type;
+  using LB = typename local_universe::LB;
+  using UB = typename local_universe::UB;
+  using allocator_type = Allocator;
+  using this_type = VStoreBool<universe_type, allocator_type>;
+  using aos_type = VStore<universe_type, allocator_type>;
+  using word_type = unsigned long long;
+  constexpr static const int word_bits = 64;
+
+  template <class Alloc>
+  using var_dom = typename aos_type::template var_dom<Alloc>;
+
+  template <class Alloc>
+  using tell_type = typename aos_type::template tell_type<Alloc>;
+
+  template <class Alloc>
+  using ask_type = typename aos_type::template ask_type<Alloc>;
+
+  /** A packed copy of the store. */
+  template <class Alloc = allocator_type>
+  struct snapshot_type {
+    battery::vector<word_type, Alloc> geq1;
+    battery::vector<word_type, Alloc> leq0;
+    size_t vars;
+    bool is_bot;
+
+    CUDA snapshot_type(const Alloc& alloc = Alloc())
+     : geq1(alloc), leq0(alloc), vars(0), is_bot(false) {}
+
+    CUDA size_t size() const {
+      return vars;
+    }
+  };
+
+  constexpr static const bool is_abstract_universe = false;
+  constexpr static const bool sequential = true;
+  constexpr static const bool is_totally_ordered = false;
+  constexpr static const bool preserve_bot = true;
+  constexpr static const bool preserve_top = true;
+  constexpr static const bool preserve_join = universe_type::preserve_join;
+  constexpr static const bool preserve_meet = universe_type::preserve_meet;
+  constexpr static const bool injective_concretization = universe_type::injective_concretization;
+  constexpr static const bool preserve_concrete_covers = universe_type::preserve_concrete_covers;
+  constexpr static const char* name = "VStoreBool";
+
+  template<class U2, class Alloc2>
+  friend class VStoreBool;
+
+private:
+  using bits_type = battery::vector<word_type, allocator_type>;
+
+  AType atype;
+  size_t n;
+  bits_type geq1;
+  bits_type leq0;
+  local::B is_at_bot;
+
+  CUDA static size_t num_words(size_t vars) {
+    return (vars + word_bits - 1) / word_bits;
+  }
+
+  CUDA static word_type bit(int x) {
+    return word_type(1) << (x % word_bits);
+  }
+
+  /** The mask of the variables represented in the word `w`. */
+  CUDA word_type mask(size_t w) const {
+    size_t r = n - w * word_bits;
+    return r >= word_bits ? ~word_type(0) : (word_type(1) << r) - 1;
+  }
+
+  CUDA void resize(size_t vars) {
+    n = vars;
+    geq1.resize(num_words(vars));
+    leq0.resize(num_words(vars));
+    // Clear the bits of the removed variables in the last word.
+    if(n % word_bits != 0) {
+      geq1.back() &= mask(geq1.size() - 1);
+      leq0.back() &= mask(leq0.size() - 1);
+    }
+  }
+
+  CUDA static bool any_bot(const bits_type& geq1, const bits_type& leq0, size_t words) {
+    for(size_t w = 0; w < words; ++w) {
+      if(geq1[w] & leq0[w]) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+public:
+  CUDA VStoreBool(const this_type& other)
+    : atype(other.atype), n(other.n), geq1(other.geq1), leq0(other.leq0), is_at_bot(other.is_at_bot)
+  {}
+
+  /** Initialize an empty store. */
+  CUDA VStoreBool(AType atype, const allocator_type& alloc = allocator_type())
+   : atype(atype), n(0), geq1(alloc), leq0(alloc), is_at_bot(false)
+  {}
+
+  CUDA VStoreBool(AType atype, size_t size, const allocator_type& alloc = allocator_type())
+   : atype(atype), n(size), geq1(num_words(size), 0, alloc), leq0(num_words(size), 0, alloc), is_at_bot(false)
+  {}
+
+  template<class R, class Alloc2>
+  CUDA VStoreBool(const VStoreBool<R, Alloc2>& other, const allocator_type& alloc = allocator_type())
+    : atype(other.atype), n(other.n), geq1(other.geq1, alloc), leq0(other.leq0, alloc), is_at_bot(other.is_at_bot)
+  {}
+
+  /** Convert a store with the "array of structures" layout, the domains are intersected with `[0..1]`. */
+  template<class R, class Alloc2>
+  CUDA VStoreBool(const VStore<R, Alloc2>& other, const allocator_type& alloc = allocator_type())
+    : VStoreBool(other.aty(), other.vars(), alloc)
+  {
+    for(int i = 0; i < other.vars(); ++i) {
+      embed(i, other[i]);
+    }
+    is_at_bot.join(other.is_bot());
+  }
+
+  /** Copy the vstore `other` in the current element.
+   *  `deps` can be empty and is not used besides to get the allocator (since this abstract domain does not have dependencies). */
+  template<class R, class Alloc2, class... Allocators>
+  CUDA VStoreBool(const VStoreBool<R, Alloc2>& other, const AbstractDeps<Allocators...>& deps)
+   : VStoreBool(other, deps.template get_allocator<allocator_type>()) {}
+
+  CUDA VStoreBool(this_type&& other):
+    atype(other.atype), n(other.n), geq1(std::move(other.geq1)), leq0(std::move(other.leq0)), is_at_bot(other.is_at_bot) {}
+
+  CUDA allocator_type get_allocator() const {
+    return geq1.get_allocator();
+  }
+
+  CUDA AType aty() const {
+    return atype;
+  }
+
+  /** Returns the number of variables currently represented by this abstract element. */
+  CUDA size_t vars() const {
+    return n;
+  }
+
+  CUDA static this_type top(AType atype = UNTYPED,
+    const allocator_type& alloc = allocator_type{})
+  {
+    return VStoreBool(atype, alloc);
+  }
+
+  /** A special symbolic element representing top. */
+  CUDA static this_type bot(AType atype = UNTYPED,
+    const allocator_type& alloc = allocator_type{})
+  {
+    auto s = VStoreBool{atype, alloc};
+    s.meet_bot();
+    return std::move(s);
+  }
+
+  template <class Env>
+  CUDA static this_type bot(Env& env,
+    const allocator_type& alloc = allocator_type{})
+  {
+    return bot(env.extends_abstract_dom(), alloc);
+  }
+
+  template <class Env>
+  CUDA static this_type top(Env& env,
+    const allocator_type& alloc = allocator_type{})
+  {
+    return top(env.extends_abstract_dom(), alloc);
+  }
+
+  CUDA local::B is_bot() const {
+    return is_at_bot;
+  }
+
+  CUDA local::B is_top() const {
+    if(is_at_bot) { return false; }
+    for(int i = 0; i < geq1.size(); ++i) {
+      if(geq1[i] | leq0[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  template <class Alloc = allocator_type>
+  CUDA snapshot_type<Alloc> snapshot(const Alloc& alloc = Alloc()) const {
+    snapshot_type<Alloc> snap(alloc);
+    snap.geq1 = battery::vector<word_type, Alloc>(geq1, alloc);
+    snap.leq0 = battery::vector<word_type, Alloc>(leq0, alloc);
+    snap.vars = n;
+    snap.is_bot = is_at_bot.value();
+    return snap;
+  }
+
+  template <class Alloc>
+  CUDA this_type& restore(const snapshot_type<Alloc>& snap) {
+    resize(snap.vars);
+    for(int i = 0; i < geq1.size(); ++i) {
+      geq1[i] = snap.geq1[i];
+      leq0[i] = snap.leq0[i];
+    }
+    is_at_bot = local::B(snap.is_bot);
+    return *this;
+  }
+
+  template <IKind kind, bool diagnose = false, class F, class Env, class I>
+  CUDA NI bool interpret(const F& f, Env& env, I& intermediate, IDiagnostics& diagnostics) const {
+    return aos_type(atype, get_allocator()).template interpret<kind, diagnose>(f, env, intermediate, diagnostics);
+  }
+
+  /** See `VStore::interpret_tell`. */
+  template <bool diagnose = false, class F, class Env, class Alloc2>
+  CUDA NI bool interpret_tell(const F& f, Env& env, tell_type<Alloc2>& tell, IDiagnostics& diagnostics) const {
+    return interpret<IKind::TELL, diagnose>(f, env, tell, diagnostics);
+  }
+
+  /** See `VStore::interpret_ask`. */
+  template <bool diagnose = false, class F, class Env, class Alloc2>
+  CUDA NI bool interpret_ask(const F& f, const Env& env, ask_type<Alloc2>& ask, IDiagnostics& diagnostics) const {
+    return aos_type(atype, get_allocator()).template interpret_ask<diagnose>(f, env, ask, diagnostics);
+  }
+
+  template <class Group, class Store>
+  CUDA void copy_to(Group& group, Store& store) const {
+    assert(vars() == store.vars());
+    if(group.thread_rank() == 0) {
+      store.is_at_bot = is_at_bot;
+    }
+    if(is_at_bot) {
+      return;
+    }
+    for (size_t i = group.thread_rank(); i < geq1.size(); i += group.num_threads()) {
+      store.geq1[i] = geq1[i];
+      store.leq0[i] = leq0[i];
+    }
+  }
+
+#ifdef __CUDACC__
+  void prefetch(int dstDevice) const {
+    if(!is_at_bot) {
+      cudaMemPrefetchAsync(geq1.data(), geq1.size() * sizeof(word_type), dstDevice);
+      cudaMemPrefetchAsync(leq0.data(), leq0.size() * sizeof(word_type), dstDevice);
+    }
+  }
+#endif
+
+  /** Change the allocator of the underlying data, and reallocate the memory without copying the old data. */
+  CUDA void reset_data(allocator_type alloc) {
+    geq1 = bits_type(geq1.size(), 0, alloc);
+    leq0 = bits_type(leq0.size(), 0, alloc);
+  }
+
+  template <class Univ>
+  CUDA void project(AVar x, Univ& u) const {
+    u.meet(project(x));
+  }
+
+  CUDA local_universe project(AVar x) const {
+    assert(x.aty() == aty());
+    assert(x.vid() < vars());
+    return (*this)[x.vid()];
+  }
+
+  CUDA local_universe operator[](int x) const {
+    bool is_one = geq1[x / word_bits] & bit(x);
+    bool is_zero = leq0[x / word_bits] & bit(x);
+    if(is_one && is_zero) {
+      return local_universe::bot();
+    }
+    return local_universe(LB(is_one ? 1 : 0), UB(is_zero ? 0 : 1));
+  }
+
+  /** \return `true` if `x` is known to be `1`. */
+  CUDA bool is_true(int x) const {
+    return geq1[x / word_bits] & bit(x);
+  }
+
+  /** \return `true` if `x` is known to be `0`. */
+  CUDA bool is_false(int x) const {
+    return leq0[x / word_bits] & bit(x);
+  }
+
+  CUDA void meet_bot() {
+    is_at_bot.join_top();
+  }
+
+  /** See `VStore::embed`, the domain is intersected with `[0..1]`.
+   * @sequential @order-preserving @increasing */
+  template <class U2>
+  CUDA bool embed(int x, const Interval<U2>& dom) {
+    assert(x < vars());
+    size_t w = x / word_bits;
+    word_type old_geq1 = geq1[w];
+    word_type old_leq0 = leq0[w];
+    if(dom.is_bot()) {
+      geq1[w] |= bit(x);
+      leq0[w] |= bit(x);
+    }
+    else {
+      auto l = dom.lb().value();
+      auto u = dom.ub().value();
+      if(l >= 1 || u < 0) {
+        geq1[w] |= bit(x);
+      }
+      if(u <= 0 || l > 1) {
+        leq0[w] |= bit(x);
+      }
+    }
+    bool has_changed = old_geq1 != geq1[w] || old_leq0 != leq0[w];
+    has_changed |= is_at_bot.join(local::B((geq1[w] & leq0[w] & bit(x)) != 0));
+    return has_changed;
+  }
+
+  template <class U2>
+  CUDA bool embed(AVar x, const Interval<U2>& dom) {
+    assert(x.aty() == aty());
+    return embed(x.vid(), dom);
+  }
+
+  /** See `VStore::deduce`.
+   * @sequential @order-preserving @increasing */
+  template <class Alloc2>
+  CUDA bool deduce(const tell_type<Alloc2>& t) {
+    if(t.size() == 0) {
+      return false;
+    }
+    if(t[0].avar == AVar{}) {
+      return is_at_bot.join(local::B(true));
+    }
+    if(t.back().avar.vid() >= vars()) {
+      resize(t.back().avar.vid()+1);
+    }
+    bool has_changed = false;
+    for(int i = 0; i < t.size(); ++i) {
+      has_changed |= embed(t[i].avar, t[i].dom);
+    }
+    return has_changed;
+  }
+
+  /** Precondition: `other` must be smaller or equal in size than the current store. */
+  template <class U2, class Alloc2>
+  CUDA bool meet(const VStoreBool<U2, Alloc2>& other) {
+    bool has_changed = is_at_bot.join(other.is_at_bot);
+    size_t words = battery::min(geq1.size(), other.geq1.size());
+    word_type changes = 0;
+    for(size_t w = 0; w < words; ++w) {
+      changes |= (other.geq1[w] & ~geq1[w]) | (other.leq0[w] & ~leq0[w]);
+      geq1[w] |= other.geq1[w];
+      leq0[w] |= other.leq0[w];
+    }
+    has_changed |= changes != 0;
+    has_changed |= is_at_bot.join(local::B(any_bot(geq1, leq0, words)));
+    for(size_t w = words; w < other.geq1.size(); ++w) {
+      assert((other.geq1[w] | other.leq0[w]) == 0); // the size of the current store cannot be modified.
+    }
+    return has_changed;
+  }
+
+  CUDA void join_top() {
+    is_at_bot.meet_bot();
+    for(int i = 0; i < geq1.size(); ++i) {
+      geq1[i] = 0;
+      leq0[i] = 0;
+    }
+  }
+
+  /** Precondition: `other` must be smaller or equal in size than the current store. */
+  template <class U2, class Alloc2>
+  CUDA bool join(const VStoreBool<U2, Alloc2>& other)  {
+    if(other.is_bot()) {
+      return false;
+    }
+    bool has_changed = is_at_bot.meet(other.is_at_bot);
+    size_t words = battery::min(geq1.size(), other.geq1.size());
+    word_type changes = 0;
+    for(size_t w = 0; w < words; ++w) {
+      changes |= (geq1[w] & ~other.geq1[w]) | (leq0[w] & ~other.leq0[w]);
+      geq1[w] &= other.geq1[w];
+      leq0[w] &= other.leq0[w];
+    }
+    for(size_t w = words; w < geq1.size(); ++w) {
+      changes |= geq1[w] | leq0[w];
+      geq1[w] = 0;
+      leq0[w] = 0;
+    }
+    return has_changed || changes != 0;
+  }
+
+  /** See `VStore::ask`.
+   * @parallel @order-preserving @decreasing */
+  template <class Alloc2>
+  CUDA local::B ask(const ask_type<Alloc2>& t) const {
+    for(int i = 0; i < t.size(); ++i) {
+      if(!((*this)[t[i].avar.vid()] <= t[i].dom)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  CUDA size_t num_deductions() const { return 0; }
+  CUDA local::B deduce(size_t) const { assert(false); return false; }
+
+  /** See `VStore::is_extractable`. */
+  template<class ExtractionStrategy = NonAtomicExtraction>
+  CUDA bool is_extractable(const ExtractionStrategy& strategy = ExtractionStrategy()) const {
+    if(is_bot()) {
+      return false;
+    }
+    if constexpr(ExtractionStrategy::atoms) {
+      for(size_t w = 0; w < geq1.size(); ++w) {
+        if((geq1[w] | leq0[w]) != mask(w)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  /** See `VStore::extract`. */
+  template<class U2, class Alloc2>
+  CUDA void extract(VStoreBool<U2, Alloc2>& ua) const {
+    if((void*)&ua != (void*)this) {
+      ua.n = n;
+      ua.geq1 = geq1;
+      ua.leq0 = leq0;
+      ua.is_at_bot.meet_bot();
+    }
+  }
+
+private:
+  template<class Env, class Allocator2>
+  CUDA TFormula<typename Env::allocator_type> deinterpret(AVar avar, const local_universe& dom, const Env& env, const Allocator2& allocator) const {
+    auto f = dom.deinterpret(avar, env, allocator);
+    f.type_as(aty());
+    map_avar_to_lvar(f, env);
+    return std::move(f);
+  }
+
+public:
+  template<class Env, class Allocator2 = typename Env::allocator_type>
+  CUDA NI TFormula<Allocator2> deinterpret(const Env& env, const Allocator2& allocator = Allocator2()) const {
+    using F = TFormula<Allocator2>;
+    typename F::Sequence seq{allocator};
+    for(int i = 0; i < vars(); ++i) {
+      AVar v(aty(), i);
+      seq.push_back(F::make_exists(aty(), env.name_of(v), env.sort_of(v)));
+      seq.push_back(deinterpret(AVar(aty(), i), (*this)[i], env, allocator));
+    }
+    return F::make_nary(AND, std::move(seq), aty());
+  }
+
+  template<class I, class Env, class Allocator2 = typename Env::allocator_type>
+  CUDA NI TFormula<Allocator2> deinterpret(const I& intermediate, const Env& env, const Allocator2& allocator = Allocator2()) const {
+    return aos_type(atype, get_allocator()).deinterpret(intermediate, env, allocator);
+  }
+
+  CUDA void print() const {
+    if(is_top()) {
+      printf("\u22A4 | ");
+    }
+    printf("<");
+    for(int i = 0; i < vars(); ++i) {
+      (*this)[i].print();
+      printf("%s", (i+1 == vars() ? "" : ", "));
+    }
+    printf(">\n");
+  }
+
+  template<class L, class K, class Alloc1, class Alloc2>
+  friend CUDA bool operator<=(const VStoreBool<L, Alloc1>& a, const VStoreBool<K, Alloc2>& b);
+  template<class L, class K, class Alloc1, class Alloc2>
+  friend CUDA bool operator==(const VStoreBool<L, Alloc1>& a, const VStoreBool<K, Alloc2>& b);
+};
+
+// Lattice operations.
+// Only the comparison operators are provided, and they are computed word-wise.
+
+template<class L, class K, class Alloc1, class Alloc2>
+CUDA bool operator<=(const VStoreBool<L, Alloc1>& a, const VStoreBool<K, Alloc2>& b)
+{
+  if(b.is_top()) {
+    return true;
+  }
+  else if(a.is_bot()) {
+    return true;
+  }
+  else if(b.is_bot()) {
+    return false;
+  }
+  else {
+    // `a <= b` when `a` knows at least the bits of `b` (the missing variables of `a` are top).
+    for(size_t w = 0; w < b.geq1.size(); ++w) {
+      auto ag = w < a.geq1.size() ? a.geq1[w] : 0;
+      auto al = w < a.leq0.size() ? a.leq0[w] : 0;
+      if((b.geq1[w] & ~ag) | (b.leq0[w] & ~al)) {
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+template<class L, class K, class Alloc1, class Alloc2>
+CUDA bool operator==(const VStoreBool<L, Alloc1>& a, const VStoreBool<K, Alloc2>& b)
+{
+  if(a.is_bot()) {
+    return b.is_bot();
+  }
+  else if(b.is_bot()) {
+    return false;
+  }
+  else {
+    size_t words = battery::max(a.geq1.size(), b.geq1.size());
+    for(size_t w = 0; w < words; ++w) {
+      auto ag = w < a.geq1.size() ? a.geq1[w] : 0;
+      auto al = w < a.leq0.size() ? a.leq0[w] : 0;
+      auto bg = w < b.geq1.size() ? b.geq1[w] : 0;
+      auto bl = w < b.leq0.size() ? b.leq0[w] : 0;
+      if(ag != bg || al != bl) {
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+template<class L, class K, class Alloc1, class Alloc2>
+CUDA bool operator<(const VStoreBool<L, Alloc1>& a, const VStoreBool<K, Alloc2>& b)
+{
+  return a <= b && a != b;
+}
+
+template<class L, class K, class Alloc1, class Alloc2>
+CUDA bool operator>=(const VStoreBool<L, Alloc1>& a, const VStoreBool<K, Alloc2>& b)
+{
+  return b <= a;
+}
+
+template<class L, class K, class Alloc1, class Alloc2>
+CUDA bool operator>(const VStoreBool<L, Alloc1>& a, const VStoreBool<K, Alloc2>& b)
+{
+  return b < a;
+}
+
+template<class L, class K, class Alloc1, class Alloc2>
+CUDA bool operator!=(const VStoreBool<L, Alloc1>& a, const VStoreBool<K, Alloc2>& b)
+{
+  return !(a == b);
+}
+
+template<class L, class Alloc>
+std::ostream& operator<<(std::ostream &s, const VStoreBool<L, Alloc> &vstore) {
+  if(vstore.is_bot()) {
+    s << "\u22A5: ";
+  }
+  else {
+    s << "<";
+    for(int i = 0; i < vstore.vars(); ++i) {
+      s << vstore[i] << (i+1 == vstore.vars() ? "" : ", ");
+    }
+    s << ">";
+  }
+  return s;
+}
+
+} // namespace lala
+
+#endif
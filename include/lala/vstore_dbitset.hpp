@@ -0,0 +1,796 @@
+// Copyright 2024 Pierre Talbot
+
+#ifndef LALA_CORE_VSTORE_DBITSET_HPP
+#define LALA_CORE_VSTORE_DBITSET_HPP
+
+#include "vstore.hpp"
+#include "universes/dbitset.hpp"
+
+namespace lala {
+
+/** A variable store of `DBitset` domains storing the bits of all the variables in a single pool of words.
+ * `VStore<DBitset<Allocator>, Allocator>` allocates an array of words per variable; here, the window of each variable (its first value and its number of bits) is fixed in the store, and its bits are stored in a contiguous slice of the pool.
+ * The flags L and R of the variables (see `DBitset`) are packed 64 variables per word.
+ * When two stores have the same windows (e.g., a store and its snapshot or a copy of it), the operations over the whole store (`meet`, `join`, `<=`, `==`, `restore`) are loops over the words of the pool, independently of the variables.
+ *
+ * It has the same interpretation and interface as `VStore<DBitset<Allocator>, Allocator>`, with the following differences:
+ *   - `project` and `operator[]` return a local copy of the domain instead of a reference.
+ *   - `deduce` computes the exact meet of a domain and extends the window of a variable when it is too small; the pool is then compacted once at the end of `deduce`.
+ *   - `embed` does not change the window of the variable: the values of `dom` outside the window are over-approximated by the flags L and R.
+ *     It is exact when the result fits in the window, which is always the case when the domains only shrink after the interpretation.
+ *
+ * Since several variables share a word, the store must be modified sequentially. */
+template<class Allocator>
+class VStoreDBitset {
+public:
+  using universe_type = DBitset<Allocator>;
+  using local_universe = typename universe_type::local_type;
+  using LB = typename local_universe::LB;
+  using UB = typename local_universe::UB;
+  using value_type = typename local_universe::value_type;
+  using allocator_type = Allocator;
+  using this_type = VStoreDBitset<allocator_type>;
+  using aos_type = VStore<universe_type, allocator_type>;
+  using word_type = typename local_universe::word_type;
+  constexpr static const int word_bits = local_universe::word_bits;
+
+  template <class Alloc>
+  using var_dom = typename aos_type::template var_dom<Alloc>;
+
+  template <class Alloc>
+  using tell_type = typename aos_type::template tell_type<Alloc>;
+
+  template <class Alloc>
+  using ask_type = typename aos_type::template ask_type<Alloc>;
+
+  /** The window of a variable, its bits being stored in `pool[offset..offset+num_words(n)-1]`. */
+  struct window_type {
+    value_type base;
+    int n;
+    size_t offset;
+
+    CUDA window_type(): base(0), n(0), offset(0) {}
+    CUDA window_type(value_type base, int n, size_t offset): base(base), n(n), offset(offset) {}
+  };
+
+  /** A copy of the store. */
+  template <class Alloc = allocator_type>
+  struct snapshot_type {
+    battery::vector<window_type, Alloc> windows;
+    battery::vector<word_type, Alloc> pool;
+    battery::vector<word_type, Alloc> lower;
+    battery::vector<word_type, Alloc> upper;
+    bool is_bot;
+
+    CUDA snapshot_type(const Alloc& alloc = Alloc())
+     : windows(alloc), pool(alloc), lower(alloc), upper(alloc), is_bot(false) {}
+
+    CUDA size_t size() const {
+      return windows.size();
+    }
+  };
+
+  constexpr static const bool is_abstract_universe = false;
+  constexpr static const bool sequential = true;
+  constexpr static const bool is_totally_ordered = false;
+  constexpr static const bool preserve_bot = true;
+  constexpr static const bool preserve_top = true;
+  constexpr static const bool preserve_join = universe_type::preserve_join;
+  constexpr static const bool preserve_meet = universe_type::preserve_meet;
+  constexpr static const bool injective_concretization = universe_type::injective_concretization;
+  constexpr static const bool preserve_concrete_covers = universe_type::preserve_concrete_covers;
+  constexpr static const char* name = "VStoreDBitset";
+
+  template<class Alloc2>
+  friend class VStoreDBitset;
+
+private:
+  using words_type = battery::vector<word_type, allocator_type>;
+  using windows_type = battery::vector<window_type, allocator_type>;
+
+  AType atype;
+  windows_type windows;
+  words_type pool;
+  words_type lower;
+  words_type upper;
+  local::B is_at_bot;
+
+  CUDA static size_t num_words(int bits) {
+    return local_universe::num_words(bits);
+  }
+
+  CUDA static word_type bit(int x) {
+    return word_type(1) << (x % word_bits);
+  }
+
+  CUDA static bool test(const words_type& flags, int x) {
+    return flags[x / word_bits] & bit(x);
+  }
+
+  CUDA static void assign_flag(words_type& flags, int x, bool value) {
+    if(value) { flags[x / word_bits] |= bit(x); }
+    else { flags[x / word_bits] &= ~bit(x); }
+  }
+
+  /** Add `vars` variables initialized to top, their windows being empty. */
+  CUDA void resize(size_t vars) {
+    size_t old = windows.size();
+    windows.resize(vars);
+    lower.resize(num_words(vars));
+    upper.resize(num_words(vars));
+    for(size_t i = old; i < vars; ++i) {
+      windows[i] = window_type(0, 0, pool.size());
+      assign_flag(lower, i, true);
+      assign_flag(upper, i, true);
+    }
+  }
+
+  /** Append `dom` at the end of the pool, with the same window. */
+  template <class A>
+  CUDA void append(int x, const DBitset<A>& dom) {
+    windows[x] = window_type(dom.base, dom.n, pool.size());
+    for(int w = 0; w < dom.words.size(); ++w) {
+      pool.push_back(dom.words[w]);
+    }
+    assign_flag(lower, x, dom.lower);
+    assign_flag(upper, x, dom.upper);
+  }
+
+  /** Store the variables contiguously and in order in the pool. */
+  CUDA void compact() {
+    size_t total = 0;
+    for(int i = 0; i < windows.size(); ++i) {
+      total += num_words(windows[i].n);
+    }
+    words_type compacted(total, 0, pool.get_allocator());
+    size_t offset = 0;
+    for(int i = 0; i < windows.size(); ++i) {
+      for(size_t w = 0; w < num_words(windows[i].n); ++w) {
+        compacted[offset + w] = pool[windows[i].offset + w];
+      }
+      windows[i].offset = offset;
+      offset += num_words(windows[i].n);
+    }
+    pool = std::move(compacted);
+  }
+
+  /** Overwrite the domain of `x` by the over-approximation of `dom` in the window of `x`. */
+  template <class A>
+  CUDA void write(int x, const DBitset<A>& dom) {
+    const window_type& win = windows[x];
+    for(size_t w = 0; w < num_words(win.n); ++w) {
+      pool[win.offset + w] = dom.window(static_cast<long long>(win.base) + w * word_bits) & local_universe::mask(win.n, w);
+    }
+    assign_flag(lower, x, has_below(dom, win.base));
+    assign_flag(upper, x, has_above(dom, static_cast<long long>(win.base) + win.n));
+  }
+
+  /** `true` if `dom` contains a value smaller than `v`. */
+  template <class A>
+  CUDA static bool has_below(const DBitset<A>& dom, long long v) {
+    auto lb = dom.lb();
+    return lb.is_top() || (!lb.is_bot() && lb.value() < v);
+  }
+
+  /** `true` if `dom` contains a value greater or equal to `v`. */
+  template <class A>
+  CUDA static bool has_above(const DBitset<A>& dom, long long v) {
+    auto ub = dom.ub();
+    return ub.is_top() || (!ub.is_bot() && ub.value() >= v);
+  }
+
+  CUDA bool is_var_bot(int x) const {
+    if(test(lower, x) || test(upper, x)) {
+      return false;
+    }
+    const window_type& win = windows[x];
+    for(size_t w = 0; w < num_words(win.n); ++w) {
+      if(pool[win.offset + w] != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /** `true` if both stores have the same variables with the same windows, hence the same layout of the pool. */
+  template <class Alloc2>
+  CUDA bool same_windows(const VStoreDBitset<Alloc2>& other) const {
+    if(windows.size() != other.windows.size() || pool.size() != other.pool.size()) {
+      return false;
+    }
+    for(int i = 0; i < windows.size(); ++i) {
+      if(windows[i].base != other.windows[i].base || windows[i].n != other.windows[i].n) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+public:
+  CUDA VStoreDBitset(const this_type& other)
+    : atype(other.atype), windows(other.windows), pool(other.pool), lower(other.lower), upper(other.upper), is_at_bot(other.is_at_bot)
+  {}
+
+  /** Initialize an empty store. */
+  CUDA VStoreDBitset(AType atype, const allocator_type& alloc = allocator_type())
+   : atype(atype), windows(alloc), pool(alloc), lower(alloc), upper(alloc), is_at_bot(false)
+  {}
+
+  CUDA VStoreDBitset(AType atype, size_t size, const allocator_type& alloc = allocator_type())
+   : VStoreDBitset(atype, alloc)
+  {
+    resize(size);
+  }
+
+  template<class Alloc2>
+  CUDA VStoreDBitset(const VStoreDBitset<Alloc2>& other, const allocator_type& alloc = allocator_type())
+    : atype(other.atype), windows(other.windows.size(), alloc), pool(other.pool, alloc), lower(other.lower, alloc), upper(other.upper, alloc), is_at_bot(other.is_at_bot)
+  {
+    for(int i = 0; i < windows.size(); ++i) {
+      windows[i] = window_type(other.windows[i].base, other.windows[i].n, other.windows[i].offset);
+    }
+  }
+
+  /** Convert a store with one bitset per variable, the window of each variable is the one of its domain. */
+  template<class A, class Alloc2>
+  CUDA VStoreDBitset(const VStore<DBitset<A>, Alloc2>& other, const allocator_type& alloc = allocator_type())
+    : VStoreDBitset(other.aty(), other.vars(), alloc)
+  {
+    for(int i = 0; i < other.vars(); ++i) {
+      append(i, other[i]);
+    }
+    is_at_bot.join(other.is_bot());
+  }
+
+  /** Copy the vstore `other` in the current element.
+   *  `deps` can be empty and is not used besides to get the allocator (since this abstract domain does not have dependencies). */
+  template<class Alloc2, class... Allocators>
+  CUDA VStoreDBitset(const VStoreDBitset<Alloc2>& other, const AbstractDeps<Allocators...>& deps)
+   : VStoreDBitset(other, deps.template get_allocator<allocator_type>()) {}
+
+  CUDA VStoreDBitset(this_type&& other):
+    atype(other.atype), windows(std::move(other.windows)), pool(std::move(other.pool)),
+    lower(std::move(other.lower)), upper(std::move(other.upper)), is_at_bot(other.is_at_bot) {}
+
+  CUDA allocator_type get_allocator() const {
+    return pool.get_allocator();
+  }
+
+  CUDA AType aty() const {
+    return atype;
+  }
+
+  /** Returns the number of variables currently represented by this abstract element. */
+  CUDA size_t vars() const {
+    return windows.size();
+  }
+
+  /** The number of words in the pool. */
+  CUDA size_t pool_size() const {
+    return pool.size();
+  }
+
+  CUDA const window_type& window_of(int x) const {
+    return windows[x];
+  }
+
+  CUDA static this_type top(AType atype = UNTYPED,
+    const allocator_type& alloc = allocator_type{})
+  {
+    return VStoreDBitset(atype, alloc);
+  }
+
+  /** A special symbolic element representing top. */
+  CUDA static this_type bot(AType atype = UNTYPED,
+    const allocator_type& alloc = allocator_type{})
+  {
+    auto s = VStoreDBitset{atype, alloc};
+    s.meet_bot();
+    return std::move(s);
+  }
+
+  template <class Env>
+  CUDA static this_type bot(Env& env,
+    const allocator_type& alloc = allocator_type{})
+  {
+    return bot(env.extends_abstract_dom(), alloc);
+  }
+
+  template <class Env>
+  CUDA static this_type top(Env& env,
+    const allocator_type& alloc = allocator_type{})
+  {
+    return top(env.extends_abstract_dom(), alloc);
+  }
+
+  CUDA local::B is_bot() const {
+    return is_at_bot;
+  }
+
+  CUDA local::B is_top() const {
+    if(is_at_bot) { return false; }
+    for(int i = 0; i < windows.size(); ++i) {
+      if(!test(lower, i) || !test(upper, i)) {
+        return false;
+      }
+      for(size_t w = 0; w < num_words(windows[i].n); ++w) {
+        if(pool[windows[i].offset + w] != local_universe::mask(windows[i].n, w)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  template <class Alloc = allocator_type>
+  CUDA snapshot_type<Alloc> snapshot(const Alloc& alloc = Alloc()) const {
+    snapshot_type<Alloc> snap(alloc);
+    snap.windows = battery::vector<window_type, Alloc>(windows, alloc);
+    snap.pool = battery::vector<word_type, Alloc>(pool, alloc);
+    snap.lower = battery::vector<word_type, Alloc>(lower, alloc);
+    snap.upper = battery::vector<word_type, Alloc>(upper, alloc);
+    snap.is_bot = is_at_bot.value();
+    return snap;
+  }
+
+  template <class Alloc>
+  CUDA this_type& restore(const snapshot_type<Alloc>& snap) {
+    windows.resize(snap.windows.size());
+    for(int i = 0; i < windows.size(); ++i) {
+      windows[i] = snap.windows[i];
+    }
+    pool.resize(snap.pool.size());
+    for(size_t w = 0; w < pool.size(); ++w) {
+      pool[w] = snap.pool[w];
+    }
+    lower.resize(snap.lower.size());
+    upper.resize(snap.upper.size());
+    for(size_t w = 0; w < lower.size(); ++w) {
+      lower[w] = snap.lower[w];
+      upper[w] = snap.upper[w];
+    }
+    is_at_bot = local::B(snap.is_bot);
+    return *this;
+  }
+
+  template <IKind kind, bool diagnose = false, class F, class Env, class I>
+  CUDA NI bool interpret(const F& f, Env& env, I& intermediate, IDiagnostics& diagnostics) const {
+    return aos_type(atype, get_allocator()).template interpret<kind, diagnose>(f, env, intermediate, diagnostics);
+  }
+
+  /** See `VStore::interpret_tell`. */
+  template <bool diagnose = false, class F, class Env, class Alloc2>
+  CUDA NI bool interpret_tell(const F& f, Env& env, tell_type<Alloc2>& tell, IDiagnostics& diagnostics) const {
+    return interpret<IKind::TELL, diagnose>(f, env, tell, diagnostics);
+  }
+
+  /** See `VStore::interpret_ask`. */
+  template <bool diagnose = false, class F, class Env, class Alloc2>
+  CUDA NI bool interpret_ask(const F& f, const Env& env, ask_type<Alloc2>& ask, IDiagnostics& diagnostics) const {
+    return aos_type(atype, get_allocator()).template interpret_ask<diagnose>(f, env, ask, diagnostics);
+  }
+
+  /** Precondition: both stores have the same windows. */
+  template <class Group, class Store>
+  CUDA void copy_to(Group& group, Store& store) const {
+    assert(vars() == store.vars());
+    assert(pool.size() == store.pool.size());
+    if(group.thread_rank() == 0) {
+      store.is_at_bot = is_at_bot;
+    }
+    if(is_at_bot) {
+      return;
+    }
+    for (size_t i = group.thread_rank(); i < pool.size(); i += group.num_threads()) {
+      store.pool[i] = pool[i];
+    }
+    for (size_t i = group.thread_rank(); i < lower.size(); i += group.num_threads()) {
+      store.lower[i] = lower[i];
+      store.upper[i] = upper[i];
+    }
+  }
+
+#ifdef __CUDACC__
+  void prefetch(int dstDevice) const {
+    if(!is_at_bot) {
+      cudaMemPrefetchAsync(pool.data(), pool.size() * sizeof(word_type), dstDevice);
+      cudaMemPrefetchAsync(lower.data(), lower.size() * sizeof(word_type), dstDevice);
+      cudaMemPrefetchAsync(upper.data(), upper.size() * sizeof(word_type), dstDevice);
+    }
+  }
+#endif
+
+  /** Change the allocator of the underlying data, and reallocate the memory without copying the old data. */
+  CUDA void reset_data(allocator_type alloc) {
+    pool = words_type(pool.size(), 0, alloc);
+    lower = words_type(lower.size(), 0, alloc);
+    upper = words_type(upper.size(), 0, alloc);
+  }
+
+  template <class Univ>
+  CUDA void project(AVar x, Univ& u) const {
+    u.meet(project(x));
+  }
+
+  CUDA local_universe project(AVar x) const {
+    assert(x.aty() == aty());
+    assert(x.vid() < vars());
+    return (*this)[x.vid()];
+  }
+
+  CUDA local_universe operator[](int x) const {
+    const window_type& win = windows[x];
+    local_universe dom(typename local_universe::window_tag{}, win.base, win.n, test(lower, x), test(upper, x), get_allocator());
+    for(int w = 0; w < dom.words.size(); ++w) {
+      dom.words[w] = pool[win.offset + w];
+    }
+    return dom;
+  }
+
+  CUDA void meet_bot() {
+    is_at_bot.join_top();
+  }
+
+  /** See `VStore::embed`, the values of `dom` outside the window of `x` are over-approximated.
+   * @sequential @order-preserving @increasing */
+  template <class A>
+  CUDA bool embed(int x, const DBitset<A>& dom) {
+    assert(x < vars());
+    const window_type& win = windows[x];
+    word_type changes = 0;
+    word_type remaining = 0;
+    for(size_t w = 0; w < num_words(win.n); ++w) {
+      word_type& word = pool[win.offset + w];
+      word_type met = word & dom.window(static_cast<long long>(win.base) + w * word_bits);
+      changes |= word & ~met;
+      remaining |= met;
+      word = met;
+    }
+    if(test(lower, x) && !has_below(dom, win.base)) {
+      assign_flag(lower, x, false);
+      changes = 1;
+    }
+    if(test(upper, x) && !has_above(dom, static_cast<long long>(win.base) + win.n)) {
+      assign_flag(upper, x, false);
+      changes = 1;
+    }
+    bool has_changed = changes != 0;
+    has_changed |= is_at_bot.join(local::B(remaining == 0 && !test(lower, x) && !test(upper, x)));
+    return has_changed;
+  }
+
+  template <class A>
+  CUDA bool embed(AVar x, const DBitset<A>& dom) {
+    assert(x.aty() == aty());
+    return embed(x.vid(), dom);
+  }
+
+  /** See `VStore::deduce`, the window of a variable is extended if the meet does not fit in it.
+   * @sequential @order-preserving @increasing */
+  template <class Alloc2>
+  CUDA bool deduce(const tell_type<Alloc2>& t) {
+    if(t.size() == 0) {
+      return false;
+    }
+    if(t[0].avar == AVar{}) {
+      return is_at_bot.join(local::B(true));
+    }
+    if(t.back().avar.vid() >= vars()) {
+      resize(t.back().avar.vid()+1);
+    }
+    bool has_changed = false;
+    bool moved = false;
+    for(int i = 0; i < t.size(); ++i) {
+      int x = t[i].avar.vid();
+      local_universe dom = (*this)[x];
+      if(dom.meet(t[i].dom)) {
+        has_changed = true;
+        const window_type& win = windows[x];
+        if(dom.base < win.base || static_cast<long long>(dom.base) + dom.n > static_cast<long long>(win.base) + win.n) {
+          append(x, dom);
+          moved = true;
+        }
+        else {
+          write(x, dom);
+        }
+        is_at_bot.join(dom.is_bot());
+      }
+    }
+    if(moved) {
+      compact();
+    }
+    return has_changed;
+  }
+
+  /** Precondition: `other` must be smaller or equal in size than the current store. */
+  template <class Alloc2>
+  CUDA bool meet(const VStoreDBitset<Alloc2>& other) {
+    bool has_changed = is_at_bot.join(other.is_at_bot);
+    if(same_windows(other)) {
+      word_type changes = 0;
+      for(size_t w = 0; w < pool.size(); ++w) {
+        changes |= pool[w] & ~other.pool[w];
+        pool[w] &= other.pool[w];
+      }
+      for(size_t w = 0; w < lower.size(); ++w) {
+        changes |= (lower[w] & ~other.lower[w]) | (upper[w] & ~other.upper[w]);
+        lower[w] &= other.lower[w];
+        upper[w] &= other.upper[w];
+      }
+      has_changed |= changes != 0;
+      for(int i = 0; i < vars() && !is_at_bot; ++i) {
+        is_at_bot.join(local::B(is_var_bot(i)));
+      }
+    }
+    else {
+      for(int i = 0; i < other.vars(); ++i) {
+        has_changed |= embed(i, other[i]);
+      }
+    }
+    return has_changed;
+  }
+
+  CUDA void join_top() {
+    is_at_bot.meet_bot();
+    for(int i = 0; i < windows.size(); ++i) {
+      for(size_t w = 0; w < num_words(windows[i].n); ++w) {
+        pool[windows[i].offset + w] = local_universe::mask(windows[i].n, w);
+      }
+    }
+    for(size_t w = 0; w < lower.size(); ++w) {
+      lower[w] = ~word_type(0);
+      upper[w] = ~word_type(0);
+    }
+  }
+
+  /** Precondition: `other` must be smaller or equal in size than the current store. */
+  template <class Alloc2>
+  CUDA bool join(const VStoreDBitset<Alloc2>& other)  {
+    if(other.is_bot()) {
+      return false;
+    }
+    bool has_changed = is_at_bot.meet(other.is_at_bot);
+    if(same_windows(other)) {
+      word_type changes = 0;
+      for(size_t w = 0; w < pool.size(); ++w) {
+        changes |= other.pool[w] & ~pool[w];
+        pool[w] |= other.pool[w];
+      }
+      for(size_t w = 0; w < lower.size(); ++w) {
+        changes |= (other.lower[w] & ~lower[w]) | (other.upper[w] & ~upper[w]);
+        lower[w] |= other.lower[w];
+        upper[w] |= other.upper[w];
+      }
+      return has_changed || changes != 0;
+    }
+    for(int i = 0; i < other.vars(); ++i) {
+      local_universe dom = (*this)[i];
+      if(dom.join(other[i])) {
+        write(i, dom);
+        has_changed = true;
+      }
+    }
+    for(int i = other.vars(); i < vars(); ++i) {
+      if(!(*this)[i].is_top()) {
+        write(i, local_universe::top());
+        has_changed = true;
+      }
+    }
+    return has_changed;
+  }
+
+  /** See `VStore::ask`.
+   * @parallel @order-preserving @decreasing */
+  template <class Alloc2>
+  CUDA local::B ask(const ask_type<Alloc2>& t) const {
+    for(int i = 0; i < t.size(); ++i) {
+      if(!((*this)[t[i].avar.vid()] <= t[i].dom)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  CUDA size_t num_deductions() const { return 0; }
+  CUDA local::B deduce(size_t) const { assert(false); return false; }
+
+  /** See `VStore::is_extractable`. */
+  template<class ExtractionStrategy = NonAtomicExtraction>
+  CUDA bool is_extractable(const ExtractionStrategy& strategy = ExtractionStrategy()) const {
+    if(is_bot()) {
+      return false;
+    }
+    if constexpr(ExtractionStrategy::atoms) {
+      for(size_t w = 0; w < lower.size(); ++w) {
+        if(lower[w] | upper[w]) {
+          return false;
+        }
+      }
+      for(int i = 0; i < windows.size(); ++i) {
+        int c = 0;
+        for(size_t w = 0; w < num_words(windows[i].n); ++w) {
+          c += battery::popcount(pool[windows[i].offset + w]);
+        }
+        if(c != 1) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  /** See `VStore::extract`. */
+  template<class Alloc2>
+  CUDA void extract(VStoreDBitset<Alloc2>& ua) const {
+    if((void*)&ua != (void*)this) {
+      ua.windows.resize(windows.size());
+      for(int i = 0; i < windows.size(); ++i) {
+        ua.windows[i] = typename VStoreDBitset<Alloc2>::window_type(windows[i].base, windows[i].n, windows[i].offset);
+      }
+      ua.pool = pool;
+      ua.lower = lower;
+      ua.upper = upper;
+      ua.is_at_bot.meet_bot();
+    }
+  }
+
+private:
+  template<class Env, class Allocator2>
+  CUDA TFormula<typename Env::allocator_type> deinterpret(AVar avar, const local_universe& dom, const Env& env, const Allocator2& allocator) const {
+    auto f = dom.deinterpret(avar, env, allocator);
+    f.type_as(aty());
+    map_avar_to_lvar(f, env);
+    return std::move(f);
+  }
+
+public:
+  template<class Env, class Allocator2 = typename Env::allocator_type>
+  CUDA NI TFormula<Allocator2> deinterpret(const Env& env, const Allocator2& allocator = Allocator2()) const {
+    using F = TFormula<Allocator2>;
+    typename F::Sequence seq{allocator};
+    for(int i = 0; i < vars(); ++i) {
+      AVar v(aty(), i);
+      seq.push_back(F::make_exists(aty(), env.name_of(v), env.sort_of(v)));
+      seq.push_back(deinterpret(AVar(aty(), i), (*this)[i], env, allocator));
+    }
+    return F::make_nary(AND, std::move(seq), aty());
+  }
+
+  template<class I, class Env, class Allocator2 = typename Env::allocator_type>
+  CUDA NI TFormula<Allocator2> deinterpret(const I& intermediate, const Env& env, const Allocator2& allocator = Allocator2()) const {
+    return aos_type(atype, get_allocator()).deinterpret(intermediate, env, allocator);
+  }
+
+  CUDA void print() const {
+    if(is_top()) {
+      printf("\u22A4 | ");
+    }
+    printf("<");
+    for(int i = 0; i < vars(); ++i) {
+      (*this)[i].print();
+      printf("%s", (i+1 == vars() ? "" : ", "));
+    }
+    printf(">\n");
+  }
+
+  template<class A1, class A2>
+  friend CUDA bool operator<=(const VStoreDBitset<A1>& a, const VStoreDBitset<A2>& b);
+  template<class A1, class A2>
+  friend CUDA bool operator==(const VStoreDBitset<A1>& a, const VStoreDBitset<A2>& b);
+};
+
+// Lattice operations.
+// Only the comparison operators are provided, they are computed word-wise when both stores have the same windows.
+
+template<class A1, class A2>
+CUDA bool operator<=(const VStoreDBitset<A1>& a, const VStoreDBitset<A2>& b)
+{
+  if(b.is_top()) {
+    return true;
+  }
+  else if(a.is_bot()) {
+    return true;
+  }
+  else if(b.is_bot()) {
+    return false;
+  }
+  else if(a.same_windows(b)) {
+    for(size_t w = 0; w < a.pool.size(); ++w) {
+      if(a.pool[w] & ~b.pool[w]) {
+        return false;
+      }
+    }
+    for(size_t w = 0; w < a.lower.size(); ++w) {
+      if((a.lower[w] & ~b.lower[w]) | (a.upper[w] & ~b.upper[w])) {
+        return false;
+      }
+    }
+    return true;
+  }
+  else {
+    // The missing variables of `a` are top.
+    for(int i = 0; i < b.vars(); ++i) {
+      if(!(i < a.vars() ? a[i] <= b[i] : b[i].is_top().value())) {
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+template<class A1, class A2>
+CUDA bool operator==(const VStoreDBitset<A1>& a, const VStoreDBitset<A2>& b)
+{
+  if(a.is_bot()) {
+    return b.is_bot();
+  }
+  else if(b.is_bot()) {
+    return false;
+  }
+  else if(a.same_windows(b)) {
+    for(size_t w = 0; w < a.pool.size(); ++w) {
+      if(a.pool[w] != b.pool[w]) {
+        return false;
+      }
+    }
+    for(size_t w = 0; w < a.lower.size(); ++w) {
+      if(a.lower[w] != b.lower[w] || a.upper[w] != b.upper[w]) {
+        return false;
+      }
+    }
+    return true;
+  }
+  else {
+    size_t vars = battery::max(a.vars(), b.vars());
+    for(int i = 0; i < vars; ++i) {
+      bool eq = i < a.vars() && i < b.vars() ? a[i] == b[i] : (i < a.vars() ? a[i].is_top() : b[i].is_top()).value();
+      if(!eq) {
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+template<class A1, class A2>
+CUDA bool operator<(const VStoreDBitset<A1>& a, const VStoreDBitset<A2>& b)
+{
+  return a <= b && a != b;
+}
+
+template<class A1, class A2>
+CUDA bool operator>=(const VStoreDBitset<A1>& a, const VStoreDBitset<A2>& b)
+{
+  return b <= a;
+}
+
+template<class A1, class A2>
+CUDA bool operator>(const VStoreDBitset<A1>& a, const VStoreDBitset<A2>& b)
+{
+  return b < a;
+}
+
+template<class A1, class A2>
+CUDA bool operator!=(const VStoreDBitset<A1>& a, const VStoreDBitset<A2>& b)
+{
+  return !(a == b);
+}
+
+template<class A>
+std::ostream& operator<<(std::ostream &s, const VStoreDBitset<A> &vstore) {
+  if(vstore.is_bot()) {
+    s << "\u22A5: ";
+  }
+  else {
+    s << "<";
+    for(int i = 0; i < vstore.vars(); ++i) {
+      s << vstore[i] << (i+1 == vstore.vars() ? "" : ", ");
+    }
+    s << ">";
+  }
+  return s;
+}
+
+} // namespace lala
+
+#endif
@@ -0,0 +1,637 @@
+// Copyright 2024 Pierre Talbot
+
+#ifndef LALA_CORE_VSTORE_SOA_HPP
+#define LALA_CORE_VSTORE_SOA_HPP
+
+#include "vstore.hpp"
+#include "interval.hpp"
+
+namespace lala {
+
+/** A variable store of intervals with a "structure of arrays" memory layout: the lower bounds and upper bounds are stored in two separate arrays.
+ * It has the same semantics and interface as `VStore<Interval<LB>, Allocator>`, but:
+ *   - The operations over the whole store (`meet`, `join`, `<=`, `is_extractable`, ...) iterate over contiguous arrays of bounds, which can be vectorized by the compiler, and lead to coalesced memory accesses on GPU.
+ *   - When a deduction operator only needs one bound of a variable, it can read it with `lb(x)` or `ub(x)` and touch half the cache lines.
+ *   - Since the intervals are not stored as such, `project` and `operator[]` return a local copy of the interval instead of a reference.
+ *
+ * The interpretation of formulas is delegated to `VStore`, hence the tell and ask types are shared with `VStore<Interval<LB>, Allocator>`.
+ *
+ * Template parameters:
+ *   - `U` is an interval universe `Interval<LB>`.
+ *   - `Allocator` is the allocator of the underlying arrays of bounds. */
+template<class U, class Allocator>
+class VStoreSoA {
+public:
+  using universe_type = U;
+  using local_universe = typename universe_type::local_type;
+  using LB = typename universe_type::LB;
+  using UB = typename universe_type::UB;
+  using allocator_type = Allocator;
+  using this_type = VStoreSoA<universe_type, allocator_type>;
+  using aos_type = VStore<universe_type, allocator_type>;
+
+  template <class Alloc>
+  using var_dom = typename aos_type::template var_dom<Alloc>;
+
+  template <class Alloc>
+  using tell_type = typename aos_type::template tell_type<Alloc>;
+
+  template <class Alloc>
+  using ask_type = typename aos_type::template ask_type<Alloc>;
+
+  template <class Alloc = allocator_type>
+  using snapshot_type = typename aos_type::template snapshot_type<Alloc>;
+
+  constexpr static const bool is_abstract_universe = false;
+  constexpr static const bool sequential = universe_type::sequential;
+  constexpr static const bool is_totally_ordered = false;
+  constexpr static const bool preserve_bot = true;
+  constexpr static const bool preserve_top = true;
+  constexpr static const bool preserve_join = universe_type::preserve_join;
+  constexpr static const bool preserve_meet = universe_type::preserve_meet;
+  constexpr static const bool injective_concretization = universe_type::injective_concretization;
+  constexpr static const bool preserve_concrete_covers = universe_type::preserve_concrete_covers;
+  constexpr static const char* name = "VStoreSoA";
+
+  template<class U2, class Alloc2>
+  friend class VStoreSoA;
+
+private:
+  using memory_type = typename universe_type::memory_type;
+  using lb_store = battery::vector<LB, allocator_type>;
+  using ub_store = battery::vector<UB, allocator_type>;
+
+  AType atype;
+  lb_store lbs;
+  ub_store ubs;
+  B<memory_type> is_at_bot;
+
+  /** The bounds of `U2` and of this store can be processed by the SIMD kernels. */
+  template <class U2>
+  static constexpr bool simd_bounds =
+    simd::same_flat_universe<LB, typename U2::LB>
+    && simd::same_flat_universe<UB, typename U2::UB>
+    && std::is_same_v<typename LB::value_type, typename UB::value_type>;
+
+  CUDA INLINE local::B is_bot_at(int x) const {
+    return local_universe(lbs[x], ubs[x]).is_bot();
+  }
+
+public:
+  CUDA VStoreSoA(const this_type& other)
+    : atype(other.atype), lbs(other.lbs), ubs(other.ubs), is_at_bot(other.is_at_bot)
+  {}
+
+  /** Initialize an empty store. */
+  CUDA VStoreSoA(AType atype, const allocator_type& alloc = allocator_type())
+   : atype(atype), lbs(alloc), ubs(alloc), is_at_bot(false)
+  {}
+
+  CUDA VStoreSoA(AType atype, size_t size, const allocator_type& alloc = allocator_type())
+   : atype(atype), lbs(size, alloc), ubs(size, alloc), is_at_bot(false)
+  {}
+
+  template<class R, class Alloc2>
+  CUDA VStoreSoA(const VStoreSoA<R, Alloc2>& other, const allocator_type& alloc = allocator_type())
+    : atype(other.atype), lbs(other.lbs, alloc), ubs(other.ubs, alloc), is_at_bot(other.is_at_bot)
+  {}
+
+  /** Convert a store with the "array of structures" layout. */
+  template<class R, class Alloc2>
+  CUDA VStoreSoA(const VStore<R, Alloc2>& other, const allocator_type& alloc = allocator_type())
+    : atype(other.aty()), lbs(other.vars(), alloc), ubs(other.vars(), alloc), is_at_bot(other.is_bot())
+  {
+    for(int i = 0; i < other.vars(); ++i) {
+      lbs[i] = other[i].lb();
+      ubs[i] = other[i].ub();
+    }
+  }
+
+  /** Copy the vstore `other` in the current element.
+   *  `deps` can be empty and is not used besides to get the allocator (since this abstract domain does not have dependencies). */
+  template<class R, class Alloc2, class... Allocators>
+  CUDA VStoreSoA(const VStoreSoA<R, Alloc2>& other, const AbstractDeps<Allocators...>& deps)
+   : VStoreSoA(other, deps.template get_allocator<allocator_type>()) {}
+
+  CUDA VStoreSoA(this_type&& other):
+    atype(other.atype), lbs(std::move(other.lbs)), ubs(std::move(other.ubs)), is_at_bot(other.is_at_bot) {}
+
+  CUDA allocator_type get_allocator() const {
+    return lbs.get_allocator();
+  }
+
+  CUDA AType aty() const {
+    return atype;
+  }
+
+  /** Returns the number of variables currently represented by this abstract element. */
+  CUDA size_t vars() const {
+    return lbs.size();
+  }
+
+  CUDA static this_type top(AType atype = UNTYPED,
+    const allocator_type& alloc = allocator_type{})
+  {
+    return VStoreSoA(atype, alloc);
+  }
+
+  /** A special symbolic element representing top. */
+  CUDA static this_type bot(AType atype = UNTYPED,
+    const allocator_type& alloc = allocator_type{})
+  {
+    auto s = VStoreSoA{atype, alloc};
+    s.meet_bot();
+    return std::move(s);
+  }
+
+  template <class Env>
+  CUDA static this_type bot(Env& env,
+    const allocator_type& alloc = allocator_type{})
+  {
+    return bot(env.extends_abstract_dom(), alloc);
+  }
+
+  template <class Env>
+  CUDA static this_type top(Env& env,
+    const allocator_type& alloc = allocator_type{})
+  {
+    return top(env.extends_abstract_dom(), alloc);
+  }
+
+  CUDA local::B is_bot() const {
+    return is_at_bot;
+  }
+
+  CUDA local::B is_top() const {
+    if(is_at_bot) { return false; }
+    for(int i = 0; i < vars(); ++i) {
+      if(!lbs[i].is_top()) {
+        return false;
+      }
+    }
+    for(int i = 0; i < vars(); ++i) {
+      if(!ubs[i].is_top()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /** Take a snapshot of the current variable store, the snapshot has the same type as the one of `VStore`. */
+  template <class Alloc = allocator_type>
+  CUDA snapshot_type<Alloc> snapshot(const Alloc& alloc = Alloc()) const {
+    snapshot_type<Alloc> snap(vars(), alloc);
+    for(int i = 0; i < vars(); ++i) {
+      snap[i] = local_universe(lbs[i], ubs[i]);
+    }
+    return snap;
+  }
+
+  template <class Alloc>
+  CUDA this_type& restore(const battery::vector<local_universe, Alloc>& snap) {
+    while(snap.size() < vars()) {
+      lbs.pop_back();
+      ubs.pop_back();
+    }
+    is_at_bot.meet_bot();
+    for(int i = 0; i < snap.size(); ++i) {
+      lbs[i].join(snap[i].lb());
+      ubs[i].join(snap[i].ub());
+      is_at_bot.join(is_bot_at(i));
+    }
+    return *this;
+  }
+
+  template <IKind kind, bool diagnose = false, class F, class Env, class I>
+  CUDA NI bool interpret(const F& f, Env& env, I& intermediate, IDiagnostics& diagnostics) const {
+    return aos_type(atype, get_allocator()).template interpret<kind, diagnose>(f, env, intermediate, diagnostics);
+  }
+
+  /** See `VStore::interpret_tell`. */
+  template <bool diagnose = false, class F, class Env, class Alloc2>
+  CUDA NI bool interpret_tell(const F& f, Env& env, tell_type<Alloc2>& tell, IDiagnostics& diagnostics) const {
+    return interpret<IKind::TELL, diagnose>(f, env, tell, diagnostics);
+  }
+
+  /** See `VStore::interpret_ask`. */
+  template <bool diagnose = false, class F, class Env, class Alloc2>
+  CUDA NI bool interpret_ask(const F& f, const Env& env, ask_type<Alloc2>& ask, IDiagnostics& diagnostics) const {
+    return aos_type(atype, get_allocator()).template interpret_ask<diagnose>(f, env, ask, diagnostics);
+  }
+
+  template <class Group, class Store>
+  CUDA void copy_to(Group& group, Store& store) const {
+    assert(vars() == store.vars());
+    if(group.thread_rank() == 0) {
+      store.is_at_bot = is_at_bot;
+    }
+    if(is_at_bot) {
+      return;
+    }
+    for (size_t i = group.thread_rank(); i < store.vars(); i += group.num_threads()) {
+      store.lbs[i] = lbs[i];
+    }
+    for (size_t i = group.thread_rank(); i < store.vars(); i += group.num_threads()) {
+      store.ubs[i] = ubs[i];
+    }
+  }
+
+#ifdef __CUDACC__
+  void prefetch(int dstDevice) const {
+    if(!is_at_bot) {
+      cudaMemPrefetchAsync(lbs.data(), lbs.size() * sizeof(LB), dstDevice);
+      cudaMemPrefetchAsync(ubs.data(), ubs.size() * sizeof(UB), dstDevice);
+    }
+  }
+#endif
+
+  /** Change the allocator of the underlying data, and reallocate the memory without copying the old data. */
+  CUDA void reset_data(allocator_type alloc) {
+    lbs = lb_store(lbs.size(), alloc);
+    ubs = ub_store(ubs.size(), alloc);
+  }
+
+  template <class Univ>
+  CUDA void project(AVar x, Univ& u) const {
+    u.meet(project(x));
+  }
+
+  CUDA local_universe project(AVar x) const {
+    assert(x.aty() == aty());
+    assert(x.vid() < vars());
+    return (*this)[x.vid()];
+  }
+
+  CUDA local_universe operator[](int x) const {
+    return local_universe(lbs[x], ubs[x]);
+  }
+
+  /** Read-only access to the lower bound of `x`. */
+  CUDA const LB& lb(int x) const {
+    return lbs[x];
+  }
+
+  /** Read-only access to the upper bound of `x`. */
+  CUDA const UB& ub(int x) const {
+    return ubs[x];
+  }
+
+  CUDA void meet_bot() {
+    is_at_bot.join_top();
+  }
+
+  /** See `VStore::embed`.
+   * @parallel @order-preserving @increasing */
+  template <class U2>
+  CUDA bool embed(int x, const Interval<U2>& dom) {
+    assert(x < vars());
+    bool has_changed = lbs[x].meet(dom.lb());
+    has_changed |= ubs[x].meet(dom.ub());
+    has_changed |= is_at_bot.join(is_bot_at(x));
+    return has_changed;
+  }
+
+  template <class U2>
+  CUDA bool embed(AVar x, const Interval<U2>& dom) {
+    assert(x.aty() == aty());
+    return embed(x.vid(), dom);
+  }
+
+  /** Only update the lower bound of `x`. */
+  template <class LB2>
+  CUDA bool embed_lb(int x, const LB2& lb) {
+    bool has_changed = lbs[x].meet(lb);
+    has_changed |= is_at_bot.join(is_bot_at(x));
+    return has_changed;
+  }
+
+  /** Only update the upper bound of `x`. */
+  template <class UB2>
+  CUDA bool embed_ub(int x, const UB2& ub) {
+    bool has_changed = ubs[x].meet(ub);
+    has_changed |= is_at_bot.join(is_bot_at(x));
+    return has_changed;
+  }
+
+  /** See `VStore::deduce`.
+   * @sequential @order-preserving @increasing */
+  template <class Alloc2>
+  CUDA bool deduce(const tell_type<Alloc2>& t) {
+    if(t.size() == 0) {
+      return false;
+    }
+    if(t[0].avar == AVar{}) {
+      return is_at_bot.join(local::B(true));
+    }
+    if(t.back().avar.vid() >= vars()) {
+      lbs.resize(t.back().avar.vid()+1);
+      ubs.resize(t.back().avar.vid()+1);
+    }
+    bool has_changed = false;
+    for(int i = 0; i < t.size(); ++i) {
+      has_changed |= embed(t[i].avar, t[i].dom);
+    }
+    return has_changed;
+  }
+
+  /** Precondition: `other` must be smaller or equal in size than the current store. */
+  template <class U2, class Alloc2>
+  CUDA bool meet(const VStoreSoA<U2, Alloc2>& other) {
+    bool has_changed = is_at_bot.join(other.is_at_bot);
+    int min_size = battery::min(vars(), other.vars());
+    if constexpr(simd_bounds<U2>) {
+      has_changed |= simd::meet_into(lbs.data(), other.lbs.data(), min_size);
+      has_changed |= simd::meet_into(ubs.data(), other.ubs.data(), min_size);
+      has_changed |= is_at_bot.join(local::B(
+        simd::any_bot(lbs.data(), min_size)
+        || simd::any_bot(ubs.data(), min_size)
+        || simd::any_gt(simd::values(lbs.data()), simd::values(ubs.data()), min_size)));
+    }
+    else {
+      for(int i = 0; i < min_size; ++i) {
+        has_changed |= lbs[i].meet(other.lbs[i]);
+      }
+      for(int i = 0; i < min_size; ++i) {
+        has_changed |= ubs[i].meet(other.ubs[i]);
+      }
+      for(int i = 0; i < min_size; ++i) {
+        has_changed |= is_at_bot.join(is_bot_at(i));
+      }
+    }
+    for(int i = min_size; i < other.vars(); ++i) {
+      assert(other[i].is_top()); // the size of the current store cannot be modified.
+    }
+    return has_changed;
+  }
+
+  CUDA void join_top() {
+    is_at_bot.meet_bot();
+    for(int i = 0; i < vars(); ++i) {
+      lbs[i].join_top();
+    }
+    for(int i = 0; i < vars(); ++i) {
+      ubs[i].join_top();
+    }
+  }
+
+  /** Precondition: `other` must be smaller or equal in size than the current store. */
+  template <class U2, class Alloc2>
+  CUDA bool join(const VStoreSoA<U2, Alloc2>& other)  {
+    if(other.is_bot()) {
+      return false;
+    }
+    int min_size = battery::min(vars(), other.vars());
+    bool has_changed = is_at_bot.meet(other.is_at_bot);
+    if constexpr(simd_bounds<U2>) {
+      has_changed |= simd::join_into(lbs.data(), other.lbs.data(), min_size);
+      has_changed |= simd::join_into(ubs.data(), other.ubs.data(), min_size);
+    }
+    else {
+      for(int i = 0; i < min_size; ++i) {
+        has_changed |= lbs[i].join(other.lbs[i]);
+      }
+      for(int i = 0; i < min_size; ++i) {
+        has_changed |= ubs[i].join(other.ubs[i]);
+      }
+    }
+    for(int i = min_size; i < vars(); ++i) {
+      has_changed |= lbs[i].join(LB::top());
+      has_changed |= ubs[i].join(UB::top());
+    }
+    for(int i = min_size; i < other.vars(); ++i) {
+      assert(other[i].is_top());
+    }
+    return has_changed;
+  }
+
+  /** See `VStore::ask`.
+   * @parallel @order-preserving @decreasing */
+  template <class Alloc2>
+  CUDA local::B ask(const ask_type<Alloc2>& t) const {
+    for(int i = 0; i < t.size(); ++i) {
+      if(!((*this)[t[i].avar.vid()] <= t[i].dom)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  CUDA size_t num_deductions() const { return 0; }
+  CUDA local::B deduce(size_t) const { assert(false); return false; }
+
+  /** See `VStore::is_extractable`. */
+  template<class ExtractionStrategy = NonAtomicExtraction>
+  CUDA bool is_extractable(const ExtractionStrategy& strategy = ExtractionStrategy()) const {
+    if(is_bot()) {
+      return false;
+    }
+    if constexpr(ExtractionStrategy::atoms) {
+      if constexpr(simd_bounds<U>) {
+        // Fast path when all bounds are equal, otherwise the scalar loop finds the first non-singleton domain.
+        if(!simd::any_neq(simd::values(lbs.data()), simd::values(ubs.data()), vars())) {
+          return true;
+        }
+      }
+      for(int i = 0; i < vars(); ++i) {
+        if(dual<UB>(lbs[i]) != ubs[i]) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+#ifdef __CUDACC__
+  template<class ExtractionStrategy = NonAtomicExtraction>
+  __device__ bool is_extractable(auto& group, const ExtractionStrategy& strategy = ExtractionStrategy()) const {
+    if(is_bot()) {
+      return false;
+    }
+    if constexpr(ExtractionStrategy::atoms) {
+      __shared__ bool res;
+      if(group.thread_rank() == 0) {
+        res = true;
+      }
+      group.sync();
+      for(int i = group.thread_rank(); i < vars(); i += group.num_threads()) {
+        if(dual<UB>(lbs[i]) != ubs[i]) {
+          res = false;
+        }
+      }
+      group.sync();
+      return res;
+    }
+    else {
+      return true;
+    }
+  }
+#endif
+
+  /** See `VStore::extract`. */
+  template<class U2, class Alloc2>
+  CUDA void extract(VStoreSoA<U2, Alloc2>& ua) const {
+    if((void*)&ua != (void*)this) {
+      ua.lbs = lbs;
+      ua.ubs = ubs;
+      ua.is_at_bot.meet_bot();
+    }
+  }
+
+private:
+  template<class Env, class Allocator2>
+  CUDA TFormula<typename Env::allocator_type> deinterpret(AVar avar, const local_universe& dom, const Env& env, const Allocator2& allocator) const {
+    auto f = dom.deinterpret(avar, env, allocator);
+    f.type_as(aty());
+    map_avar_to_lvar(f, env);
+    return std::move(f);
+  }
+
+public:
+  template<class Env, class Allocator2 = typename Env::allocator_type>
+  CUDA NI TFormula<Allocator2> deinterpret(const Env& env, const Allocator2& allocator = Allocator2()) const {
+    using F = TFormula<Allocator2>;
+    typename F::Sequence seq{allocator};
+    for(int i = 0; i < vars(); ++i) {
+      AVar v(aty(), i);
+      seq.push_back(F::make_exists(aty(), env.name_of(v), env.sort_of(v)));
+      seq.push_back(deinterpret(AVar(aty(), i), (*this)[i], env, allocator));
+    }
+    return F::make_nary(AND, std::move(seq), aty());
+  }
+
+  template<class I, class Env, class Allocator2 = typename Env::allocator_type>
+  CUDA NI TFormula<Allocator2> deinterpret(const I& intermediate, const Env& env, const Allocator2& allocator = Allocator2()) const {
+    return aos_type(atype, get_allocator()).deinterpret(intermediate, env, allocator);
+  }
+
+  CUDA void print() const {
+    if(is_top()) {
+      printf("\u22A4 | ");
+    }
+    printf("<");
+    for(int i = 0; i < vars(); ++i) {
+      (*this)[i].print();
+      printf("%s", (i+1 == vars() ? "" : ", "));
+    }
+    printf(">\n");
+  }
+
+  template<class L, class K, class Alloc1, class Alloc2>
+  friend CUDA bool operator<=(const VStoreSoA<L, Alloc1>& a, const VStoreSoA<K, Alloc2>& b);
+  template<class L, class K, class Alloc1, class Alloc2>
+  friend CUDA bool operator==(const VStoreSoA<L, Alloc1>& a, const VStoreSoA<K, Alloc2>& b);
+};
+
+// Lattice operations.
+// Only the comparison operators are provided, and they are computed bound-wise to benefit from the memory layout.
+
+template<class L, class K, class Alloc1, class Alloc2>
+CUDA bool operator<=(const VStoreSoA<L, Alloc1>& a, const VStoreSoA<K, Alloc2>& b)
+{
+  if(b.is_top()) {
+    return true;
+  }
+  else if(a.is_bot()) {
+    return true;
+  }
+  else if(b.is_bot()) {
+    return false;
+  }
+  else {
+    int min_size = battery::min(a.vars(), b.vars());
+    bool leq = true;
+    if constexpr(simd::same_flat_universe<typename L::LB, typename K::LB> && simd::same_flat_universe<typename L::UB, typename K::UB>) {
+      leq = simd::all_leq(a.lbs.data(), b.lbs.data(), min_size)
+         && simd::all_leq(a.ubs.data(), b.ubs.data(), min_size);
+    }
+    else {
+      for(int i = 0; i < min_size; ++i) {
+        leq &= (a.lbs[i] <= b.lbs[i]);
+      }
+      for(int i = 0; i < min_size; ++i) {
+        leq &= (a.ubs[i] <= b.ubs[i]);
+      }
+    }
+    for(int i = min_size; i < b.vars(); ++i) {
+      leq &= b[i].is_top().value();
+    }
+    return leq;
+  }
+}
+
+template<class L, class K, class Alloc1, class Alloc2>
+CUDA bool operator==(const VStoreSoA<L, Alloc1>& a, const VStoreSoA<K, Alloc2>& b)
+{
+  if(a.is_bot()) {
+    return b.is_bot();
+  }
+  else if(b.is_bot()) {
+    return false;
+  }
+  else {
+    int min_size = battery::min(a.vars(), b.vars());
+    bool eq = true;
+    if constexpr(simd::same_flat_universe<typename L::LB, typename K::LB> && simd::same_flat_universe<typename L::UB, typename K::UB>) {
+      eq = simd::all_eq(a.lbs.data(), b.lbs.data(), min_size)
+        && simd::all_eq(a.ubs.data(), b.ubs.data(), min_size);
+    }
+    else {
+      for(int i = 0; i < min_size; ++i) {
+        eq &= (a.lbs[i] == b.lbs[i]);
+      }
+      for(int i = 0; i < min_size; ++i) {
+        eq &= (a.ubs[i] == b.ubs[i]);
+      }
+    }
+    for(int i = min_size; i < a.vars(); ++i) {
+      eq &= a[i].is_top().value();
+    }
+    for(int i = min_size; i < b.vars(); ++i) {
+      eq &= b[i].is_top().value();
+    }
+    return eq;
+  }
+}
+
+template<class L, class K, class Alloc1, class Alloc2>
+CUDA bool operator<(const VStoreSoA<L, Alloc1>& a, const VStoreSoA<K, Alloc2>& b)
+{
+  return a <= b && a != b;
+}
+
+template<class L, class K, class Alloc1, class Alloc2>
+CUDA bool operator>=(const VStoreSoA<L, Alloc1>& a, const VStoreSoA<K, Alloc2>& b)
+{
+  return b <= a;
+}
+
+template<class L, class K, class Alloc1, class Alloc2>
+CUDA bool operator>(const VStoreSoA<L, Alloc1>& a, const VStoreSoA<K, Alloc2>& b)
+{
+  return b < a;
+}
+
+template<class L, class K, class Alloc1, class Alloc2>
+CUDA bool operator!=(const VStoreSoA<L, Alloc1>& a, const VStoreSoA<K, Alloc2>& b)
+{
+  return !(a == b);
+}
+
+template<class L, class Alloc>
+std::ostream& operator<<(std::ostream &s, const VStoreSoA<L, Alloc> &vstore) {
+  if(vstore.is_bot()) {
+    s << "\u22A5: ";
+  }
+  else {
+    s << "<";
+    for(int i = 0; i < vstore.vars(); ++i) {
+      s << vstore[i] << (i+1 == vstore.vars() ? "" : ", ");
+    }
+    s << ">";
+  }
+  return s;
+}
+
+} // namespace lala
+
+#endif
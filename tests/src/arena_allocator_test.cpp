@@ -0,0 +1,108 @@
+// Copyright 2024 Pierre Talbot
+
+#include "abstract_testing.hpp"
+#include "lala/arena_allocator.hpp"
+#include "lala/vstore.hpp"
+#include "lala/interval.hpp"
+
+using Arena = arena_allocator<standard_allocator>;
+using zlb = local::ZLB;
+using Itv = Interval<zlb>;
+using IStore = VStore<Itv, standard_allocator>;
+
+TEST(ArenaAllocatorTest, BumpAllocation) {
+  Arena arena(256);
+  EXPECT_EQ(arena.allocate(0), nullptr);
+  char* a = static_cast<char*>(arena.allocate(3));
+  char* b = static_cast<char*>(arena.allocate(5));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(a) % Arena::alignment, 0);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % Arena::alignment, 0);
+  EXPECT_EQ(b - a, Arena::alignment); // Consecutive allocations are contiguous.
+  arena.deallocate(a);
+  EXPECT_EQ(arena.num_allocations(), 2);
+  EXPECT_EQ(arena.num_deallocations(), 1);
+  EXPECT_EQ(arena.allocated_bytes(), 2 * Arena::alignment);
+  // Allocations larger than a chunk are served by a dedicated chunk.
+  void* large = arena.allocate(1000);
+  EXPECT_NE(large, nullptr);
+  EXPECT_GE(arena.reserved_bytes(), 1000 + 256);
+  char* c = static_cast<char*>(arena.allocate(1));
+  EXPECT_EQ(c - b, Arena::alignment);
+  arena.release();
+  EXPECT_EQ(arena.reserved_bytes(), 0);
+  EXPECT_NE(arena.allocate(8), nullptr);
+}
+
+TEST(ArenaAllocatorTest, SharedArena) {
+  Arena arena(1024);
+  Arena copy(arena);
+  EXPECT_TRUE(arena == copy);
+  EXPECT_TRUE(arena != Arena());
+  copy.allocate(16);
+  EXPECT_EQ(arena.num_allocations(), 1);
+  // A moved-from allocator still shares the arena.
+  Arena moved(std::move(copy));
+  void* p = copy.allocate(8);
+  copy.deallocate(p);
+  EXPECT_TRUE(moved == copy);
+  EXPECT_EQ(arena.num_allocations(), 2);
+  EXPECT_EQ(arena.num_deallocations(), 1);
+  {
+    battery::vector<int, Arena> v(arena);
+    for(int i = 0; i < 100; ++i) {
+      v.push_back(i);
+    }
+    EXPECT_EQ(v[99], 99);
+  }
+  EXPECT_EQ(arena.num_allocations(), copy.num_allocations());
+}
+
+TEST(ArenaAllocatorTest, DefaultForwardsToUpstream) {
+  Arena def;
+  EXPECT_TRUE(def == Arena());
+  void* p = def.allocate(64);
+  EXPECT_NE(p, nullptr);
+  def.deallocate(p);
+  EXPECT_EQ(def.num_allocations(), 0);
+  EXPECT_EQ(def.reserved_bytes(), 0);
+  battery::vector<int, Arena> v;
+  for(int i = 0; i < 100; ++i) {
+    v.push_back(i);
+  }
+  EXPECT_EQ(v[99], 99);
+  Arena copy(def);
+  EXPECT_TRUE(copy == def);
+  EXPECT_EQ(copy.allocated_bytes(), 0);
+}
+
+TEST(ArenaAllocatorTest, InterpretInArena) {
+  using FA = TFormula<Arena>;
+  Arena arena(4096);
+  Itv x;
+  F g;
+  {
+    VarEnv<Arena> env(arena);
+    typename FA::Sequence seq(arena);
+    seq.push_back(FA::make_exists(UNTYPED, LVar<Arena>("x", arena), Sort<Arena>(Sort<Arena>::Int)));
+    seq.push_back(FA::make_binary(FA::make_lvar(UNTYPED, LVar<Arena>("x", arena)), GEQ, FA::make_z(1), UNTYPED, arena));
+    seq.push_back(FA::make_binary(FA::make_lvar(UNTYPED, LVar<Arena>("x", arena)), LEQ, FA::make_z(5), UNTYPED, arena));
+    FA f = FA::make_nary(AND, std::move(seq));
+    size_t allocations = arena.num_allocations();
+    size_t bytes = arena.allocated_bytes();
+    EXPECT_GT(allocations, 0);
+    IDiagnostics diagnostics;
+    auto store = create_and_interpret_and_tell<IStore>(f, env, diagnostics, standard_allocator{}, arena);
+    EXPECT_TRUE(store.has_value());
+    x = (*store)[0];
+    // The interpretation allocates its temporary objects in the arena.
+    EXPECT_GT(arena.num_allocations(), allocations);
+    EXPECT_GT(arena.allocated_bytes(), bytes);
+    // The formula can be copied out of the arena before it is released.
+    g = F(f, standard_allocator{});
+  }
+  EXPECT_GT(arena.reserved_bytes(), 0);
+  arena.release();
+  EXPECT_EQ(arena.reserved_bytes(), 0);
+  EXPECT_EQ(x, Itv(1, 5));
+  EXPECT_EQ(g.seq().size(), 3);
+}
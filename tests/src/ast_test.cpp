@@ -137,6 +137,61 @@ TEST(AST, VarEnv) {
   check_env_state1(env);
 }
 
+TEST(AST, VarEnvLookup) {
+  using F = TFormula<standard_allocator>;
+  VarEnv<standard_allocator> env;
+  IDiagnostics diagnostics;
+  const int n = 10000;
+  auto snap = env.snapshot();
+  for(int i = 0; i < n; ++i) {
+    AVar avar;
+    auto x = LVar<standard_allocator>("x") + LVar<standard_allocator>::from_int(i);
+    EXPECT_TRUE(env.interpret(F::make_exists(0, x, Sort<standard_allocator>(Sort<standard_allocator>::Int)), avar, diagnostics));
+    EXPECT_EQ(avar, AVar(0, i));
+  }
+  for(int i = 0; i < n; ++i) {
+    auto x = LVar<standard_allocator>("x") + LVar<standard_allocator>::from_int(i);
+    EXPECT_EQ(env.lvar_index_of(x), std::optional<size_t>(i));
+    EXPECT_EQ(env[*env.lvar_index_of(x)].name, x);
+  }
+  EXPECT_FALSE(env.lvar_index_of("y").has_value());
+  env.restore(snap);
+  EXPECT_EQ(env.num_vars(), 0);
+  EXPECT_FALSE(env.contains("x0"));
+  EXPECT_FALSE(env.contains("x9999"));
+}
+
+TEST(AST, VarEnvNestedSnapshots) {
+  using F = TFormula<standard_allocator>;
+  VarEnv<standard_allocator> env;
+  IDiagnostics diagnostics;
+  AVar avar;
+  auto x = LVar<standard_allocator>("x");
+  auto y = LVar<standard_allocator>("y");
+  auto int_sort = Sort<standard_allocator>(Sort<standard_allocator>::Int);
+  EXPECT_TRUE(env.interpret(F::make_exists(0, x, int_sort), avar, diagnostics));
+  auto snap1 = env.snapshot();
+  // Adding an abstract variable to an existing logical variable.
+  EXPECT_TRUE(env.interpret(F::make_exists(2, x, int_sort), avar, diagnostics));
+  EXPECT_EQ(avar, AVar(2, 0));
+  auto snap2 = env.snapshot();
+  EXPECT_TRUE(env.interpret(F::make_exists(2, y, int_sort), avar, diagnostics));
+  EXPECT_EQ(env.num_vars(), 2);
+  EXPECT_EQ(env.num_vars_in(2), 2);
+  // A snapshot without changes in-between does not change anything.
+  env.restore(env.snapshot());
+  EXPECT_EQ(env.num_vars(), 2);
+  env.restore(snap2);
+  EXPECT_EQ(env.num_vars(), 1);
+  EXPECT_FALSE(env.contains("y"));
+  EXPECT_EQ(env.num_vars_in(2), 1);
+  EXPECT_EQ(env.num_abstract_doms(), 3);
+  env.restore(snap1);
+  EXPECT_EQ(env.num_abstract_doms(), 1);
+  EXPECT_FALSE(env.variable_of("x")->get().avar_of(2).has_value());
+  EXPECT_EQ(*env.variable_of("x")->get().avar_of(0), AVar(0, 0));
+}
+
 TEST(AST, NumVars) {
   using F = TFormula<standard_allocator>;
   auto var_x = LVar<standard_allocator>("x");
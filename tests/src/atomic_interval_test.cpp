@@ -0,0 +1,97 @@
+// Copyright 2024 Pierre Talbot
+
+#include "lala/atomic_interval.hpp"
+#include "lala/vstore.hpp"
+#include "abstract_testing.hpp"
+
+#include <thread>
+
+using zlb = local::ZLB;
+using zub = local::ZUB;
+using Itv = Interval<zlb>;
+using LItv32 = AtomicInterval32<local_memory>;
+using AItv32 = AtomicInterval32<atomic_memory<>>;
+
+TEST(AtomicInterval32Test, PackUnpack) {
+  EXPECT_EQ(LItv32().value(), Itv::top());
+  EXPECT_TRUE(LItv32().is_top());
+  EXPECT_TRUE(LItv32(Itv::bot()).is_bot());
+  EXPECT_EQ(LItv32(-5, 10).value(), Itv(-5, 10));
+  EXPECT_EQ(LItv32(zlb(-5), zub(-2)).value(), Itv(-5, -2));
+  EXPECT_EQ(LItv32(3).value(), Itv(3, 3));
+  EXPECT_EQ(AItv32(Itv(-1, 0)).lb(), zlb(-1));
+  EXPECT_EQ(AItv32(Itv(-1, 0)).ub(), zub(0));
+  EXPECT_EQ(AItv32(LItv32(7, 8)), Itv(7, 8));
+}
+
+TEST(AtomicInterval32Test, LatticeOperations) {
+  AItv32 a(Itv(0, 10));
+  EXPECT_TRUE(a.meet(Itv(-5, 5)));
+  EXPECT_EQ(a, Itv(0, 5));
+  EXPECT_FALSE(a.meet(Itv(-5, 5)));
+  EXPECT_TRUE(a.meet_lb(zlb(2)));
+  EXPECT_TRUE(a.meet_ub(zub(4)));
+  EXPECT_FALSE(a.meet_ub(zub(6)));
+  EXPECT_EQ(a, Itv(2, 4));
+  EXPECT_TRUE(a.join(Itv(8, 9)));
+  EXPECT_EQ(a, Itv(2, 9));
+  EXPECT_TRUE(a <= Itv(0, 10));
+  EXPECT_TRUE(Itv(3, 4) < a);
+  EXPECT_TRUE(a != LItv32(2, 8));
+  EXPECT_TRUE(a.meet(LItv32(10, 11)));
+  EXPECT_TRUE(a.is_bot());
+  a.join_top();
+  EXPECT_TRUE(a.is_top());
+  a.meet_bot();
+  EXPECT_TRUE(a.is_bot());
+}
+
+TEST(AtomicInterval32Test, VStore) {
+  using Store = VStore<AItv32, standard_allocator>;
+  Store s(0, 3);
+  EXPECT_TRUE(s.embed(0, Itv(0, 10)));
+  EXPECT_TRUE(s.embed(1, Itv(1, 1)));
+  EXPECT_EQ(s[0], Itv(0, 10));
+  EXPECT_EQ(s.project(AVar(0, 1)), Itv(1, 1));
+  Store::snapshot_type<> snap = s.snapshot();
+  EXPECT_TRUE(s.embed(0, Itv(11, 12)));
+  EXPECT_TRUE(s.is_bot());
+  s.restore(snap);
+  EXPECT_FALSE(s.is_bot());
+  EXPECT_EQ(s[0], Itv(0, 10));
+  EXPECT_FALSE(s.is_extractable(AtomicExtraction{}));
+  s.embed(0, Itv(2, 2));
+  s.embed(2, Itv(3, 3));
+  EXPECT_TRUE(s.is_extractable(AtomicExtraction{}));
+}
+
+/** Narrow concurrently `[0..2n]` with `[k..2n-k]`: a reader thread must never observe an interval that is not symmetric, nor an interval wider than a previous one. */
+TEST(AtomicInterval32Test, ConcurrentMeet) {
+  const int n = 10000;
+  const int num_threads = 4;
+  AItv32 a(Itv(0, 2 * n));
+  std::vector<std::thread> writers;
+  for(int t = 0; t < num_threads; ++t) {
+    writers.emplace_back([&, t]() {
+      for(int k = t; k < n; k += num_threads) {
+        a.meet(Itv(k, 2 * n - k));
+      }
+    });
+  }
+  bool consistent = true;
+  std::thread reader([&]() {
+    Itv prev = a.value();
+    for(int i = 0; i < 100000; ++i) {
+      Itv itv = a.value();
+      consistent &= itv.lb().value() + itv.ub().value() == 2 * n;
+      consistent &= itv <= prev;
+      prev = itv;
+    }
+  });
+  for(auto& w : writers) {
+    w.join();
+  }
+  reader.join();
+  EXPECT_TRUE(consistent);
+  EXPECT_EQ(a, Itv(n - 1, n + 1));
+}
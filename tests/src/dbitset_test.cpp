@@ -0,0 +1,196 @@
+// Copyright 2024 Pierre Talbot
+
+#include "lala/universes/dbitset.hpp"
+#include "abstract_testing.hpp"
+
+using DBit = DBitset<standard_allocator>;
+using LB = DBit::LB;
+using UB = DBit::UB;
+
+TEST(DBitsetTest, BotTopTests) {
+  bot_top_test(DBit(0, 1));
+  bot_top_test(DBit(0));
+  bot_top_test(DBit(-1, -1));
+  bot_top_test(DBit(-100, 10));
+  bot_top_test(DBit(5000, 9000));
+}
+
+TEST(DBitsetTest, TellInterpretation) {
+  VarEnv<standard_allocator> env;
+  expect_interpret_equal_to<IKind::TELL>("constraint int_eq(x, -100);", DBit(-100), env);
+  expect_interpret_equal_to<IKind::TELL>("constraint int_eq(x, 4000);", DBit(4000), env);
+  expect_interpret_equal_to<IKind::TELL>("constraint int_eq(x, 0); constraint int_eq(x, 10);", DBit::bot(), env);
+  expect_interpret_equal_to<IKind::TELL>("constraint set_in(x, {-5, 10, 3000});", DBit::from_set({-5, 10, 3000}), env);
+  expect_interpret_equal_to<IKind::TELL>("constraint nbool_or(int_eq(x, -1), int_eq(x, 100), int_eq(x, 2000));", DBit::from_set({-1, 100, 2000}), env);
+  expect_interpret_equal_to<IKind::TELL>("var 0..4000: x;", DBit(0, 4000), env);
+  expect_interpret_equal_to<IKind::TELL>("constraint int_ne(x, 1000);", DBit(1000).complement(), env);
+  expect_interpret_equal_to<IKind::TELL>("constraint int_ge(x, 0); constraint int_le(x, 4000); constraint int_ne(x, 1000);", fmeet(DBit(0, 4000), DBit(1000).complement()), env);
+  expect_interpret_equal_to<IKind::TELL>("constraint int_gt(x, 10); constraint int_lt(x, 20);", DBit(11, 19), env);
+  expect_interpret_equal_to<IKind::TELL>("constraint nbool_or(int_le(x, 0), int_ge(x, 0));", DBit(), env);
+}
+
+TEST(DBitsetTest, AskInterpretation) {
+  VarEnv<standard_allocator> env;
+  expect_interpret_equal_to<IKind::ASK>("constraint int_eq(x, 4000);", DBit(4000), env);
+  expect_interpret_equal_to<IKind::ASK>("constraint set_in(x, {-5, 10, 3000});", DBit::from_set({-5, 10, 3000}), env);
+  expect_interpret_equal_to<IKind::ASK>("constraint int_ne(x, 1000);", DBit(1000).complement(), env);
+  expect_interpret_equal_to<IKind::ASK>("constraint int_le(x, 100); constraint int_ge(x, -100);", DBit(-100, 100), env);
+}
+
+TEST(DBitsetTest, JoinMeetTest) {
+  join_meet_generic_test(DBit::bot(), DBit::top());
+  join_meet_generic_test(DBit(0), DBit(0));
+  join_meet_generic_test(DBit(0, 5), DBit(0, 10));
+  join_meet_generic_test(DBit(5, 5), DBit(0, 10));
+  join_meet_generic_test(DBit(-1000, -900), DBit(-2000, 3000));
+  join_meet_generic_test(DBit::from_set({0, 1000}), DBit::from_set({0, 5, 10, 1000}));
+  join_meet_generic_test(DBit::from_set({-300, 2000}), DBit(-300, 2000));
+  join_meet_generic_test(DBit::from_set({}), DBit::from_set({-1, 5, 10, 1000}));
+  join_meet_generic_test(DBit(3000).complement(), DBit());
+  join_meet_generic_test(fmeet(DBit(10).complement(), DBit(20).complement()), DBit(20).complement());
+}
+
+TEST(DBitsetTest, UnalignedWindows) {
+  DBit a(3, 200);
+  DBit b(70, 500);
+  DBit c = fmeet(a, b);
+  EXPECT_EQ(c, DBit(70, 200));
+  EXPECT_EQ(c.lb(), LB(70));
+  EXPECT_EQ(c.ub(), UB(200));
+  EXPECT_EQ(c.count(), 131);
+  EXPECT_EQ(fjoin(a, b), DBit(3, 500));
+  DBit holes = fjoin(DBit(-130, -65), DBit(65, 130));
+  EXPECT_FALSE(holes.contains(0));
+  EXPECT_TRUE(holes.contains(-100));
+  EXPECT_TRUE(holes.contains(100));
+  EXPECT_EQ(holes.count(), 132);
+  EXPECT_TRUE(fmeet(holes, DBit(-64, 64)).is_bot());
+  // The window is only extended where the set contains all the values outside of it.
+  DBit ge = DBit(0, 10).complement();
+  EXPECT_TRUE(ge.meet(DBit(4000).complement()));
+  EXPECT_FALSE(ge.contains(5));
+  EXPECT_FALSE(ge.contains(4000));
+  EXPECT_TRUE(ge.contains(4001));
+  EXPECT_TRUE(ge.contains(-1));
+}
+
+TEST(DBitsetTest, OrderTest) {
+  EXPECT_FALSE(DBit(10, 20) <= DBit(8, 12));
+  EXPECT_TRUE(DBit(8, 12) <= DBit(8, 12));
+  EXPECT_TRUE(DBit(7, 13) >= DBit(8, 12));
+  EXPECT_TRUE(DBit(10, 12) <= DBit(8, 12));
+  EXPECT_TRUE(DBit::from_set({-2000, 10, 3000}) >= DBit::from_set({10, 3000}));
+  EXPECT_FALSE(DBit::from_set({-2000, 10}) >= DBit::from_set({10, 3000}));
+  EXPECT_TRUE(DBit(0, 63) < DBit(0, 64));
+  EXPECT_TRUE(DBit(1000).complement() >= DBit(0, 999));
+  EXPECT_FALSE(DBit(1000).complement() >= DBit(0, 1000));
+}
+
+TEST(DBitsetTest, GenericFunTests) {
+  generic_unary_fun_test<DBit>(NEG);
+  generic_abs_test<DBit>();
+}
+
+TEST(DBitsetTest, Negation) {
+  EXPECT_EQ((project_fun(NEG, DBit(5, 10))), DBit(-10, -5));
+  EXPECT_EQ((project_fun(NEG, DBit::from_set({-300, 7, 2000}))), DBit::from_set({-2000, -7, 300}));
+  EXPECT_EQ((project_fun(NEG, DBit(-10, 10))), DBit(-10, 10));
+  EXPECT_EQ((project_fun(NEG, DBit(0, 10).complement())), DBit(-10, 0).complement());
+  EXPECT_EQ((project_fun(NEG, DBit(1000).complement())), DBit(-1000).complement());
+  // Windows spanning several vectors of four words, with and without unused bits in the last word.
+  EXPECT_EQ((project_fun(NEG, DBit(0, 255))), DBit(-255, 0));
+  EXPECT_EQ((project_fun(NEG, DBit(-3000, 5))), DBit(-5, 3000));
+  EXPECT_EQ((project_fun(NEG, DBit::from_set({-4000, -1, 63, 64, 1000, 4095}))), DBit::from_set({-4095, -1000, -64, -63, 1, 4000}));
+  EXPECT_EQ((project_fun(NEG, fmeet(DBit(-70, 4000), DBit(0).complement()))), fmeet(DBit(-4000, 70), DBit(0).complement()));
+}
+
+TEST(DBitsetTest, Absolute) {
+  EXPECT_EQ((project_fun(ABS, DBit(5, 10))), DBit(5, 10));
+  EXPECT_EQ((project_fun(ABS, DBit(-10, 5))), DBit(0, 10));
+  EXPECT_EQ((project_fun(ABS, DBit::from_set({-300, -7, 2000}))), DBit::from_set({7, 300, 2000}));
+  EXPECT_EQ((project_fun(ABS, DBit(-1))), DBit(1));
+  DBit positive;
+  positive.meet_lb(LB(1));
+  EXPECT_EQ((project_fun(ABS, DBit(0, 10).complement())), positive);
+}
+
+TEST(DBitsetTest, Width) {
+  EXPECT_EQ(DBit(0, 0).width(), DBit(1));
+  EXPECT_EQ(DBit(-100, 3000).width(), DBit(3101));
+  EXPECT_EQ(DBit::from_set({-300, 7, 2000}).width(), DBit(3));
+  EXPECT_EQ(DBit(0, 10).complement().width(), DBit::top());
+  EXPECT_EQ(DBit::top().width(), DBit::top());
+  EXPECT_EQ(DBit::bot().width(), DBit(0));
+}
+
+TEST(DBitsetTest, Projections) {
+  EXPECT_EQ(DBit(0, 0).lb(), LB(0));
+  EXPECT_EQ(DBit(0, 0).ub(), UB(0));
+  EXPECT_EQ(DBit(-1000, 3000).lb(), LB(-1000));
+  EXPECT_EQ(DBit(-1000, 3000).ub(), UB(3000));
+  EXPECT_EQ(DBit::from_set({-300, 7, 2000}).lb(), LB(-300));
+  EXPECT_EQ(DBit::from_set({-300, 7, 2000}).ub(), UB(2000));
+  EXPECT_EQ(DBit(0, 10).complement().lb(), LB::top());
+  EXPECT_EQ(DBit(0, 10).complement().ub(), UB::top());
+  EXPECT_EQ(fmeet(DBit(0, 10).complement(), DBit(-5, 20)).lb(), LB(-5));
+  EXPECT_EQ(fmeet(DBit(0, 10).complement(), DBit(-5, 20)).ub(), UB(20));
+  EXPECT_EQ(DBit::top().lb(), LB::top());
+  EXPECT_EQ(DBit::top().ub(), UB::top());
+  EXPECT_EQ(DBit::bot().lb(), LB::bot());
+  EXPECT_EQ(DBit::bot().ub(), UB::bot());
+}
+
+TEST(DBitsetTest, Median) {
+  EXPECT_EQ(DBit(5).median(), DBit(5));
+  EXPECT_EQ(DBit(0, 9).median(), DBit(4));
+  EXPECT_EQ(DBit::from_set({-300, 7, 2000, 3000}).median(), DBit(7));
+  EXPECT_EQ(DBit(100, 4000).median(), DBit(2049));
+  EXPECT_TRUE(DBit::bot().median().is_bot());
+}
+
+TEST(DBitsetTest, WideAndExtremeBounds) {
+  // Windows larger than `max_window_size` keep their first values, and the other values are over-approximated by the flag R.
+  DBit wide(0, 1000000000);
+  EXPECT_EQ(wide.window_size(), DBit::max_window_size);
+  EXPECT_EQ(wide.lb(), LB(0));
+  EXPECT_EQ(wide.ub(), UB::top());
+  EXPECT_TRUE(wide.contains(1000000000));
+  EXPECT_FALSE(wide.contains(-1));
+  EXPECT_TRUE(wide.meet_ub(UB(4000)));
+  EXPECT_EQ(wide, DBit(0, 4000));
+  DBit all(INT_MIN + 1, INT_MAX - 1);
+  EXPECT_EQ(all.window_size(), DBit::max_window_size);
+  EXPECT_EQ(all.lb(), LB(INT_MIN + 1));
+  // The meet of bounds far apart is over-approximated, and does not change the set when the over-approximation is not smaller.
+  DBit ge = DBit::top();
+  EXPECT_TRUE(ge.meet_lb(LB(-10)));
+  EXPECT_FALSE(ge.meet_ub(UB(INT_MAX - 1)));
+  EXPECT_EQ(ge.lb(), LB(-10));
+  DBit le = DBit::top();
+  EXPECT_TRUE(le.meet_ub(UB(10)));
+  EXPECT_FALSE(le.meet_lb(LB(INT_MIN + 1)));
+  EXPECT_EQ(le.ub(), UB(10));
+  EXPECT_TRUE(fmeet(DBit(-10, 10), ge) <= DBit(-10, 10));
+  // Windows far apart are compared without enumerating the values between them.
+  DBit far = fjoin(DBit(-1000000000), DBit(1000000000));
+  EXPECT_TRUE(far.contains(-1000000000));
+  EXPECT_TRUE(far.contains(1000000000));
+  EXPECT_FALSE(far.contains(-1000000001));
+  EXPECT_FALSE(DBit(-1000000000) <= DBit(1000000000));
+  EXPECT_TRUE(DBit(1000000000) <= DBit(-1000000000).complement());
+  EXPECT_FALSE(DBit(1000000000).complement() <= DBit(-1000000000).complement());
+  // Bounds at the limits of `int`.
+  VarEnv<standard_allocator> env;
+  IDiagnostics diagnostics;
+  DBit lt = DBit::top();
+  EXPECT_TRUE(DBit::interpret_tell(F::make_binary(F::make_avar(AVar(0, 0)), LT, F::make_z(INT_MIN)), env, lt, diagnostics));
+  EXPECT_TRUE(lt.is_bot());
+  DBit gt = DBit::top();
+  EXPECT_TRUE(DBit::interpret_tell(F::make_binary(F::make_avar(AVar(0, 0)), GT, F::make_z(INT_MAX)), env, gt, diagnostics));
+  EXPECT_TRUE(gt.is_bot());
+  DBit leq_max = DBit::top();
+  EXPECT_TRUE(DBit::interpret_tell(F::make_binary(F::make_avar(AVar(0, 0)), LEQ, F::make_z(INT_MAX)), env, leq_max, diagnostics));
+  EXPECT_TRUE(leq_max.is_top());
+  EXPECT_EQ(DBit(INT_MAX).count(), 1);
+  EXPECT_TRUE(DBit(INT_MAX - 1).complement().contains(INT_MAX));
+}
@@ -0,0 +1,241 @@
+// Copyright 2024 Pierre Talbot
+
+#include <gtest/gtest.h>
+#include <random>
+#include <algorithm>
+#include <sstream>
+#include "battery/memory.hpp"
+#include "battery/vector.hpp"
+#include "lala/fixpoint.hpp"
+#include "lala/profiled_fixpoint.hpp"
+#include "lala/universes/arith_bound.hpp"
+
+using namespace battery;
+using namespace lala;
+
+template <class Mem>
+class Minimum {
+  const std::vector<int>* data;
+  ZUB<int, Mem> result;
+
+public:
+  Minimum(const std::vector<int>* data) : data(data), result() {}
+  int num_deductions() { return data->size(); }
+  bool deduce(size_t i) {
+    return result.meet(local::ZUB((*data)[i]));
+  }
+  int extract() { return result.value(); }
+  local::B is_bot() const { return false; }
+};
+
+/** `x[i+1] >= x[i] + 1` for all `i`, requiring several iterations when the deductions are not executed in order. */
+template <class Mem>
+class Chain {
+  vector<ZLB<int, Mem>> xs;
+  size_t overflow;
+
+public:
+  Chain(size_t n, size_t overflow = 0) : xs(n), overflow(overflow) {
+    for(size_t i = 0; i < n; ++i) {
+      xs[i].meet(local::ZLB(0));
+    }
+  }
+  int num_deductions() { return xs.size() - 1; }
+  bool deduce(size_t i) {
+    size_t j = (num_deductions() - 1) - i; // Reversed order to disadvantage Gauss-Seidel iteration.
+    return xs[j+1].meet(local::ZLB(xs[j].value() + 1));
+  }
+  int operator[](size_t i) const { return xs[i].value(); }
+  void tell(size_t i, int lb) { xs[i].meet(local::ZLB(lb)); }
+  local::B is_bot() const { return overflow > 0 && xs[xs.size() - 1].value() >= static_cast<int>(overflow); }
+};
+
+std::vector<int> init_random_vector(size_t size) {
+  std::vector<int> v(size);
+  std::mt19937 m{42};
+  std::uniform_int_distribution<int> dist{-10000000, 10000000};
+  std::generate(v.begin(), v.end(), [&dist, &m](){ return dist(m); });
+  return v;
+}
+
+TEST(FixpointTest, AsynchronousMinimum) {
+  std::vector<int> v = init_random_vector(100000);
+  int expected = *std::min_element(v.begin(), v.end());
+  for(size_t workers : {1, 2, 3, 8}) {
+    AsynchronousIterationCPU fp(workers);
+    EXPECT_EQ(fp.workers(), workers);
+    Minimum<atomic_memory<>> m(&v);
+    EXPECT_TRUE(fp.fixpoint(m));
+    EXPECT_EQ(m.extract(), expected);
+    EXPECT_FALSE(fp.fixpoint(m));
+  }
+}
+
+TEST(FixpointTest, AsynchronousSameFixpointAsGaussSeidel) {
+  const size_t n = 200;
+  Chain<local_memory> seq(n);
+  size_t seq_iterations;
+  local::B has_changed(false);
+  seq_iterations = GaussSeidelIteration{}.fixpoint(seq, has_changed);
+  EXPECT_TRUE(has_changed);
+  EXPECT_EQ(seq_iterations, n);
+  for(size_t workers : {1, 2, 4, 7}) {
+    AsynchronousIterationCPU fp(workers);
+    // The engine is reused several times.
+    for(int k = 0; k < 3; ++k) {
+      Chain<atomic_memory<>> par(n);
+      local::B par_changed(false);
+      size_t iterations = fp.fixpoint(par, par_changed);
+      EXPECT_TRUE(par_changed);
+      EXPECT_LE(iterations, n);
+      for(size_t i = 0; i < n; ++i) {
+        EXPECT_EQ(par[i], seq[i]);
+      }
+      EXPECT_FALSE(fp.iterate(par));
+    }
+  }
+}
+
+TEST(FixpointTest, AsynchronousStopOnBot) {
+  AsynchronousIterationCPU fp(4);
+  Chain<atomic_memory<>> c(1000, 10);
+  local::B has_changed(false);
+  size_t iterations = fp.fixpoint(c, has_changed);
+  EXPECT_TRUE(c.is_bot());
+  EXPECT_LT(iterations, 999);
+}
+
+TEST(FixpointTest, AsynchronousStopFlag) {
+  AsynchronousIterationCPU fp(2);
+  Chain<atomic_memory<>> c(100);
+  local::B has_changed(false);
+  volatile bool stop = true;
+  EXPECT_EQ(fp.fixpoint(c, has_changed, &stop), 0);
+  EXPECT_FALSE(has_changed);
+}
+
+/** `Chain` with the dependencies of each deduction, for `EventDrivenIteration`. */
+class WatchedChain {
+  Chain<local_memory> chain;
+  vector<vector<int>> deps;
+
+public:
+  size_t calls;
+
+  WatchedChain(size_t n) : chain(n), deps(n - 1), calls(0) {
+    for(size_t i = 0; i < n - 1; ++i) {
+      size_t j = (n - 2) - i;
+      deps[i].push_back(j);
+      deps[i].push_back(j + 1);
+    }
+  }
+  int num_deductions() { return chain.num_deductions(); }
+  bool deduce(size_t i) {
+    ++calls;
+    return chain.deduce(i);
+  }
+  const vector<int>& deduction_dependencies(size_t i) const { return deps[i]; }
+  int operator[](size_t i) const { return chain[i]; }
+  void tell(size_t i, int lb) { chain.tell(i, lb); }
+  local::B is_bot() const { return false; }
+};
+
+TEST(FixpointTest, EventDrivenSameFixpointAsGaussSeidel) {
+  const size_t n = 200;
+  Chain<local_memory> seq(n);
+  GaussSeidelIteration{}.fixpoint(seq);
+  WatchedChain c(n);
+  EventDrivenIteration<> fp;
+  local::B has_changed(false);
+  fp.fixpoint(c, has_changed);
+  EXPECT_TRUE(has_changed);
+  for(size_t i = 0; i < n; ++i) {
+    EXPECT_EQ(c[i], seq[i]);
+  }
+  // Gauss-Seidel iteration requires n*(n-1) calls on this example.
+  EXPECT_LT(c.calls, n * (n - 1));
+  EXPECT_EQ(fp.num_scheduled(), 0);
+  // Only the deductions downstream of x[n-10] are executed again.
+  c.calls = 0;
+  c.tell(n - 10, 1000);
+  fp.schedule_var(n - 10);
+  EXPECT_TRUE(fp.fixpoint(c));
+  EXPECT_EQ(c[n - 1], 1009);
+  EXPECT_LT(c.calls, 40);
+  // Nothing is scheduled, so everything is scheduled once and nothing changes.
+  c.calls = 0;
+  EXPECT_FALSE(fp.fixpoint(c));
+  EXPECT_EQ(c.calls, n - 1);
+}
+
+TEST(FixpointTest, EventDrivenScheduleVar) {
+  WatchedChain c(10);
+  EventDrivenIteration<> fp;
+  fp.fixpoint(c);
+  fp.schedule_var(4);
+  EXPECT_EQ(fp.num_scheduled(), 2);
+  c.calls = 0;
+  EXPECT_FALSE(fp.fixpoint(c));
+  EXPECT_EQ(c.calls, 2);
+}
+
+TEST(FixpointTest, EventDrivenFallback) {
+  std::vector<int> v = init_random_vector(1000);
+  Minimum<local_memory> m(&v);
+  EventDrivenIteration<> fp;
+  EXPECT_TRUE(fp.fixpoint(m));
+  EXPECT_EQ(m.extract(), *std::min_element(v.begin(), v.end()));
+}
+
+TEST(FixpointTest, ProfiledGaussSeidel) {
+  const size_t n = 20;
+  Chain<local_memory> c(n);
+  GaussSeidelIteration gs;
+  DeductionProfiler<> profiler;
+  ProfiledIteration fp(gs, profiler);
+  EXPECT_EQ(fp.fixpoint(c), local::B(true));
+  ASSERT_EQ(profiler.num_deductions(), n - 1);
+  for(size_t i = 0; i < n - 1; ++i) {
+    EXPECT_EQ(profiler.calls[i], n);
+    // The deduction `x[j+1] >= x[j] + 1` is executed in reversed order, so it fires for the last time at iteration `j+1`.
+    size_t j = (n - 2) - i;
+    EXPECT_EQ(profiler.changes[i], j + 1);
+    EXPECT_EQ(profiler.last_iteration[i], j + 1);
+  }
+  EXPECT_EQ(profiler.num_dead(), 0);
+  std::ostringstream csv;
+  profiler.print_csv(csv);
+  EXPECT_EQ(csv.str().rfind("deduction,calls,changes,nanoseconds,last_iteration\n0,20,19,", 0), 0);
+  std::ostringstream json;
+  profiler.print_json(json);
+  EXPECT_NE(json.str().find("{\"deduction\": 18, \"calls\": 20, \"changes\": 1, "), std::string::npos);
+}
+
+TEST(FixpointTest, ProfiledOtherEngines) {
+  const size_t n = 50;
+  AsynchronousIterationCPU async(4);
+  DeductionProfiler<> profiler;
+  ProfiledIteration fp(async, profiler);
+  Chain<atomic_memory<>> c(n);
+  local::B has_changed(false);
+  size_t iterations = fp.fixpoint(c, has_changed);
+  EXPECT_TRUE(has_changed);
+  for(size_t i = 0; i < n - 1; ++i) {
+    EXPECT_EQ(profiler.calls[i], iterations);
+  }
+
+  EventDrivenIteration<> event;
+  DeductionProfiler<> event_profiler;
+  WatchedChain w(n);
+  ProfiledIteration(event, event_profiler).fixpoint(w);
+  size_t total = 0;
+  for(size_t i = 0; i < n - 1; ++i) {
+    total += event_profiler.calls[i];
+  }
+  EXPECT_EQ(total, w.calls);
+
+  GaussSeidelIteration gs;
+  ProfiledIteration<GaussSeidelIteration, NoProfiler> no_profiling(gs);
+  Chain<local_memory> c2(n);
+  EXPECT_TRUE(no_profiling.fixpoint(c2));
+}
@@ -0,0 +1,86 @@
+// Copyright 2024 Pierre Talbot
+
+#include <gtest/gtest.h>
+#include "battery/allocator.hpp"
+#include "lala/logic/logic.hpp"
+
+using namespace lala;
+using namespace battery;
+
+using F = TFormula<standard_allocator>;
+using FF = FlatFormula<standard_allocator>;
+
+F x() { return F::make_lvar(UNTYPED, "x"); }
+F y() { return F::make_lvar(UNTYPED, "y"); }
+
+/** `exists x, exists y, x = y /\ (x + (2 * 3) <= 10 \/ false) /\ y = 1 + 1 /\ z1 \in {1..3}` */
+F make_formula() {
+  F::Sequence seq;
+  seq.push_back(F::make_exists(UNTYPED, "x", Sort<standard_allocator>(Sort<standard_allocator>::Int)));
+  seq.push_back(F::make_exists(UNTYPED, "y", Sort<standard_allocator>(Sort<standard_allocator>::Int)));
+  seq.push_back(F::make_binary(x(), EQ, y()));
+  seq.push_back(F::make_binary(
+    F::make_binary(F::make_binary(x(), ADD, F::make_binary(F::make_z(2), MUL, F::make_z(3))), LEQ, F::make_z(10)),
+    OR,
+    F::make_false()));
+  seq.push_back(F::make_binary(y(), EQ, F::make_binary(F::make_z(1), ADD, F::make_z(1))));
+  F::LogicSet set;
+  set.push_back(battery::make_tuple(F::make_z(1), F::make_z(3)));
+  seq.push_back(F::make_binary(F::make_avar(AVar(1, 4)), IN, F::make_set(set)));
+  seq.push_back(F::make_real(1.5, 2.5));
+  return F::make_nary(AND, std::move(seq));
+}
+
+TEST(FlatFormulaTest, RoundTrip) {
+  F f = make_formula();
+  FF ff(f);
+  EXPECT_EQ(ff.root(), ff.size() - 1);
+  EXPECT_EQ(ff.begin(ff.root()), 0);
+  EXPECT_EQ(ff.arity(ff.root()), f.seq().size());
+  EXPECT_EQ(ff.to_formula(), f);
+  for(int k = 0; k < f.seq().size(); ++k) {
+    EXPECT_EQ(ff.to_formula(ff.child(ff.root(), k)), f.seq(k));
+  }
+}
+
+TEST(FlatFormulaTest, InternedNames) {
+  FF ff(make_formula());
+  EXPECT_EQ(ff.symbols().size(), 2);
+  int eq = ff.child(ff.root(), 2);
+  EXPECT_EQ(ff.var_id(ff.child(eq, 0)), ff.var_id(ff.child(ff.root(), 0)));
+  EXPECT_EQ(ff.var_id(ff.child(eq, 1)), ff.var_id(ff.child(ff.root(), 1)));
+  EXPECT_EQ(ff.lv(ff.child(eq, 1)), "y");
+  EXPECT_EQ(ff.symbols().find("x", 1), std::optional<int>(0));
+  EXPECT_FALSE(ff.symbols().find("z", 1).has_value());
+}
+
+TEST(FlatFormulaTest, SameResultsAsTFormula) {
+  F f = make_formula();
+  FF ff(f);
+  EXPECT_EQ(num_vars(ff), num_vars(f));
+  EXPECT_EQ(ff.to_formula(var_in(ff)), var_in(f));
+  for(int k = 0; k < f.seq().size(); ++k) {
+    int i = ff.child(ff.root(), k);
+    EXPECT_EQ(num_vars(ff, i), num_vars(f.seq(k)));
+    EXPECT_EQ(ff.to_formula(var_in(ff, i)), var_in(f.seq(k)));
+    EXPECT_EQ(is_var_equality(ff, i), is_var_equality(f.seq(k)));
+    EXPECT_EQ(eval(ff, i), eval(f.seq(k)));
+  }
+  EXPECT_EQ(eval(ff), eval(f));
+}
+
+TEST(FlatFormulaTest, SymbolTable) {
+  SymbolTable<standard_allocator> table;
+  for(int i = 0; i < 100; ++i) {
+    EXPECT_EQ(table.intern(LVar<standard_allocator>::from_int(i)), i);
+  }
+  for(int i = 0; i < 100; ++i) {
+    EXPECT_EQ(table.intern(LVar<standard_allocator>::from_int(i)), i);
+    EXPECT_EQ(table[i], LVar<standard_allocator>::from_int(i));
+  }
+  EXPECT_EQ(table.size(), 100);
+  table.resize(50);
+  EXPECT_EQ(table.size(), 50);
+  EXPECT_FALSE(table.find(LVar<standard_allocator>::from_int(70)).has_value());
+  EXPECT_EQ(table.find(LVar<standard_allocator>::from_int(42)), std::optional<int>(42));
+}
@@ -0,0 +1,78 @@
+// Copyright 2024 Pierre Talbot
+
+#include <gtest/gtest.h>
+#include "battery/allocator.hpp"
+#include "lala/logic/logic.hpp"
+
+using namespace lala;
+using namespace battery;
+
+using F = TFormula<standard_allocator>;
+using HC = HashConsing<standard_allocator>;
+
+F x() { return F::make_lvar(UNTYPED, "x"); }
+F y() { return F::make_lvar(UNTYPED, "y"); }
+F x_plus_y() { return F::make_binary(x(), ADD, y()); }
+
+/** `(x + y <= 10) /\ (x + y >= 2) /\ exists z /\ z \in {1..3} /\ 1.5 /\ x + y >= 2` */
+F make_formula() {
+  F::Sequence seq;
+  seq.push_back(F::make_binary(x_plus_y(), LEQ, F::make_z(10)));
+  seq.push_back(F::make_binary(x_plus_y(), GEQ, F::make_z(2)));
+  seq.push_back(F::make_exists(UNTYPED, "z", Sort<standard_allocator>(Sort<standard_allocator>::Int)));
+  F::LogicSet set;
+  set.push_back(battery::make_tuple(F::make_z(1), F::make_z(3)));
+  seq.push_back(F::make_binary(F::make_avar(AVar(1, 4)), IN, F::make_set(set)));
+  seq.push_back(F::make_real(1.5, 1.5));
+  seq.push_back(F::make_binary(x_plus_y(), GEQ, F::make_z(2)));
+  return F::make_nary(AND, std::move(seq));
+}
+
+TEST(HashConsingTest, SharedSubformulas) {
+  HC hc;
+  F f = make_formula();
+  int id = hc.intern(f);
+  EXPECT_EQ(hc.to_formula(id), f);
+  // The first and last conjuncts are the same formula, and `x + y` is shared by three conjuncts.
+  EXPECT_EQ(hc.child(id, 1), hc.child(id, 5));
+  EXPECT_EQ(hc.child(hc.child(id, 0), 0), hc.child(hc.child(id, 1), 0));
+  // Interning again does not create new formulas.
+  size_t n = hc.size();
+  EXPECT_EQ(hc.intern(make_formula()), id);
+  EXPECT_EQ(hc.size(), n);
+  // Factory methods build the same formulas.
+  int sum = hc.make_binary(hc.make_lvar(UNTYPED, LVar<standard_allocator>("x")), ADD, hc.make_lvar(UNTYPED, LVar<standard_allocator>("y")));
+  EXPECT_EQ(sum, hc.intern(x_plus_y()));
+  EXPECT_EQ(hc.make_binary(sum, LEQ, hc.make_z(10)), hc.child(id, 0));
+  EXPECT_NE(hc.make_binary(sum, LEQ, hc.make_z(11)), hc.child(id, 0));
+  EXPECT_NE(hc.make_z(10, 1), hc.make_z(10));
+  EXPECT_EQ(hc.make_real(battery::make_tuple(1.5, 1.5)), hc.child(id, 4));
+  EXPECT_EQ(hc.size(), n + 3);
+}
+
+TEST(HashConsingTest, StructuralHash) {
+  HC hc;
+  F f = make_formula();
+  int id = hc.intern(f);
+  EXPECT_EQ(hc.hash(id), structural_hash(f));
+  for(int k = 0; k < f.seq().size(); ++k) {
+    EXPECT_EQ(hc.hash(hc.child(id, k)), structural_hash(f.seq(k)));
+  }
+  EXPECT_EQ(structural_hash(make_formula()), structural_hash(f));
+  EXPECT_NE(structural_hash(F::make_binary(x(), ADD, y())), structural_hash(F::make_binary(y(), ADD, x())));
+  // The hash does not depend on the insertion order.
+  HC hc2;
+  hc2.intern(F::make_z(42));
+  EXPECT_EQ(hc2.hash(hc2.intern(f)), hc.hash(id));
+}
+
+TEST(HashConsingTest, ManyFormulas) {
+  HC hc;
+  for(int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(hc.intern(F::make_binary(x(), LEQ, F::make_z(i))), 2 * i + 2);
+  }
+  for(int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(hc.to_formula(hc.intern(F::make_binary(x(), LEQ, F::make_z(i)))), F::make_binary(x(), LEQ, F::make_z(i)));
+  }
+  EXPECT_EQ(hc.size(), 2001);
+}
@@ -0,0 +1,91 @@
+// Copyright 2024 Pierre Talbot
+
+#include "lala/interval_bitset.hpp"
+#include "lala/vstore.hpp"
+#include "abstract_testing.hpp"
+
+using zlb = local::ZLB;
+using zub = local::ZUB;
+using Itv = Interval<zlb>;
+using NBit = NBitset<128, local_memory, unsigned long long>;
+using IB = IntervalBitset<128, local_memory>;
+
+TEST(IntervalBitsetTest, BotTopTests) {
+  bot_top_test(IB(0, 10));
+  bot_top_test(IB(5));
+  bot_top_test(IB(Itv(0, 100), NBit::from_set({3, 50})));
+}
+
+TEST(IntervalBitsetTest, Reduce) {
+  IB a(Itv(0, 100), NBit::from_set({3, 50, 70}));
+  EXPECT_EQ(a.interval(), Itv(3, 70));
+  EXPECT_EQ(a.bitset(), NBit::from_set({3, 50, 70}));
+  IB b(Itv(10, 60), NBit(0, 100));
+  EXPECT_EQ(b.interval(), Itv(10, 60));
+  EXPECT_EQ(b.bitset(), NBit(10, 60));
+  // Removing the lower bound from the bitset tightens the interval.
+  EXPECT_TRUE(a.meet(IB(Itv::top(), NBit(3).complement())));
+  EXPECT_EQ(a.interval(), Itv(50, 70));
+  EXPECT_EQ(a.lb(), zlb(50));
+  // Tightening the interval removes the values from the bitset, and the interval is then tightened to the next value in the bitset.
+  EXPECT_TRUE(a.meet_lb(zlb(51)));
+  EXPECT_EQ(a.interval(), Itv(70, 70));
+  EXPECT_EQ(a.bitset(), NBit(70));
+  EXPECT_FALSE(a.meet(IB(0, 100)));
+  EXPECT_TRUE(a.meet(IB(Itv::top(), NBit::from_set({1}))));
+  EXPECT_TRUE(a.is_bot());
+  EXPECT_TRUE(a.interval().is_bot());
+  EXPECT_TRUE(a.bitset().is_bot());
+  // Values beyond the bitset are only represented by the interval.
+  IB c(Itv(200, 300), NBit());
+  EXPECT_EQ(c.interval(), Itv(200, 300));
+  EXPECT_EQ(c.bitset(), NBit(127, 127));
+  EXPECT_FALSE(c.is_bot());
+}
+
+TEST(IntervalBitsetTest, Interpretation) {
+  VarEnv<standard_allocator> env;
+  expect_interpret_equal_to<IKind::TELL>("constraint int_ge(x, 5); constraint int_ne(x, 5);", IB(Itv(zlb(6), zub::top()), NBit(6, 1000)), env);
+  expect_interpret_equal_to<IKind::TELL>("constraint set_in(x, {1, 5, 9});", IB(Itv(1, 9), NBit::from_set({1, 5, 9})), env);
+  expect_interpret_equal_to<IKind::TELL>("constraint int_le(x, 10); constraint int_ge(x, 0); constraint int_ne(x, 10);", IB(0, 9), env);
+  expect_interpret_equal_to<IKind::TELL>("constraint int_eq(x, 4);", IB(4), env);
+  expect_interpret_equal_to<IKind::ASK>("constraint int_le(x, 10); constraint int_ge(x, 5);", IB(5, 10), env);
+}
+
+TEST(IntervalBitsetTest, JoinMeetTest) {
+  join_meet_generic_test(IB::bot(), IB::top());
+  join_meet_generic_test(IB(0), IB(0));
+  join_meet_generic_test(IB(0, 5), IB(0, 10));
+  join_meet_generic_test(IB(5, 5), IB(0, 10));
+  EXPECT_EQ(fmeet(IB(0, 10), IB(Itv(5, 20), NBit::from_set({5, 7, 20}))), IB(Itv(5, 7), NBit::from_set({5, 7})));
+  EXPECT_EQ(fjoin(IB(0, 2), IB(8, 10)), IB(Itv(0, 10), fjoin(NBit(0, 2), NBit(8, 10))));
+}
+
+TEST(IntervalBitsetTest, Projections) {
+  generic_unary_fun_test<IB>(NEG);
+  EXPECT_EQ((project_fun(NEG, IB(5, 10))), IB(Itv(-10, -5), NBit(-1)));
+  EXPECT_EQ((project_fun(ABS, IB(-10, 5))), IB(0, 10));
+  IB sum;
+  sum.project(ADD, IB(1, 2), IB(10, 20));
+  EXPECT_EQ(sum, IB(11, 22));
+  IB s(Itv(0, 100), NBit::from_set({1, 5, 9}));
+  EXPECT_EQ(s.width(), IB(3));
+  EXPECT_EQ(s.median(), IB(1));
+  EXPECT_EQ(IB(0, 10).median(), IB(4));
+}
+
+TEST(IntervalBitsetTest, VStore) {
+  using Store = VStore<IB, standard_allocator>;
+  Store s(0, 2);
+  EXPECT_TRUE(s.embed(0, IB(0, 100)));
+  EXPECT_TRUE(s.embed(0, IB(Itv::top(), NBit(0).complement())));
+  EXPECT_EQ(s[0], IB(1, 100));
+  EXPECT_EQ(s[0].interval(), Itv(1, 100));
+  EXPECT_TRUE(s.embed(1, IB(Itv(0, 10), NBit::from_set({0, 10}))));
+  EXPECT_EQ(s[1].interval(), Itv(0, 10));
+  EXPECT_TRUE(s.embed(1, IB(Itv(1, 20), NBit())));
+  EXPECT_EQ(s[1], IB(10));
+  EXPECT_FALSE(s.is_extractable(AtomicExtraction{}));
+  EXPECT_TRUE(s.embed(0, IB(7)));
+  EXPECT_TRUE(s.is_extractable(AtomicExtraction{}));
+}
@@ -0,0 +1,111 @@
+// Copyright 2024 Pierre Talbot
+
+#include "abstract_testing.hpp"
+#include "lala/mapped_allocator.hpp"
+#include "lala/vstore.hpp"
+#include "lala/interval.hpp"
+
+#ifdef LALA_CORE_HAS_MMAP
+
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+
+using zlb = local::ZLB;
+using zub = local::ZUB;
+using Itv = Interval<zlb>;
+using IStore = VStore<Itv, standard_allocator>;
+using MStore = VStore<Itv, mapped_allocator>;
+
+/** Each test writes its image in a file of the temporary directory named after the test and the process, removed after the test. */
+class MappedAllocatorTest : public ::testing::Test {
+protected:
+  std::string image_file;
+  const char* image_path;
+
+  void SetUp() override {
+    const ::testing::TestInfo* info = ::testing::UnitTest::GetInstance()->current_test_info();
+    image_file = ::testing::TempDir() + info->test_suite_name() + "_" + info->name() + "_" + std::to_string(getpid()) + ".lala";
+    image_path = image_file.c_str();
+  }
+
+  void TearDown() override {
+    std::remove(image_path);
+  }
+};
+
+IStore make_root(int n) {
+  IStore root(0, n);
+  for(int i = 0; i < n; ++i) {
+    root.embed(i, Itv(zlb(-i), zub(i)));
+  }
+  return root;
+}
+
+TEST_F(MappedAllocatorTest, StoreImage) {
+  const int n = 10000;
+  IStore root = make_root(n);
+  ASSERT_TRUE(write_store_image(image_path, root));
+  {
+    auto store = load_store_image<Itv>(image_path);
+    ASSERT_TRUE(store.has_value());
+    mapped_allocator alloc = store->get_allocator();
+    EXPECT_TRUE(alloc.is_mapped());
+    EXPECT_EQ(alloc.image_size(), n * sizeof(Itv));
+    EXPECT_TRUE(alloc.is_mapping(&(*store)[0]));
+    EXPECT_EQ(store->aty(), 0);
+    EXPECT_EQ(store->vars(), n);
+    EXPECT_FALSE(store->is_bot());
+    for(int i = 0; i < n; ++i) {
+      EXPECT_EQ((*store)[i], root[i]);
+    }
+
+    // A worker copies the root store, and shares the unmodified pages again.
+    MStore worker(*store);
+    EXPECT_TRUE(alloc.is_mapping(&worker[0]));
+    size_t pages = alloc.share(&worker[0]);
+    EXPECT_GT(pages, 1);
+    worker.embed(5000, Itv(zlb(0), zub(1)));
+    EXPECT_EQ(alloc.share(&worker[0]), pages - 1);
+    EXPECT_EQ(worker[5000], Itv(zlb(0), zub(1)));
+    EXPECT_EQ(worker[4999], root[4999]);
+
+    // The image and the other stores are not modified.
+    EXPECT_EQ((*store)[5000], root[5000]);
+    auto store2 = load_store_image<Itv>(image_path);
+    ASSERT_TRUE(store2.has_value());
+    EXPECT_EQ((*store2)[5000], root[5000]);
+
+    // Snapshots of the root are also mapped.
+    auto snap = worker.snapshot(alloc);
+    EXPECT_TRUE(alloc.is_mapping(snap.data()));
+    EXPECT_EQ(alloc.share(snap.data()), pages - 1);
+    worker.embed(0, Itv(zlb(0), zub(0)));
+    worker.restore(snap);
+    EXPECT_EQ(worker[0], root[0]);
+    EXPECT_TRUE(alloc.reset(&worker[0]));
+    EXPECT_FALSE(alloc.reset(&root[0]));
+    EXPECT_EQ(worker[5000], root[5000]);
+  }
+}
+
+TEST_F(MappedAllocatorTest, BotAndInvalidImages) {
+  IStore root = make_root(10);
+  root.embed(3, Itv::bot());
+  ASSERT_TRUE(write_store_image(image_path, root));
+  auto store = load_store_image<Itv>(image_path);
+  ASSERT_TRUE(store.has_value());
+  EXPECT_TRUE(store->is_bot());
+  // Wrong universe.
+  EXPECT_FALSE(load_store_image<zlb>(image_path).has_value());
+  std::remove(image_path);
+  EXPECT_FALSE(load_store_image<Itv>(image_path).has_value());
+  // Without image, the allocations are not mapped.
+  mapped_allocator alloc;
+  void* p = alloc.allocate(100);
+  EXPECT_NE(p, nullptr);
+  EXPECT_FALSE(alloc.is_mapping(p));
+  alloc.deallocate(p);
+}
+
+#endif
@@ -200,3 +200,26 @@ TEST(NBitsetTest, Projections) {
   EXPECT_EQ(NBit(-1, -1).lb(), LB::top());
   EXPECT_EQ(NBit(-1, -1).ub(), UB(-1));
 }
+
+template <size_t N>
+void median_test() {
+  using B = NBitset<N, battery::local_memory, unsigned long long>;
+  const int M = static_cast<int>(N) - 3;
+  EXPECT_TRUE(B::bot().median().is_bot());
+  EXPECT_EQ(B(0).median(), B(0));
+  EXPECT_EQ(B(M).median(), B(M));
+  EXPECT_EQ(B(0, M).median(), B((M + 1) / 2 - 1));
+  EXPECT_EQ(B(M / 2, M).median(), B(M / 2 + (M - M / 2 + 1) / 2 - 1));
+  EXPECT_EQ(B::from_set({1, M / 3, M / 2, M}).median(), B(M / 3));
+  EXPECT_EQ(B::from_set({2, M - 1}).median(), B(2));
+  EXPECT_EQ(B(-1).median(), B(-1));
+  EXPECT_EQ(B(-10, 10).median(), B(4));
+}
+
+TEST(NBitsetTest, Median) {
+  median_test<64>();
+  median_test<128>();
+  median_test<256>();
+  median_test<1024>();
+  median_test<4096>();
+}
@@ -0,0 +1,215 @@
+// Copyright 2024 Pierre Talbot
+
+#include <gtest/gtest.h>
+#include "battery/allocator.hpp"
+#include "lala/logic/logic.hpp"
+#include "lala/vstore.hpp"
+#include "lala/interval.hpp"
+#include "lala/universes/nbitset.hpp"
+
+using namespace lala;
+using namespace battery;
+
+using F = TFormula<standard_allocator>;
+using Itv = Interval<local::ZLB>;
+using IStore = VStore<Itv, standard_allocator>;
+
+F x() { return F::make_lvar(UNTYPED, "x"); }
+
+/** `exists x, x + (2 * 3) <= 10 \/ false, z1 \in {1..3}, [1.5..2.5], set_sort, ext(x, true)` */
+F make_formula() {
+  F::Sequence seq;
+  seq.push_back(F::make_exists(0, "x", Sort<standard_allocator>(Sort<standard_allocator>::Int)));
+  seq.push_back(F::make_binary(
+    F::make_binary(F::make_binary(x(), ADD, F::make_binary(F::make_z(2), MUL, F::make_z(3))), LEQ, F::make_z(10)),
+    OR,
+    F::make_false()));
+  F::LogicSet set;
+  set.push_back(battery::make_tuple(F::make_z(1), F::make_z(3)));
+  seq.push_back(F::make_binary(F::make_avar(AVar(1, 4)), IN, F::make_set(set), 1));
+  seq.push_back(F::make_real(1.5, 2.5));
+  seq.push_back(F::make_exists(UNTYPED, "s", Sort<standard_allocator>(Sort<standard_allocator>::Set, Sort<standard_allocator>(Sort<standard_allocator>::Int))));
+  F::Sequence args;
+  args.push_back(x());
+  args.push_back(F::make_true());
+  seq.push_back(F::make_nary("ext", std::move(args)));
+  return F::make_nary(AND, std::move(seq));
+}
+
+TEST(SerializationTest, FormulaRoundTrip) {
+  F f = make_formula();
+  BinaryWriter<standard_allocator> w;
+  serialize(w, f);
+  BinaryReader r(w.data(), w.size());
+  ASSERT_TRUE(r.ok());
+  auto g = deserialize_formula<F>(r);
+  ASSERT_TRUE(g.has_value());
+  EXPECT_EQ(*g, f);
+  EXPECT_EQ(r.remaining(), 0);
+}
+
+TEST(SerializationTest, InvalidBuffers) {
+  BinaryWriter<standard_allocator> w;
+  serialize(w, make_formula());
+  // Truncated buffer.
+  for(size_t n = 0; n < w.size(); n += 7) {
+    BinaryReader r(w.data(), n);
+    EXPECT_FALSE(deserialize_formula<F>(r).has_value());
+    EXPECT_FALSE(r.ok());
+  }
+  // Wrong version.
+  battery::vector<char, standard_allocator> bytes(w.size());
+  memcpy(bytes.data(), w.data(), w.size());
+  bytes[4] += 1;
+  BinaryReader r(bytes.data(), bytes.size());
+  EXPECT_FALSE(r.ok());
+}
+
+TEST(SerializationTest, VarEnvAndVStore) {
+  VarEnv<standard_allocator> env;
+  IDiagnostics diagnostics;
+  AVar avar;
+  for(int i = 0; i < 100; ++i) {
+    auto name = LVar<standard_allocator>("x") + LVar<standard_allocator>::from_int(i);
+    EXPECT_TRUE(env.interpret(F::make_exists(i % 2, name, Sort<standard_allocator>(Sort<standard_allocator>::Int)), avar, diagnostics));
+  }
+  EXPECT_TRUE(env.interpret(F::make_exists(1, "x0", Sort<standard_allocator>(Sort<standard_allocator>::Int)), avar, diagnostics));
+  IStore store(0, 50);
+  for(int i = 0; i < 50; ++i) {
+    store.embed(i, Itv(local::ZLB(-i), local::ZUB(i * 2)));
+  }
+
+  BinaryWriter<standard_allocator> w;
+  env.serialize(w);
+  store.serialize(w);
+  BinaryReader r(w.data(), w.size());
+  auto env2 = VarEnv<standard_allocator>::deserialize(r);
+  auto store2 = IStore::deserialize(r);
+  ASSERT_TRUE(env2.has_value());
+  ASSERT_TRUE(store2.has_value());
+  EXPECT_EQ(r.remaining(), 0);
+
+  EXPECT_EQ(env2->num_vars(), env.num_vars());
+  EXPECT_EQ(env2->num_abstract_doms(), env.num_abstract_doms());
+  EXPECT_EQ(env2->num_vars_in(1), env.num_vars_in(1));
+  EXPECT_EQ(*env2->variable_of("x0")->get().avar_of(1), *env.variable_of("x0")->get().avar_of(1));
+  EXPECT_EQ(env2->name_of(AVar(1, 10)), env.name_of(AVar(1, 10)));
+  // The trail is preserved, so we can still restore the environment.
+  auto snap = env2->snapshot();
+  EXPECT_TRUE(env2->interpret(F::make_exists(0, "y", Sort<standard_allocator>(Sort<standard_allocator>::Int)), avar, diagnostics));
+  env2->restore(snap);
+  EXPECT_FALSE(env2->contains("y"));
+
+  EXPECT_EQ(store2->aty(), 0);
+  EXPECT_EQ(store2->vars(), 50);
+  for(int i = 0; i < 50; ++i) {
+    EXPECT_EQ((*store2)[i], store[i]);
+  }
+}
+
+TEST(SerializationTest, StoreSizeLargerThanBuffer) {
+  IStore store(0, 10);
+  BinaryWriter<standard_allocator> w;
+  store.serialize(w);
+  // The number of variables is the last field before the universes.
+  size_t n_offset = w.size() - 10 * 2 * sizeof(int) - sizeof(unsigned long long);
+  for(unsigned long long n : {11ull, 1ull << 40, ~0ull}) {
+    battery::vector<char, standard_allocator> bytes(w.size());
+    memcpy(bytes.data(), w.data(), w.size());
+    memcpy(bytes.data() + n_offset, &n, sizeof(n));
+    BinaryReader r(bytes.data(), bytes.size());
+    EXPECT_FALSE(IStore::deserialize(r).has_value());
+  }
+  BinaryReader r(w.data(), w.size());
+  EXPECT_TRUE(IStore::deserialize(r).has_value());
+}
+
+/** Deserialize `env` after overwriting the last trail entry (the last 9 bytes: `lvar`, `aty` and `created`) with `lvar`, `aty` and `created`. */
+bool deserialize_with_last_entry(const VarEnv<standard_allocator>& env, int lvar, AType aty, unsigned char created) {
+  BinaryWriter<standard_allocator> w;
+  env.serialize(w);
+  battery::vector<char, standard_allocator> bytes(w.size());
+  memcpy(bytes.data(), w.data(), w.size());
+  size_t e = w.size() - sizeof(int) - sizeof(AType) - 1;
+  memcpy(bytes.data() + e, &lvar, sizeof(int));
+  memcpy(bytes.data() + e + sizeof(int), &aty, sizeof(AType));
+  bytes[w.size() - 1] = created;
+  BinaryReader r(bytes.data(), bytes.size());
+  return VarEnv<standard_allocator>::deserialize(r).has_value();
+}
+
+/** Deserialize `env` after appending the trail entry `lvar`, `aty` and `created`. */
+bool deserialize_with_extra_entry(const VarEnv<standard_allocator>& env, int lvar, AType aty, unsigned char created) {
+  BinaryWriter<standard_allocator> w;
+  env.serialize(w);
+  w.write(lvar);
+  w.write(aty);
+  w.write(created);
+  battery::vector<char, standard_allocator> bytes(w.size());
+  memcpy(bytes.data(), w.data(), w.size());
+  unsigned long long trail_size = env.snapshot().trail_size + 1;
+  size_t entry_size = sizeof(int) + sizeof(AType) + 1;
+  memcpy(bytes.data() + w.size() - trail_size * entry_size - sizeof(trail_size), &trail_size, sizeof(trail_size));
+  BinaryReader r(bytes.data(), bytes.size());
+  return VarEnv<standard_allocator>::deserialize(r).has_value();
+}
+
+TEST(SerializationTest, InvalidTrail) {
+  VarEnv<standard_allocator> env;
+  IDiagnostics diagnostics;
+  AVar avar;
+  EXPECT_TRUE(env.interpret(F::make_exists(0, "x", Sort<standard_allocator>(Sort<standard_allocator>::Int)), avar, diagnostics));
+  EXPECT_TRUE(env.interpret(F::make_exists(1, "y", Sort<standard_allocator>(Sort<standard_allocator>::Int)), avar, diagnostics));
+  // The last entry records the creation of `y` in the abstract domain `1`.
+  EXPECT_TRUE(deserialize_with_last_entry(env, 1, 1, 1));
+  // Out of range variable or abstract domain.
+  EXPECT_FALSE(deserialize_with_last_entry(env, 2, 1, 1));
+  EXPECT_FALSE(deserialize_with_last_entry(env, -2, 1, 1));
+  EXPECT_FALSE(deserialize_with_last_entry(env, 1, 2, 1));
+  EXPECT_FALSE(deserialize_with_last_entry(env, 1, -1, 1));
+  // Inconsistent with the variables created.
+  EXPECT_FALSE(deserialize_with_last_entry(env, 1, 1, 0));
+  EXPECT_FALSE(deserialize_with_last_entry(env, 0, 1, 1));
+  EXPECT_FALSE(deserialize_with_last_entry(env, 1, 1, 2));
+  // A new abstract domain instead of the variable `y`.
+  EXPECT_FALSE(deserialize_with_last_entry(env, -1, UNTYPED, 0));
+  // The abstract variable of `y` recorded as an abstract variable of `x`.
+  EXPECT_FALSE(deserialize_with_last_entry(env, 0, 1, 0));
+  // An entry without abstract variable to remove: `restore` would pop an empty vector.
+  EXPECT_FALSE(deserialize_with_extra_entry(env, 0, 0, 0));
+  EXPECT_FALSE(deserialize_with_extra_entry(env, 1, 1, 0));
+  EXPECT_FALSE(deserialize_with_extra_entry(env, -1, UNTYPED, 0));
+}
+
+TEST(SerializationTest, BitsetStore) {
+  using NBit = NBitset<64, local_memory, unsigned long long>;
+  VStore<NBit, standard_allocator> store(0, 3);
+  store.embed(0, NBit(2, 5));
+  store.meet_bot();
+  BinaryWriter<standard_allocator> w;
+  store.serialize(w);
+  BinaryReader r(w.data(), w.size());
+  auto store2 = VStore<NBit, standard_allocator>::deserialize(r);
+  ASSERT_TRUE(store2.has_value());
+  EXPECT_TRUE(store2->is_bot());
+  EXPECT_EQ((*store2)[0], store[0]);
+}
+
+#ifdef LALA_CORE_HAS_MMAP
+TEST(SerializationTest, MappedFile) {
+  F f = make_formula();
+  BinaryWriter<standard_allocator> w;
+  serialize(w, f);
+  const char* path = "serialization_test.lala";
+  ASSERT_TRUE(write_file(path, w));
+  {
+    MappedFile file(path);
+    ASSERT_TRUE(file.is_open());
+    EXPECT_EQ(file.size(), w.size());
+    BinaryReader r = file.reader();
+    EXPECT_EQ(deserialize_formula<F>(r), std::optional<F>(f));
+  }
+  remove(path);
+  EXPECT_FALSE(MappedFile(path).is_open());
+}
+#endif
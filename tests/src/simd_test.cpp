@@ -0,0 +1,276 @@
+// Copyright 2024 Pierre Talbot
+
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "lala/simd.hpp"
+#include "lala/vstore.hpp"
+#include "lala/vstore_soa.hpp"
+#include "lala/interval.hpp"
+
+using namespace lala;
+using namespace battery;
+
+using zlb = local::ZLB;
+using zub = local::ZUB;
+using flb = local::FLB;
+using Itv = Interval<zlb>;
+using FItv = Interval<flb>;
+using ZStore = VStore<zlb, standard_allocator>;
+using IStore = VStore<Itv, standard_allocator>;
+using FStore = VStore<FItv, standard_allocator>;
+using SoAStore = VStoreSoA<Itv, standard_allocator>;
+using FSoAStore = VStoreSoA<FItv, standard_allocator>;
+
+static_assert(simd::flat_universe<zlb>);
+static_assert(simd::flat_universe<zub>);
+static_assert(simd::flat_universe<flb>);
+static_assert(!simd::flat_universe<Itv>);
+static_assert(!simd::flat_universe<ZLB<int, atomic_memory<>>>);
+static_assert(simd::flat_interval<Itv>);
+static_assert(simd::flat_interval<FItv>);
+static_assert(!simd::flat_interval<zlb>);
+static_assert(!simd::flat_interval<Interval<ZLB<int, atomic_memory<>>>>);
+
+/** The targets `simd_test_avx2` and `simd_test_avx512f` compile these tests with `-mavx2` and `-mavx512f`, they are skipped on CPUs lacking these instructions. */
+class CPUFeaturesEnvironment : public ::testing::Environment {
+public:
+  void SetUp() override {
+#if defined(__GNUC__) && defined(__AVX512F__)
+    if(!__builtin_cpu_supports("avx512f")) {
+      GTEST_SKIP() << "The CPU does not support AVX-512.";
+    }
+#elif defined(__GNUC__) && defined(__AVX2__)
+    if(!__builtin_cpu_supports("avx2")) {
+      GTEST_SKIP() << "The CPU does not support AVX2.";
+    }
+#endif
+  }
+};
+
+static ::testing::Environment* const cpu_features_env = ::testing::AddGlobalTestEnvironment(new CPUFeaturesEnvironment);
+
+const size_t sizes[] = {0, 1, 3, 4, 7, 8, 9, 15, 16, 17, 33, 1000, 4099};
+
+template <class T>
+std::vector<T> random_values(size_t n, std::mt19937& gen) {
+  std::uniform_int_distribution<int> dist(-20, 20);
+  std::vector<T> v(n);
+  for(auto& x : v) { x = static_cast<T>(dist(gen)); }
+  return v;
+}
+
+template <class T>
+void test_kernels() {
+  std::mt19937 gen(0);
+  for(size_t n : sizes) {
+    std::vector<T> a = random_values<T>(n, gen);
+    std::vector<T> b = random_values<T>(n, gen);
+    std::vector<T> mx = a, mn = a;
+    bool mx_changed = false, mn_changed = false, gt = false, neq = false, eq = false;
+    for(size_t i = 0; i < n; ++i) {
+      mx_changed |= b[i] > a[i];
+      mn_changed |= b[i] < a[i];
+      mx[i] = std::max(a[i], b[i]);
+      mn[i] = std::min(a[i], b[i]);
+      gt |= a[i] > b[i];
+      neq |= a[i] != b[i];
+      eq |= a[i] == T(7);
+    }
+    EXPECT_EQ(simd::any_gt(a.data(), b.data(), n), gt);
+    EXPECT_EQ(simd::any_neq(a.data(), b.data(), n), neq);
+    EXPECT_FALSE(simd::any_neq(a.data(), a.data(), n));
+    EXPECT_EQ(simd::any_eq(a.data(), T(7), n), eq);
+    std::vector<T> c = a;
+    EXPECT_EQ(simd::max_into(c.data(), b.data(), n), mx_changed);
+    EXPECT_EQ(c, mx);
+    EXPECT_FALSE(simd::max_into(c.data(), b.data(), n));
+    c = a;
+    EXPECT_EQ(simd::min_into(c.data(), b.data(), n), mn_changed);
+    EXPECT_EQ(c, mn);
+    EXPECT_FALSE(simd::min_into(c.data(), b.data(), n));
+    for(bool even : {true, false}) {
+      std::vector<T> mxmn = a;
+      bool mxmn_changed = false, gtlt = false, neq_pairs = false;
+      for(size_t i = 0; i < n; ++i) {
+        bool max_lane = (i % 2 == 0) == even;
+        mxmn[i] = max_lane ? mx[i] : mn[i];
+        mxmn_changed |= mxmn[i] != a[i];
+        gtlt |= max_lane ? a[i] > b[i] : a[i] < b[i];
+        neq_pairs |= i % 2 == 0 && i + 1 < n && (a[i] != a[i + 1] || a[i] == T(7) || a[i] == T(-3));
+      }
+      c = a;
+      EXPECT_EQ(simd::max_min_into(c.data(), b.data(), n, even), mxmn_changed);
+      EXPECT_EQ(c, mxmn);
+      EXPECT_EQ(simd::any_gt_lt(a.data(), b.data(), n, even), gtlt);
+      EXPECT_EQ(simd::any_neq_pairs(a.data(), T(7), T(-3), n), neq_pairs);
+    }
+  }
+}
+
+TEST(SIMDTest, IntKernels) {
+  test_kernels<int>();
+}
+
+TEST(SIMDTest, DoubleKernels) {
+  test_kernels<double>();
+}
+
+TEST(SIMDTest, LongKernels) {
+  test_kernels<long long>();
+}
+
+template <class Store, class U>
+Store random_store(size_t n, std::mt19937& gen) {
+  std::uniform_int_distribution<int> dist(-20, 20);
+  Store s(UNTYPED, n);
+  for(size_t i = 0; i < n; ++i) {
+    int l = dist(gen);
+    s.embed(i, U(l, l + std::abs(dist(gen))));
+  }
+  return s;
+}
+
+template <class Store, class U>
+void test_soa_store() {
+  std::mt19937 gen(1);
+  for(size_t n : sizes) {
+    Store a = random_store<Store, U>(n, gen);
+    Store b = random_store<Store, U>(n, gen);
+    EXPECT_TRUE(a == a);
+    EXPECT_TRUE(a <= a);
+    Store met(a);
+    met.meet(b);
+    Store joined(a);
+    joined.join(b);
+    bool is_bot = false;
+    for(size_t i = 0; i < n; ++i) {
+      EXPECT_EQ(met[i], fmeet(a[i], b[i]));
+      EXPECT_EQ(joined[i], fjoin(a[i], b[i]));
+      is_bot |= fmeet(a[i], b[i]).is_bot();
+    }
+    EXPECT_EQ(met.is_bot(), is_bot);
+    EXPECT_TRUE(a <= joined);
+    EXPECT_TRUE(b <= joined);
+    if(!is_bot) {
+      EXPECT_TRUE(met <= a);
+      EXPECT_TRUE(met <= b);
+    }
+    EXPECT_EQ(a <= b, n == 0 || a == b);
+    Store singletons(UNTYPED, n);
+    for(size_t i = 0; i < n; ++i) {
+      singletons.embed(i, U(i, i));
+    }
+    EXPECT_TRUE(singletons.is_extractable(AtomicExtraction{}));
+    if(n > 0) {
+      Store wider(UNTYPED, n);
+      for(size_t i = 0; i < n; ++i) {
+        wider.embed(i, U(i + (i == n - 1), i + (i == n - 1)));
+      }
+      singletons.join(wider);
+      EXPECT_FALSE(singletons.is_extractable(AtomicExtraction{}));
+    }
+  }
+}
+
+TEST(SIMDTest, VStoreSoAOperations) {
+  test_soa_store<SoAStore, Itv>();
+  test_soa_store<FSoAStore, FItv>();
+}
+
+TEST(SIMDTest, VStoreOperations) {
+  std::mt19937 gen(2);
+  std::uniform_int_distribution<int> dist(-20, 20);
+  for(size_t n : sizes) {
+    ZStore a(UNTYPED, n), b(UNTYPED, n);
+    for(size_t i = 0; i < n; ++i) {
+      a.embed(i, zlb(dist(gen)));
+      b.embed(i, zlb(dist(gen)));
+    }
+    ZStore met(a);
+    EXPECT_EQ(met.meet(b), n > 0 && !(a <= b));
+    ZStore joined(a);
+    joined.join(b);
+    for(size_t i = 0; i < n; ++i) {
+      EXPECT_EQ(met[i], fmeet(a[i], b[i]));
+      EXPECT_EQ(joined[i], fjoin(a[i], b[i]));
+    }
+    EXPECT_TRUE(met <= a);
+    EXPECT_TRUE(a <= joined);
+    EXPECT_TRUE(a == ZStore(a));
+    EXPECT_EQ(a == b, n == 0);
+  }
+}
+
+/** Random intervals, some of them being bot. */
+template <class U>
+std::vector<U> random_intervals(size_t n, std::mt19937& gen) {
+  std::uniform_int_distribution<int> dist(-20, 20);
+  std::vector<U> v;
+  for(size_t i = 0; i < n; ++i) {
+    int l = dist(gen);
+    v.push_back(U(l, l + dist(gen) / 2));
+  }
+  return v;
+}
+
+template <class Store, class U>
+void test_interval_store() {
+  std::mt19937 gen(3);
+  for(size_t n : sizes) {
+    std::vector<U> x = random_intervals<U>(n, gen);
+    std::vector<U> y = random_intervals<U>(n, gen);
+    Store a(UNTYPED, n), b(UNTYPED, n);
+    for(size_t i = 0; i < n; ++i) {
+      a.embed(i, x[i]);
+      b.embed(i, y[i]);
+    }
+    Store met(a);
+    met.meet(b);
+    Store joined(a);
+    joined.join(b);
+    bool leq = true, eq = true;
+    for(size_t i = 0; i < n; ++i) {
+      EXPECT_EQ(met[i].as_product(), fmeet(a[i].as_product(), b[i].as_product()));
+      EXPECT_EQ(joined[i].as_product(), b.is_bot() ? a[i].as_product() : fjoin(a[i].as_product(), b[i].as_product()));
+      leq &= a[i] <= b[i];
+      eq &= a[i] == b[i];
+    }
+    EXPECT_EQ(a <= b, leq);
+    EXPECT_EQ(a == b, a.is_bot() || b.is_bot() ? a.is_bot() && b.is_bot() : eq);
+    EXPECT_TRUE(a <= joined);
+    EXPECT_TRUE(met <= a);
+    EXPECT_TRUE(a == Store(a));
+    Store singletons(UNTYPED, n);
+    for(size_t i = 0; i < n; ++i) {
+      singletons.embed(i, U(i, i));
+    }
+    EXPECT_TRUE(singletons.is_extractable(AtomicExtraction{}));
+    if(n > 0) {
+      singletons.join(singletons);
+      EXPECT_TRUE(singletons.is_extractable(AtomicExtraction{}));
+      Store wider(UNTYPED, n);
+      wider.embed(n - 1, U(n - 1, n));
+      singletons.join(wider);
+      EXPECT_FALSE(singletons.is_extractable(AtomicExtraction{}));
+    }
+  }
+}
+
+TEST(SIMDTest, IntervalVStoreOperations) {
+  test_interval_store<IStore, Itv>();
+  test_interval_store<FStore, FItv>();
+  // A bot interval is smaller than any interval, although their bounds are not ordered.
+  IStore a(UNTYPED, 20), b(UNTYPED, 20);
+  EXPECT_TRUE(a.embed(3, Itv(5, 3)));
+  EXPECT_TRUE(b.embed(3, Itv(10, 12)));
+  EXPECT_TRUE(a <= b);
+  EXPECT_FALSE(b <= a);
+  // Equal bounds are not singletons when they are the bot or top value of the lower bound.
+  std::vector<Itv> singletons(20, Itv(4, 4));
+  EXPECT_TRUE(simd::all_singletons(singletons.data(), singletons.size()));
+  singletons[17] = Itv(zlb::bot(), zub(zlb::bot().value()));
+  EXPECT_FALSE(simd::all_singletons(singletons.data(), singletons.size()));
+  singletons[17] = Itv(zlb::top(), zub(zlb::top().value()));
+  EXPECT_FALSE(simd::all_singletons(singletons.data(), singletons.size()));
+}
@@ -9,6 +9,7 @@
 using Itv = Interval<local::ZLB>;
 using IStore = VStore<Itv, standard_allocator>;
 
+template <class Iteration = GaussSeidelIteration>
 void test_simplification(
   const char* store_formula,
   const char* simplifier_formula,
@@ -35,8 +36,10 @@ void test_simplification(
   simplifier_type::tell_type<standard_allocator> tell;
   EXPECT_TRUE((ginterpret_in<IKind::TELL, true>(simplifier, f2, env, tell, diagnostics)));
   simplifier.deduce(std::move(tell));
-  local::B has_changed = GaussSeidelIteration{}.fixpoint(simplifier);
+  local::B has_changed = Iteration{}.fixpoint(simplifier);
   EXPECT_TRUE(has_changed);
+  // Only the formulas affected by a change are simplified again, so a second fixpoint does not change anything.
+  EXPECT_FALSE(Iteration{}.fixpoint(simplifier));
 
   printf("fixed point reached\n");
 
@@ -72,3 +75,73 @@ TEST(Simplifier, SimplificationGlobalTest) {
     "var 0..8: x;"
   );
 }
+
+TEST(Simplifier, EqualityChain) {
+  const int n = 50;
+  std::string decls;
+  for(int i = 0; i < n; ++i) {
+    decls += "var " + std::string(i == n - 1 ? "3..5" : "0..10") + ": x" + std::to_string(i) + "; ";
+  }
+  std::string chain = decls;
+  for(int i = n - 2; i >= 0; --i) {
+    chain += "constraint int_eq(x" + std::to_string(i) + ", x" + std::to_string(i + 1) + "); ";
+  }
+  test_simplification(decls.c_str(), chain.c_str(), "var 3..5: x0;");
+}
+
+TEST(Simplifier, EventDrivenSimplification) {
+  test_simplification<EventDrivenIteration<>>(
+    "var 0..8: x; var 2..10: y; var 5..5: z; var 0..10: w;",
+    "var 0..8: x; var 2..10: y; var 5..5: z; var 0..10: w; constraint int_eq(x, y); constraint int_ge(y, z); constraint int_ge(y, w);",
+    "var 2..8: x; var 0..10: w; constraint int_ge(x, 5); constraint int_ge(x, w);"
+  );
+
+  test_simplification<EventDrivenIteration<>>(
+    "var 0..8: x; var 2..10: y; var 5..5: z; var 0..10: w;",
+    "var 0..8: x; var 2..10: y; var 5..5: z; var 0..10: w; constraint int_eq(x, y); constraint int_eq(y, w); constraint int_eq(w, z);",
+    "var 5..5: x;"
+  );
+}
+
+TEST(Simplifier, RedundantFormulas) {
+  test_simplification(
+    "var 0..10: x; var 0..10: y;",
+    "var 0..10: x; var 0..10: y; constraint int_le(x, 5); constraint int_le(x, 7); constraint int_lin_le([1, 1], [x, y], 8); constraint int_lin_le([1, 1], [y, x], 8); constraint int_lin_le([1, 1], [x, y], 12);",
+    "var 0..5: x; var 0..10: y; constraint int_lin_le([1, 1], [x, y], 8);"
+  );
+}
+
+TEST(Simplifier, AffineSubstitution) {
+  VarEnv<standard_allocator> env;
+  auto f1 = *parse_flatzinc_str<standard_allocator>("var 0..20: x; var 0..20: y; var 0..20: z; var 0..20: w;");
+  // x = 2y + 1, z = x + 3, x + z <= w.
+  auto f2 = *parse_flatzinc_str<standard_allocator>(
+    "var 0..20: x; var 0..20: y; var 0..20: z; var 0..20: w;\
+     constraint int_lin_eq([1, -2], [x, y], 1);\
+     constraint int_lin_eq([1, -1], [z, x], 3);\
+     constraint int_le(int_plus(x, z), w);");
+  IDiagnostics diagnostics;
+  auto istore = battery::make_shared<IStore, standard_allocator>(create_and_interpret_and_tell<IStore>(f1, env, diagnostics).value());
+  using simplifier_type = Simplifier<IStore, standard_allocator>;
+  simplifier_type simplifier{env.extends_abstract_dom(), istore};
+  simplifier_type::tell_type<standard_allocator> tell;
+  EXPECT_TRUE((ginterpret_in<IKind::TELL, true>(simplifier, f2, env, tell, diagnostics)));
+  simplifier.deduce(std::move(tell));
+  GaussSeidelIteration{}.fixpoint(simplifier);
+  // `x` and `z` are substituted by `2y + 1` and `2y + 4`, and the domain of `y` is restricted accordingly (`z <= 20` implies `y <= 8`).
+  EXPECT_EQ(simplifier.num_eliminated_variables(), 2);
+  auto f3 = *parse_flatzinc_str<standard_allocator>(
+    "var 0..8: y; var 0..20: w;\
+     constraint int_le(int_plus(int_plus(int_times(y, 2), 1), int_plus(int_times(y, 2), 4)), w);");
+  auto f4 = simplifier.deinterpret();
+  EXPECT_EQ(f3, f4);
+  // The values of `x` and `z` are rebuilt from the value of `y`.
+  EXPECT_TRUE(istore->embed(env.variable_of("y")->get().avars[0], Itv(3, 3)));
+  testing::internal::CaptureStdout();
+  simplifier.print_variable(LVar<standard_allocator>("x"), env, *istore);
+  printf(" ");
+  simplifier.print_variable(LVar<standard_allocator>("z"), env, *istore);
+  printf(" ");
+  simplifier.print_variable(LVar<standard_allocator>("y"), env, *istore);
+  EXPECT_EQ(testing::internal::GetCapturedStdout(), "7 10 3");
+}
@@ -0,0 +1,265 @@
+// Copyright 2024 Pierre Talbot
+
+#include "lala/universes/sparse_set.hpp"
+#include "lala/vstore.hpp"
+#include "abstract_testing.hpp"
+
+using SSet = SparseSet<standard_allocator>;
+using LB = SSet::LB;
+using UB = SSet::UB;
+
+/** Counts the allocations, to check that the stores of sparse sets are restored without copying the sets. */
+struct counting_allocator : standard_allocator {
+  static inline int allocations = 0;
+  CUDA void* allocate(size_t bytes) {
+    ++allocations;
+    return standard_allocator::allocate(bytes);
+  }
+};
+
+TEST(SparseSetTest, BotTopTests) {
+  bot_top_test(SSet(0, 1));
+  bot_top_test(SSet(0));
+  bot_top_test(SSet(-1, -1));
+  bot_top_test(SSet(-100, 10));
+  bot_top_test(SSet(5000, 9000));
+}
+
+TEST(SparseSetTest, TellInterpretation) {
+  VarEnv<standard_allocator> env;
+  expect_interpret_equal_to<IKind::TELL>("constraint int_eq(x, -100);", SSet(-100), env);
+  expect_interpret_equal_to<IKind::TELL>("constraint int_eq(x, 0); constraint int_eq(x, 10);", SSet::bot(), env);
+  expect_interpret_equal_to<IKind::TELL>("constraint set_in(x, {-5, 10, 3000});", SSet::from_set({-5, 10, 3000}), env);
+  expect_interpret_equal_to<IKind::TELL>("var 0..4000: x;", SSet(0, 4000), env);
+  expect_interpret_equal_to<IKind::TELL>("constraint int_ne(x, 1000);", SSet(1000).complement(), env);
+  expect_interpret_equal_to<IKind::TELL>("constraint int_ge(x, 0); constraint int_le(x, 4000); constraint int_ne(x, 1000);", fmeet(SSet(0, 4000), SSet(1000).complement()), env);
+  expect_interpret_equal_to<IKind::TELL>("constraint int_gt(x, 10); constraint int_lt(x, 20);", SSet(11, 19), env);
+  expect_interpret_equal_to<IKind::TELL>("constraint nbool_or(int_le(x, 0), int_ge(x, 0));", SSet(), env);
+}
+
+TEST(SparseSetTest, AskInterpretation) {
+  VarEnv<standard_allocator> env;
+  expect_interpret_equal_to<IKind::ASK>("constraint int_eq(x, 4000);", SSet(4000), env);
+  expect_interpret_equal_to<IKind::ASK>("constraint set_in(x, {-5, 10, 3000});", SSet::from_set({-5, 10, 3000}), env);
+  expect_interpret_equal_to<IKind::ASK>("constraint int_ne(x, 1000);", SSet(1000).complement(), env);
+  expect_interpret_equal_to<IKind::ASK>("constraint int_le(x, 100); constraint int_ge(x, -100);", SSet(-100, 100), env);
+}
+
+TEST(SparseSetTest, JoinMeetTest) {
+  join_meet_generic_test(SSet::bot(), SSet::top());
+  join_meet_generic_test(SSet(0), SSet(0));
+  join_meet_generic_test(SSet(0, 5), SSet(0, 10));
+  join_meet_generic_test(SSet(5, 5), SSet(0, 10));
+  join_meet_generic_test(SSet(-1000, -900), SSet(-2000, 3000));
+  join_meet_generic_test(SSet::from_set({0, 1000}), SSet::from_set({0, 5, 10, 1000}));
+  join_meet_generic_test(SSet::from_set({-300, 2000}), SSet(-300, 2000));
+  join_meet_generic_test(SSet::from_set({}), SSet::from_set({-1, 5, 10, 1000}));
+  join_meet_generic_test(SSet(3000).complement(), SSet());
+  join_meet_generic_test(fmeet(SSet(10).complement(), SSet(20).complement()), SSet(20).complement());
+}
+
+TEST(SparseSetTest, OrderTest) {
+  EXPECT_FALSE(SSet(10, 20) <= SSet(8, 12));
+  EXPECT_TRUE(SSet(8, 12) <= SSet(8, 12));
+  EXPECT_TRUE(SSet(7, 13) >= SSet(8, 12));
+  EXPECT_TRUE(SSet::from_set({-2000, 10, 3000}) >= SSet::from_set({10, 3000}));
+  EXPECT_FALSE(SSet::from_set({-2000, 10}) >= SSet::from_set({10, 3000}));
+  EXPECT_TRUE(SSet(1000).complement() >= SSet(0, 999));
+  EXPECT_FALSE(SSet(1000).complement() >= SSet(0, 1000));
+}
+
+TEST(SparseSetTest, Removals) {
+  SSet s(0, 4000);
+  EXPECT_TRUE(s.meet(SSet(0).complement()));
+  EXPECT_TRUE(s.meet(SSet(4000).complement()));
+  EXPECT_TRUE(s.meet(SSet(2000).complement()));
+  EXPECT_FALSE(s.meet(SSet(2000).complement()));
+  EXPECT_EQ(s.window_size(), 4001);
+  EXPECT_EQ(s.count(), 3998);
+  EXPECT_EQ(s.lb(), LB(1));
+  EXPECT_EQ(s.ub(), UB(3999));
+  EXPECT_FALSE(s.contains(2000));
+  EXPECT_TRUE(s.meet_lb(LB(1999)));
+  EXPECT_EQ(s.lb(), LB(1999));
+  EXPECT_TRUE(s.meet(SSet(1999).complement()));
+  EXPECT_EQ(s.lb(), LB(2001));
+  EXPECT_TRUE(s.meet_ub(UB(2003)));
+  EXPECT_EQ(s, SSet(2001, 2003));
+  EXPECT_TRUE(s.meet(SSet::from_set({-5, 2002, 5000})));
+  EXPECT_EQ(s, SSet(2002));
+  EXPECT_EQ(s.window_size(), 4001);
+  EXPECT_TRUE(s.meet(SSet(2002).complement()));
+  EXPECT_TRUE(s.is_bot());
+}
+
+TEST(SparseSetTest, SnapshotRestore) {
+  SSet s(0, 4000);
+  SSet::snapshot_type root = s.snapshot();
+  s.meet(SSet(100).complement());
+  s.meet_lb(LB(50));
+  SSet::snapshot_type child = s.snapshot();
+  s.meet(SSet::from_set({60, 100, 3000}));
+  EXPECT_EQ(s, SSet::from_set({60, 3000}));
+  s.meet_ub(UB(10));
+  EXPECT_TRUE(s.is_bot());
+  EXPECT_TRUE(s.restore(child));
+  EXPECT_EQ(s, fmeet(SSet(50, 4000), SSet(100).complement()));
+  EXPECT_EQ(s.lb(), LB(50));
+  EXPECT_TRUE(s.restore(root));
+  EXPECT_EQ(s, SSet(0, 4000));
+  EXPECT_EQ(s.count(), 4001);
+  // Sets with unbounded sides are restored too, as long as the window does not change.
+  SSet t(SSet(0, 10).complement());
+  SSet::snapshot_type snap = t.snapshot();
+  t.meet_ub(UB(-1));
+  EXPECT_EQ(t.ub(), UB(-1));
+  EXPECT_TRUE(t.restore(snap));
+  EXPECT_EQ(t, SSet(0, 10).complement());
+  // A snapshot taken before the set is joined or rebuilt cannot be restored, and the set is left unchanged.
+  SSet u(0, 10);
+  SSet::snapshot_type before = u.snapshot();
+  u.join(SSet(20));
+  EXPECT_FALSE(u.restore(before));
+  EXPECT_EQ(u, fjoin(SSet(0, 10), SSet(20)));
+}
+
+TEST(SparseSetTest, WideAndExtremeBounds) {
+  // Windows larger than `max_window_size` keep their first values, and the other values are over-approximated by the flag R.
+  SSet wide(0, 1000000000);
+  EXPECT_EQ(wide.window_size(), SSet::max_window_size);
+  EXPECT_EQ(wide.lb(), LB(0));
+  EXPECT_EQ(wide.ub(), UB::top());
+  EXPECT_TRUE(wide.contains(1000000000));
+  EXPECT_FALSE(wide.contains(-1));
+  EXPECT_TRUE(wide.meet_ub(UB(4000)));
+  EXPECT_EQ(wide, SSet(0, 4000));
+  SSet all(INT_MIN + 1, INT_MAX - 1);
+  EXPECT_EQ(all.window_size(), SSet::max_window_size);
+  EXPECT_EQ(all.lb(), LB(INT_MIN + 1));
+  SSet ge = SSet::top();
+  EXPECT_TRUE(ge.meet_lb(LB(-10)));
+  EXPECT_FALSE(ge.meet_ub(UB(INT_MAX - 1)));
+  EXPECT_EQ(ge.lb(), LB(-10));
+  EXPECT_TRUE(fmeet(SSet(-10, 10), ge) <= SSet(-10, 10));
+  // Windows far apart are compared without enumerating the values between them.
+  SSet far = fjoin(SSet(-1000000000), SSet(1000000000));
+  EXPECT_TRUE(far.contains(-1000000000));
+  EXPECT_TRUE(far.contains(1000000000));
+  EXPECT_FALSE(far.contains(-1000000001));
+  EXPECT_FALSE(SSet(-1000000000) <= SSet(1000000000));
+  EXPECT_TRUE(SSet(1000000000) <= SSet(-1000000000).complement());
+  EXPECT_FALSE(SSet(1000000000).complement() <= SSet(-1000000000).complement());
+  // Bounds at the limits of `int`.
+  VarEnv<standard_allocator> env;
+  IDiagnostics diagnostics;
+  SSet lt = SSet::top();
+  EXPECT_TRUE(SSet::interpret_tell(F::make_binary(F::make_avar(AVar(0, 0)), LT, F::make_z(INT_MIN)), env, lt, diagnostics));
+  EXPECT_TRUE(lt.is_bot());
+  SSet gt = SSet::top();
+  EXPECT_TRUE(SSet::interpret_tell(F::make_binary(F::make_avar(AVar(0, 0)), GT, F::make_z(INT_MAX)), env, gt, diagnostics));
+  EXPECT_TRUE(gt.is_bot());
+}
+
+TEST(SparseSetTest, GenericFunTests) {
+  generic_unary_fun_test<SSet>(NEG);
+  generic_abs_test<SSet>();
+}
+
+TEST(SparseSetTest, Projections) {
+  EXPECT_EQ((project_fun(NEG, SSet::from_set({-300, 7, 2000}))), SSet::from_set({-2000, -7, 300}));
+  EXPECT_EQ((project_fun(NEG, SSet(0, 10).complement())), SSet(-10, 0).complement());
+  EXPECT_EQ((project_fun(ABS, SSet::from_set({-300, -7, 2000}))), SSet::from_set({7, 300, 2000}));
+  EXPECT_EQ(SSet::from_set({-300, 7, 2000}).lb(), LB(-300));
+  EXPECT_EQ(SSet::from_set({-300, 7, 2000}).ub(), UB(2000));
+  EXPECT_EQ(SSet(0, 10).complement().lb(), LB::top());
+  EXPECT_EQ(fmeet(SSet(0, 10).complement(), SSet(-5, 20)).ub(), UB(20));
+  EXPECT_EQ(SSet::bot().lb(), LB::bot());
+  EXPECT_EQ(SSet::from_set({-300, 7, 2000}).width(), SSet(3));
+  EXPECT_EQ(SSet(0, 10).complement().width(), SSet::top());
+  EXPECT_EQ(SSet::from_set({-300, 7, 2000, 3000}).median(), SSet(7));
+  EXPECT_EQ(SSet(0, 9).median(), SSet(4));
+}
+
+TEST(SparseSetTest, VStore) {
+  using CSet = SparseSet<counting_allocator>;
+  using Store = VStore<CSet, counting_allocator>;
+  Store s(0, 2);
+  EXPECT_TRUE(s.embed(0, CSet(0, 4000)));
+  EXPECT_TRUE(s.embed(1, CSet(-10, 10)));
+  Store::snapshot_type<> snap = s.snapshot();
+  CSet not1000 = CSet(1000).complement();
+  CSet five(5);
+  CSet six(6);
+  CSet root(0, 4000);
+  // The sets are only narrowed in place, hence restoring the snapshot does not copy them.
+  int allocations = counting_allocator::allocations;
+  EXPECT_TRUE(s.embed(0, not1000));
+  EXPECT_TRUE(s.embed(1, five));
+  EXPECT_TRUE(s.embed(1, six));
+  EXPECT_TRUE(s.is_bot());
+  s.restore(snap);
+  EXPECT_EQ(counting_allocator::allocations, allocations);
+  EXPECT_FALSE(s.is_bot());
+  EXPECT_EQ(s[0], root);
+  EXPECT_EQ(s[1], CSet(-10, 10));
+  // Once the trail is allocated, backtracking does not copy the sets either.
+  s.push_level();
+  EXPECT_TRUE(s.embed(0, five));
+  EXPECT_TRUE(s.embed(1, five));
+  s.pop_level();
+  allocations = counting_allocator::allocations;
+  s.push_level();
+  EXPECT_TRUE(s.embed(0, five));
+  EXPECT_FALSE(s.is_extractable(AtomicExtraction{}));
+  EXPECT_TRUE(s.embed(1, five));
+  EXPECT_TRUE(s.is_extractable(AtomicExtraction{}));
+  EXPECT_EQ(s.trail_copies(), 0);
+  s.pop_level();
+  EXPECT_EQ(counting_allocator::allocations, allocations);
+  EXPECT_EQ(s[0], root);
+  EXPECT_EQ(s[1], CSet(-10, 10));
+  // Restoring a snapshot taken in the current level only records the states of the sets.
+  s.push_level();
+  Store::snapshot_type<> child = s.snapshot();
+  EXPECT_TRUE(s.embed(0, not1000));
+  s.restore(child);
+  EXPECT_TRUE(s.embed(0, five));
+  EXPECT_EQ(s.trail_copies(), 0);
+  s.pop_level();
+  EXPECT_EQ(s[0], root);
+  // A snapshot taken before the current level widens the sets beyond their values in this level, hence they are copied in the trail to be narrowed back by `pop_level`.
+  s.push_level();
+  EXPECT_TRUE(s.embed(0, five));
+  s.restore(snap);
+  EXPECT_EQ(s[0], root);
+  EXPECT_TRUE(s.embed(0, not1000));
+  EXPECT_EQ(s.trail_copies(), 1);
+  s.pop_level();
+  EXPECT_EQ(s[0], root);
+  s.push_level();
+  EXPECT_TRUE(s.embed(0, six));
+  s.push_level();
+  s.restore(snap);
+  EXPECT_TRUE(s.embed(0, not1000));
+  s.pop_level();
+  EXPECT_EQ(s[0], six);
+  s.pop_level();
+  EXPECT_EQ(s[0], root);
+  // A set joined since the snapshot cannot be restored, and the store becomes bot instead of over-approximating it.
+  Store u(s);
+  Store::snapshot_type<> before = u.snapshot();
+  EXPECT_TRUE(u.embed(0, five));
+  Store other(0, 2);
+  EXPECT_TRUE(other.embed(0, six));
+  EXPECT_TRUE(other.embed(1, five));
+  EXPECT_TRUE(u.join(other));
+  u.restore(before);
+  EXPECT_TRUE(u.is_bot());
+  // A set with unbounded sides might be extended beyond its window by a meet, hence it is copied in the trail.
+  Store t(0, 1);
+  t.push_level();
+  EXPECT_TRUE(t.embed(0, root));
+  EXPECT_EQ(t.trail_copies(), 1);
+  t.pop_level();
+  EXPECT_EQ(t[0], CSet::top());
+}
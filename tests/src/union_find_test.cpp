@@ -0,0 +1,49 @@
+// Copyright 2024 Pierre Talbot
+
+#include <gtest/gtest.h>
+#include "lala/union_find.hpp"
+#include <thread>
+#include <vector>
+
+using namespace lala;
+using namespace battery;
+
+template <class UF>
+void check_chains(UF& uf, int n, int k) {
+  // Elements `i` and `j` are in the same class iff `i % k == j % k`.
+  for(int i = 0; i < n; ++i) {
+    EXPECT_EQ(uf.representative(i), i % k);
+    EXPECT_TRUE(uf.same(i, i % k));
+    EXPECT_FALSE(uf.same(i, (i + 1) % k));
+  }
+}
+
+TEST(UnionFindTest, SequentialChains) {
+  const int n = 1000, k = 3;
+  UnionFind<> uf(n);
+  EXPECT_EQ(uf.num_classes(), n);
+  for(int i = n - 1; i >= k; --i) {
+    EXPECT_TRUE(uf.unite(i, i - k));
+  }
+  EXPECT_FALSE(uf.unite(k, 2 * k));
+  EXPECT_EQ(uf.num_classes(), k);
+  check_chains(uf, n, k);
+}
+
+TEST(UnionFindTest, ConcurrentChains) {
+  const int n = 10000, k = 7, num_threads = 4;
+  ConcurrentUnionFind<> uf(n);
+  std::vector<std::thread> threads;
+  for(int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t]() {
+      for(int i = k + t; i < n; i += num_threads) {
+        uf.unite(i, i - k);
+        uf.unite(n - 1 - i + k, n - 1 - i);
+      }
+    });
+  }
+  for(auto& t : threads) {
+    t.join();
+  }
+  check_chains(uf, n, k);
+}
@@ -0,0 +1,95 @@
+// Copyright 2024 Pierre Talbot
+
+#include "lala/vstore_bool.hpp"
+#include "lala/interval.hpp"
+#include "abstract_testing.hpp"
+
+using zlb = local::ZLB;
+using zub = local::ZUB;
+using Itv = Interval<zlb>;
+using IStore = VStore<Itv, standard_allocator>;
+using BStore = VStoreBool<Itv, standard_allocator>;
+
+TEST(VStoreBoolTest, Interpretation) {
+  const char* fzn = "var 0..1: a; var 0..1: b; var 0..1: c; constraint int_ge(a, 1); constraint int_le(c, 0);";
+  BStore bs = create_and_interpret_and_tell<BStore>(fzn);
+  IStore aos = create_and_interpret_and_tell<IStore>(fzn);
+  EXPECT_EQ(bs.vars(), aos.vars());
+  for(int i = 0; i < bs.vars(); ++i) {
+    EXPECT_EQ(bs[i], aos[i]);
+  }
+  EXPECT_TRUE(bs.is_true(0));
+  EXPECT_TRUE(bs.is_false(2));
+  EXPECT_EQ(BStore(aos), bs);
+  BStore bot = create_and_interpret_and_tell<BStore>("var 0..1: a; constraint int_ge(a, 1); constraint int_le(a, 0);");
+  EXPECT_TRUE(bot.is_bot());
+}
+
+TEST(VStoreBoolTest, Embed) {
+  BStore s(0, 130);
+  EXPECT_TRUE(s.is_top());
+  EXPECT_FALSE(s.embed(0, Itv(0, 10)));
+  EXPECT_TRUE(s.embed(0, Itv(1, 10)));
+  EXPECT_EQ(s[0], Itv(1, 1));
+  EXPECT_TRUE(s.embed(129, Itv(-5, 0)));
+  EXPECT_EQ(s.project(AVar(0, 129)), Itv(0, 0));
+  EXPECT_EQ(s[64], Itv(0, 1));
+  EXPECT_FALSE(s.is_bot());
+  EXPECT_TRUE(s.embed(64, Itv(2, 3)));
+  EXPECT_TRUE(s.is_bot());
+  EXPECT_TRUE(s[64].is_bot());
+}
+
+TEST(VStoreBoolTest, SnapshotRestore) {
+  BStore s(0, 100);
+  s.embed(70, Itv(1, 1));
+  BStore::snapshot_type<> snap = s.snapshot();
+  for(int j = 0; j < 3; ++j) {
+    EXPECT_TRUE(s.embed(0, Itv(0, 0)));
+    EXPECT_TRUE(s.embed(70, Itv(0, 0)));
+    EXPECT_TRUE(s.is_bot());
+    s.restore(snap);
+    EXPECT_FALSE(s.is_bot());
+    EXPECT_EQ(s[0], Itv(0, 1));
+    EXPECT_EQ(s[70], Itv(1, 1));
+  }
+}
+
+TEST(VStoreBoolTest, LatticeOperations) {
+  BStore a(0, 70);
+  a.embed(0, Itv(0, 0));
+  a.embed(69, Itv(1, 1));
+  BStore b(0, 70);
+  b.embed(1, Itv(1, 1));
+  BStore met(a);
+  EXPECT_TRUE(met.meet(b));
+  EXPECT_EQ(met[0], Itv(0, 0));
+  EXPECT_EQ(met[1], Itv(1, 1));
+  EXPECT_EQ(met[69], Itv(1, 1));
+  BStore joined(met);
+  EXPECT_TRUE(joined.join(b));
+  EXPECT_EQ(joined[0], Itv(0, 1));
+  EXPECT_EQ(joined[1], Itv(1, 1));
+  EXPECT_TRUE(met <= a);
+  EXPECT_TRUE(met < a);
+  EXPECT_TRUE(met <= joined);
+  EXPECT_FALSE(a <= b);
+  EXPECT_TRUE(a == BStore(a));
+  EXPECT_TRUE(BStore::bot() <= a);
+  EXPECT_FALSE(met.is_extractable(AtomicExtraction{}));
+  for(int i = 0; i < 70; ++i) {
+    met.embed(i, Itv(0, 1));
+    met.embed(i, Itv(i % 2, i % 2));
+  }
+  EXPECT_FALSE(met.is_bot());
+  EXPECT_TRUE(met.is_extractable(AtomicExtraction{}));
+  BStore full(0, 70);
+  for(int i = 0; i < 70; ++i) {
+    full.embed(i, Itv(i % 2, i % 2));
+  }
+  EXPECT_TRUE(full.is_extractable(AtomicExtraction{}));
+  BStore other(full);
+  other.embed(3, Itv(0, 0));
+  EXPECT_TRUE(full.meet(other));
+  EXPECT_TRUE(full.is_bot());
+}
@@ -0,0 +1,143 @@
+// Copyright 2024 Pierre Talbot
+
+#include "lala/vstore_dbitset.hpp"
+#include "abstract_testing.hpp"
+
+using DBit = DBitset<standard_allocator>;
+using AStore = VStore<DBit, standard_allocator>;
+using DStore = VStoreDBitset<standard_allocator>;
+using Tell = DStore::tell_type<standard_allocator>;
+using VarDom = DStore::var_dom<standard_allocator>;
+
+TEST(VStoreDBitsetTest, Interpretation) {
+  const char* fzn = "var 0..4000: a; var -100..100: b; var int: c; constraint int_ne(a, 1000); constraint set_in(b, {-100, 5, 100}); constraint int_ge(c, 10);";
+  DStore ds = create_and_interpret_and_tell<DStore>(fzn);
+  AStore aos = create_and_interpret_and_tell<AStore>(fzn);
+  EXPECT_EQ(ds.vars(), aos.vars());
+  for(int i = 0; i < ds.vars(); ++i) {
+    EXPECT_EQ(ds[i], aos[i]);
+  }
+  EXPECT_EQ(DStore(aos), ds);
+  DStore bot = create_and_interpret_and_tell<DStore>("var 0..4000: a; constraint int_ge(a, 3000); constraint int_le(a, 2000);");
+  EXPECT_TRUE(bot.is_bot());
+}
+
+TEST(VStoreDBitsetTest, DeduceExtendsWindows) {
+  DStore s(0, 3);
+  EXPECT_TRUE(s.is_top());
+  EXPECT_EQ(s.pool_size(), 0);
+  Tell t;
+  DBit ge0;
+  ge0.meet_lb(DBit::LB(0));
+  DBit le4000;
+  le4000.meet_ub(DBit::UB(4000));
+  t.push_back(VarDom(AVar(0, 0), ge0));
+  t.push_back(VarDom(AVar(0, 0), le4000));
+  t.push_back(VarDom(AVar(0, 2), DBit::from_set({-64, 64})));
+  t.push_back(VarDom(AVar(0, 0), DBit(1000).complement()));
+  EXPECT_TRUE(s.deduce(t));
+  EXPECT_FALSE(s.deduce(t));
+  EXPECT_EQ(s.window_of(0).n, 4001);
+  EXPECT_EQ(s.window_of(2).n, 129);
+  EXPECT_EQ(s.window_of(2).offset, s.window_of(0).offset + 63);
+  EXPECT_EQ(s.pool_size(), 63 + 3);
+  DBit expected = fmeet(DBit(0, 4000), DBit(1000).complement());
+  EXPECT_EQ(s[0], expected);
+  EXPECT_TRUE(s[1].is_top());
+  EXPECT_EQ(s[2], DBit::from_set({-64, 64}));
+  // New variables are added on demand.
+  Tell t2;
+  t2.push_back(VarDom(AVar(0, 4), DBit(7)));
+  EXPECT_TRUE(s.deduce(t2));
+  EXPECT_EQ(s.vars(), 5);
+  EXPECT_EQ(s[4], DBit(7));
+  EXPECT_EQ(s[0], expected);
+}
+
+TEST(VStoreDBitsetTest, Embed) {
+  DStore s(0, 2);
+  Tell t;
+  t.push_back(VarDom(AVar(0, 0), DBit(-1000, 1000)));
+  t.push_back(VarDom(AVar(0, 1), DBit(0, 1)));
+  s.deduce(t);
+  EXPECT_FALSE(s.embed(0, DBit(-2000, 2000)));
+  EXPECT_TRUE(s.embed(0, DBit(0).complement()));
+  EXPECT_TRUE(s.embed(0, DBit(-500, 500)));
+  EXPECT_EQ(s[0], fmeet(DBit(-500, 500), DBit(0).complement()));
+  EXPECT_EQ(s.project(AVar(0, 0)).lb(), DBit::LB(-500));
+  EXPECT_FALSE(s.is_bot());
+  EXPECT_TRUE(s.embed(1, DBit(5, 10)));
+  EXPECT_TRUE(s.is_bot());
+}
+
+TEST(VStoreDBitsetTest, SnapshotRestore) {
+  DStore s(0, 2);
+  Tell t;
+  t.push_back(VarDom(AVar(0, 0), DBit(0, 3000)));
+  t.push_back(VarDom(AVar(0, 1), DBit(-10, 10)));
+  s.deduce(t);
+  DStore::snapshot_type<> snap = s.snapshot();
+  for(int j = 0; j < 3; ++j) {
+    EXPECT_TRUE(s.embed(0, DBit::from_set({7, 2999})));
+    EXPECT_TRUE(s.embed(1, DBit(11)));
+    EXPECT_TRUE(s.is_bot());
+    s.restore(snap);
+    EXPECT_FALSE(s.is_bot());
+    EXPECT_EQ(s[0], DBit(0, 3000));
+    EXPECT_EQ(s[1], DBit(-10, 10));
+  }
+}
+
+TEST(VStoreDBitsetTest, LatticeOperations) {
+  DStore a(0, 2);
+  Tell t;
+  t.push_back(VarDom(AVar(0, 0), DBit(0, 200)));
+  t.push_back(VarDom(AVar(0, 1), DBit(0, 200)));
+  a.deduce(t);
+  DStore b(a);
+  EXPECT_TRUE(a == b);
+  a.embed(0, DBit(100).complement());
+  b.embed(1, DBit(150, 200));
+  DStore met(a);
+  EXPECT_TRUE(met.meet(b));
+  EXPECT_EQ(met[0], fmeet(DBit(0, 200), DBit(100).complement()));
+  EXPECT_EQ(met[1], DBit(150, 200));
+  DStore joined(met);
+  EXPECT_TRUE(joined.join(b));
+  EXPECT_EQ(joined[0], DBit(0, 200));
+  EXPECT_EQ(joined[1], DBit(150, 200));
+  EXPECT_TRUE(met <= a);
+  EXPECT_TRUE(met < a);
+  EXPECT_TRUE(met <= joined);
+  EXPECT_FALSE(a <= b);
+  EXPECT_TRUE(DStore::bot() <= a);
+  // Stores with different windows.
+  DStore c(0, 2);
+  Tell t2;
+  t2.push_back(VarDom(AVar(0, 0), DBit(50, 120)));
+  c.deduce(t2);
+  DStore d(a);
+  EXPECT_TRUE(d.meet(c));
+  EXPECT_EQ(d[0], fmeet(DBit(50, 120), DBit(100).complement()));
+  EXPECT_EQ(d[1], DBit(0, 200));
+  EXPECT_TRUE(d <= c);
+  EXPECT_FALSE(c <= d);
+}
+
+TEST(VStoreDBitsetTest, Extraction) {
+  DStore s(0, 2);
+  Tell t;
+  t.push_back(VarDom(AVar(0, 0), DBit(0, 3000)));
+  t.push_back(VarDom(AVar(0, 1), DBit(-10, 10)));
+  s.deduce(t);
+  EXPECT_TRUE(s.is_extractable());
+  EXPECT_FALSE(s.is_extractable(AtomicExtraction{}));
+  s.embed(0, DBit(2048));
+  EXPECT_FALSE(s.is_extractable(AtomicExtraction{}));
+  s.embed(1, DBit(-3));
+  EXPECT_TRUE(s.is_extractable(AtomicExtraction{}));
+  DStore e(0);
+  s.extract(e);
+  EXPECT_EQ(e[0], DBit(2048));
+  EXPECT_EQ(e[1], DBit(-3));
+}
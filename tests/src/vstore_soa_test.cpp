@@ -0,0 +1,88 @@
+// Copyright 2024 Pierre Talbot
+
+#include "lala/vstore_soa.hpp"
+#include "lala/interval.hpp"
+#include "abstract_testing.hpp"
+
+using zlb = local::ZLB;
+using zub = local::ZUB;
+using Itv = Interval<zlb>;
+using IStore = VStore<Itv, standard_allocator>;
+using SoAStore = VStoreSoA<Itv, standard_allocator>;
+
+void expect_same_store(const SoAStore& soa, const IStore& aos) {
+  EXPECT_EQ(soa.vars(), aos.vars());
+  EXPECT_EQ(soa.is_bot(), aos.is_bot());
+  for(int i = 0; i < soa.vars(); ++i) {
+    EXPECT_EQ(soa[i], aos[i]);
+    EXPECT_EQ(soa.lb(i), aos[i].lb());
+    EXPECT_EQ(soa.ub(i), aos[i].ub());
+  }
+}
+
+TEST(VStoreSoATest, Interpretation) {
+  const char* fzn = "var 5..10: x; var -5..5: y; var int: z; constraint int_le(z, 1);";
+  SoAStore soa = create_and_interpret_and_tell<SoAStore>(fzn);
+  IStore aos = create_and_interpret_and_tell<IStore>(fzn);
+  expect_same_store(soa, aos);
+  expect_same_store(SoAStore(aos), aos);
+  SoAStore bot = create_and_interpret_and_tell<SoAStore>("var int: x; constraint int_gt(x, 4); constraint int_lt(x, 4);");
+  EXPECT_TRUE(bot.is_bot());
+}
+
+TEST(VStoreSoATest, EmbedAndBounds) {
+  SoAStore s(0, 3);
+  EXPECT_TRUE(s.is_top());
+  EXPECT_TRUE(s.embed(0, Itv(0, 10)));
+  EXPECT_FALSE(s.embed(0, Itv(-1, 11)));
+  EXPECT_TRUE(s.embed_lb(1, zlb(2)));
+  EXPECT_TRUE(s.embed_ub(1, zub(4)));
+  EXPECT_EQ(s[1], Itv(2, 4));
+  EXPECT_EQ(s.project(AVar(0, 1)), Itv(2, 4));
+  EXPECT_FALSE(s.is_bot());
+  EXPECT_TRUE(s.embed_ub(1, zub(1)));
+  EXPECT_TRUE(s.is_bot());
+}
+
+TEST(VStoreSoATest, SnapshotRestore) {
+  SoAStore s(0, 2);
+  s.embed(0, Itv(0, 10));
+  s.embed(1, Itv(0, 10));
+  SoAStore::snapshot_type<> snap = s.snapshot();
+  for(int j = 0; j < 3; ++j) {
+    EXPECT_TRUE(s.embed(0, Itv(2, 3)));
+    EXPECT_TRUE(s.embed(1, Itv::bot()));
+    EXPECT_TRUE(s.is_bot());
+    s.restore(snap);
+    EXPECT_FALSE(s.is_bot());
+    EXPECT_EQ(s[0], Itv(0, 10));
+    EXPECT_EQ(s[1], Itv(0, 10));
+  }
+}
+
+TEST(VStoreSoATest, LatticeOperations) {
+  SoAStore a(0, 2);
+  a.embed(0, Itv(0, 10));
+  a.embed(1, Itv(5, 5));
+  SoAStore b(0, 2);
+  b.embed(0, Itv(2, 12));
+  SoAStore met(a);
+  EXPECT_TRUE(met.meet(b));
+  EXPECT_EQ(met[0], Itv(2, 10));
+  EXPECT_EQ(met[1], Itv(5, 5));
+  SoAStore joined(a);
+  EXPECT_TRUE(joined.join(b));
+  EXPECT_EQ(joined[0], Itv(0, 12));
+  EXPECT_TRUE(joined[1].is_top());
+  EXPECT_TRUE(met <= a);
+  EXPECT_TRUE(met < a);
+  EXPECT_TRUE(a <= joined);
+  EXPECT_FALSE(a <= b);
+  EXPECT_TRUE(a == SoAStore(a));
+  EXPECT_TRUE(SoAStore::bot() <= a);
+  EXPECT_FALSE(a.is_extractable(AtomicExtraction{}));
+  EXPECT_TRUE(met.embed(0, Itv(3, 3)));
+  EXPECT_TRUE(met.is_extractable(AtomicExtraction{}));
+  EXPECT_TRUE(met.embed(0, Itv(4, 4)));
+  EXPECT_FALSE(met.is_extractable());
+}
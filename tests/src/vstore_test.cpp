@@ -70,6 +70,152 @@ TEST(VStoreTest, SnapshotRestore) {
   EXPECT_FALSE(vstore.is_bot());
 }
 
+TEST(VStoreTest, PushPopLevel) {
+  IStore vstore = create_and_interpret_and_tell<IStore>("var 0..10: x; var 0..10: y; var 0..10: z;");
+  vstore.push_level();
+  EXPECT_TRUE(vstore.embed(0, Itv(2, 8)));
+  EXPECT_TRUE(vstore.embed(0, Itv(3, 7)));
+  EXPECT_EQ(vstore.trail_size(), 1); // `x` is trailed only once per level.
+  vstore.push_level();
+  EXPECT_TRUE(vstore.embed(0, Itv(5, 5)));
+  EXPECT_TRUE(vstore.embed(2, Itv::bot()));
+  EXPECT_TRUE(vstore.is_bot());
+  EXPECT_EQ(vstore.trail_size(), 3);
+  vstore.pop_level();
+  EXPECT_FALSE(vstore.is_bot());
+  EXPECT_EQ(vstore[0], Itv(3, 7));
+  EXPECT_EQ(vstore[2], Itv(0, 10));
+  EXPECT_EQ(vstore.trail_size(), 1);
+  // After backtracking, the modifications are trailed again in the current level.
+  EXPECT_TRUE(vstore.embed(0, Itv(4, 7)));
+  EXPECT_TRUE(vstore.embed(1, Itv(4, 7)));
+  vstore.pop_level();
+  EXPECT_EQ(vstore.num_levels(), 0);
+  EXPECT_EQ(vstore.trail_size(), 0);
+  for(int i = 0; i < 3; ++i) {
+    EXPECT_EQ(vstore[i], Itv(0, 10));
+  }
+  // Without levels, nothing is trailed.
+  EXPECT_TRUE(vstore.embed(0, Itv(1, 1)));
+  EXPECT_EQ(vstore.trail_size(), 0);
+}
+
+TEST(VStoreTest, PushPopLevelNewVariables) {
+  ZStore vstore = create_and_interpret_and_tell<ZStore>("var int: x; constraint int_ge(x, 1);");
+  vstore.push_level();
+  ZStore::tell_type<standard_allocator> tell;
+  tell.push_back(ZStore::var_dom<standard_allocator>(AVar(vstore.aty(), 0), zlb(2)));
+  tell.push_back(ZStore::var_dom<standard_allocator>(AVar(vstore.aty(), 1), zlb(3)));
+  EXPECT_TRUE(vstore.deduce(tell));
+  EXPECT_EQ(vstore.vars(), 2);
+  vstore.pop_level();
+  EXPECT_EQ(vstore.vars(), 1);
+  EXPECT_EQ(vstore[0], zlb(1));
+}
+
+TEST(VStoreTest, TrackChanges) {
+  IStore vstore = create_and_interpret_and_tell<IStore>("var 0..10: x; var 0..10: y; var 0..10: z;");
+  vstore.track_changes();
+  EXPECT_TRUE(vstore.changed_vars().empty());
+  EXPECT_TRUE(vstore.embed(2, Itv(2, 8)));
+  EXPECT_FALSE(vstore.embed(0, Itv(0, 10)));
+  EXPECT_TRUE(vstore.changed(2));
+  EXPECT_FALSE(vstore.changed(0));
+  IStore other = create_and_interpret_and_tell<IStore>("var 0..10: x; var 0..10: y; var 0..10: z;");
+  other.embed(0, Itv(1, 10));
+  other.embed(2, Itv(3, 8));
+  EXPECT_TRUE(vstore.meet(other));
+  battery::vector<int> changed = vstore.changed_vars();
+  EXPECT_EQ(changed.size(), 2);
+  EXPECT_EQ(changed[0], 0);
+  EXPECT_EQ(changed[1], 2);
+  vstore.clear_changes();
+  EXPECT_TRUE(vstore.changed_vars().empty());
+  // New variables created by `deduce` are tracked too.
+  IStore::tell_type<standard_allocator> tell;
+  tell.push_back(IStore::var_dom<standard_allocator>(AVar(vstore.aty(), 3), Itv(1, 1)));
+  EXPECT_TRUE(vstore.deduce(tell));
+  changed = vstore.changed_vars();
+  EXPECT_EQ(changed.size(), 1);
+  EXPECT_EQ(changed[0], 3);
+  vstore.clear_changes();
+  // Backtracking marks the restored variables.
+  vstore.push_level();
+  vstore.embed(1, Itv(5, 5));
+  vstore.clear_changes();
+  vstore.pop_level();
+  EXPECT_TRUE(vstore.changed(1));
+  vstore.untrack_changes();
+  EXPECT_FALSE(vstore.is_tracking_changes());
+}
+
+TEST(VStoreTest, PagedSnapshots) {
+  const int n = 1000;
+  const int pages = (n + IStore::snapshot_page_size - 1) / IStore::snapshot_page_size;
+  IStore vstore(0, n);
+  for(int i = 0; i < n; ++i) {
+    vstore.embed(i, Itv(0, 10));
+  }
+  IStore::paged_snapshot_type root = vstore.paged_snapshot();
+  EXPECT_EQ(root.size(), n);
+  EXPECT_EQ(root.pages.size(), pages);
+  // Only the modified page is copied, the others are shared with the previous snapshot.
+  EXPECT_TRUE(vstore.embed(300, Itv(5, 5)));
+  IStore::paged_snapshot_type child = vstore.paged_snapshot();
+  for(int p = 0; p < pages; ++p) {
+    EXPECT_EQ(child.pages[p].get() == root.pages[p].get(), p != 300 / IStore::snapshot_page_size);
+  }
+  EXPECT_TRUE(vstore.embed(999, Itv::bot()));
+  EXPECT_TRUE(vstore.is_bot());
+  vstore.restore(root);
+  EXPECT_FALSE(vstore.is_bot());
+  EXPECT_EQ(vstore[300], Itv(0, 10));
+  EXPECT_EQ(vstore[999], Itv(0, 10));
+  // A paged snapshot can be restored from any state, not only from its descendants.
+  vstore.embed(0, Itv(1, 1));
+  vstore.restore(child);
+  EXPECT_EQ(vstore[0], Itv(0, 10));
+  EXPECT_EQ(vstore[300], Itv(5, 5));
+  IStore::paged_snapshot_type same = vstore.paged_snapshot();
+  for(int p = 0; p < pages; ++p) {
+    EXPECT_EQ(same.pages[p].get(), child.pages[p].get());
+  }
+  // New variables created by `deduce` are copied in the next snapshot, and removed by `restore`.
+  IStore::tell_type<standard_allocator> tell;
+  tell.push_back(IStore::var_dom<standard_allocator>(AVar(vstore.aty(), n), Itv(1, 1)));
+  EXPECT_TRUE(vstore.deduce(tell));
+  IStore::paged_snapshot_type grown = vstore.paged_snapshot();
+  EXPECT_EQ(grown.pages.size(), pages);
+  EXPECT_NE(grown.pages[pages - 1].get(), same.pages[pages - 1].get());
+  EXPECT_EQ(grown.pages[0].get(), same.pages[0].get());
+  vstore.restore(root);
+  EXPECT_EQ(vstore.vars(), n);
+  EXPECT_EQ(vstore[300], Itv(0, 10));
+  vstore.restore(grown);
+  EXPECT_EQ(vstore.vars(), n + 1);
+  EXPECT_EQ(vstore[n], Itv(1, 1));
+  vstore.forget_paged_snapshot();
+  EXPECT_NE(vstore.paged_snapshot().pages[0].get(), grown.pages[0].get());
+}
+
+TEST(VStoreTest, PagedSnapshotsMeetJoin) {
+  // `meet` and `join` of whole stores must flag the modified pages, even when they are vectorized.
+  ZStore vstore(0, 10);
+  ZStore root = vstore;
+  ZStore::paged_snapshot_type parent = vstore.paged_snapshot();
+  ZStore other(0, 10);
+  other.embed(3, zlb(7));
+  EXPECT_TRUE(vstore.meet(other));
+  ZStore::paged_snapshot_type child = vstore.paged_snapshot();
+  EXPECT_NE(child.pages[0].get(), parent.pages[0].get());
+  EXPECT_EQ((*child.pages[0])[3], zlb(7));
+  EXPECT_TRUE((*parent.pages[0])[3].is_top());
+  EXPECT_TRUE(vstore.join(root));
+  ZStore::paged_snapshot_type joined = vstore.paged_snapshot();
+  EXPECT_NE(joined.pages[0].get(), child.pages[0].get());
+  EXPECT_TRUE((*joined.pages[0])[3].is_top());
+}
+
 TEST(VStoreTest, Extract) {
   ZStore vstore = create_and_interpret_and_tell<ZStore>("var int: x; var int: y; constraint int_ge(x, 1); constraint int_ge(y, 1);");
   ZStore copy(vstore, AbstractDeps<standard_allocator>(standard_allocator{}));
@@ -82,6 +228,44 @@ TEST(VStoreTest, Extract) {
   }
 }
 
+TEST(VStoreTest, ExtractDifferentSize) {
+  // Extracting into a larger store, which tracks changes, takes paged snapshots and has levels.
+  IStore small = create_and_interpret_and_tell<IStore>("var 0..10: x; var 0..10: y; var 0..10: z;");
+  IStore large(0, 1000);
+  large.track_changes();
+  IStore::paged_snapshot_type root = large.paged_snapshot();
+  large.push_level();
+  large.embed(999, Itv(1, 1));
+  EXPECT_TRUE(small.is_extractable());
+  small.extract(large);
+  EXPECT_EQ(large.vars(), 3);
+  EXPECT_EQ(large.num_levels(), 0);
+  EXPECT_EQ(large.changed_vars().size(), 3);
+  large.clear_changes();
+  large.push_level();
+  EXPECT_TRUE(large.embed(2, Itv(2, 8)));
+  EXPECT_TRUE(large.changed(2));
+  EXPECT_NE(large.paged_snapshot().pages[0].get(), root.pages[0].get());
+  large.pop_level();
+  EXPECT_EQ(large[2], Itv(0, 10));
+  // Extracting into a smaller store, then adding variables.
+  IStore tiny(0, 1);
+  tiny.track_changes();
+  tiny.paged_snapshot();
+  large.extract(tiny);
+  EXPECT_EQ(tiny.vars(), 3);
+  tiny.clear_changes();
+  EXPECT_TRUE(tiny.embed(2, Itv(3, 3)));
+  IStore::tell_type<standard_allocator> tell;
+  tell.push_back(IStore::var_dom<standard_allocator>(AVar(tiny.aty(), 3), Itv(1, 1)));
+  EXPECT_TRUE(tiny.deduce(tell));
+  battery::vector<int> changed = tiny.changed_vars();
+  EXPECT_EQ(changed.size(), 2);
+  EXPECT_EQ(changed[0], 2);
+  EXPECT_EQ(changed[1], 3);
+  EXPECT_EQ(tiny.paged_snapshot().size(), 4);
+}
+
 template<class L>
 L interpret_and_test(const char* fzn, const vector<typename L::universe_type>& expect) {
   L s = create_and_interpret_and_tell<L>(fzn);